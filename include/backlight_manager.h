@@ -0,0 +1,117 @@
+/*********************************************************************************************************
+ * Backlight Dimming & Display Sleep Manager
+ *
+ * Description:
+ *   Tracks distance activity and steps the display through ACTIVE -> DIMMED -> ASLEEP when nothing
+ *   significant changes for a configurable time, waking straight back to ACTIVE on motion. It also keeps
+ *   a running estimate of the energy saved compared to a backlight that is always on at full brightness.
+ *
+ * How It Works:
+ *   1. Activity: A reading counts as activity when it moves more than thresholdMm away from the last
+ *      active reading (small jitter from a static target does not keep the screen awake)
+ *   2. State Machine: Inactivity longer than dimAfterMs dims the backlight, longer than sleepAfterMs puts
+ *      the panel to sleep. Any activity returns to ACTIVE immediately. tick() advances the idle timer
+ *      when there is no reading to feed (timeouts, blanked readings, no measurement this pass)
+ *   3. Energy: Time spent in each state is weighted by the configured power draw of that state
+ *
+ * Notes:
+ *   - Pure logic with time passed in by the caller, so recorded traces can be replayed on host
+ *   - sleepAfterMs must be greater than dimAfterMs
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+enum class DisplayPower : uint8_t {
+  ACTIVE, // full brightness, rendering
+  DIMMED, // reduced brightness, rendering
+  ASLEEP  // backlight off, panel asleep, rendering suspended
+};
+
+struct BacklightConfig {
+  uint32_t dimAfterMs;   // inactivity before dimming
+  uint32_t sleepAfterMs; // inactivity before sleeping
+  int32_t thresholdMm;   // minimum change that counts as activity
+  uint8_t activeDuty;    // PWM duty when active (0-255)
+  uint8_t dimDuty;       // PWM duty when dimmed (0-255)
+  uint16_t activeMw;     // estimated display power when active (mW)
+  uint16_t dimMw;        // estimated display power when dimmed (mW)
+  uint16_t asleepMw;     // estimated display power when asleep (mW)
+};
+
+class BacklightManager {
+public:
+  explicit BacklightManager(const BacklightConfig& config)
+    : cfg(config), state(DisplayPower::ACTIVE), referenceMm(-1), lastActivityMs(0), lastUpdateMs(0),
+      savedMj(0), savedUj(0) {}
+
+  // Feed a reading, returns true if the power state changed
+  bool update(uint32_t nowMs, int32_t distanceMm) {
+    int32_t change = distanceMm - referenceMm;
+    if (change < 0) change = -change;
+
+    if (referenceMm < 0 || change > cfg.thresholdMm) {
+      referenceMm = distanceMm;
+      lastActivityMs = nowMs;
+    }
+    return tick(nowMs);
+  }
+
+  // Advance the idle timer without a reading, returns true if the power state changed
+  bool tick(uint32_t nowMs) {
+    accumulateEnergy(nowMs);
+
+    DisplayPower next = DisplayPower::ACTIVE;
+    uint32_t idleMs = nowMs - lastActivityMs;
+    if (idleMs >= cfg.sleepAfterMs) {
+      next = DisplayPower::ASLEEP;
+    }
+    else if (idleMs >= cfg.dimAfterMs) {
+      next = DisplayPower::DIMMED;
+    }
+
+    if (next == state) return false;
+    state = next;
+    return true;
+  }
+
+  DisplayPower powerState() const { return state; }
+  bool renderingEnabled() const { return state != DisplayPower::ASLEEP; }
+
+  // PWM duty for the current state
+  uint8_t duty() const {
+    switch (state) {
+      case DisplayPower::ACTIVE: return cfg.activeDuty;
+      case DisplayPower::DIMMED: return cfg.dimDuty;
+      default:                   return 0;
+    }
+  }
+
+  // Estimated energy saved versus always-on full brightness (millijoules)
+  uint64_t savedMillijoules() const { return savedMj; }
+
+private:
+  void accumulateEnergy(uint32_t nowMs) {
+    uint32_t dtMs = nowMs - lastUpdateMs;
+    lastUpdateMs = nowMs;
+
+    uint16_t mw = cfg.activeMw;
+    if (state == DisplayPower::DIMMED) mw = cfg.dimMw;
+    else if (state == DisplayPower::ASLEEP) mw = cfg.asleepMw;
+
+    // mW * ms = µJ
+    uint64_t uj = savedUj + (uint64_t)(cfg.activeMw - mw) * dtMs;
+    savedMj += uj / 1000;
+    savedUj = uj % 1000;
+  }
+
+  BacklightConfig cfg;
+  DisplayPower state;
+  int32_t referenceMm;
+  uint32_t lastActivityMs;
+  uint32_t lastUpdateMs;
+  uint64_t savedMj;
+  uint32_t savedUj; // remainder below 1 mJ
+};
@@ -0,0 +1,185 @@
+/*********************************************************************************************************
+ * Batched Sample Publisher with Store-and-Forward
+ *
+ * Description:
+ *   Decouples publishing from acquisition. The acquisition loop drops compact sample records into a
+ *   lock-free ring; a publisher task on the other core packs them into batches and hands each batch to a
+ *   sink (the MQTT client on the device, a fake broker in test/test_batch_publisher). While the connection is down the
+ *   ring keeps filling, and once it is back the backlog drains a few batches per pass, oldest first.
+ *
+ * How It Works:
+ *   1. Ring: Single-producer single-consumer ring of SampleRecords. The producer never waits; when the
+ *      ring is full new records are counted as dropped (the buffered backlog is kept intact)
+ *   2. Batch: Up to BATCH_MAX_SAMPLES records are encoded as a little-endian binary payload:
+ *        "S1" | uint32 first timestamp (ms) | uint16 count | count x (uint16 dt ms, uint16 mm, flags, conf)
+ *      A sample more than 65s after the previous one ends the batch (dt must fit 16 bits)
+ *   3. Compressed: With compressed set the records are written as "S2" | uint16 count | bit-packed
+ *      stream (see sample_codec.h), typically 1-3 bytes per sample instead of 6. A batch ends early if the
+ *      next sample would not fit the payload buffer
+ *   4. Backpressure: A batch is removed from the ring only after the sink accepts it. A refused publish
+ *      ends the pass, and at most maxBatches are sent per pass so the drain never starves the sink's own
+ *      housekeeping (keep-alives, acknowledgements)
+ *
+ * Notes:
+ *   - S1 payload size is 8 + 6 x samples bytes (776 bytes for a full batch of 128)
+ *   - decodeBatch() is the matching reader for both formats, used by the host ingest server (tools/ingest)
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "sample_codec.h"
+
+#define BATCH_MAX_SAMPLES 128       // samples per payload
+#define BATCH_HEADER_BYTES 8        // "S1", first timestamp, count
+#define BATCH_RECORD_BYTES 6        // dt, mm, flags, confidence
+#define BATCH_PAYLOAD_MAX (BATCH_HEADER_BYTES + BATCH_MAX_SAMPLES * BATCH_RECORD_BYTES)
+#define BATCH_COMPRESSED_HEADER_BYTES 4 // "S2", count
+
+// Decode a batch payload, calling out(record) per sample; returns the sample count or -1 if malformed
+template <class Output>
+int decodeBatch(const uint8_t* payload, size_t length, Output out) {
+  if (length >= BATCH_COMPRESSED_HEADER_BYTES && payload[0] == 'S' && payload[1] == '2') {
+    uint16_t samples = (uint16_t)(payload[2] | (payload[3] << 8));
+    if (samples > BATCH_MAX_SAMPLES) return -1;
+    SampleDecoder decoder(payload + BATCH_COMPRESSED_HEADER_BYTES, length - BATCH_COMPRESSED_HEADER_BYTES,
+                          samples);
+    SampleRecord record;
+    uint16_t decoded = 0;
+    while (decoder.next(record)) {
+      out(record);
+      decoded++;
+    }
+    return decoded == samples ? samples : -1;
+  }
+
+  if (length < BATCH_HEADER_BYTES || payload[0] != 'S' || payload[1] != '1') return -1;
+  uint16_t samples = (uint16_t)(payload[6] | (payload[7] << 8));
+  if (samples > BATCH_MAX_SAMPLES) return -1;
+  if (length != BATCH_HEADER_BYTES + (size_t)samples * BATCH_RECORD_BYTES) return -1;
+
+  SampleRecord record;
+  record.timestampMs = (uint32_t)payload[2] | ((uint32_t)payload[3] << 8) | ((uint32_t)payload[4] << 16) |
+                       ((uint32_t)payload[5] << 24);
+  const uint8_t* p = payload + BATCH_HEADER_BYTES;
+  for (uint16_t i = 0; i < samples; i++, p += BATCH_RECORD_BYTES) {
+    record.timestampMs += (uint32_t)(p[0] | (p[1] << 8));
+    record.distanceMm = (uint16_t)(p[2] | (p[3] << 8));
+    record.flags = p[4];
+    record.confidence = p[5];
+    out(record);
+  }
+  return samples;
+}
+
+template <uint16_t CAPACITY>
+class BatchPublisher {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+public:
+  explicit BatchPublisher(bool compressed = false)
+    : head(0), tail(0), dropped(0), batches(0), compress(compressed) {}
+
+  // Producer side (acquisition): never blocks, returns false if the record was dropped
+  bool push(const SampleRecord& record) {
+    uint32_t h = head;
+    if (h - tail >= CAPACITY) {
+      dropped = dropped + 1;
+      return false;
+    }
+    ring[h & (CAPACITY - 1)] = record;
+    __sync_synchronize();
+    head = h + 1;
+    return true;
+  }
+
+  // Consumer side: publish up to maxBatches batches through sink.publish(payload, length)
+  template <class Sink>
+  uint8_t drain(Sink& sink, uint8_t maxBatches) {
+    uint8_t sent = 0;
+    while (sent < maxBatches) {
+      uint16_t samples;
+      size_t length = compress ? encodeCompressed(payload, samples) : encode(payload, samples);
+      if (samples == 0 || !sink.publish(payload, length)) break;
+
+      // Accepted: release the records
+      __sync_synchronize();
+      tail = tail + samples;
+      batches++;
+      sent++;
+    }
+    return sent;
+  }
+
+  uint32_t pending() const { return head - tail; }
+  uint32_t droppedSamples() const { return dropped; }
+  uint32_t batchesSent() const { return batches; }
+
+private:
+  // Encode the oldest buffered records into buf, returns the payload length
+  size_t encode(uint8_t* buf, uint16_t& samples) const {
+    uint32_t available = head - tail;
+    __sync_synchronize();
+    samples = 0;
+    if (available == 0) return 0;
+
+    uint32_t first = ring[tail & (CAPACITY - 1)].timestampMs;
+    uint32_t previous = first;
+    size_t pos = BATCH_HEADER_BYTES;
+
+    while (samples < BATCH_MAX_SAMPLES && samples < available) {
+      const SampleRecord& record = ring[(tail + samples) & (CAPACITY - 1)];
+      uint32_t dt = record.timestampMs - previous;
+      if (dt > 0xFFFF) break;
+
+      put16(buf + pos, (uint16_t)dt);
+      put16(buf + pos + 2, record.distanceMm);
+      buf[pos + 4] = record.flags;
+      buf[pos + 5] = record.confidence;
+      pos += BATCH_RECORD_BYTES;
+      previous = record.timestampMs;
+      samples++;
+    }
+
+    buf[0] = 'S';
+    buf[1] = '1';
+    put16(buf + 2, first & 0xFFFF);
+    put16(buf + 4, first >> 16);
+    put16(buf + 6, samples);
+    return pos;
+  }
+
+  // Same as encode() in the bit-packed S2 format
+  size_t encodeCompressed(uint8_t* buf, uint16_t& samples) const {
+    uint32_t available = head - tail;
+    __sync_synchronize();
+    SampleEncoder encoder(buf + BATCH_COMPRESSED_HEADER_BYTES,
+                          BATCH_PAYLOAD_MAX - BATCH_COMPRESSED_HEADER_BYTES);
+    while (encoder.count() < BATCH_MAX_SAMPLES && encoder.count() < available) {
+      if (!encoder.append(ring[(tail + encoder.count()) & (CAPACITY - 1)])) break;
+    }
+    samples = (uint16_t)encoder.count();
+    if (samples == 0) return 0;
+
+    buf[0] = 'S';
+    buf[1] = '2';
+    put16(buf + 2, samples);
+    return BATCH_COMPRESSED_HEADER_BYTES + encoder.finish();
+  }
+
+  static void put16(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+  }
+
+  SampleRecord ring[CAPACITY];
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  volatile uint32_t dropped;
+  uint32_t batches;
+  bool compress;
+  uint8_t payload[BATCH_PAYLOAD_MAX];
+};
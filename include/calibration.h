@@ -0,0 +1,114 @@
+/*********************************************************************************************************
+ * Per-Unit Distance Calibration (Offset & Gain)
+ *
+ * Description:
+ *   Each HC-SR04 has its own trigger-to-burst delay and transducer offset, which shows up as a fixed mm
+ *   bias and a small scale error. This module converts echo time to mm in fixed point and applies a
+ *   per-unit gain and offset with a single multiply-add.
+ *
+ * How It Works:
+ *   1. Conversion: echo µs * 0.1715 mm/µs (half of 343 m/s) as a Q16 multiply
+ *   2. Correction: calibrated = raw * gain (Q16) + offset
+ *   3. Two-Point Routine: The raw reading is averaged at two known reference distances; gain is the ratio
+ *      of reference spacing to raw spacing and offset makes the first point exact
+ *
+ * Notes:
+ *   - Reference distances should be far apart (e.g. 100mm and 1000mm) for a well-conditioned gain
+ *   - Results with gain outside 0.8-1.2 are rejected as a bad capture rather than a real sensor error
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CAL_GAIN_ONE 65536          // 1.0 in Q16
+#define ECHO_US_TO_MM_Q16 11239     // 0.1715 mm/µs in Q16 (speed of sound 343 m/s, round trip)
+#define CAL_MIN_SPAN_MM 100         // minimum raw spacing between the two reference points
+#define CAL_CAPTURE_SAMPLES 8       // readings averaged per reference point
+
+// Convert echo pulse duration to uncalibrated distance (mm)
+inline int32_t echoToRawMm(uint32_t echoUs) {
+  return (int32_t)(((uint64_t)echoUs * ECHO_US_TO_MM_Q16 + (1 << 15)) >> 16);
+}
+
+struct Calibration {
+  int32_t gainQ16;  // scale correction (Q16)
+  int32_t offsetMm; // fixed bias correction (mm)
+
+  // Apply the correction (one multiply-add)
+  int32_t apply(int32_t rawMm) const {
+    return (int32_t)(((int64_t)rawMm * gainQ16 + (1 << 15)) >> 16) + offsetMm;
+  }
+
+  // Apply the correction to a sub-mm distance in Q8 (1/256 mm)
+  int32_t applyQ8(int32_t rawMmQ8) const {
+    return (int32_t)(((int64_t)rawMmQ8 * gainQ16 + (1 << 15)) >> 16) + offsetMm * 256;
+  }
+};
+
+const Calibration CAL_IDENTITY = { CAL_GAIN_ONE, 0 };
+
+// Compute gain and offset from two (raw, reference) pairs, returns false if the capture is unusable
+inline bool computeTwoPointCalibration(int32_t raw1, int32_t ref1, int32_t raw2, int32_t ref2,
+                                       Calibration& out) {
+  int32_t rawSpan = raw2 - raw1;
+  int32_t refSpan = ref2 - ref1;
+  if (rawSpan < 0) {
+    rawSpan = -rawSpan;
+    refSpan = -refSpan;
+  }
+  if (rawSpan < CAL_MIN_SPAN_MM || refSpan <= 0) return false;
+
+  // Rounded Q16 ratio
+  int64_t gain = (((int64_t)refSpan << 16) + rawSpan / 2) / rawSpan;
+  if (gain < CAL_GAIN_ONE * 8 / 10 || gain > CAL_GAIN_ONE * 12 / 10) return false;
+
+  Calibration result = { (int32_t)gain, 0 };
+  result.offsetMm = ref1 - result.apply(raw1);
+  out = result;
+  return true;
+}
+
+// Collects averaged raw readings at two reference distances
+class CalibrationRoutine {
+public:
+  CalibrationRoutine() : pointCount(0), capturing(false), sum(0), count(0) {}
+
+  // Start averaging the next readings for a reference distance
+  void beginCapture(int32_t referenceMm) {
+    if (pointCount >= 2) pointCount = 0;
+    refMm[pointCount] = referenceMm;
+    sum = 0;
+    count = 0;
+    capturing = true;
+  }
+
+  // Feed a raw reading, returns true when the current reference point is complete
+  bool addReading(int32_t rawMm) {
+    if (!capturing) return false;
+    sum += rawMm;
+    if (++count < CAL_CAPTURE_SAMPLES) return false;
+
+    rawAvgMm[pointCount++] = (sum + count / 2) / count;
+    capturing = false;
+    return true;
+  }
+
+  bool isCapturing() const { return capturing; }
+  uint8_t pointsCaptured() const { return pointCount; }
+
+  // Compute the result once both points are captured
+  bool result(Calibration& out) const {
+    if (pointCount < 2) return false;
+    return computeTwoPointCalibration(rawAvgMm[0], refMm[0], rawAvgMm[1], refMm[1], out);
+  }
+
+private:
+  int32_t refMm[2];
+  int32_t rawAvgMm[2];
+  uint8_t pointCount;
+  bool capturing;
+  int32_t sum;
+  int32_t count;
+};
@@ -0,0 +1,134 @@
+/*********************************************************************************************************
+ * Compile-Time Colormaps
+ *
+ * Description:
+ *   RGB565 lookup tables for the level meter and trend plot, generated by constexpr functions so the
+ *   selected map is a constant table in flash and a colour costs one array lookup. Alternatives to the
+ *   original red-to-green ramp: viridis (perceptually uniform and readable with the common forms of
+ *   colour blindness), traffic-light and monochrome.
+ *
+ * How It Works:
+ *   1. Stops: A map is a list of evenly spaced sRGB colour stops, linearly interpolated into
+ *      COLORMAP_SIZE entries and rounded to RGB565
+ *   2. Ordered Maps: Maps that encode the value in brightness (viridis, monochrome) must have stops that
+ *      get strictly brighter, checked with static_assert so a list out of order fails to compile. They
+ *      are generated with holdLuma so that RGB565 rounding never makes an entry darker than the one
+ *      before it
+ *   3. Zones: withZones() splits a map at up to two thresholds into flat bands. Zone k of n takes the
+ *      map colour at k / (n - 1), so traffic-light with two thresholds gives pure red, amber and green.
+ *      zonesIncreasing() checks the thresholds in a static_assert: used ones strictly increasing and
+ *      inside the table
+ *   4. Lookup: colormapIndex() maps a value within [0, range] to a table index
+ *
+ * Notes:
+ *   - Brightness is compared with integer Rec. 709 luma of the 8-bit expanded RGB565 colour
+ *   - Viridis stops are the 9 evenly spaced samples of matplotlib's viridis
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define COLORMAP_SIZE 256           // entries per table
+
+struct ColourStop {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+struct ColormapTable {
+  uint16_t colour[COLORMAP_SIZE];
+};
+
+constexpr ColourStop RED_GREEN_STOPS[] = { { 255, 0, 0 }, { 0, 255, 0 } };
+constexpr ColourStop VIRIDIS_STOPS[] = {
+  { 68, 1, 84 }, { 71, 44, 122 }, { 59, 81, 139 }, { 44, 113, 142 }, { 33, 144, 141 },
+  { 39, 173, 129 }, { 92, 200, 99 }, { 170, 220, 50 }, { 253, 231, 37 }
+};
+constexpr ColourStop TRAFFIC_LIGHT_STOPS[] = { { 255, 0, 0 }, { 255, 191, 0 }, { 0, 255, 0 } };
+constexpr ColourStop MONOCHROME_STOPS[] = { { 48, 48, 48 }, { 255, 255, 255 } }; // darkest stays visible on black
+
+constexpr uint16_t rgb565(uint32_t r, uint32_t g, uint32_t b) {
+  return (uint16_t)((((r * 31 + 127) / 255) << 11) | (((g * 63 + 127) / 255) << 5) | ((b * 31 + 127) / 255));
+}
+
+// Rec. 709 luma (x10000) of an sRGB stop
+constexpr uint32_t stopLuma(const ColourStop& stop) {
+  return 2126 * stop.r + 7152 * stop.g + 722 * stop.b;
+}
+
+// Rec. 709 luma (x10000) of an RGB565 colour expanded to 8 bits per channel
+constexpr uint32_t luma565(uint16_t colour) {
+  uint32_t r = ((colour >> 11) & 0x1F) * 255 / 31;
+  uint32_t g = ((colour >> 5) & 0x3F) * 255 / 63;
+  uint32_t b = (colour & 0x1F) * 255 / 31;
+  return 2126 * r + 7152 * g + 722 * b;
+}
+
+// Interpolate count evenly spaced stops into a table; holdLuma repeats the previous entry instead of
+// letting rounding make the map darker
+template<int COUNT>
+constexpr ColormapTable makeColormap(const ColourStop (&stops)[COUNT], bool holdLuma) {
+  ColormapTable table{};
+  const uint32_t span = (COLORMAP_SIZE - 1) * 2; // half steps, so rounding is symmetric
+  for (int i = 0; i < COLORMAP_SIZE; i++) {
+    uint32_t position = (uint32_t)i * (COUNT - 1) * 2;          // stop coordinate x span
+    uint32_t segment = position / span;
+    if (segment >= (uint32_t)COUNT - 1) segment = COUNT - 2;
+    uint32_t t = position - segment * span;                    // 0 .. span within the segment
+    const ColourStop& a = stops[segment];
+    const ColourStop& b = stops[segment + 1];
+    uint32_t r = (a.r * (span - t) + b.r * t + span / 2) / span;
+    uint32_t g = (a.g * (span - t) + b.g * t + span / 2) / span;
+    uint32_t bl = (a.b * (span - t) + b.b * t + span / 2) / span;
+    table.colour[i] = rgb565(r, g, bl);
+    if (holdLuma && i > 0 && luma565(table.colour[i]) < luma565(table.colour[i - 1])) {
+      table.colour[i] = table.colour[i - 1];
+    }
+  }
+  return table;
+}
+
+// Flat bands split at table indices lowIndex and highIndex (0 = unused); zone k of n shows the colour at k / (n - 1)
+constexpr ColormapTable withZones(const ColormapTable& map, uint16_t lowIndex, uint16_t highIndex) {
+  if (lowIndex == 0 && highIndex == 0) return map;
+  uint16_t thresholds[2] = { lowIndex, highIndex };
+  int zones = 1;
+  for (int i = 0; i < 2; i++) {
+    if (thresholds[i] > 0) thresholds[zones++ - 1] = thresholds[i];
+  }
+  ColormapTable table{};
+  for (int i = 0; i < COLORMAP_SIZE; i++) {
+    int zone = 0;
+    while (zone < zones - 1 && i >= thresholds[zone]) zone++;
+    table.colour[i] = map.colour[zone * (COLORMAP_SIZE - 1) / (zones - 1)];
+  }
+  return table;
+}
+
+// True if the used thresholds (0 = unused) lie inside the table and, when both are used, low < high
+constexpr bool zonesIncreasing(uint16_t lowIndex, uint16_t highIndex) {
+  if (lowIndex >= COLORMAP_SIZE || highIndex >= COLORMAP_SIZE) return false;
+  return lowIndex == 0 || highIndex == 0 || lowIndex < highIndex;
+}
+
+// True if every stop is brighter than the one before it
+template<int COUNT>
+constexpr bool stopsBrighten(const ColourStop (&stops)[COUNT]) {
+  for (int i = 1; i < COUNT; i++) {
+    if (stopLuma(stops[i]) <= stopLuma(stops[i - 1])) return false;
+  }
+  return true;
+}
+
+static_assert(stopsBrighten(VIRIDIS_STOPS), "viridis stops must brighten monotonically");
+static_assert(stopsBrighten(MONOCHROME_STOPS), "monochrome stops must brighten monotonically");
+
+// Table index of value within [0, range], clamped
+inline uint16_t colormapIndex(float value, float range) {
+  if (!(value > 0)) return 0;
+  if (value >= range) return COLORMAP_SIZE - 1;
+  return (uint16_t)(value * (COLORMAP_SIZE - 1) / range);
+}
@@ -0,0 +1,39 @@
+/*********************************************************************************************************
+ * Live Dashboard Page
+ *
+ * Description:
+ *   Static page served at "/". It opens the /ws WebSocket, decodes the binary "S1" sample batches (see
+ *   batch_publisher.h) and plots the last minute of distances with the latest reading in large digits.
+ *
+ * Notes:
+ *   - The page asks for each batch: every 100ms (twice the stream rate) it sends the 4-byte first
+ *     timestamp of the last batch it has, and the device answers only when it holds a newer one
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <Arduino.h>
+
+const char DASHBOARD_HTML[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><meta name="viewport" content="width=device-width">
+<title>Distance</title>
+<style>body{background:#000;color:#fff;font-family:sans-serif;margin:16px}#mm{font-size:64px}
+#st{color:#888}canvas{width:100%;height:240px;background:#111}</style></head>
+<body><div id="mm">--</div><div id="st">connecting</div><canvas id="c" width="600" height="240"></canvas>
+<script>
+const pts=[],c=document.getElementById('c'),g=c.getContext('2d');
+function draw(){const now=pts.length?pts[pts.length-1][0]:0;g.clearRect(0,0,600,240);g.strokeStyle='#0f0';g.beginPath();
+for(const [t,d] of pts){const x=600-(now-t)/100,y=240-d*240/4000;g.lineTo(x,y);}g.stroke();}
+function open(){const ws=new WebSocket('ws://'+location.host+'/ws');ws.binaryType='arraybuffer';let last=0;
+const ask=setInterval(()=>{if(ws.readyState!=1)return;const r=new DataView(new ArrayBuffer(4));
+r.setUint32(0,last,true);ws.send(r.buffer);},100);
+ws.onopen=()=>st.textContent='live';
+ws.onclose=()=>{clearInterval(ask);st.textContent='reconnecting';setTimeout(open,2000);};
+ws.onmessage=e=>{const v=new DataView(e.data);if(v.getUint8(0)!=83||v.getUint8(1)!=49)return;
+let t=v.getUint32(2,true);last=t;const n=v.getUint16(6,true);let d=0,f=0;
+for(let i=0;i<n;i++){const o=8+i*6;t+=v.getUint16(o,true);d=v.getUint16(o+2,true);f=v.getUint8(o+4);
+if(f==0)pts.push([t,d]);}while(pts.length&&pts[pts.length-1][0]-pts[0][0]>60000)pts.shift();
+mm.textContent=f?'--':d+' mm';draw();};}
+open();
+</script></body></html>)rawliteral";
@@ -0,0 +1,213 @@
+/*********************************************************************************************************
+ * Echo Timing & Serial Frame Decoding for Range Sensors
+ *
+ * Description:
+ *   The hardware-independent half of the range sensor drivers. Trigger/echo sensors hand their echo line
+ *   edges (captured by an interrupt) to an EchoPulseTimer, serial sensors hand received bytes to a frame
+ *   parser. Neither touches pins or UARTs, so both can be driven by scripted edges or byte streams.
+ *
+ * How It Works:
+ *   1. Edge Capture: The echo interrupt pushes (time, level) pairs into an EdgeRing, a single-producer
+ *      single-consumer ring that is safe between the ISR and the main loop without locks
+ *   2. Pulse Timing: EchoPulseTimer is armed at trigger time and validates the edge sequence
+ *      trigger -> rise -> fall before accepting a pulse, reporting a timeout if no valid pulse arrives
+ *   3. Glitch Rejection: Noise on long cables shows up as short pulses. A rise outside the expected
+ *      trigger-to-echo latency, a pulse shorter than the minimum width and a brief dropout inside a real
+ *      pulse are all counted as glitches; the timer keeps waiting for (or continues) the real echo
+ *   4. US-100 Serial: Us100Parser collects the two-byte big-endian mm reply to a 0x55 request
+ *
+ * Notes:
+ *   - Times are micros() values; all arithmetic is wrap-safe unsigned subtraction
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define ECHO_TIMEOUT_US 30000       // no echo after 30ms (~5m) is a timeout
+#define EDGE_RING_SIZE 16           // edges buffered between ISR and poll (power of 2)
+
+// Glitch filter defaults (HC-SR04 raises echo ~450µs after the trigger, 2cm is a 116µs pulse)
+// (override with build flags for other sensors or cable lengths)
+#ifndef ECHO_RISE_MIN_US
+#define ECHO_RISE_MIN_US 150        // earliest plausible echo rise after the trigger
+#endif
+#ifndef ECHO_RISE_MAX_US
+#define ECHO_RISE_MAX_US 2500       // latest plausible echo rise after the trigger
+#endif
+#ifndef ECHO_MIN_PULSE_US
+#define ECHO_MIN_PULSE_US 100       // shorter pulses are noise
+#endif
+#ifndef ECHO_BRIDGE_GAP_US
+#define ECHO_BRIDGE_GAP_US 20       // dropouts shorter than this inside a pulse are noise
+#endif
+
+struct EchoFilterConfig {
+  uint16_t riseMinUs;
+  uint16_t riseMaxUs;
+  uint16_t minPulseUs;
+  uint16_t bridgeGapUs;
+};
+
+const EchoFilterConfig ECHO_FILTER_DEFAULT = {
+  ECHO_RISE_MIN_US, ECHO_RISE_MAX_US, ECHO_MIN_PULSE_US, ECHO_BRIDGE_GAP_US
+};
+
+// Raw result of one measurement, before calibration and classification
+struct RawReading {
+  uint32_t echoUs; // echo pulse duration (or equivalent for sensors that report mm), 0 on timeout
+  int32_t rawMm;   // uncalibrated distance (mm)
+};
+
+// Round-trip echo time equivalent to a distance, for sensors that report mm directly
+inline uint32_t mmToEchoUs(int32_t mm) {
+  return mm <= 0 ? 0 : (uint32_t)(((uint64_t)mm * 2000 + 171) / 343);
+}
+
+struct EchoEdge {
+  uint32_t timeUs;
+  uint8_t level; // 1 = rising edge, 0 = falling edge
+};
+
+// Lock-free edge buffer: push() from the ISR, pop() from the main loop
+class EdgeRing {
+public:
+  EdgeRing() : head(0), tail(0), dropped(0) {}
+
+  // Returns false (edge dropped and counted) when full
+  bool push(uint32_t timeUs, uint8_t level) {
+    uint8_t h = head;
+    if ((uint8_t)(h - tail) >= EDGE_RING_SIZE) {
+      dropped = dropped + 1;
+      return false;
+    }
+    edges[h & (EDGE_RING_SIZE - 1)].timeUs = timeUs;
+    edges[h & (EDGE_RING_SIZE - 1)].level = level;
+    head = h + 1;
+    return true;
+  }
+
+  bool pop(EchoEdge& edge) {
+    uint8_t t = tail;
+    if (t == head) return false;
+    edge.timeUs = edges[t & (EDGE_RING_SIZE - 1)].timeUs;
+    edge.level = edges[t & (EDGE_RING_SIZE - 1)].level;
+    tail = t + 1;
+    return true;
+  }
+
+  // Discard everything (consumer side, between measurements)
+  void clear() { tail = head; }
+
+  // Edges lost because the ring was full (noise bursts)
+  uint32_t droppedEdges() const { return dropped; }
+
+private:
+  volatile EchoEdge edges[EDGE_RING_SIZE];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  volatile uint32_t dropped;
+};
+
+// Times the echo pulse of one measurement from its edges, rejecting glitches
+class EchoPulseTimer {
+public:
+  explicit EchoPulseTimer(const EchoFilterConfig& config = ECHO_FILTER_DEFAULT)
+    : cfg(config), triggerUs(0), riseUs(0), fallUs(0), glitchCount(0), state(IDLE) {}
+
+  // Start a measurement at the trigger time
+  void arm(uint32_t nowUs) {
+    triggerUs = nowUs;
+    state = AWAIT_RISE;
+  }
+
+  void onEdge(const EchoEdge& edge) {
+    switch (state) {
+      case AWAIT_RISE: {
+          if (!edge.level) break;
+          
+          // A rise outside the trigger-to-echo latency window is not the echo
+          uint32_t latency = edge.timeUs - triggerUs;
+          if (latency < cfg.riseMinUs || latency > cfg.riseMaxUs) {
+            glitchCount++;
+            break;
+          }
+          riseUs = edge.timeUs;
+          state = IN_PULSE;
+          break;
+        }
+
+      case IN_PULSE:
+        if (edge.level) break;
+        
+        // Too short to be an echo: discard and keep waiting for the real one
+        if (edge.timeUs - riseUs < cfg.minPulseUs) {
+          glitchCount++;
+          state = AWAIT_RISE;
+          break;
+        }
+        fallUs = edge.timeUs;
+        state = FALL_PENDING;
+        break;
+
+      case FALL_PENDING:
+        // Line came straight back up: the fall was a dropout inside the pulse
+        if (edge.level && edge.timeUs - fallUs < cfg.bridgeGapUs) {
+          glitchCount++;
+          state = IN_PULSE;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  // True once a valid pulse is complete or the measurement has timed out
+  bool finished(uint32_t nowUs) {
+    if (state == FALL_PENDING && nowUs - fallUs >= cfg.bridgeGapUs) state = DONE;
+    return state == DONE || (state != IDLE && nowUs - triggerUs > ECHO_TIMEOUT_US);
+  }
+
+  // Echo pulse duration, 0 on timeout
+  uint32_t echoUs() const { return state == DONE ? fallUs - riseUs : 0; }
+
+  // Total rejected glitches since start-up
+  uint32_t glitches() const { return glitchCount; }
+
+private:
+  enum State : uint8_t { IDLE, AWAIT_RISE, IN_PULSE, FALL_PENDING, DONE };
+
+  EchoFilterConfig cfg;
+  uint32_t triggerUs;
+  uint32_t riseUs;
+  uint32_t fallUs;
+  uint32_t glitchCount;
+  State state;
+};
+
+// Decodes the US-100 serial distance reply (2 bytes, big-endian mm)
+class Us100Parser {
+public:
+  Us100Parser() : count(0), value(0) {}
+
+  void reset() {
+    count = 0;
+    value = 0;
+  }
+
+  // Feed a received byte, returns true when the reply is complete
+  bool feed(uint8_t byte) {
+    if (count >= 2) return true;
+    value = (uint16_t)((value << 8) | byte);
+    return ++count >= 2;
+  }
+
+  bool complete() const { return count >= 2; }
+  uint16_t distanceMm() const { return complete() ? value : 0; }
+
+private:
+  uint8_t count;
+  uint16_t value;
+};
@@ -0,0 +1,145 @@
+/*********************************************************************************************************
+ * Pre-Rendered Glyph Atlas
+ *
+ * Description:
+ *   Large anti-aliased digits for the distance readout. Smooth text blends every glyph pixel against the
+ *   background each time it is drawn and sends it to the panel in many small writes. Here each glyph is
+ *   rendered once at start-up into an RGB565 cell, already blended with the known background colour. An
+ *   update then copies glyph rows into a strip buffer with memcpy and pushes the strip with one pushImage.
+ *
+ * How It Works:
+ *   1. Coverage: Each glyph is scaled down from a larger bitmap font (any Source with ink(x, y)). Every
+ *      output pixel takes 4x4 samples of the source, which gives 17 coverage levels of anti-aliasing
+ *   2. Blend: The coverage mixes the foreground and background colours per channel (blend565). Cells
+ *      are stored byte-swapped (panel byte order), so pushImage() needs no setSwapBytes()
+ *   3. Compose: compose() right-aligns a string in the strip: background up to the first glyph, then one
+ *      memcpy per glyph row at the glyph's advance width
+ *
+ * Notes:
+ *   - Characters outside GLYPH_ATLAS_CHARSET are skipped; a space is drawn as background
+ *   - One atlas holds one foreground colour; keep an atlas per colour the readout uses
+ *   - Memory: 12 cells of CELL_WIDTH x CELL_HEIGHT pixels, 2 bytes each
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define GLYPH_ATLAS_CHARSET "0123456789. " // glyphs held by an atlas, in cell order
+#define GLYPH_ATLAS_GLYPHS 12
+#define GLYPH_SUPERSAMPLE 4                // samples per output pixel along each axis
+
+// Mix two RGB565 colours, alpha 0 (background) .. 255 (foreground)
+inline uint16_t blend565(uint16_t fg, uint16_t bg, uint8_t alpha) {
+  uint32_t a = alpha, b = 255 - alpha;
+  uint32_t r = (((fg >> 11) & 0x1F) * a + ((bg >> 11) & 0x1F) * b + 127) / 255;
+  uint32_t g = (((fg >> 5) & 0x3F) * a + ((bg >> 5) & 0x3F) * b + 127) / 255;
+  uint32_t bl = ((fg & 0x1F) * a + (bg & 0x1F) * b + 127) / 255;
+  return (uint16_t)((r << 11) | (g << 5) | bl);
+}
+
+// RGB565 in the byte order the panel expects (high byte first in memory)
+inline uint16_t panelOrder565(uint16_t colour) { return (uint16_t)((colour >> 8) | (colour << 8)); }
+
+// Cell index of c in GLYPH_ATLAS_CHARSET, -1 if the atlas does not hold it
+inline int glyphIndex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c == '.') return 10;
+  if (c == ' ') return 11;
+  return -1;
+}
+
+template<int CELL_WIDTH, int CELL_HEIGHT>
+class GlyphAtlas {
+public:
+  GlyphAtlas() : foreground(0xFFFF), background(0) {
+    memset(advances, 0, sizeof(advances));
+  }
+
+  // Set the colours the following glyphs are blended with
+  void begin(uint16_t foregroundColour, uint16_t backgroundColour) {
+    foreground = foregroundColour;
+    background = backgroundColour;
+  }
+
+  // Render c from a source glyph sourceWidth x sourceHeight px (the source font height maps to CELL_HEIGHT)
+  template<class Source>
+  void addGlyph(char c, const Source& source, int sourceWidth, int sourceHeight) {
+    int index = glyphIndex(c);
+    if (index < 0 || sourceHeight <= 0) return;
+    int width = (sourceWidth * CELL_HEIGHT + sourceHeight / 2) / sourceHeight;
+    advances[index] = (uint8_t)(width < CELL_WIDTH ? width : CELL_WIDTH);
+
+    // Sample centres ((2k + 1) / 2S of an output pixel) mapped back to source pixels, in integers
+    const int S = GLYPH_SUPERSAMPLE;
+    const int32_t denominator = 2 * S * CELL_HEIGHT;
+    uint16_t* cell = cells[index];
+    for (int y = 0; y < CELL_HEIGHT; y++) {
+      for (int x = 0; x < CELL_WIDTH; x++) {
+        int covered = 0;
+        for (int sy = 0; sy < S; sy++) {
+          int py = (int)((int32_t)(2 * (y * S + sy) + 1) * sourceHeight / denominator);
+          for (int sx = 0; sx < S; sx++) {
+            int px = (int)((int32_t)(2 * (x * S + sx) + 1) * sourceHeight / denominator);
+            if (px < sourceWidth && source.ink(px, py)) covered++;
+          }
+        }
+        uint8_t alpha = (uint8_t)((covered * 255 + S * S / 2) / (S * S));
+        cell[y * CELL_WIDTH + x] = panelOrder565(blend565(foreground, background, alpha));
+      }
+    }
+  }
+
+  // Width of text in pixels (characters the atlas does not hold count as zero)
+  int textWidth(const char* text) const {
+    int width = 0;
+    for (; *text; text++) {
+      int index = glyphIndex(*text);
+      if (index >= 0) width += advances[index];
+    }
+    return width;
+  }
+
+  // Right-align text in a stripWidth x CELL_HEIGHT strip (panel byte order), clipping on the left
+  void compose(const char* text, uint16_t* strip, int stripWidth) const {
+    int x0 = stripWidth - textWidth(text);
+    uint16_t fill = panelOrder565(background);
+    for (int y = 0; y < CELL_HEIGHT; y++) {
+      uint16_t* row = strip + y * stripWidth;
+      for (int x = 0; x < x0; x++) row[x] = fill;
+
+      int x = x0;
+      for (const char* p = text; *p; p++) {
+        int index = glyphIndex(*p);
+        if (index < 0) continue;
+        int width = advances[index];
+        if (x + width <= 0) {           // wholly clipped: no row to copy
+          x += width;
+          continue;
+        }
+        int skip = x < 0 ? -x : 0;
+        memcpy(row + x + skip, cells[index] + y * CELL_WIDTH + skip, (width - skip) * sizeof(uint16_t));
+        x += width;
+      }
+    }
+  }
+
+  uint8_t advance(char c) const {
+    int index = glyphIndex(c);
+    return index < 0 ? 0 : advances[index];
+  }
+
+  // Cell of a glyph (CELL_WIDTH x CELL_HEIGHT, panel byte order), nullptr if not held
+  const uint16_t* glyph(char c) const {
+    int index = glyphIndex(c);
+    return index < 0 ? nullptr : cells[index];
+  }
+
+private:
+  uint16_t cells[GLYPH_ATLAS_GLYPHS][CELL_WIDTH * CELL_HEIGHT];
+  uint8_t advances[GLYPH_ATLAS_GLYPHS];
+  uint16_t foreground;
+  uint16_t background;
+};
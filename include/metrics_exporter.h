@@ -0,0 +1,195 @@
+/*********************************************************************************************************
+ * Prometheus Text Exposition Writer & Latency Histogram
+ *
+ * Description:
+ *   Renders counters, gauges and histograms in the Prometheus text format (version 0.0.4) into a caller
+ *   provided buffer. Numbers are formatted by hand, so a scrape does no heap allocation and no printf.
+ *   LatencyHistogram records durations into fixed buckets with a compare per bucket. MetricsSnapshot
+ *   hands the values from the task that owns them to the web server task that renders them.
+ *
+ * How It Works:
+ *   1. Families: family() writes the # HELP and # TYPE lines, then one or more samples follow
+ *   2. Values: Integers are written directly; scaled values (mm as metres, µs as seconds) are written as
+ *      a fixed-point decimal with trailing zeros removed
+ *   3. Histograms: Buckets are stored per range and emitted cumulatively with le="..." labels, followed by
+ *      the +Inf bucket, _sum and _count as the format requires
+ *   4. Snapshot: The same double buffer and sequence number as the Modbus register snapshot
+ *      (seqlock_snapshot.h). The owner fills the idle copy and publishes it; a scrape copies the current
+ *      one and retries if a publish overlapped, so it never renders a histogram or reading that is half
+ *      updated
+ *
+ * Notes:
+ *   - A write that would overflow the buffer is truncated at the last complete line and overflowed()
+ *     reports it, so a scrape never sees a half-written sample
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "seqlock_snapshot.h"
+
+// Duration histogram (µs) with fixed upper bounds
+template <uint8_t BUCKETS>
+class LatencyHistogram {
+public:
+  explicit LatencyHistogram(const uint32_t (&upperBoundsUs)[BUCKETS]) : bounds(upperBoundsUs) {
+    memset(counts, 0, sizeof(counts));
+    sumUs = 0;
+    total = 0;
+  }
+
+  void observe(uint32_t us) {
+    uint8_t i = 0;
+    while (i < BUCKETS && us > bounds[i]) i++;
+    counts[i]++;
+    sumUs += us;
+    total++;
+  }
+
+  uint32_t bound(uint8_t i) const { return bounds[i]; }
+  uint32_t bucketCount(uint8_t i) const { return counts[i]; } // i == BUCKETS is the overflow bucket
+  uint64_t sum() const { return sumUs; }
+  uint32_t count() const { return total; }
+
+private:
+  const uint32_t* bounds; // pointer, not reference, so a histogram can be copied into a snapshot
+  uint32_t counts[BUCKETS + 1];
+  uint64_t sumUs;
+  uint32_t total;
+};
+
+// Double-buffered copy of the exported values: one writer (the owning task), readers in any task
+template <typename T>
+using MetricsSnapshot = SeqlockSnapshot<T>;
+
+class MetricsWriter {
+public:
+  MetricsWriter(char* buffer, size_t capacity)
+    : buf(buffer), cap(capacity), len(0), lineStart(0), full(false) {
+    if (cap > 0) buf[0] = '\0';
+  }
+
+  // # HELP and # TYPE lines
+  void family(const char* name, const char* type, const char* help) {
+    text("# HELP "); text(name); text(" "); text(help); endLine();
+    text("# TYPE "); text(name); text(" "); text(type); endLine();
+  }
+
+  void sample(const char* name, uint64_t value) {
+    text(name); text(" "); unsignedValue(value); endLine();
+  }
+
+  void sample(const char* name, int64_t value) {
+    text(name); text(" ");
+    if (value < 0) {
+      text("-");
+      unsignedValue((uint64_t)(-value));
+    }
+    else {
+      unsignedValue((uint64_t)value);
+    }
+    endLine();
+  }
+
+  // value / 10^decimals (e.g. mm as metres with decimals = 3)
+  void scaledSample(const char* name, int64_t value, uint8_t decimals) {
+    text(name); text(" "); scaled(value, decimals); endLine();
+  }
+
+  void counter(const char* name, const char* help, uint64_t value) {
+    family(name, "counter", help);
+    sample(name, value);
+  }
+
+  void gauge(const char* name, const char* help, int64_t value) {
+    family(name, "gauge", help);
+    sample(name, value);
+  }
+
+  // Histogram of µs durations exported in seconds
+  template <uint8_t BUCKETS>
+  void histogramSeconds(const char* name, const char* help, const LatencyHistogram<BUCKETS>& histogram) {
+    family(name, "histogram", help);
+    uint64_t cumulative = 0;
+    for (uint8_t i = 0; i <= BUCKETS; i++) {
+      cumulative += histogram.bucketCount(i);
+      text(name); text("_bucket{le=\"");
+      if (i < BUCKETS) scaled(histogram.bound(i), 6);
+      else text("+Inf");
+      text("\"} "); unsignedValue(cumulative); endLine();
+    }
+    text(name); text("_sum "); scaled((int64_t)histogram.sum(), 6); endLine();
+    text(name); text("_count "); unsignedValue(histogram.count()); endLine();
+  }
+
+  const char* data() const { return buf; }
+  size_t length() const { return len; }
+  bool overflowed() const { return full; }
+
+private:
+  void text(const char* s) {
+    if (full) return;
+    size_t n = strlen(s);
+    if (len + n + 1 > cap) { // keep room for the terminator
+      full = true;
+      return;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+
+  void put(char c) {
+    if (full) return;
+    if (len + 1 >= cap) { // keep room for the terminator
+      full = true;
+      return;
+    }
+    buf[len++] = c;
+  }
+
+  // Commit the line, or roll back to the previous line if it did not fit
+  void endLine() {
+    put('\n');
+    if (full) len = lineStart;
+    else lineStart = len;
+    if (cap > 0) buf[len] = '\0';
+  }
+
+  void unsignedValue(uint64_t value) {
+    char digits[20];
+    uint8_t n = 0;
+    do {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    while (n > 0) put(digits[--n]);
+  }
+
+  void scaled(int64_t value, uint8_t decimals) {
+    if (value < 0) {
+      put('-');
+      value = -value;
+    }
+    uint64_t divisor = 1;
+    for (uint8_t i = 0; i < decimals; i++) divisor *= 10;
+    unsignedValue((uint64_t)value / divisor);
+
+    uint64_t fraction = (uint64_t)value % divisor;
+    if (fraction == 0) return;
+    put('.');
+    while (divisor > 1 && fraction > 0) {
+      divisor /= 10;
+      put('0' + fraction / divisor);
+      fraction %= divisor;
+    }
+  }
+
+  char* buf;
+  size_t cap;
+  size_t len;
+  size_t lineStart;
+  bool full;
+};
@@ -0,0 +1,210 @@
+/*********************************************************************************************************
+ * Modbus RTU Slave
+ *
+ * Description:
+ *   Lets a PLC poll the latest readings directly over RS-485. The slave assembles request frames from the
+ *   UART byte stream, checks address and CRC, and answers Read Holding Registers (03), Read Input
+ *   Registers (04) and Write Single Register (06) from a register snapshot. Responses never wait for the
+ *   acquisition loop: the loop publishes a fresh snapshot after each reading and the slave reads whichever
+ *   one is current.
+ *
+ * How It Works:
+ *   1. Framing: A silence longer than 3.5 character times ends a frame. The UART's receive timeout
+ *      detects it in hardware and the receive handler feeds the frame's bytes and then calls process(),
+ *      so the slave itself keeps no timing
+ *   2. Validation: Frames with a bad CRC, too short or too long are counted and dropped silently (the
+ *      master times out and retries, as the standard requires); other addresses are ignored
+ *   3. Snapshot: Two register buffers and a sequence number (seqlock_snapshot.h). The writer fills the
+ *      idle buffer and bumps the sequence; a reader copies the current buffer and retries if the sequence
+ *      moved meanwhile, so neither side ever waits on a lock
+ *   4. Writes: Validated holding register writes are queued (lock-free) for the main loop to apply
+ *
+ * Notes:
+ *   - Exceptions: 01 illegal function, 02 illegal address, 03 illegal value, 06 busy (write queue full)
+ *   - Broadcast (address 0) writes are applied without a response
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "seqlock_snapshot.h"
+
+#define MODBUS_FRAME_MAX 256        // largest RTU frame
+#define MODBUS_INPUT_REGS 20        // input registers in the map (function 04)
+#define MODBUS_HOLDING_REGS 3       // holding registers in the map (functions 03 / 06)
+#define MODBUS_WRITE_QUEUE 4        // pending writes (power of 2)
+#define MODBUS_MAX_READ 125         // registers per read request (standard limit)
+
+#define MODBUS_ILLEGAL_FUNCTION 0x01
+#define MODBUS_ILLEGAL_ADDRESS 0x02
+#define MODBUS_ILLEGAL_VALUE 0x03
+#define MODBUS_BUSY 0x06
+
+// CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF)
+inline uint16_t modbusCrc16(const uint8_t* data, uint16_t length) {
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+  }
+  return crc;
+}
+
+struct ModbusRegisters {
+  uint16_t input[MODBUS_INPUT_REGS];
+  uint16_t holding[MODBUS_HOLDING_REGS];
+};
+
+struct ModbusWrite {
+  uint16_t address;
+  uint16_t value;
+};
+
+// Double-buffered register snapshot: one writer (acquisition), readers in any task
+typedef SeqlockSnapshot<ModbusRegisters> ModbusSnapshot;
+
+class ModbusRtuSlave {
+public:
+  // holdingMax: largest value accepted by each holding register
+  ModbusRtuSlave(uint8_t slaveAddress, const uint16_t* holdingMax)
+    : address(slaveAddress), maxValue(holdingMax), length(0), overflow(false),
+      writeHead(0), writeTail(0), frameCount(0), crcErrorCount(0), exceptionCount(0) {}
+
+  // Add a received byte to the current frame
+  void feed(uint8_t byte) {
+    if (length < MODBUS_FRAME_MAX) frame[length++] = byte;
+    else overflow = true;
+  }
+
+  // Handle the frame fed since the last call (the line has been silent for 3.5 characters), writing the
+  // response; returns its length (0 = no response)
+  uint16_t process(const ModbusRegisters& registers, uint8_t* response) {
+    uint16_t frameLength = length;
+    bool tooLong = overflow;
+    length = 0;
+    overflow = false;
+
+    if (tooLong || frameLength < 4) {
+      crcErrorCount++;
+      return 0;
+    }
+    uint16_t crc = modbusCrc16(frame, frameLength - 2);
+    if (frame[frameLength - 2] != (crc & 0xFF) || frame[frameLength - 1] != (crc >> 8)) {
+      crcErrorCount++;
+      return 0;
+    }
+
+    uint8_t target = frame[0];
+    if (target != address && target != 0) return 0;
+    frameCount++;
+
+    bool broadcast = target == 0;
+    uint8_t function = frame[1];
+    uint8_t error = 0;
+    uint16_t responseLength = 0;
+
+    if ((function == 0x03 || function == 0x04) && !broadcast) {
+      error = readRegisters(function, registers, frameLength, response, responseLength);
+    }
+    else if (function == 0x06) {
+      error = writeRegister(frameLength, response, responseLength);
+    }
+    else if (!broadcast) {
+      error = MODBUS_ILLEGAL_FUNCTION;
+    }
+
+    if (broadcast) return 0;
+    if (error != 0) {
+      exceptionCount++;
+      response[0] = address;
+      response[1] = function | 0x80;
+      response[2] = error;
+      responseLength = 3;
+    }
+    return appendCrc(response, responseLength);
+  }
+
+  // Next validated write for the main loop to apply
+  bool takeWrite(ModbusWrite& write) {
+    uint8_t t = writeTail;
+    if (t == writeHead) return false;
+    write.address = writes[t & (MODBUS_WRITE_QUEUE - 1)].address;
+    write.value = writes[t & (MODBUS_WRITE_QUEUE - 1)].value;
+    writeTail = t + 1;
+    return true;
+  }
+
+  uint32_t frames() const { return frameCount; }
+  uint32_t crcErrors() const { return crcErrorCount; }
+  uint32_t exceptions() const { return exceptionCount; }
+
+private:
+  static uint16_t word(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+  uint8_t readRegisters(uint8_t function, const ModbusRegisters& registers, uint16_t frameLength,
+                        uint8_t* response, uint16_t& responseLength) {
+    if (frameLength != 8) return MODBUS_ILLEGAL_VALUE;
+    uint16_t start = word(&frame[2]);
+    uint16_t quantity = word(&frame[4]);
+    if (quantity == 0 || quantity > MODBUS_MAX_READ) return MODBUS_ILLEGAL_VALUE;
+
+    const uint16_t* table = function == 0x04 ? registers.input : registers.holding;
+    uint16_t size = function == 0x04 ? MODBUS_INPUT_REGS : MODBUS_HOLDING_REGS;
+    if ((uint32_t)start + quantity > size) return MODBUS_ILLEGAL_ADDRESS;
+
+    response[0] = address;
+    response[1] = function;
+    response[2] = (uint8_t)(quantity * 2);
+    for (uint16_t i = 0; i < quantity; i++) {
+      response[3 + i * 2] = table[start + i] >> 8;
+      response[4 + i * 2] = table[start + i] & 0xFF;
+    }
+    responseLength = 3 + quantity * 2;
+    return 0;
+  }
+
+  uint8_t writeRegister(uint16_t frameLength, uint8_t* response, uint16_t& responseLength) {
+    if (frameLength != 8) return MODBUS_ILLEGAL_VALUE;
+    uint16_t target = word(&frame[2]);
+    uint16_t value = word(&frame[4]);
+    if (target >= MODBUS_HOLDING_REGS) return MODBUS_ILLEGAL_ADDRESS;
+    if (value > maxValue[target]) return MODBUS_ILLEGAL_VALUE;
+
+    // Queue for the main loop (single producer: the receive handler)
+    uint8_t h = writeHead;
+    if ((uint8_t)(h - writeTail) >= MODBUS_WRITE_QUEUE) return MODBUS_BUSY;
+    writes[h & (MODBUS_WRITE_QUEUE - 1)].address = target;
+    writes[h & (MODBUS_WRITE_QUEUE - 1)].value = value;
+    writeHead = h + 1;
+
+    // Normal response echoes the request
+    memcpy(response, frame, 6);
+    response[0] = address;
+    responseLength = 6;
+    return 0;
+  }
+
+  static uint16_t appendCrc(uint8_t* response, uint16_t responseLength) {
+    uint16_t crc = modbusCrc16(response, responseLength);
+    response[responseLength] = crc & 0xFF;
+    response[responseLength + 1] = crc >> 8;
+    return responseLength + 2;
+  }
+
+  uint8_t address;
+  const uint16_t* maxValue;
+  uint8_t frame[MODBUS_FRAME_MAX];
+  uint16_t length;
+  bool overflow;
+  volatile ModbusWrite writes[MODBUS_WRITE_QUEUE];
+  volatile uint8_t writeHead;
+  volatile uint8_t writeTail;
+  uint32_t frameCount;
+  uint32_t crcErrorCount;
+  uint32_t exceptionCount;
+};
@@ -0,0 +1,165 @@
+/*********************************************************************************************************
+ * Velocity, Acceleration & Time-to-Contact Estimator
+ *
+ * Description:
+ *   Derives closing speed, acceleration and time-to-contact from the timestamped sample stream. Velocity is
+ *   the least-squares slope of distance over a sliding window of samples, acceleration is the slope of the
+ *   velocity estimates. Both windows are updated in O(1) per sample using running sums.
+ *
+ * How It Works:
+ *   1. Sliding Regression: Running sums of t, y, t*y and t² give the slope directly. Times are kept
+ *      relative to the oldest sample in the window, re-basing the sums in O(1) when it is evicted
+ *   2. Savitzky-Golay (optional): For evenly spaced samples a 5-point quadratic fit gives less lag on
+ *      velocity and a direct second derivative for acceleration
+ *   3. Time-to-Contact: distance / closing speed while the target approaches faster than a threshold
+ *
+ * Notes:
+ *   - Velocity is negative while the target approaches (distance decreasing)
+ *   - Estimates describe the centre of the window, so they lag the newest sample by half the window
+ *   - Feed only usable samples; call reset() after a gap so stale history is not fitted
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define MOTION_WINDOW 8                 // samples per least-squares window
+#define MOTION_MIN_CLOSING_MM_S 20      // slower approach than this has no time-to-contact
+#define MOTION_NO_CONTACT 0xFFFFFFFFUL  // time-to-contact when not approaching
+
+// Least-squares slope of y over t across the last N points, O(1) per point
+template <uint8_t N>
+class SlopeWindow {
+public:
+  SlopeWindow() { reset(); }
+
+  void reset() {
+    count = 0;
+    head = 0;
+    baseMs = 0;
+    sumT = sumY = sumTY = sumTT = 0;
+  }
+
+  void add(uint32_t tMs, int32_t y) {
+    if (count == N) {
+      // Drop the oldest point, then re-base times on the new oldest point
+      uint8_t oldest = head;
+      int64_t t = (int64_t)(times[oldest] - baseMs);
+      sumT -= t;
+      sumY -= values[oldest];
+      sumTY -= t * values[oldest];
+      sumTT -= t * t;
+      count--;
+      rebase(times[(oldest + 1) % N]);
+    }
+    else if (count == 0) {
+      baseMs = tMs;
+    }
+
+    times[head] = tMs;
+    values[head] = y;
+    head = (head + 1) % N;
+    count++;
+
+    int64_t t = (int64_t)(tMs - baseMs);
+    sumT += t;
+    sumY += y;
+    sumTY += t * y;
+    sumTT += t * t;
+  }
+
+  bool ready() const { return count >= 3; }
+
+  // Slope in y units per second (0 until ready)
+  int32_t slopePerSecond() const {
+    if (!ready()) return 0;
+    int64_t den = (int64_t)count * sumTT - sumT * sumT;
+    if (den == 0) return 0;
+    int64_t num = (int64_t)count * sumTY - sumT * sumY;
+    return (int32_t)(num * 1000 / den);
+  }
+
+  // Point i back from the newest (0 = newest)
+  int32_t value(uint8_t back) const { return values[(head + N - 1 - back) % N]; }
+  uint32_t time(uint8_t back) const { return times[(head + N - 1 - back) % N]; }
+  uint8_t size() const { return count; }
+
+private:
+  // Shift the time origin so sums stay small (exact: Σ(t-d) etc. expanded)
+  void rebase(uint32_t newBaseMs) {
+    int64_t d = (int64_t)(newBaseMs - baseMs);
+    sumTT -= 2 * d * sumT - (int64_t)count * d * d;
+    sumTY -= d * sumY;
+    sumT -= (int64_t)count * d;
+    baseMs = newBaseMs;
+  }
+
+  uint32_t times[N];
+  int32_t values[N];
+  uint8_t count;
+  uint8_t head;
+  uint32_t baseMs;
+  int64_t sumT, sumY, sumTY, sumTT;
+};
+
+struct MotionState {
+  int32_t velocityMmS;     // rate of change of distance (negative = approaching)
+  int32_t accelMmS2;       // rate of change of velocity
+  uint32_t timeToContactMs; // MOTION_NO_CONTACT when not approaching
+  bool valid;              // enough samples for an estimate
+};
+
+class MotionEstimator {
+public:
+  explicit MotionEstimator(bool savitzkyGolay = false) : useSavGol(savitzkyGolay) { reset(); }
+
+  void reset() {
+    distance.reset();
+    velocity.reset();
+    state = { 0, 0, MOTION_NO_CONTACT, false };
+  }
+
+  // Feed a usable sample, returns the updated estimate
+  const MotionState& update(uint32_t timestampMs, int32_t distanceMm) {
+    distance.add(timestampMs, distanceMm);
+
+    if (useSavGol && distance.size() >= 5) {
+      savitzkyGolay();
+    }
+    else if (distance.ready()) {
+      state.velocityMmS = distance.slopePerSecond();
+      velocity.add(timestampMs, state.velocityMmS);
+      state.accelMmS2 = velocity.slopePerSecond();
+    }
+    state.valid = distance.ready();
+
+    // Time-to-contact while approaching
+    int32_t closing = -state.velocityMmS;
+    state.timeToContactMs = MOTION_NO_CONTACT;
+    if (state.valid && closing >= MOTION_MIN_CLOSING_MM_S && distanceMm > 0) {
+      state.timeToContactMs = (uint32_t)((int64_t)distanceMm * 1000 / closing);
+    }
+    return state;
+  }
+
+  const MotionState& current() const { return state; }
+
+private:
+  // 5-point quadratic Savitzky-Golay derivatives at the centre point (assumes even spacing)
+  void savitzkyGolay() {
+    int64_t y0 = distance.value(4), y1 = distance.value(3), y2 = distance.value(2);
+    int64_t y3 = distance.value(1), y4 = distance.value(0);
+    int64_t spanMs = (int64_t)(distance.time(0) - distance.time(4));
+    if (spanMs <= 0) return;
+
+    // h = span / 4: v = (-2y0 - y1 + y3 + 2y4) / 10h, a = (2y0 - y1 - 2y2 - y3 + 2y4) / 7h²
+    state.velocityMmS = (int32_t)((-2 * y0 - y1 + y3 + 2 * y4) * 4000 / (10 * spanMs));
+    state.accelMmS2 = (int32_t)((2 * y0 - y1 - 2 * y2 - y3 + 2 * y4) * 16000000 / (7 * spanMs * spanMs));
+  }
+
+  SlopeWindow<MOTION_WINDOW> distance;
+  SlopeWindow<MOTION_WINDOW> velocity;
+  MotionState state;
+  bool useSavGol;
+};
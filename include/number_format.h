@@ -0,0 +1,163 @@
+/*********************************************************************************************************
+ * Allocation-Free Number Formatting
+ *
+ * Description:
+ *   Integer and fixed-point to text conversion for the readout and the serial telemetry, without printf,
+ *   float printing or heap use. Print::print(float, digits) goes through double arithmetic (software
+ *   floating point on the ESP32-S3) for every digit; here a value is split into digit pairs with one
+ *   divide by 100 per pair and a lookup in a table generated at compile time.
+ *
+ * How It Works:
+ *   1. Tables: DIGIT_PAIRS ("00".."99") and POWERS_OF_10 are built by constexpr functions, so they live in
+ *      flash and cost nothing at start-up
+ *   2. Digits: Values are written backwards into a small stack array two digits at a time, then copied
+ *   3. Fixed Point: fixed(value, decimals) prints value / 10^decimals, e.g. tenths of a millimetre with
+ *      decimals = 1; the sign is written once, so -5 with one decimal becomes "-0.5"
+ *   4. TextBuilder: Appends text, integers, fixed-point values and hex bytes into a caller-provided buffer,
+ *      always NUL-terminated; output that does not fit is dropped and overflowed() reports it
+ *   5. Rounding: roundedQuotient() brings a value to the printed resolution (e.g. mL to tenths of a litre)
+ *      rounding half away from zero, so fixed() shows what "%.1f" would for the same quantity
+ *
+ * Notes:
+ *   - Needs C++17 (inline constexpr tables, loops in constexpr functions); see build_flags in
+ *     platformio.ini
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+struct DigitPairTable {
+  char text[200];
+};
+
+constexpr DigitPairTable makeDigitPairs() {
+  DigitPairTable table{};
+  for (int i = 0; i < 100; i++) {
+    table.text[i * 2] = (char)('0' + i / 10);
+    table.text[i * 2 + 1] = (char)('0' + i % 10);
+  }
+  return table;
+}
+
+struct PowerTable {
+  uint32_t value[10];
+};
+
+constexpr PowerTable makePowersOf10() {
+  PowerTable table{};
+  uint32_t p = 1;
+  for (int i = 0; i < 10; i++) {
+    table.value[i] = p;
+    p *= 10;
+  }
+  return table;
+}
+
+inline constexpr DigitPairTable DIGIT_PAIRS = makeDigitPairs();
+inline constexpr PowerTable POWERS_OF_10 = makePowersOf10();
+
+static_assert(DIGIT_PAIRS.text[198] == '9' && DIGIT_PAIRS.text[15] == '7', "digit pair table");
+static_assert(POWERS_OF_10.value[9] == 1000000000u, "power table");
+
+#define FORMAT_MAX_DIGITS 10        // digits in a uint32_t
+
+// Write value's digits so they end just before end, returns the first digit
+inline char* formatDigitsBackward(char* end, uint32_t value) {
+  while (value >= 100) {
+    uint32_t pair = value % 100;
+    value /= 100;
+    end -= 2;
+    memcpy(end, &DIGIT_PAIRS.text[pair * 2], 2);
+  }
+  if (value >= 10) {
+    end -= 2;
+    memcpy(end, &DIGIT_PAIRS.text[value * 2], 2);
+  }
+  else {
+    *--end = (char)('0' + value);
+  }
+  return end;
+}
+
+// numerator / divisor rounded half away from zero (divisor > 0)
+inline int32_t roundedQuotient(int64_t numerator, int32_t divisor) {
+  int64_t half = divisor / 2;
+  return (int32_t)((numerator + (numerator < 0 ? -half : half)) / divisor);
+}
+
+class TextBuilder {
+public:
+  TextBuilder(char* buffer, size_t capacity) : buf(buffer), cap(capacity), len(0), full(false) {
+    if (cap > 0) buf[0] = '\0';
+  }
+
+  TextBuilder& text(const char* s) {
+    return append(s, strlen(s));
+  }
+
+  TextBuilder& character(char c) {
+    return append(&c, 1);
+  }
+
+  TextBuilder& unsignedValue(uint32_t value) {
+    char digits[FORMAT_MAX_DIGITS];
+    char* first = formatDigitsBackward(digits + FORMAT_MAX_DIGITS, value);
+    return append(first, digits + FORMAT_MAX_DIGITS - first);
+  }
+
+  TextBuilder& signedValue(int32_t value) {
+    if (value < 0) character('-');
+    return unsignedValue(magnitude(value));
+  }
+
+  // value / 10^decimals with exactly decimals digits after the point
+  TextBuilder& fixed(int32_t value, uint8_t decimals) {
+    if (decimals == 0) return signedValue(value);
+    if (decimals > FORMAT_MAX_DIGITS - 1) decimals = FORMAT_MAX_DIGITS - 1;
+    if (value < 0) character('-');
+    uint32_t m = magnitude(value);
+    uint32_t scale = POWERS_OF_10.value[decimals];
+    unsignedValue(m / scale);
+    character('.');
+
+    // Fraction with leading zeros: write it after a leading 1 and skip that digit
+    char digits[FORMAT_MAX_DIGITS + 1];
+    char* end = digits + sizeof(digits);
+    formatDigitsBackward(end, m % scale + scale);
+    return append(end - decimals, decimals);
+  }
+
+  // Two upper-case hex digits
+  TextBuilder& hex2(uint8_t value) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    character(HEX_DIGITS[value >> 4]);
+    return character(HEX_DIGITS[value & 0x0F]);
+  }
+
+  const char* c_str() const { return buf; }
+  size_t length() const { return len; }
+  bool overflowed() const { return full; }
+
+private:
+  static uint32_t magnitude(int32_t value) { return value < 0 ? 0u - (uint32_t)value : (uint32_t)value; }
+
+  TextBuilder& append(const char* s, size_t n) {
+    if (len + n >= cap) { // keep room for the terminator
+      full = true;
+      return *this;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+    return *this;
+  }
+
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool full;
+};
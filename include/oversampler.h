@@ -0,0 +1,109 @@
+/*********************************************************************************************************
+ * Dithered Oversampling for Sub-Resolution Distance Estimates
+ *
+ * Description:
+ *   The HC-SR04 resolves ~3mm per ping, but a static target measured many times with a randomised trigger
+ *   phase spreads the quantisation error evenly, so the mean of N pings resolves finer than one ping. This
+ *   module accumulates echo times in integer sums and decimates them into a mean with a 95% confidence
+ *   interval that shrinks with sqrt(N).
+ *
+ * How It Works:
+ *   1. Dither: randomTriggerDelayUs() gives a random pre-trigger delay so pings sample the quantisation
+ *      step at different phases. The spread is a whole number of steps, so every phase is equally likely
+ *      (a partial step would favour some phases and leave a bias that averaging cannot remove)
+ *   2. Accumulate: sum and sum of squares of the echo times (µs) are kept in 64-bit integers
+ *   3. Decimate: After N pings the mean and standard error are computed in Q8 fixed point (1/256 µs)
+ *
+ * Notes:
+ *   - Only valid for static targets: motion during the N pings is averaged as well
+ *   - Timed-out pings (echo 0) should not be added
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define OVERSAMPLE_MAX_PINGS 256    // upper bound on pings per estimate (keeps sums in range)
+#define OVERSAMPLE_DITHER_US 34     // trigger phase spread, 0..34µs: two whole ~17.5µs resolution steps
+
+// Integer square root (floor) of a 64-bit value
+inline uint32_t isqrt64(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > value) bit >>= 2;
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+// Decimated estimate of N pings
+struct OversampleEstimate {
+  uint32_t meanEchoQ8; // mean echo time (1/256 µs)
+  uint32_t ci95EchoQ8; // 95% confidence half-width of the mean (1/256 µs)
+  uint16_t pings;      // pings that contributed
+};
+
+class Oversampler {
+public:
+  Oversampler() : target(16), count(0), sum(0), sumSq(0) {}
+
+  // Start a new estimate over the given number of pings
+  void begin(uint16_t pings) {
+    if (pings < 2) pings = 2;
+    if (pings > OVERSAMPLE_MAX_PINGS) pings = OVERSAMPLE_MAX_PINGS;
+    target = pings;
+    count = 0;
+    sum = 0;
+    sumSq = 0;
+  }
+
+  // Add one echo time, returns true once the estimate is complete
+  bool addEcho(uint32_t echoUs) {
+    if (count >= target) return true;
+    sum += echoUs;
+    sumSq += (uint64_t)echoUs * echoUs;
+    count++;
+    return count >= target;
+  }
+
+  bool complete() const { return count >= target; }
+  uint16_t pingsTaken() const { return count; }
+  uint16_t pingsPerEstimate() const { return target; }
+
+  OversampleEstimate estimate() const {
+    OversampleEstimate result = { 0, 0, count };
+    if (count < 2) return result;
+
+    result.meanEchoQ8 = (uint32_t)(((sum << 8) + count / 2) / count);
+
+    // Sample variance in Q16 µs²: (n*Σx² - (Σx)²) / (n*(n-1)), scaled by 2^16
+    uint64_t spread = (uint64_t)count * sumSq - sum * sum;
+    uint64_t varianceQ16 = (spread << 16) / ((uint64_t)count * (count - 1));
+
+    // Standard error of the mean in Q8, times 1.96 (502/256)
+    uint32_t stdErrQ8 = isqrt64(varianceQ16 / count);
+    result.ci95EchoQ8 = (uint32_t)(((uint64_t)stdErrQ8 * 502 + 128) >> 8);
+    return result;
+  }
+
+private:
+  uint16_t target;
+  uint16_t count;
+  uint64_t sum;
+  uint64_t sumSq;
+};
+
+// Random pre-trigger delay from a 32-bit random value
+inline uint32_t randomTriggerDelayUs(uint32_t random) {
+  return random % (OVERSAMPLE_DITHER_US + 1);
+}
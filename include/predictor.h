@@ -0,0 +1,53 @@
+/*********************************************************************************************************
+ * Latency-Compensated Position Predictor
+ *
+ * Description:
+ *   A reading is already up to one update interval plus render time old when it reaches the screen. For a
+ *   moving target the predictor extrapolates the reading to the render time using the tracked velocity,
+ *   so the displayed position is where the target is now rather than where it was.
+ *
+ * How It Works:
+ *   1. Age: render time minus the sample timestamp, capped at PREDICT_MAX_HORIZON_MS
+ *   2. Extrapolate: distance + velocity * age, with the correction capped at PREDICT_MAX_STEP_MM
+ *   3. Fallback: The raw reading is returned when the sample has a PREDICT_REJECT_FLAGS flag, its
+ *      confidence is low or there is no valid velocity estimate
+ *
+ * Notes:
+ *   - Extrapolation is first order only (acceleration is too noisy at 4Hz to help)
+ *   - The result is clamped to the sensor range so a prediction never shows an impossible distance
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include "sample.h"
+#include "motion_estimator.h"
+
+#define PREDICT_MAX_HORIZON_MS 500  // never extrapolate further ahead than this
+#define PREDICT_MAX_STEP_MM 300     // largest correction applied to a reading
+#define PREDICT_MIN_CONFIDENCE 128  // below this the raw reading is shown
+#define PREDICT_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED) // never extrapolated
+
+// Distance extrapolated to renderMs (sets predicted to false when falling back to the raw reading)
+inline int32_t predictDistance(const Sample& sample, const MotionState& motion, uint32_t renderMs,
+                               bool& predicted) {
+  predicted = false;
+  if (!sample.accepts(PREDICT_REJECT_FLAGS) || sample.confidence < PREDICT_MIN_CONFIDENCE || !motion.valid) {
+    return sample.distanceMm;
+  }
+
+  uint32_t ageMs = renderMs - sample.timestampMs;
+  if (ageMs > PREDICT_MAX_HORIZON_MS) ageMs = PREDICT_MAX_HORIZON_MS;
+
+  int32_t step = (int32_t)((int64_t)motion.velocityMmS * ageMs / 1000);
+  if (step > PREDICT_MAX_STEP_MM) step = PREDICT_MAX_STEP_MM;
+  if (step < -PREDICT_MAX_STEP_MM) step = -PREDICT_MAX_STEP_MM;
+
+  int32_t distance = sample.distanceMm + step;
+  if (distance < SAMPLE_MIN_MM) distance = SAMPLE_MIN_MM;
+  if (distance > SAMPLE_MAX_MM) distance = SAMPLE_MAX_MM;
+
+  predicted = true;
+  return distance;
+}
@@ -0,0 +1,157 @@
+/*********************************************************************************************************
+ * Background-Model Presence Detection
+ *
+ * Description:
+ *   Turns the distance stream into occupancy events. An adaptive background model learns the distance the
+ *   sensor sees when nobody is there (wall, floor, empty shelf) and how much it normally jitters; a
+ *   reading that departs from that background by more than the jitter explains means something is in
+ *   the beam. Enter and leave events carry timestamps for telemetry and drive the alarm output.
+ *
+ * How It Works:
+ *   1. Background: Exponential moving averages of the distance and of its squared deviation (variance)
+ *      in fixed point, learned only while the scene is empty. The first readings seed it quickly
+ *   2. Enter: The deviation from the background must exceed enterSigmas standard deviations plus a
+ *      minimum distance for enterCount consecutive readings (a single stray echo is not a person)
+ *   3. Leave: The deviation must stay below the lower leaveSigmas threshold for leaveMs (hysteresis, so
+ *      a target near the threshold does not chatter); isolated stray echoes do not restart the timer
+ *   4. Absorb: Something present for longer than absorbMs (a parked trolley) becomes the new background
+ *      and a leave event is reported
+ *
+ * Notes:
+ *   - Costs a handful of integer operations per reading, thresholds are compared squared (no square roots)
+ *   - Learning rate is per reading: at higher ping rates use a larger learnShift for the same time constant
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+enum class PresenceEvent : uint8_t { NONE, ENTER, LEAVE };
+
+struct PresenceConfig {
+  uint8_t learnShift;     // background EMA weight 1/2^learnShift per reading
+  uint8_t enterSigmas;    // deviation (in standard deviations) that indicates presence
+  uint8_t leaveSigmas;    // deviation below which the scene counts as empty again (< enterSigmas)
+  uint16_t minDeltaMm;    // deviation always required on top of the sigma threshold
+  uint8_t enterCount;     // consecutive present readings before an enter event
+  uint32_t leaveMs;       // time below the leave threshold before a leave event
+  uint32_t absorbMs;      // presence longer than this is learned into the background (0 = never)
+};
+
+const PresenceConfig PRESENCE_DEFAULT = { 8, 4, 2, 50, 3, 1000, 300000 };
+
+#define PRESENCE_SEED_READINGS 16    // readings averaged to seed the background
+#define PRESENCE_MIN_VARIANCE 4      // variance floor (mm²), a perfectly steady echo still jitters
+
+class PresenceDetector {
+public:
+  explicit PresenceDetector(const PresenceConfig& config = PRESENCE_DEFAULT) : cfg(config) { reset(); }
+
+  void reset() {
+    meanQ8 = 0;
+    varianceQ8 = 0;
+    seeded = 0;
+    present = false;
+    streak = 0;
+    quietSinceMs = 0;
+    quiet = false;
+    enteredMs = 0;
+  }
+
+  // Feed one reading, returns ENTER or LEAVE when the occupancy changes
+  PresenceEvent update(uint32_t timeMs, int32_t distanceMm) {
+    int32_t xQ8 = distanceMm * 256;
+
+    // Seed the background with a cumulative average of the first readings
+    if (seeded == 0) {
+      meanQ8 = xQ8;
+      varianceQ8 = 0;
+    }
+    if (seeded < PRESENCE_SEED_READINGS) {
+      seeded++;
+      learn(xQ8, seeded);
+      return PresenceEvent::NONE;
+    }
+
+    int32_t deviation = distanceMm - (meanQ8 >> 8);
+    if (deviation < 0) deviation = -deviation;
+
+    if (!present) {
+      if (exceeds(deviation, cfg.enterSigmas)) {
+        if (++streak >= cfg.enterCount) {
+          present = true;
+          quiet = false;
+          streak = 0;
+          enteredMs = timeMs;
+          return PresenceEvent::ENTER;
+        }
+      }
+      else {
+        streak = 0;
+        learn(xQ8, 1u << cfg.learnShift);
+      }
+      return PresenceEvent::NONE;
+    }
+
+    // Long-term presence becomes background
+    if (cfg.absorbMs > 0 && timeMs - enteredMs >= cfg.absorbMs) {
+      meanQ8 = xQ8;
+      return leave();
+    }
+
+    // Leaving also needs consecutive readings to be interrupted, so stray echoes do not hold presence
+    if (exceeds(deviation, cfg.leaveSigmas)) {
+      if (++streak >= cfg.enterCount) quiet = false;
+      return PresenceEvent::NONE;
+    }
+    streak = 0;
+    if (!quiet) {
+      quiet = true;
+      quietSinceMs = timeMs;
+    }
+    return timeMs - quietSinceMs >= cfg.leaveMs ? leave() : PresenceEvent::NONE;
+  }
+
+  bool isPresent() const { return present; }
+  bool ready() const { return seeded >= PRESENCE_SEED_READINGS; }
+
+  // Background model (for display and diagnostics)
+  int32_t backgroundMm() const { return (meanQ8 + 128) >> 8; }
+  float sigmaMm() const { return sqrtf(varianceQ8 / 256.0f); }
+
+private:
+  // EMA of the distance and squared deviation with weight 1/divisor
+  void learn(int32_t xQ8, uint32_t divisor) {
+    int32_t errorQ8 = xQ8 - meanQ8;
+    meanQ8 += errorQ8 / (int32_t)divisor;
+
+    int64_t squareQ8 = ((int64_t)errorQ8 * errorQ8) >> 8;
+    varianceQ8 += (squareQ8 - varianceQ8) / (int64_t)divisor;
+  }
+
+  // deviation > sigmas * sigma + minDelta, compared squared
+  bool exceeds(int32_t deviationMm, uint8_t sigmas) const {
+    int32_t excess = deviationMm - cfg.minDeltaMm;
+    if (excess <= 0) return false;
+    int64_t variance = varianceQ8 < PRESENCE_MIN_VARIANCE * 256 ? PRESENCE_MIN_VARIANCE * 256 : varianceQ8;
+    return (int64_t)excess * excess * 256 > variance * sigmas * sigmas;
+  }
+
+  PresenceEvent leave() {
+    present = false;
+    streak = 0;
+    return PresenceEvent::LEAVE;
+  }
+
+  PresenceConfig cfg;
+  int32_t meanQ8;       // background distance (mm Q8)
+  int64_t varianceQ8;   // background variance (mm² Q8)
+  uint8_t seeded;       // readings in the seed average
+  bool present;
+  uint8_t streak;       // consecutive readings above the enter threshold
+  uint32_t quietSinceMs;
+  bool quiet;           // below the leave threshold since quietSinceMs
+  uint32_t enteredMs;
+};
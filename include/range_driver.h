@@ -0,0 +1,140 @@
+/*********************************************************************************************************
+ * Range Sensor Drivers (HC-SR04, JSN-SR04T, US-100 Serial)
+ *
+ * Description:
+ *   Non-blocking drivers sharing one compile-time interface, so the acquisition state machine can be
+ *   built for any supported sensor without virtual dispatch:
+ *     - begin()                      set up pins / UART
+ *     - startMeasurement(phaseUs)    start a measurement (false while the sensor's minimum cycle runs)
+ *     - poll(nowUs)                  true once the measurement has completed or timed out
+ *     - reading()                    raw echo time and uncalibrated mm of the finished measurement
+ *     - glitches()                   rejected noise pulses / bad frames since start-up
+ *     - MIN_RANGE_MM                 closest distance the sensor reports reliably
+ *
+ * How It Works:
+ *   1. Trigger/Echo (HC-SR04, JSN-SR04T): The trigger pulse is sent, then a CHANGE interrupt on the echo
+ *      pin records edges into an EdgeRing that poll() feeds to an EchoPulseTimer (no pulseIn blocking)
+ *   2. US-100 Serial: startMeasurement() sends 0x55 and poll() parses the 2-byte reply as it arrives
+ *
+ * Notes:
+ *   - JSN-SR04T (waterproof) needs a longer trigger pulse, has a ~25cm blind zone and a longer cycle
+ *   - US-100 in serial mode (jumper fitted): Trig/TX -> MCU TX, Echo/RX -> MCU RX, 9600 baud 8N1
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <Arduino.h>
+#include "echo_timing.h"
+#include "calibration.h"
+
+#define US100_BAUD 9600
+#define US100_REQUEST_DISTANCE 0x55
+#define US100_TIMEOUT_US 100000     // reply takes a few ms, anything past 100ms is lost
+
+// Trigger/echo sensors: pins, trigger pulse width (µs), minimum range (mm) and minimum cycle (ms)
+template <uint8_t TRIG, uint8_t ECHO, uint8_t TRIGGER_PULSE_US, uint16_t MIN_RANGE, uint16_t MIN_CYCLE_MS>
+class TriggerEchoDriver {
+public:
+  static const int32_t MIN_RANGE_MM = MIN_RANGE;
+
+  void begin() {
+    pinMode(TRIG, OUTPUT);
+    pinMode(ECHO, INPUT);
+    digitalWrite(TRIG, LOW);
+    attachInterrupt(digitalPinToInterrupt(ECHO), onEcho, CHANGE);
+    lastStartMs = millis() - MIN_CYCLE_MS;
+  }
+
+  bool startMeasurement(uint32_t phaseDelayUs) {
+    if (millis() - lastStartMs < MIN_CYCLE_MS) return false;
+    lastStartMs = millis();
+
+    // Trigger the sensor with clean pulse (optionally delayed to dither the trigger phase)
+    edges.clear();
+    digitalWrite(TRIG, LOW);
+    delayMicroseconds(2 + phaseDelayUs);
+    digitalWrite(TRIG, HIGH);
+    delayMicroseconds(TRIGGER_PULSE_US);
+    digitalWrite(TRIG, LOW);
+    timer.arm(micros());
+    return true;
+  }
+
+  bool poll(uint32_t nowUs) {
+    EchoEdge edge;
+    while (edges.pop(edge)) timer.onEdge(edge);
+    return timer.finished(nowUs);
+  }
+
+  RawReading reading() const {
+    RawReading result = { timer.echoUs(), echoToRawMm(timer.echoUs()) };
+    return result;
+  }
+
+  // Rejected glitches plus edges lost to noise bursts
+  uint32_t glitches() const { return timer.glitches() + edges.droppedEdges(); }
+
+private:
+  static void IRAM_ATTR onEcho() {
+    edges.push(micros(), digitalRead(ECHO));
+  }
+
+  static EdgeRing edges;
+  EchoPulseTimer timer;
+  unsigned long lastStartMs;
+};
+
+template <uint8_t TRIG, uint8_t ECHO, uint8_t TRIGGER_PULSE_US, uint16_t MIN_RANGE, uint16_t MIN_CYCLE_MS>
+EdgeRing TriggerEchoDriver<TRIG, ECHO, TRIGGER_PULSE_US, MIN_RANGE, MIN_CYCLE_MS>::edges;
+
+// HC-SR04: 10µs trigger, 2cm minimum, re-trigger spacing set by the caller
+template <uint8_t TRIG, uint8_t ECHO>
+using HcSr04Driver = TriggerEchoDriver<TRIG, ECHO, 10, 20, 0>;
+
+// JSN-SR04T: 20µs trigger (10µs is unreliable on v2/v3 boards), 25cm blind zone, 60ms cycle
+template <uint8_t TRIG, uint8_t ECHO>
+using JsnSr04tDriver = TriggerEchoDriver<TRIG, ECHO, 20, 250, 60>;
+
+// US-100 in serial mode on a hardware UART
+template <uint8_t TX, uint8_t RX>
+class Us100SerialDriver {
+public:
+  static const int32_t MIN_RANGE_MM = 20;
+
+  explicit Us100SerialDriver(HardwareSerial& serialPort) : uart(serialPort), startUs(0) {}
+
+  void begin() {
+    uart.begin(US100_BAUD, SERIAL_8N1, RX, TX);
+  }
+
+  bool startMeasurement(uint32_t) {
+    // Drop any late bytes from a previous timed-out request
+    while (uart.available() > 0) uart.read();
+    parser.reset();
+    uart.write(US100_REQUEST_DISTANCE);
+    startUs = micros();
+    return true;
+  }
+
+  bool poll(uint32_t nowUs) {
+    while (uart.available() > 0) {
+      if (parser.feed(uart.read())) return true;
+    }
+    return nowUs - startUs > US100_TIMEOUT_US;
+  }
+
+  RawReading reading() const {
+    int32_t mm = parser.distanceMm();
+    RawReading result = { mmToEchoUs(mm), mm };
+    return result;
+  }
+
+  // Serial mode has no echo line to glitch
+  uint32_t glitches() const { return 0; }
+
+private:
+  HardwareSerial& uart;
+  Us100Parser parser;
+  uint32_t startUs;
+};
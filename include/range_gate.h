@@ -0,0 +1,157 @@
+/*********************************************************************************************************
+ * Range Gating & Static-Obstacle Blanking Windows
+ *
+ * Description:
+ *   Fixed objects in the beam (a mounting bracket, a pipe, a ladder rung) return an echo at the same
+ *   distance on every ping. Blanking windows mark those distance ranges so readings inside them are flagged
+ *   at capture time instead of being filtered downstream. Windows can be entered by hand or learned by
+ *   watching the scene while only the static clutter is present.
+ *
+ * How It Works:
+ *   1. Window Table: Windows are kept sorted by start distance and non-overlapping (added windows that
+ *      overlap or touch are merged), so a lookup is one binary search over a handful of entries
+ *   2. Learn Mode: GateLearner histograms in-range readings into 10mm bins. Bins hit by at least
+ *      GATE_LEARN_MIN_PERCENT of the readings are persistent echoes; runs of such bins become windows,
+ *      widened by GATE_LEARN_MARGIN_MM on each side to absorb jitter
+ *
+ * Notes:
+ *   - Window bounds are inclusive, in calibrated mm
+ *   - The table is a plain array so it can be stored as-is in NVS
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define GATE_MAX_WINDOWS 8          // blanking windows in the table
+#define GATE_LEARN_BIN_MM 10        // learn-mode histogram resolution
+#define GATE_LEARN_BINS 400         // bins cover 0-4000mm
+#define GATE_LEARN_MIN_PERCENT 20   // share of readings that marks a bin as a static echo
+#define GATE_LEARN_MIN_READINGS 20  // fewer readings than this cannot be trusted
+#define GATE_LEARN_MARGIN_MM 20     // widen learned windows by this on each side
+
+struct GateWindow {
+  int32_t fromMm; // inclusive
+  int32_t toMm;   // inclusive
+};
+
+class RangeGate {
+public:
+  RangeGate() : count(0) {}
+
+  // Add a window, merging with any it overlaps or touches (false when the table is full)
+  bool add(int32_t fromMm, int32_t toMm) {
+    if (toMm < fromMm) return false;
+
+    // Absorb every window that overlaps or touches the new one
+    uint8_t first = lowerBound(fromMm - 1);
+    uint8_t last = first;
+    while (last < count && windows[last].fromMm <= toMm + 1) {
+      if (windows[last].fromMm < fromMm) fromMm = windows[last].fromMm;
+      if (windows[last].toMm > toMm) toMm = windows[last].toMm;
+      last++;
+    }
+    if (last == first && count >= GATE_MAX_WINDOWS) return false;
+
+    // Replace windows [first, last) with the merged one
+    uint8_t removed = last - first;
+    if (removed != 1) {
+      memmove(&windows[first + 1], &windows[last], (count - last) * sizeof(GateWindow));
+      count = count + 1 - removed;
+    }
+    windows[first].fromMm = fromMm;
+    windows[first].toMm = toMm;
+    return true;
+  }
+
+  // Remove the window at index (in sorted order)
+  bool remove(uint8_t index) {
+    if (index >= count) return false;
+    memmove(&windows[index], &windows[index + 1], (count - index - 1) * sizeof(GateWindow));
+    count--;
+    return true;
+  }
+
+  void clear() { count = 0; }
+
+  // True if the distance falls inside a blanking window
+  bool blanked(int32_t mm) const {
+    uint8_t i = lowerBound(mm);
+    return i < count && windows[i].fromMm <= mm;
+  }
+
+  uint8_t size() const { return count; }
+  const GateWindow& window(uint8_t index) const { return windows[index]; }
+
+  // Raw table access for persistence
+  const GateWindow* table() const { return windows; }
+  void load(const GateWindow* table, uint8_t n) {
+    clear();
+    for (uint8_t i = 0; i < n && i < GATE_MAX_WINDOWS; i++) add(table[i].fromMm, table[i].toMm);
+  }
+
+private:
+  // First window whose end is at or beyond mm
+  uint8_t lowerBound(int32_t mm) const {
+    uint8_t lo = 0, hi = count;
+    while (lo < hi) {
+      uint8_t mid = (lo + hi) / 2;
+      if (windows[mid].toMm < mm) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  GateWindow windows[GATE_MAX_WINDOWS];
+  uint8_t count;
+};
+
+class GateLearner {
+public:
+  GateLearner() { begin(); }
+
+  void begin() {
+    memset(bins, 0, sizeof(bins));
+    total = 0;
+  }
+
+  void addReading(int32_t mm) {
+    if (mm < 0) return;
+    uint32_t bin = (uint32_t)mm / GATE_LEARN_BIN_MM;
+    if (bin >= GATE_LEARN_BINS) return;
+    if (bins[bin] < UINT16_MAX) bins[bin]++;
+    total++;
+  }
+
+  uint32_t readings() const { return total; }
+
+  // Add windows for the persistent echoes to the gate, returns the number of windows found
+  uint8_t apply(RangeGate& gate) const {
+    if (total < GATE_LEARN_MIN_READINGS) return 0;
+
+    uint32_t threshold = (total * GATE_LEARN_MIN_PERCENT + 99) / 100;
+    uint8_t found = 0;
+    uint16_t bin = 0;
+    while (bin < GATE_LEARN_BINS) {
+      if (bins[bin] < threshold) {
+        bin++;
+        continue;
+      }
+
+      // Extend over the run of persistent bins
+      uint16_t start = bin;
+      while (bin < GATE_LEARN_BINS && bins[bin] >= threshold) bin++;
+
+      int32_t fromMm = (int32_t)start * GATE_LEARN_BIN_MM - GATE_LEARN_MARGIN_MM;
+      int32_t toMm = (int32_t)bin * GATE_LEARN_BIN_MM - 1 + GATE_LEARN_MARGIN_MM;
+      if (gate.add(fromMm < 0 ? 0 : fromMm, toMm)) found++;
+    }
+    return found;
+  }
+
+private:
+  uint16_t bins[GATE_LEARN_BINS];
+  uint32_t total;
+};
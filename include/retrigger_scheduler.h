@@ -0,0 +1,69 @@
+/*********************************************************************************************************
+ * Adaptive Re-Trigger Scheduler
+ *
+ * Description:
+ *   The earliest safe time to ping again is set by how long the previous burst keeps echoing around the
+ *   room. For a near target the echo (and its ring-down) is over in a few milliseconds, so waiting a fixed
+ *   interval wastes most of the available sample rate. This scheduler spaces pings by the previous echo
+ *   time plus a decay margin, falling back to the full interval after a timeout.
+ *
+ * How It Works:
+ *   1. Interval: echo time * (100 + decayPercent) / 100 + decayMarginUs, clamped to [min, max]
+ *   2. Timeout: No echo means the burst may still be travelling to a far reflector, so the maximum
+ *      interval is used before the next ping
+ *   3. Ready: ready(now) is true once the interval has elapsed since the previous trigger
+ *
+ * Notes:
+ *   - Pinging sooner than the multipath decay produces "ghost" echoes from the previous burst that read
+ *     as a spuriously short distance; raise decayMarginUs in reverberant spaces
+ *   - A flat target reflects the burst back off the sensor face, so a second echo arrives at twice the
+ *     echo time; with decayPercent below 100 it lands in the next ping, reads short, shortens the next
+ *     interval and the ghosts feed themselves
+ *   - Setting minIntervalUs = maxIntervalUs gives a fixed-rate scheduler
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+struct RetriggerConfig {
+  uint32_t minIntervalUs;  // never ping faster than this
+  uint32_t maxIntervalUs;  // interval after a timeout (and upper bound)
+  uint32_t decayMarginUs;  // fixed ring-down allowance after the echo
+  uint16_t decayPercent;   // extra allowance proportional to the echo time (multipath)
+};
+
+class RetriggerScheduler {
+public:
+  explicit RetriggerScheduler(const RetriggerConfig& config)
+    : cfg(config), lastTriggerUs(0), interval(config.maxIntervalUs), armed(false) {}
+
+  // Record a finished measurement (echoUs 0 = timeout) started at triggerUs
+  void onMeasurement(uint32_t triggerUs, uint32_t echoUs) {
+    lastTriggerUs = triggerUs;
+    armed = true;
+
+    if (echoUs == 0) {
+      interval = cfg.maxIntervalUs;
+      return;
+    }
+
+    uint64_t next = (uint64_t)echoUs * (100 + cfg.decayPercent) / 100 + cfg.decayMarginUs;
+    if (next < cfg.minIntervalUs) next = cfg.minIntervalUs;
+    if (next > cfg.maxIntervalUs) next = cfg.maxIntervalUs;
+    interval = (uint32_t)next;
+  }
+
+  // True once the next ping is safe
+  bool ready(uint32_t nowUs) const { return !armed || nowUs - lastTriggerUs >= interval; }
+
+  // Current spacing between pings (µs)
+  uint32_t intervalUs() const { return interval; }
+
+private:
+  RetriggerConfig cfg;
+  uint32_t lastTriggerUs;
+  uint32_t interval;
+  bool armed;
+};
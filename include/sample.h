@@ -0,0 +1,160 @@
+/*********************************************************************************************************
+ * Distance Sample with Quality Flags & Confidence
+ *
+ * Description:
+ *   A timestamped distance reading that carries why it can or cannot be trusted. Clamped readings are no
+ *   longer indistinguishable from real ones: a timeout, a target closer than 2cm and a target beyond 4m
+ *   each get their own flag, and a confidence score (0-255) reflects how consistent the echo timing is
+ *   with the recent readings.
+ *
+ * How It Works:
+ *   1. Range: Echo timeouts and out-of-range distances are flagged and clamped to the sensor limits
+ *   2. Consistency: The reading is compared with the trend of the last few in-range readings (their
+ *      median advanced by the median step between readings, so steady motion is not penalised); large
+ *      jumps are flagged as outliers and the confidence falls with the distance from the trend
+ *   3. Blanking: With a RangeGate attached, in-range readings inside a blanking window (a known static
+ *      obstacle) are flagged and kept out of the history
+ *   4. Staleness: Consumers call markStale() when a sample is older than they can accept
+ *
+ * Notes:
+ *   - There is no single "usable" test: each consumer rejects the flags it cannot use with accepts()
+ *     (a sudden jump is an outlier to a line fit but activity to the backlight)
+ *   - The first in-range readings after a gap have reduced confidence until the history fills
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include "range_gate.h"
+
+// Sample status flags
+#define SAMPLE_OK 0x00          // in range and consistent
+#define SAMPLE_TIMEOUT 0x01     // no echo received
+#define SAMPLE_BELOW_MIN 0x02   // closer than the minimum range (clamped to 0)
+#define SAMPLE_ABOVE_MAX 0x04   // beyond the maximum range (clamped to max)
+#define SAMPLE_OUTLIER 0x08     // inconsistent with recent readings
+#define SAMPLE_STALE 0x10       // older than the consumer accepts
+#define SAMPLE_BLANKED 0x20     // inside a blanking window (static obstacle)
+#define SAMPLE_NO_DISTANCE (SAMPLE_TIMEOUT | SAMPLE_BELOW_MIN | SAMPLE_ABOVE_MAX) // distance is a clamp, not a reading
+
+#define SAMPLE_MIN_MM 20        // sensor min range is ~2cm
+#define SAMPLE_MAX_MM 4000      // sensor max range is ~400cm
+#define SAMPLE_OUTLIER_MM 150   // jump from the recent trend that counts as an outlier
+#define SAMPLE_HISTORY 5        // readings used for the median (odd)
+
+struct Sample {
+  uint32_t timestampMs; // time the ping was taken
+  int32_t distanceMm;   // calibrated distance, clamped to the sensor range
+  uint16_t echoUs;      // raw echo pulse duration (0 on timeout)
+  uint8_t flags;        // SAMPLE_* status flags
+  uint8_t confidence;   // 0 (none) to 255 (consistent with recent readings)
+
+  // True when none of the flags the consumer rejects are set
+  bool accepts(uint8_t rejectedFlags) const { return (flags & rejectedFlags) == 0; }
+  bool inRange() const { return accepts(SAMPLE_NO_DISTANCE); }
+};
+
+// Flag a sample as stale if it is older than maxAgeMs
+inline void markStale(Sample& sample, uint32_t nowMs, uint32_t maxAgeMs) {
+  if (nowMs - sample.timestampMs > maxAgeMs) sample.flags |= SAMPLE_STALE;
+}
+
+// Short text for the most significant flag (for display and console output)
+inline const char* sampleStatusText(uint8_t flags) {
+  if (flags & SAMPLE_TIMEOUT) return "timeout";
+  if (flags & SAMPLE_BELOW_MIN) return "too close";
+  if (flags & SAMPLE_ABOVE_MAX) return "out of range";
+  if (flags & SAMPLE_BLANKED) return "blanked";
+  if (flags & SAMPLE_OUTLIER) return "outlier";
+  if (flags & SAMPLE_STALE) return "stale";
+  return "ok";
+}
+
+class SampleClassifier {
+public:
+  SampleClassifier() : gate(nullptr), count(0), next(0) {}
+
+  // Flag readings inside the gate's blanking windows (nullptr disables blanking)
+  void setGate(const RangeGate* rangeGate) { gate = rangeGate; }
+
+  // Build a classified sample from a ping (echoUs 0 = timeout, distanceMm already calibrated)
+  Sample classify(uint32_t timestampMs, uint32_t echoUs, int32_t distanceMm, int32_t minMm = SAMPLE_MIN_MM) {
+    Sample sample = { timestampMs, distanceMm, (uint16_t)(echoUs > 0xFFFF ? 0xFFFF : echoUs), SAMPLE_OK, 0 };
+
+    if (echoUs == 0) {
+      sample.flags = SAMPLE_TIMEOUT;
+      sample.distanceMm = SAMPLE_MAX_MM;
+      return sample;
+    }
+    if (distanceMm < minMm) {
+      sample.flags = SAMPLE_BELOW_MIN;
+      sample.distanceMm = 0;
+      return sample;
+    }
+    if (distanceMm > SAMPLE_MAX_MM) {
+      sample.flags = SAMPLE_ABOVE_MAX;
+      sample.distanceMm = SAMPLE_MAX_MM;
+      return sample;
+    }
+    if (gate != nullptr && gate->blanked(distanceMm)) {
+      sample.flags = SAMPLE_BLANKED;
+      return sample;
+    }
+
+    // Confidence from the distance to the recent trend, scaled down while the history is filling
+    int32_t deviation = count > 0 ? distanceMm - expected() : 0;
+    if (deviation < 0) deviation = -deviation;
+
+    if (count >= SAMPLE_HISTORY && deviation > SAMPLE_OUTLIER_MM) {
+      sample.flags = SAMPLE_OUTLIER;
+    }
+    int32_t consistency = deviation >= SAMPLE_OUTLIER_MM ? 0 : 255 - deviation * 255 / SAMPLE_OUTLIER_MM;
+    sample.confidence = (uint8_t)(consistency * (count + 1) / (SAMPLE_HISTORY + 1));
+
+    // Outliers still enter the history so a real step change is accepted after a few readings
+    history[next] = distanceMm;
+    next = (next + 1) % SAMPLE_HISTORY;
+    if (count < SAMPLE_HISTORY) count++;
+    return sample;
+  }
+
+  // Forget the history (e.g. after a long gap in readings)
+  void reset() { count = 0; next = 0; }
+
+private:
+  // Median of values (insertion sort in place, n is tiny)
+  static int32_t median(int32_t* values, uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) {
+      int32_t value = values[i];
+      int8_t j = i - 1;
+      while (j >= 0 && values[j] > value) {
+        values[j + 1] = values[j];
+        j--;
+      }
+      values[j + 1] = value;
+    }
+    return values[n / 2];
+  }
+
+  // Expected next reading: median of the history advanced by the median step to the newest reading
+  int32_t expected() const {
+    int32_t values[SAMPLE_HISTORY];
+    int32_t steps[SAMPLE_HISTORY];
+    uint8_t oldest = (next + SAMPLE_HISTORY - count) % SAMPLE_HISTORY;
+
+    for (uint8_t i = 0; i < count; i++) {
+      values[i] = history[(oldest + i) % SAMPLE_HISTORY];
+      if (i > 0) steps[i - 1] = values[i] - values[i - 1];
+    }
+    if (count < 3) return values[count - 1];
+
+    int32_t step = median(steps, count - 1);
+    return median(values, count) + step * ((count + 1) / 2);
+  }
+
+  const RangeGate* gate;
+  int32_t history[SAMPLE_HISTORY];
+  uint8_t count;
+  uint8_t next;
+};
@@ -0,0 +1,293 @@
+/*********************************************************************************************************
+ * Delta-of-Delta Sample Codec
+ *
+ * Description:
+ *   Bit-packed compression for sample streams, in the style of Facebook's Gorilla time-series encoding.
+ *   Readings arrive at a nearly fixed rate and the distance changes slowly, so most samples need a few
+ *   bits instead of the 6 bytes of a raw batch record. The same coders are used by the device (compressed
+ *   "S2" batches, see batch_publisher.h) and by the host store (tools/ingest/column_log.h).
+ *
+ * How It Works:
+ *   1. Timestamps: The first is stored raw (32 bits), then only the change of the interval is coded:
+ *        0                   same interval as before
+ *        10   + 7 bits       -63 .. 64 ms
+ *        110  + 9 bits       -255 .. 256 ms
+ *        1110 + 12 bits      -2047 .. 2048 ms
+ *        1111 + 32 bits      anything else
+ *   2. Distances: The first is stored raw (16 bits), then the difference to the previous reading:
+ *        0 (unchanged) | 10 + 4 bits (-8..7) | 110 + 7 bits (-64..63) | 1110 + 10 bits (-512..511) |
+ *        1111 + 16 bits (raw value)
+ *   3. Status bytes (flags, confidence): 0 when unchanged, otherwise 1 + 8 bits
+ *   4. Streaming: SampleEncoder appends one sample at a time and refuses (rolling back) a sample that
+ *      would not fit the buffer; SampleDecoder returns samples one at a time, so neither side needs the
+ *      whole stream in memory
+ *
+ * Notes:
+ *   - Bits are packed MSB first; the final byte is zero-padded by finish()
+ *   - Arithmetic is modulo 2^32, so timestamps that wrap (millis() after 49 days) round-trip exactly
+ *   - A stream carries no length; the container stores the sample count
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SampleRecord {
+  uint32_t timestampMs;
+  uint16_t distanceMm;
+  uint8_t flags;
+  uint8_t confidence;
+};
+
+inline uint32_t codecMask(uint8_t bits) { return bits >= 32 ? 0xFFFFFFFFu : (1u << bits) - 1; }
+
+class BitWriter {
+public:
+  BitWriter(uint8_t* buffer, size_t capacity)
+    : buf(buffer), capBits((uint64_t)capacity * 8), pos(0), acc(0), accBits(0), full(false) {}
+
+  // Append the low bits of value (bits <= 32); sets full() instead of writing past the buffer
+  void write(uint32_t value, uint8_t bits) {
+    if (full || usedBits() + bits > capBits) {
+      full = true;
+      return;
+    }
+    acc = (acc << bits) | (value & codecMask(bits));
+    accBits += bits;
+    while (accBits >= 8) {
+      accBits -= 8;
+      buf[pos++] = (uint8_t)(acc >> accBits);
+    }
+  }
+
+  // Write the zero-padded final byte, returns the stream length in bytes
+  size_t finish() {
+    if (accBits > 0) {
+      buf[pos++] = (uint8_t)(acc << (8 - accBits));
+      accBits = 0;
+    }
+    return pos;
+  }
+
+  struct Mark {
+    size_t pos;
+    uint64_t acc;
+    uint8_t accBits;
+  };
+  Mark mark() const { return Mark{ pos, acc, accBits }; }
+  void restore(const Mark& m) {
+    pos = m.pos;
+    acc = m.acc;
+    accBits = m.accBits;
+    full = false;
+  }
+
+  uint64_t usedBits() const { return (uint64_t)pos * 8 + accBits; }
+  bool overflowed() const { return full; }
+
+private:
+  uint8_t* buf;
+  uint64_t capBits;
+  size_t pos;
+  uint64_t acc;
+  uint8_t accBits;
+  bool full;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t* buffer, size_t length) : buf(buffer), len(length), pos(0), acc(0), accBits(0) {}
+
+  // Next bits (<= 32) of the stream; reading past the end returns zeros and sets exhausted()
+  uint32_t read(uint8_t bits) {
+    while (accBits < bits) {
+      acc = (acc << 8) | (pos < len ? buf[pos] : 0);
+      pos++;
+      accBits += 8;
+    }
+    accBits -= bits;
+    return (uint32_t)(acc >> accBits) & codecMask(bits);
+  }
+
+  bool exhausted() const { return pos > len; }
+
+private:
+  const uint8_t* buf;
+  size_t len;
+  size_t pos;
+  uint64_t acc;
+  uint8_t accBits;
+};
+
+// Timestamp column: delta-of-delta
+class TimestampCoder {
+public:
+  TimestampCoder() : previous(0), previousDelta(0), started(false) {}
+
+  void encode(BitWriter& out, uint32_t timestampMs) {
+    if (!started) {
+      out.write(timestampMs, 32);
+      started = true;
+    }
+    else {
+      uint32_t delta = timestampMs - previous;
+      int32_t dod = (int32_t)(delta - previousDelta);
+      if (dod == 0) out.write(0, 1);
+      else if (dod >= -63 && dod <= 64) { out.write(0x2, 2); out.write((uint32_t)(dod + 63), 7); }
+      else if (dod >= -255 && dod <= 256) { out.write(0x6, 3); out.write((uint32_t)(dod + 255), 9); }
+      else if (dod >= -2047 && dod <= 2048) { out.write(0xE, 4); out.write((uint32_t)(dod + 2047), 12); }
+      else { out.write(0xF, 4); out.write((uint32_t)dod, 32); }
+      previousDelta = delta;
+    }
+    previous = timestampMs;
+  }
+
+  uint32_t decode(BitReader& in) {
+    if (!started) {
+      started = true;
+      previous = in.read(32);
+      return previous;
+    }
+    uint32_t dod;
+    if (in.read(1) == 0) dod = 0;
+    else if (in.read(1) == 0) dod = in.read(7) - 63;
+    else if (in.read(1) == 0) dod = in.read(9) - 255;
+    else if (in.read(1) == 0) dod = in.read(12) - 2047;
+    else dod = in.read(32);
+    previousDelta += dod;
+    previous += previousDelta;
+    return previous;
+  }
+
+private:
+  uint32_t previous;
+  uint32_t previousDelta;
+  bool started;
+};
+
+// Distance column: delta to the previous reading
+class DistanceCoder {
+public:
+  DistanceCoder() : previous(0), started(false) {}
+
+  void encode(BitWriter& out, uint16_t mm) {
+    int32_t delta = (int32_t)mm - previous;
+    if (!started) { out.write(mm, 16); started = true; }
+    else if (delta == 0) out.write(0, 1);
+    else if (delta >= -8 && delta <= 7) { out.write(0x2, 2); out.write((uint32_t)(delta + 8), 4); }
+    else if (delta >= -64 && delta <= 63) { out.write(0x6, 3); out.write((uint32_t)(delta + 64), 7); }
+    else if (delta >= -512 && delta <= 511) { out.write(0xE, 4); out.write((uint32_t)(delta + 512), 10); }
+    else { out.write(0xF, 4); out.write(mm, 16); }
+    previous = mm;
+  }
+
+  uint16_t decode(BitReader& in) {
+    if (!started) {
+      started = true;
+      previous = (uint16_t)in.read(16);
+    }
+    else if (in.read(1) == 0) {}
+    else if (in.read(1) == 0) previous = (uint16_t)(previous + (int32_t)in.read(4) - 8);
+    else if (in.read(1) == 0) previous = (uint16_t)(previous + (int32_t)in.read(7) - 64);
+    else if (in.read(1) == 0) previous = (uint16_t)(previous + (int32_t)in.read(10) - 512);
+    else previous = (uint16_t)in.read(16);
+    return previous;
+  }
+
+private:
+  uint16_t previous;
+  bool started;
+};
+
+// Flags / confidence: repeat bit
+class ByteCoder {
+public:
+  ByteCoder() : previous(0) {}
+
+  void encode(BitWriter& out, uint8_t value) {
+    if (value == previous) out.write(0, 1);
+    else out.write(0x100 | value, 9);
+    previous = value;
+  }
+
+  uint8_t decode(BitReader& in) {
+    if (in.read(1)) previous = (uint8_t)in.read(8);
+    return previous;
+  }
+
+private:
+  uint8_t previous;
+};
+
+// Interleaved stream of whole samples (timestamp, distance, flags, confidence)
+class SampleEncoder {
+public:
+  SampleEncoder(uint8_t* buffer, size_t capacity) : out(buffer, capacity), samples(0) {}
+
+  // Append a sample; false (and nothing written) if it does not fit
+  bool append(const SampleRecord& record) {
+    BitWriter::Mark mark = out.mark();
+    TimestampCoder savedTime = time;
+    DistanceCoder savedDistance = distance;
+    ByteCoder savedFlags = flags;
+    ByteCoder savedConfidence = confidence;
+
+    time.encode(out, record.timestampMs);
+    distance.encode(out, record.distanceMm);
+    flags.encode(out, record.flags);
+    confidence.encode(out, record.confidence);
+    if (out.overflowed()) {
+      out.restore(mark);
+      time = savedTime;
+      distance = savedDistance;
+      flags = savedFlags;
+      confidence = savedConfidence;
+      return false;
+    }
+    samples++;
+    return true;
+  }
+
+  size_t finish() { return out.finish(); }
+  uint32_t count() const { return samples; }
+  uint64_t bits() const { return out.usedBits(); }
+
+private:
+  BitWriter out;
+  TimestampCoder time;
+  DistanceCoder distance;
+  ByteCoder flags;
+  ByteCoder confidence;
+  uint32_t samples;
+};
+
+class SampleDecoder {
+public:
+  SampleDecoder(const uint8_t* stream, size_t length, uint32_t sampleCount)
+    : in(stream, length), remaining(sampleCount) {}
+
+  // Next sample; false at the end of the stream (or if the stream is truncated)
+  bool next(SampleRecord& record) {
+    if (remaining == 0) return false;
+    record.timestampMs = time.decode(in);
+    record.distanceMm = distance.decode(in);
+    record.flags = flags.decode(in);
+    record.confidence = confidence.decode(in);
+    if (in.exhausted()) {
+      remaining = 0;
+      return false;
+    }
+    remaining--;
+    return true;
+  }
+
+private:
+  BitReader in;
+  TimestampCoder time;
+  DistanceCoder distance;
+  ByteCoder flags;
+  ByteCoder confidence;
+  uint32_t remaining;
+};
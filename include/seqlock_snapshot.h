@@ -0,0 +1,56 @@
+/*********************************************************************************************************
+ * Double-Buffered Snapshot (Sequence Lock)
+ *
+ * Description:
+ *   Hands a block of values from the one task that owns them to readers in any other task without a
+ *   lock: the Modbus register map (modbus_rtu.h) and the exported metrics (metrics_exporter.h). Neither
+ *   side ever waits, and a reader never sees a copy that is half updated.
+ *
+ * How It Works:
+ *   1. Buffers: Two copies of T and a sequence number; the sequence's low bit selects the current copy
+ *   2. Writer: edit() returns the idle copy, publish() bumps the sequence to make it current and then
+ *      copies it back into the new idle one, so the next edit starts from the published values
+ *   3. Reader: read() copies the current buffer and retries if the sequence moved during the copy
+ *
+ * Notes:
+ *   - One writer only; T is copied with memcpy, so it must not own pointers into itself
+ *   - The writer publishes at most once per reading, far slower than a copy, so a read rarely retries
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+template <typename T>
+class SeqlockSnapshot {
+public:
+  SeqlockSnapshot() : buffers(), sequence(0) {}
+
+  // Copy to fill before publish() (not visible to readers)
+  T& edit() { return buffers[(sequence + 1) & 1]; }
+
+  // Make the edited copy current; the next edit starts from it
+  void publish() {
+    __sync_synchronize();
+    sequence = sequence + 1;
+    __sync_synchronize();
+    buffers[(sequence + 1) & 1] = buffers[sequence & 1];
+  }
+
+  // Copy the current values (retries only if a publish overlapped the copy)
+  void read(T& out) const {
+    uint32_t before;
+    do {
+      before = sequence;
+      __sync_synchronize();
+      memcpy((void*)&out, (const void*)&buffers[before & 1], sizeof(T));
+      __sync_synchronize();
+    } while (sequence != before);
+  }
+
+private:
+  T buffers[2];
+  volatile uint32_t sequence;
+};
@@ -0,0 +1,99 @@
+/*********************************************************************************************************
+ * Live-Stream Client Admission & Backpressure
+ *
+ * Description:
+ *   Decides, for each sample batch, which WebSocket clients get it. A fixed number of clients is admitted
+ *   so the web server's memory use is bounded. A client whose send queue is still full when the next batch
+ *   is due skips that batch instead of growing the queue, and a client that keeps falling behind is
+ *   dropped so it cannot hold buffers forever. Acquisition never waits on a slow viewer.
+ *
+ * How It Works:
+ *   1. Admission: admit() takes a free slot for a new connection id and its client, refusing once
+ *      STREAM_MAX_CLIENTS are connected
+ *   2. Per Batch: onBatch(id, writable) returns SEND when the client can take more data, SKIP while it
+ *      cannot, and DROP once it has skipped STREAM_MAX_SKIPS batches in a row
+ *   3. Clients: The table keeps each admitted client's handle and id, so a sender can reach the viewers
+ *      without walking the web server's own client list
+ *
+ * Notes:
+ *   - Transport independent: the device stores AsyncWebSocketClient pointers and passes canSend(), host
+ *     tests a non-blocking socket's writability
+ *   - Not thread safe: on the device it is changed and used only on the async_tcp task (connect /
+ *     disconnect events and the viewers' batch requests), under a mutex so the loop can read the counters
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#define STREAM_MAX_CLIENTS 4        // concurrent live-stream viewers
+#define STREAM_MAX_SKIPS 25         // consecutive skipped batches before a client is dropped
+
+enum class StreamAction : uint8_t { SEND, SKIP, DROP };
+
+template <typename Client>
+class StreamClients {
+public:
+  StreamClients() : count(0), skipped(0), droppedClients(0) {}
+
+  // Take a slot for a new client (false when all slots are in use)
+  bool admit(uint32_t id, Client* client) {
+    if (find(id) >= 0) return true;
+    if (count >= STREAM_MAX_CLIENTS) return false;
+    slots[count].id = id;
+    slots[count].client = client;
+    slots[count].skips = 0;
+    count++;
+    return true;
+  }
+
+  void remove(uint32_t id) {
+    int8_t i = find(id);
+    if (i < 0) return;
+    slots[i] = slots[count - 1];
+    count--;
+  }
+
+  // What to do with the next batch for this client
+  StreamAction onBatch(uint32_t id, bool writable) {
+    int8_t i = find(id);
+    if (i < 0) return StreamAction::DROP;
+
+    if (writable) {
+      slots[i].skips = 0;
+      return StreamAction::SEND;
+    }
+    skipped++;
+    if (++slots[i].skips < STREAM_MAX_SKIPS) return StreamAction::SKIP;
+
+    droppedClients++;
+    remove(id);
+    return StreamAction::DROP;
+  }
+
+  uint8_t size() const { return count; }
+  uint32_t id(uint8_t index) const { return slots[index].id; }
+  Client* client(uint8_t index) const { return slots[index].client; }
+  uint32_t skippedBatches() const { return skipped; }
+  uint32_t slowClientsDropped() const { return droppedClients; }
+
+private:
+  int8_t find(uint32_t id) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (slots[i].id == id) return i;
+    }
+    return -1;
+  }
+
+  struct Slot {
+    uint32_t id;
+    Client* client;
+    uint8_t skips;
+  };
+
+  Slot slots[STREAM_MAX_CLIENTS];
+  uint8_t count;
+  uint32_t skipped;
+  uint32_t droppedClients;
+};
@@ -0,0 +1,180 @@
+/*********************************************************************************************************
+ * Tank Level-to-Volume Conversion & Flow Estimation
+ *
+ * Description:
+ *   Converts the liquid level (tank depth minus measured distance) into a volume for the common tank
+ *   shapes or a custom strapping table. The geometry is evaluated once into a fixed-point piecewise-linear
+ *   table, so each conversion is a binary search plus one multiply instead of trigonometry per reading.
+ *   A least-squares slope over recent volumes gives the fill / draw-off rate.
+ *
+ * How It Works:
+ *   1. Geometry: Vertical cylinder (pi r² h), horizontal cylinder (circular segment area x length),
+ *      rectangular (L x W x h), or a strapping table of measured (level, volume) points
+ *   2. Table: Breakpoints are placed uniformly in level, except for the horizontal cylinder where they
+ *      follow a cosine spacing to crowd the curved bottom and top of the tank. Each segment stores its
+ *      start volume and slope (mL per mm, Q8)
+ *   3. Lookup: Binary search for the segment, then volume = start + slope x (level - segment start)
+ *   4. Flow: Volumes decimated to one per FLOW_SPACING_MS feed a SlopeWindow, giving mL/s averaged over
+ *      the window (sloshing and ripple average out)
+ *
+ * Notes:
+ *   - Volumes are in mL (uint32_t, up to ~4 million litres; flow estimation up to ~2 million), levels in mm
+ *   - Levels outside the tank are clamped to empty / full
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+#include "motion_estimator.h"
+
+#define TANK_TABLE_POINTS 33        // breakpoints in the volume table (32 segments)
+#define FLOW_WINDOW 16              // volume points in the flow slope
+#define FLOW_SPACING_MS 1000        // minimum time between flow points
+
+enum class TankShape : uint8_t {
+  VERTICAL_CYLINDER,
+  HORIZONTAL_CYLINDER,
+  RECTANGULAR
+};
+
+struct TankGeometry {
+  TankShape shape;
+  uint32_t heightMm;   // depth of liquid when full (vertical cylinder, rectangular)
+  uint32_t diameterMm; // cylinders
+  uint32_t lengthMm;   // horizontal cylinder length, rectangular length
+  uint32_t widthMm;    // rectangular width
+};
+
+// Measured point of a strapping table
+struct StrapPoint {
+  int32_t levelMm;
+  uint32_t volumeMl;
+};
+
+class VolumeTable {
+public:
+  VolumeTable() : count(0) {}
+
+  // Build the table from tank geometry (false for a degenerate tank)
+  bool build(const TankGeometry& tank) {
+    uint32_t height = tank.shape == TankShape::HORIZONTAL_CYLINDER ? tank.diameterMm : tank.heightMm;
+    if (height == 0) return false;
+
+    for (uint8_t i = 0; i < TANK_TABLE_POINTS; i++) {
+      double fraction = (double)i / (TANK_TABLE_POINTS - 1);
+      if (tank.shape == TankShape::HORIZONTAL_CYLINDER) fraction = (1.0 - cos(M_PI * fraction)) / 2.0;
+
+      double level = fraction * height;
+      levels[i] = (int32_t)(level + 0.5);
+      volumes[i] = (uint32_t)(volumeMm3(tank, levels[i]) / 1000.0 + 0.5);
+    }
+    count = TANK_TABLE_POINTS;
+    return computeSlopes();
+  }
+
+  // Build the table from a strapping table (levels strictly increasing, volumes not decreasing)
+  bool build(const StrapPoint* points, uint8_t n) {
+    if (n < 2 || n > TANK_TABLE_POINTS) return false;
+    for (uint8_t i = 0; i < n; i++) {
+      if (i > 0 && (points[i].levelMm <= points[i - 1].levelMm || points[i].volumeMl < points[i - 1].volumeMl)) {
+        count = 0;
+        return false;
+      }
+      levels[i] = points[i].levelMm;
+      volumes[i] = points[i].volumeMl;
+    }
+    count = n;
+    return computeSlopes();
+  }
+
+  // Volume at a liquid level (mL)
+  uint32_t volumeMl(int32_t levelMm) const {
+    if (count == 0) return 0;
+    if (levelMm <= levels[0]) return volumes[0];
+    if (levelMm >= levels[count - 1]) return volumes[count - 1];
+
+    // Last breakpoint at or below the level
+    uint8_t lo = 0, hi = count - 1;
+    while (hi - lo > 1) {
+      uint8_t mid = (lo + hi) / 2;
+      if (levels[mid] <= levelMm) lo = mid;
+      else hi = mid;
+    }
+    return volumes[lo] + (uint32_t)(((uint64_t)slopeQ8[lo] * (uint32_t)(levelMm - levels[lo]) + 128) >> 8);
+  }
+
+  uint32_t capacityMl() const { return count == 0 ? 0 : volumes[count - 1]; }
+  int32_t fullLevelMm() const { return count == 0 ? 0 : levels[count - 1]; }
+  bool valid() const { return count > 0; }
+
+private:
+  // Exact liquid volume at a level (mm³), used only while building the table
+  static double volumeMm3(const TankGeometry& tank, double level) {
+    switch (tank.shape) {
+      case TankShape::VERTICAL_CYLINDER: {
+          double r = tank.diameterMm / 2.0;
+          return M_PI * r * r * level;
+        }
+
+      case TankShape::HORIZONTAL_CYLINDER: {
+          // Circular segment of depth 'level' times the tank length
+          double r = tank.diameterMm / 2.0;
+          if (level >= 2 * r) return M_PI * r * r * tank.lengthMm;
+          double segment = r * r * acos((r - level) / r) - (r - level) * sqrt(2 * r * level - level * level);
+          return segment * tank.lengthMm;
+        }
+
+      case TankShape::RECTANGULAR:
+        return (double)tank.lengthMm * tank.widthMm * level;
+    }
+    return 0;
+  }
+
+  // Slope of each segment (mL per mm, Q8, rounded)
+  bool computeSlopes() {
+    for (uint8_t i = 0; i + 1 < count; i++) {
+      uint32_t span = (uint32_t)(levels[i + 1] - levels[i]);
+      if (span == 0) {
+        count = 0;
+        return false;
+      }
+      uint64_t slope = (((uint64_t)(volumes[i + 1] - volumes[i]) << 8) + span / 2) / span;
+      if (slope > UINT32_MAX) {
+        count = 0;
+        return false;
+      }
+      slopeQ8[i] = (uint32_t)slope;
+    }
+    return true;
+  }
+
+  int32_t levels[TANK_TABLE_POINTS];
+  uint32_t volumes[TANK_TABLE_POINTS];
+  uint32_t slopeQ8[TANK_TABLE_POINTS - 1];
+  uint8_t count;
+};
+
+// Fill (+) / draw-off (-) rate from the volume stream
+class FlowEstimator {
+public:
+  FlowEstimator() : lastMs(0) {}
+
+  void reset() { window.reset(); }
+
+  void update(uint32_t timeMs, uint32_t volumeMl) {
+    if (window.size() > 0 && timeMs - lastMs < FLOW_SPACING_MS) return;
+    lastMs = timeMs;
+    window.add(timeMs, (int32_t)volumeMl);
+  }
+
+  bool valid() const { return window.ready(); }
+
+  // Flow rate in mL/s (0 until enough points)
+  int32_t mlPerSecond() const { return window.slopePerSecond(); }
+
+private:
+  SlopeWindow<FLOW_WINDOW> window;
+  uint32_t lastMs;
+};
@@ -0,0 +1,101 @@
+/*********************************************************************************************************
+ * Tearing-Effect (TE) Synchronised Push Scheduler
+ *
+ * Description:
+ *   Models the ST7789 refresh as a scan line sweeping the panel rows once per frame period. Given a
+ *   dirty band of rows and the time it takes to write one row, the scheduler works out how long to wait
+ *   so the band is written while the scan line is outside of it, so the panel never shows half of an
+ *   old frame and half of a new one.
+ *
+ * How It Works:
+ *   1. Vsync: onVsync() anchors the scan line to row 0 (called from the TE interrupt, or once at init
+ *      for the timed estimate). Consecutive vsyncs refine the frame period estimate.
+ *   2. Scan Line: scanline() extrapolates the current row from the last vsync and the frame period.
+ *   3. Scheduling: delayForBand() returns the wait (µs) until the band can be written without the scan
+ *      line entering it. Bands too tall to fit between two scans are started just behind the scan line.
+ *   4. Ordering: orderBands() sorts pending bands so the one that becomes safe first is pushed first.
+ *
+ * Notes:
+ *   - Pure logic with time passed in by the caller, so it can be driven by a simulated clock on host
+ *   - Without a wired TE pin the phase is only an estimate anchored at init and will drift slowly
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+// A horizontal band of panel rows [y0, y1) waiting to be pushed
+struct DirtyBand {
+  uint16_t y0;
+  uint16_t y1;
+};
+
+class TearScheduler {
+public:
+  TearScheduler(uint16_t panelRows, uint32_t framePeriodUs)
+    : rows(panelRows), periodUs(framePeriodUs), lastVsyncUs(0) {}
+
+  // Anchor the scan line to row 0 at nowUs and refine the period estimate
+  void onVsync(uint32_t nowUs) {
+    uint32_t measured = nowUs - lastVsyncUs;
+
+    // Only accept periods within +/-25% of the current estimate (rejects missed/double pulses)
+    if (lastVsyncUs != 0 && measured > periodUs - periodUs / 4 && measured < periodUs + periodUs / 4) {
+      periodUs = (periodUs * 7 + measured) / 8; // slow EMA to track panel oscillator drift
+    }
+    lastVsyncUs = nowUs;
+  }
+
+  // Current scan line row (0 to rows-1)
+  uint16_t scanline(uint32_t nowUs) const {
+    uint32_t phase = (nowUs - lastVsyncUs) % periodUs;
+    return (uint16_t)((uint64_t)phase * rows / periodUs);
+  }
+
+  // Microseconds to wait before writing band [y0, y1) at rowWriteUs per row (0 = push now)
+  uint32_t delayForBand(uint16_t y0, uint16_t y1, uint32_t rowWriteUs, uint32_t nowUs) const {
+    if (y1 <= y0) return 0;
+
+    uint32_t phase = (nowUs - lastVsyncUs) % periodUs;
+    uint32_t bandStart = rowTime(y0); // phase at which the scan line enters the band
+    uint32_t bandEnd = rowTime(y1);   // phase at which the scan line leaves the band
+    uint32_t writeUs = (uint32_t)(y1 - y0) * rowWriteUs;
+    uint32_t gapUs = periodUs - (bandEnd - bandStart); // time per frame the scan line is outside the band
+
+    // Band cannot be written within one gap: start right behind the scan line as it enters the band
+    if (writeUs > gapUs) {
+      return (bandStart + periodUs - phase) % periodUs;
+    }
+
+    // Phase relative to the scan line leaving the band: safe while write completes before re-entry
+    uint32_t sinceExit = (phase + periodUs - bandEnd) % periodUs;
+    if (sinceExit + writeUs <= gapUs) return 0;
+
+    return periodUs - sinceExit; // wait for the scan line to leave the band again
+  }
+
+  // Sort bands so the one that can be pushed soonest comes first (insertion sort, n is tiny)
+  void orderBands(DirtyBand* bands, uint8_t count, uint32_t rowWriteUs, uint32_t nowUs) const {
+    for (uint8_t i = 1; i < count; i++) {
+      DirtyBand band = bands[i];
+      uint32_t wait = delayForBand(band.y0, band.y1, rowWriteUs, nowUs);
+      int8_t j = i - 1;
+      while (j >= 0 && delayForBand(bands[j].y0, bands[j].y1, rowWriteUs, nowUs) > wait) {
+        bands[j + 1] = bands[j];
+        j--;
+      }
+      bands[j + 1] = band;
+    }
+  }
+
+  uint32_t framePeriodUs() const { return periodUs; }
+
+private:
+  // Phase within the frame at which the scan line reaches row y (rounded up, so scanline() already reports y)
+  uint32_t rowTime(uint16_t y) const { return (uint32_t)(((uint64_t)y * periodUs + rows - 1) / rows); }
+
+  uint16_t rows;
+  uint32_t periodUs;
+  uint32_t lastVsyncUs;
+};
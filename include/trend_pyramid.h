@@ -0,0 +1,141 @@
+/*********************************************************************************************************
+ * Multi-Resolution Min/Max Trend Pyramid
+ *
+ * Description:
+ *   Summarises the sample history at several time resolutions (e.g. 1s, 10s, 1min, 10min buckets) so hours
+ *   of data can be drawn on a 170 pixel wide screen by reading one bucket per pixel column, instead of
+ *   scanning raw history on every redraw.
+ *
+ * How It Works:
+ *   1. Buckets: Each bucket holds min, max, sum and count of the samples in its time slot
+ *   2. Incremental Update: A sample only touches the open bucket of the finest level. When a bucket's slot
+ *      ends it is closed into that level's ring and folded into the open bucket of the next coarser level,
+ *      so each coarser level is built from closed buckets, never from raw samples
+ *   3. Gaps: Slots with no samples are closed as empty buckets, so bucket i back always covers the slot
+ *      i durations before the newest one (one column per slot when drawing)
+ *
+ * Notes:
+ *   - Each level duration should be a whole multiple of the previous one
+ *   - Per-sample cost is O(1) amortised; closing a slot cascades at most once per level
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+struct TrendBucket {
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  uint32_t count; // 0 = no samples in this slot
+
+  void clear() {
+    min = INT32_MAX;
+    max = INT32_MIN;
+    sum = 0;
+    count = 0;
+  }
+
+  void add(int32_t value) {
+    if (value < min) min = value;
+    if (value > max) max = value;
+    sum += value;
+    count++;
+  }
+
+  void merge(const TrendBucket& other) {
+    if (other.count == 0) return;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+    sum += other.sum;
+    count += other.count;
+  }
+
+  int32_t mean() const { return count == 0 ? 0 : (int32_t)(sum / (int64_t)count); }
+};
+
+template <uint8_t LEVELS, uint16_t COLUMNS>
+class TrendPyramid {
+public:
+  // durationsMs: bucket duration of each level, finest first
+  explicit TrendPyramid(const uint32_t (&durationsMs)[LEVELS]) : started(false) {
+    for (uint8_t level = 0; level < LEVELS; level++) {
+      levels[level].durationMs = durationsMs[level];
+      levels[level].head = 0;
+      levels[level].filled = 0;
+      levels[level].open.clear();
+    }
+  }
+
+  void add(uint32_t timeMs, int32_t value) {
+    if (!started) {
+      for (uint8_t level = 0; level < LEVELS; level++) {
+        levels[level].openStartMs = timeMs - timeMs % levels[level].durationMs;
+      }
+      started = true;
+    }
+    advance(0, timeMs);
+    levels[0].open.add(value);
+  }
+
+  // Closed buckets available at a level (up to COLUMNS)
+  uint16_t available(uint8_t level) const { return levels[level].filled; }
+
+  // Closed bucket 'back' slots before the newest (0 = most recently closed)
+  const TrendBucket& bucket(uint8_t level, uint16_t back) const {
+    const Level& l = levels[level];
+    return l.ring[(l.head + COLUMNS - 1 - back) % COLUMNS];
+  }
+
+  // Bucket still collecting samples (the current slot)
+  const TrendBucket& openBucket(uint8_t level) const { return levels[level].open; }
+
+  uint32_t durationMs(uint8_t level) const { return levels[level].durationMs; }
+
+private:
+  struct Level {
+    uint32_t durationMs;
+    uint32_t openStartMs;
+    TrendBucket open;
+    TrendBucket ring[COLUMNS];
+    uint16_t head;
+    uint16_t filled;
+  };
+
+  // Close every slot of 'level' that ended before timeMs, cascading closed buckets upwards
+  void advance(uint8_t level, uint32_t timeMs) {
+    Level& l = levels[level];
+    if (timeMs - l.openStartMs < l.durationMs) return;
+
+    uint32_t slots = (timeMs - l.openStartMs) / l.durationMs;
+    closeSlot(level);
+
+    // Empty slots in a gap: only the last ring's worth can ever be drawn, skip the rest
+    uint32_t emptySlots = slots - 1;
+    if (emptySlots > COLUMNS) {
+      l.openStartMs += (emptySlots - COLUMNS) * l.durationMs;
+      emptySlots = COLUMNS;
+    }
+    while (emptySlots-- > 0) closeSlot(level);
+  }
+
+  // Close the open bucket into the ring, fold it into the next level and open the following slot
+  void closeSlot(uint8_t level) {
+    Level& l = levels[level];
+    l.ring[l.head] = l.open;
+    l.head = (l.head + 1) % COLUMNS;
+    if (l.filled < COLUMNS) l.filled++;
+
+    if (level + 1 < LEVELS) {
+      advance(level + 1, l.openStartMs);
+      levels[level + 1].open.merge(l.open);
+    }
+
+    l.open.clear();
+    l.openStartMs += l.durationMs;
+  }
+
+  Level levels[LEVELS];
+  bool started;
+};
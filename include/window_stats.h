@@ -0,0 +1,105 @@
+/*********************************************************************************************************
+ * Rolling Windowed Statistics (Min / Max / Mean / Standard Deviation)
+ *
+ * Description:
+ *   Keeps min, max, mean and standard deviation over the most recent samples, bounded by time ("last 10s"),
+ *   by count ("last 100 readings") or both. Every operation is O(1) amortised and nothing is allocated
+ *   after construction, so it can run per sample at high ping rates.
+ *
+ * How It Works:
+ *   1. History: Samples are stored in a fixed ring of CAPACITY entries, each tagged with a sequence number
+ *   2. Min/Max: Two monotonic deques hold the sequence numbers of candidates; a new sample pops every
+ *      candidate it beats from the back, so the front is always the window min (or max)
+ *   3. Mean/Variance: Running integer sums of the values and their squares, updated on add and evict
+ *
+ * Notes:
+ *   - CAPACITY must be a power of 2 so free-running sequence numbers stay consistent when they wrap
+ *   - CAPACITY bounds the window: at rates above CAPACITY / span the window becomes count-limited
+ *   - Values are integers (mm); mean and standard deviation are returned as floats for display
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+template <uint16_t CAPACITY>
+class WindowStats {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2 (sequence numbers wrap)");
+
+public:
+  // spanMs = 0 disables the time bound, maxCount = 0 uses the full capacity
+  WindowStats(uint32_t spanMs, uint16_t maxCount = 0)
+    : span(spanMs), limit(maxCount == 0 || maxCount > CAPACITY ? CAPACITY : maxCount) {
+    clear();
+  }
+
+  void clear() {
+    first = next = 0;
+    minHead = minTail = maxHead = maxTail = 0;
+    sum = sumSq = 0;
+  }
+
+  void add(uint32_t timeMs, int32_t value) {
+    // Make room in the ring before storing
+    if (size() >= limit) evictOldest();
+
+    uint32_t seq = next++;
+    times[seq % CAPACITY] = timeMs;
+    values[seq % CAPACITY] = value;
+    sum += value;
+    sumSq += (int64_t)value * value;
+
+    // Monotonic deques: drop candidates the new value dominates
+    while (minTail != minHead && values[minQueue[(minTail - 1) % CAPACITY] % CAPACITY] >= value) minTail--;
+    minQueue[minTail++ % CAPACITY] = seq;
+    while (maxTail != maxHead && values[maxQueue[(maxTail - 1) % CAPACITY] % CAPACITY] <= value) maxTail--;
+    maxQueue[maxTail++ % CAPACITY] = seq;
+
+    expire(timeMs);
+  }
+
+  // Drop samples that have aged out of the time window (call when no new samples arrive)
+  void expire(uint32_t nowMs) {
+    if (span == 0) return;
+    while (size() > 0 && nowMs - times[first % CAPACITY] > span) evictOldest();
+  }
+
+  uint16_t size() const { return (uint16_t)(next - first); }
+  bool empty() const { return size() == 0; }
+
+  int32_t min() const { return empty() ? 0 : values[minQueue[minHead % CAPACITY] % CAPACITY]; }
+  int32_t max() const { return empty() ? 0 : values[maxQueue[maxHead % CAPACITY] % CAPACITY]; }
+
+  float mean() const { return empty() ? 0.0f : (float)sum / size(); }
+
+  // Population standard deviation
+  float stddev() const {
+    uint16_t n = size();
+    if (n < 2) return 0.0f;
+    int64_t spread = (int64_t)n * sumSq - sum * sum; // n² * variance, exact in integers
+    return spread <= 0 ? 0.0f : sqrtf((float)spread) / n;
+  }
+
+private:
+  void evictOldest() {
+    uint32_t seq = first++;
+    int32_t value = values[seq % CAPACITY];
+    sum -= value;
+    sumSq -= (int64_t)value * value;
+    if (minHead != minTail && minQueue[minHead % CAPACITY] == seq) minHead++;
+    if (maxHead != maxTail && maxQueue[maxHead % CAPACITY] == seq) maxHead++;
+  }
+
+  uint32_t span;
+  uint16_t limit;
+  uint32_t times[CAPACITY];
+  int32_t values[CAPACITY];
+  uint32_t minQueue[CAPACITY];
+  uint32_t maxQueue[CAPACITY];
+  uint32_t first, next;              // sequence numbers of the oldest and next sample
+  uint32_t minHead, minTail;         // deque bounds (free-running, indexed modulo CAPACITY)
+  uint32_t maxHead, maxTail;
+  int64_t sum, sumSq;
+};
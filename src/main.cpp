@@ -9,22 +9,62 @@
  *
  * Key Features:
  *   - Displays measured distance in millimeters (mm) for higher precision
+ *   - Large anti-aliased digits, pre-rendered once into a glyph atlas so an update is a single push
  *   - Visual meter shows distance in centimeters (0-100cm)
+ *   - Selectable meter colormaps (red-green, viridis, traffic-light, monochrome) built at compile time
  *   - Smooth updates using a sptite to prevent flickering
- *   - Non-blocking state machine implementation
+ *   - Only the rows of the meter that changed are pushed, synchronised to the panel refresh (no tearing)
+ *   - Backlight dims after a period of inactivity and the panel sleeps, waking instantly on motion
+ *   - Per-unit two-point calibration (offset & gain) stored in NVS
+ *   - High-resolution mode averaging dithered pings for sub-mm estimates of static targets
+ *   - Every reading carries quality flags (timeout, too close, out of range, outlier, stale) and a
+ *     confidence score, shown on screen and streamed as serial telemetry
+ *   - Closing speed, acceleration and time-to-contact estimated from the sample stream
+ *   - Rolling min / max / mean / standard deviation over the last 10s, displayed and telemetered
+ *   - Long-term trend views (1s, 10s, 1min, 10min per pixel column) selected with the KEY button
+ *   - Optional latency compensation: moving targets are shown where they are now, not when pinged
+ *   - Echo-line glitch rejection (latency window, minimum pulse width, dropout bridging)
+ *   - Compile-time choice of range sensor driver: HC-SR04, JSN-SR04T (waterproof) or US-100 (serial)
+ *   - Adaptive re-trigger: pings as soon as the previous echo has decayed, so near targets are sampled
+ *     far faster than the 4Hz display refresh
+ *   - Presence detection against a learned background, with enter/leave events and an alarm output
+ *   - Optional tank volume (vertical / horizontal cylinder, rectangular or strapping table) and fill rate
+ *   - Modbus RTU slave on RS-485 so PLCs can poll readings, statistics and settings directly
+ *   - Optional MQTT publishing: samples batched into compact binary payloads by a task on the other core,
+ *     buffered in RAM while the network is down and drained once it is back
+ *   - Optional web dashboard with a WebSocket live stream (capped viewers, slow viewers skip batches)
+ *   - Prometheus metrics at /metrics (sample, timeout and glitch counters, render time histogram, heap)
+ *   - Blanking windows ignore known static obstacles (entered by hand or learned), stored in NVS
+ *   - Non-blocking state machine implementation (echo timed by interrupt, no pulseIn)
  *
  * How It Works:
- *   1. Sensor Reading: Triggers the HC-SR04 and measures echo pulse duration
- *   2. Distance Calculation: Converts pulse duration to distance in cm, then to mm for display
- *   3. Display: Shows measured distance numerically in mm and as a visual level meter (0 to 100cm)
- *   4. State Machine: Manages timing of sensor readings and display updates (4Hz refresh rate)
+ *   1. Sensor Reading: Triggers the sensor and times the echo pulse from interrupt-captured edges,
+ *      validating the trigger -> rise -> fall sequence and rejecting noise pulses
+ *      (or requests and parses the distance over UART for the US-100)
+ *   2. Distance Calculation: Converts pulse duration to mm in fixed point and applies the per-unit
+ *      calibration (one multiply-add)
+ *   3. Classification: Flags timeouts, out-of-range and blanked readings and scores consistency with
+ *      recent readings
+ *   4. Motion: Sliding least-squares slopes give velocity and acceleration, and time-to-contact while
+ *      the target approaches
+ *   5. Display: Shows measured distance numerically in mm and as a visual level meter (0 to 100cm),
+ *      extrapolated along the tracked velocity to the time it is on screen when prediction is enabled
+ *   6. Tear Sync: Dirty meter bands are pushed while the panel scan line is outside them, using the
+ *      ST7789 TE signal when wired or a timed estimate of the refresh otherwise
+ *   7. Power: PWM backlight dims when the distance stops changing, then the panel sleeps and rendering
+ *      is suspended until the next significant change
+ *   8. State Machines: Acquisition runs continuously, spacing pings by the last echo time plus a decay
+ *      margin; display updates run independently at a 4Hz refresh rate
  *
  * Pin Connections:
  *   - HC-SR04 Trig  -> GPIO1 (output)
  *   - HC-SR04 Echo  -> GPIO2 (input)
  *   - HC-SR04 GND   -> GND
  *   - HC-SR04 VCC   -> 5V
- *   - LCD Backlight -> GPIO15
+ *   - LCD Backlight -> GPIO15 (PWM)
+ *   - KEY Button    -> GPIO14 (on board, cycles meter / trend views)
+ *   - Alarm Output  -> GPIO16 (high while presence is detected)
+ *   - RS-485 (Modbus) -> GPIO17 TX, GPIO18 RX, GPIO21 DE/RE (MAX485 or similar transceiver)
  *
  * Notes:
  *   - Keep sensor perpendicular to measured surface for accurate readings
@@ -32,6 +72,22 @@
  *   - Visual meter shows 0-100cm range while numeric display shows actual measurement (20mm-4000mm)
  *   - For best results, avoid measuring soft/uneven surfaces and in areas with high noise
  *   - The TFT_eSPI library is configured for LilyGO T-Display-S3
+ *   - Calibrate over the serial monitor (115200): place a target at a known distance and send
+ *     "cal <mm>", repeat at a second distance. "cal show" prints the result, "cal reset" clears it
+ *   - Telemetry lines "S,<ms>,<mm>,<flags>,<confidence>" are printed per display update ("tele off" to stop),
+ *     followed by "M,<ms>,<mm/s>,<mm/s²>,<ttc ms>" once a motion estimate is available and
+ *     "W,<ms>,<min>,<max>,<mean>,<stddev>" for the rolling 10s window. Presence events are printed as
+ *     they happen: "P,<ms>,ENTER|LEAVE,<mm>". With a tank configured, "V,<ms>,<litres>,<L/min>" follows
+ *   - "stats" prints the sample count, current ping interval and the number of rejected echo glitches
+ *   - "hires <n>" averages n dithered pings per reading (static targets only), "hires off" disables it
+ *   - Modbus (address 1, 19200 8N1). Input registers (04): 0 distance mm, 1 flags, 2 confidence,
+ *     3-4 timestamp ms, 5 velocity mm/s, 6-9 10s min / max / mean mm / stddev x10, 10-11 sample count,
+ *     12 echo glitches, 13 presence, 14-15 volume x0.1L, 16 flow x0.1L/min, 17 ping interval x0.1ms,
+ *     18 background mm, 19 Modbus CRC errors (32-bit values high word first, signed as two's complement).
+ *     Holding registers (03/06): 0 telemetry on/off, 1 hi-res pings (0 = off), 2 view (0 = meter, 1-4 trend)
+ *   - "gate add <from> <to>" blanks a distance range (mm), "gate del <n>", "gate clear" and "gate list"
+ *     manage the table; "gate learn <s>" watches the scene for s seconds (clutter only, no target) and
+ *     blanks the persistent echoes it finds
  *
  * HC-SR04 Specifications:
  *   - Measurement Range: ~2cm to ~400cm (20mm to 4000mm)
@@ -49,14 +105,46 @@
 
 #include <Arduino.h>
 #include <TFT_eSPI.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <ESPAsyncWebServer.h>
+#include "tear_sync.h"
+#include "backlight_manager.h"
+#include "calibration.h"
+#include "oversampler.h"
+#include "sample.h"
+#include "motion_estimator.h"
+#include "predictor.h"
+#include "range_driver.h"
+#include "window_stats.h"
+#include "trend_pyramid.h"
+#include "retrigger_scheduler.h"
+#include "range_gate.h"
+#include "presence_detector.h"
+#include "tank_volume.h"
+#include "modbus_rtu.h"
+#include "batch_publisher.h"
+#include "stream_clients.h"
+#include "dashboard_html.h"
+#include "metrics_exporter.h"
+#include "number_format.h"
+#include "glyph_atlas.h"
+#include "colormap.h"
 
 // TFT_eSPI
 TFT_eSPI tft = TFT_eSPI();
 TFT_eSprite meterFillSprite = TFT_eSprite(&tft);
 
 // HC-SR04 Pins
-#define TRIGGER_PIN 1 // digital pin connected to Trig (GPIO1)
-#define ECHO_PIN 2    // digital pin connected to Echo (GPIO2)
+#define TRIGGER_PIN 1 // digital pin connected to Trig (GPIO1), US-100 Trig/TX in serial mode
+#define ECHO_PIN 2    // digital pin connected to Echo (GPIO2), US-100 Echo/RX in serial mode
+
+// Range sensor selection
+#define RANGE_SENSOR_HCSR04 0        // HC-SR04 trigger/echo
+#define RANGE_SENSOR_JSNSR04T 1      // JSN-SR04T waterproof trigger/echo
+#define RANGE_SENSOR_US100 2         // US-100 in serial mode (UART1)
+#define RANGE_SENSOR RANGE_SENSOR_HCSR04
 
 // Display parameters
 #define LEVEL_METER_X 50       // x position
@@ -66,52 +154,706 @@ TFT_eSprite meterFillSprite = TFT_eSprite(&tft);
 #define MIN_DISTANCE_CM 0      // minimum distance to display
 #define MAX_DISTANCE_CM 100    // maximum distance to display
 
-// State Machine States
+// Meter colormap (also used by the trend plot)
+#define COLORMAP_RED_GREEN 0         // red near to green far (original ramp)
+#define COLORMAP_VIRIDIS 1           // dark purple to yellow, readable with colour blindness
+#define COLORMAP_TRAFFIC_LIGHT 2     // red, amber, green
+#define COLORMAP_MONOCHROME 3        // grey to white
+#define METER_COLORMAP COLORMAP_RED_GREEN
+#define METER_ZONE_LOW_CM 0          // zone boundaries for flat colour bands, e.g. 20 and 50 (0 = unused)
+#define METER_ZONE_HIGH_CM 0
+
+// Tear sync parameters
+#define TEAR_SYNC_MODE 1             // 0 = off, 1 = timed estimate, 2 = ST7789 TE pin
+#define LCD_TE_PIN -1                // GPIO wired to the panel TE output (only used in mode 2)
+#define LCD_PANEL_ROWS 320           // rows scanned per frame (portrait)
+#define LCD_FRAME_PERIOD_US 16667    // ST7789 default frame rate is ~60Hz
+#define MAX_DIRTY_BANDS 2            // meter bands that can be pending at once
+
+// Backlight parameters
+#define BACKLIGHT_PIN 15             // LCD backlight (GPIO15)
+#define BACKLIGHT_PWM_CHANNEL 0      // LEDC channel
+#define BACKLIGHT_PWM_FREQ 10000     // PWM frequency (Hz), above audible range
+#define BACKLIGHT_PWM_BITS 8         // duty resolution (0-255)
+#define BACKLIGHT_DIM_AFTER_MS 30000 // inactivity before dimming
+#define BACKLIGHT_SLEEP_AFTER_MS 120000 // inactivity before the panel sleeps
+#define ACTIVITY_THRESHOLD_MM 20     // distance change that counts as activity
+
+// Presence detection parameters
+#define ALARM_PIN 16                 // alarm output, high while presence is detected
+#define PRESENCE_LEARN_SHIFT 10      // background learns 1/1024 per reading (~15s at 70Hz pings)
+#define PRESENCE_MIN_DELTA_MM 50     // smallest departure from the background that counts
+#define PRESENCE_LEAVE_MS 1000       // time back at the background before a leave event
+#define PRESENCE_ABSORB_MS 300000    // presence longer than 5min becomes background
+
+// Tank volume parameters (level = TANK_EMPTY_DISTANCE_MM - measured distance)
+#define TANK_NONE 0                  // volume conversion off
+#define TANK_VERTICAL_CYLINDER 1     // TANK_DIAMETER_MM x TANK_HEIGHT_MM
+#define TANK_HORIZONTAL_CYLINDER 2   // TANK_DIAMETER_MM x TANK_LENGTH_MM
+#define TANK_RECTANGULAR 3           // TANK_LENGTH_MM x TANK_WIDTH_MM x TANK_HEIGHT_MM
+#define TANK_STRAPPING 4             // measured table in tankStrapping[]
+#define TANK_TYPE TANK_NONE
+#define TANK_EMPTY_DISTANCE_MM 1500  // sensor to tank bottom
+#define TANK_HEIGHT_MM 1200          // liquid depth when full
+#define TANK_DIAMETER_MM 1000
+#define TANK_LENGTH_MM 2000
+#define TANK_WIDTH_MM 1000
+
+// Modbus RTU parameters
+#define MODBUS_ENABLED 1             // 0 = no Modbus slave
+#define MODBUS_SERIAL Serial2        // UART used for RS-485
+#define MODBUS_ADDRESS 1             // slave address (1-247)
+#define MODBUS_BAUD 19200            // 8N1
+#define MODBUS_TX_PIN 17             // to transceiver DI
+#define MODBUS_RX_PIN 18             // from transceiver RO
+#define MODBUS_DE_PIN 21             // transceiver DE/RE (driven by the UART in RS-485 mode)
+#define MODBUS_RX_TIMEOUT_SYMBOLS 4  // receive timeout ending a frame (>= 3.5 characters)
+
+// Wi-Fi parameters (used by MQTT and the web dashboard)
+#define WIFI_SSID ""
+#define WIFI_PASSWORD ""
+
+// MQTT parameters (fill in the Wi-Fi details and the broker, then set MQTT_ENABLED to 1)
+#define MQTT_ENABLED 0
+#define MQTT_HOST "192.168.1.10"
+#define MQTT_PORT 1883
+#define MQTT_TOPIC "sensors/distance"  // batches go to <topic>/<client id>/samples
+#define MQTT_SAMPLE_INTERVAL_MS 100  // queue at most one sample per 100ms (10Hz)
+#define MQTT_BATCH_INTERVAL_MS 5000  // publish the queued samples every 5s
+#define MQTT_MAX_BATCHES_PER_PASS 4  // batches per pass while draining a backlog
+#define MQTT_BUFFER_SAMPLES 4096     // store-and-forward depth (~7min at 10Hz, 32KB)
+#define MQTT_COMPRESSED 1            // 1 = bit-packed "S2" batches (~2x smaller), 0 = plain "S1"
+#define MQTT_RECONNECT_MS 5000       // broker reconnect attempt interval
+#define MQTT_TASK_CORE 0             // the Arduino loop (acquisition) runs on core 1
+
+// Web dashboard parameters (dashboard at http://<device>/, live stream at ws://<device>/ws)
+#define WEB_ENABLED 0
+#define WEB_PORT 80
+#define WEB_STREAM_INTERVAL_MS 200   // one batch to each viewer 5 times a second
+#define WEB_BUFFER_SAMPLES 256       // samples held between stream batches
+
+#define METRICS_ENABLED 1            // Prometheus metrics at http://<device>/metrics (needs WEB_ENABLED)
+#define METRICS_BUFFER_SIZE 4096     // exposition text buffer (one scrape at a time)
+
+#define WIFI_ENABLED (MQTT_ENABLED || WEB_ENABLED)
+
+// Display timing
+#define RENDER_DEADLINE_US 20000     // display update budget (draw + tear-synced push)
+
+// Distance readout (anti-aliased digits from a glyph atlas built at start-up)
+#define READOUT_X 4                  // x position of the digit strip
+#define READOUT_Y 20                 // y position of the digit strip
+#define READOUT_WIDTH 144            // strip width, the value is right-aligned ("4500.0" fits)
+#define READOUT_HEIGHT 36            // digit height (px)
+#define READOUT_CELL_WIDTH 28        // widest glyph held by the atlas (px)
+#define READOUT_SOURCE_FONT 8        // built-in font the glyphs are scaled down from (75px digits)
+
+// High-resolution mode parameters
+#define HIRES_DEFAULT_PINGS 64       // pings averaged per estimate
+
+// Acquisition parameters
+#define ADAPTIVE_RETRIGGER 1         // 0 = one ping per display update (fixed 4Hz)
+#define RETRIGGER_MIN_US 5000        // never ping faster than 200Hz
+#define RETRIGGER_MAX_US 60000       // interval after a timeout (datasheet measurement cycle)
+#define RETRIGGER_DECAY_MARGIN_US 8000 // ring-down allowance after the echo (~1.4m of multipath)
+#define RETRIGGER_DECAY_PERCENT 100  // proportional allowance: the second bounce arrives at twice the echo time
+
+// Sample quality parameters
+#define SAMPLE_STALE_MS 1000         // readings older than this are shown as stale
+#define LOW_CONFIDENCE 128           // readings below this confidence are highlighted
+
+// Flags each consumer of a reading rejects (SAMPLE_NO_DISTANCE = timeout or clamped to the range)
+#define TRUSTED_REJECT_FLAGS (SAMPLE_OUTLIER | SAMPLE_STALE | SAMPLE_BLANKED)          // readout drawn highlighted
+#define MOTION_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED)     // line fit needs real positions
+#define STATS_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED)      // min/max and trends
+#define VOLUME_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED)     // splashes, inlet pipe
+#define BACKLIGHT_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_BLANKED)                   // a sudden jump is activity
+#define PRESENCE_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED)   // the background learns only real echoes
+
+// Motion parameters
+#define SHOW_MOTION_READOUT 1        // show velocity / time-to-contact below the meter
+#define MOTION_SAVGOL 0              // 1 = Savitzky-Golay derivatives (even sample spacing only)
+#define MOTION_GAP_RESET_MS 1000     // restart the estimate after a gap in usable readings
+#define MOTION_MIN_SPACING_MS 50     // decimate fast pings so the window spans a useful time
+#define PREDICTIVE_DISPLAY 1         // extrapolate moving targets to the time they are on screen
+#define MOTION_READOUT_Y (LEVEL_METER_Y + LEVEL_METER_HEIGHT + 8) // y position of the motion readout (below the 0cm label)
+
+// Rolling statistics parameters
+#define STATS_WINDOW_MS 10000        // window for the min/max readout
+#define STATS_CAPACITY 1024          // samples held (power of 2), window is count-limited above ~100Hz
+#define STATS_READOUT_Y 66           // y position of the min/max readout (small font, above the meter)
+
+// Trend view parameters
+#define VIEW_BUTTON_PIN 14           // on-board KEY button (active low)
+#define BUTTON_DEBOUNCE_MS 50        // ignore bounces shorter than this
+#define TREND_LEVELS 4               // 1s, 10s, 1min, 10min per column
+#define TREND_COLUMNS 160            // pixel columns in the trend plot
+#define TREND_X 5                    // x position of the oldest column
+#define VIEW_METER -1                // displayView value for the level meter
+
+// Console parameters
+#define CONSOLE_LINE_LENGTH 48       // longest accepted serial command
+
+// Acquisition State Machine States
+enum class AcquisitionState {
+  TRIGGER_SENSOR, // state for starting a measurement
+  AWAIT_ECHO      // state for waiting for the measurement to complete
+};
+
+// Display State Machine States
 enum class State {
-  READ_SENSOR,    // state for reading sensor data
   UPDATE_DISPLAY, // state for updating the display
+  PUSH_DISPLAY,   // state for pushing dirty bands in sync with the panel refresh
   WAIT            // state for waiting between updates
 };
 
 // Global variables
-State currentState = State::READ_SENSOR;  // initial state
+State currentState = State::WAIT;         // initial state (first update after one interval)
+AcquisitionState acquisitionState = AcquisitionState::TRIGGER_SENSOR;
 unsigned long previousMillis = 0;         // for non-blocking timing
 const unsigned long updateInterval = 250; // update every 250ms (4Hz refresh)
 long duration = 0;                        // pulse duration in microseconds
+unsigned long measurementMillis = 0;      // time the current measurement was started
+uint32_t measurementMicros = 0;           // trigger time of the current measurement (µs)
+uint32_t sampleCount = 0;                 // measurements completed since start-up
 float distance_cm = 0;                    // distance in centimeters
 float prev_distance_cm = -1;              // previous distance value
+int32_t raw_distance_mm = 0;              // uncalibrated distance in millimeters
+Sample currentSample = { 0, 0, 0, SAMPLE_TIMEOUT, 0 }; // latest classified reading
+SampleClassifier sampleClassifier;
+bool telemetryEnabled = true;             // print a telemetry line per reading
+
+// Motion
+MotionEstimator motion(MOTION_SAVGOL);
+uint32_t lastUsableMillis = 0;            // time of the last usable reading
+int prevFillHeight = 0;                   // meter fill height currently on the panel (px)
+
+// Meter colours (generated at compile time, one lookup per row)
+#if METER_COLORMAP == COLORMAP_VIRIDIS
+constexpr ColormapTable meterColormap = makeColormap(VIRIDIS_STOPS, true);
+#elif METER_COLORMAP == COLORMAP_TRAFFIC_LIGHT
+constexpr ColormapTable meterColormap = makeColormap(TRAFFIC_LIGHT_STOPS, false);
+#elif METER_COLORMAP == COLORMAP_MONOCHROME
+constexpr ColormapTable meterColormap = makeColormap(MONOCHROME_STOPS, true);
+#else
+constexpr ColormapTable meterColormap = makeColormap(RED_GREEN_STOPS, false);
+#endif
+constexpr uint16_t meterZoneLow = METER_ZONE_LOW_CM * (COLORMAP_SIZE - 1) / MAX_DISTANCE_CM;
+constexpr uint16_t meterZoneHigh = METER_ZONE_HIGH_CM * (COLORMAP_SIZE - 1) / MAX_DISTANCE_CM;
+static_assert(zonesIncreasing(meterZoneLow, meterZoneHigh),
+              "METER_ZONE_LOW_CM must be below METER_ZONE_HIGH_CM and both within MAX_DISTANCE_CM");
+constexpr ColormapTable meterColours = withZones(meterColormap, meterZoneLow, meterZoneHigh);
+
+// Tear sync
+TearScheduler tearScheduler(LCD_PANEL_ROWS, LCD_FRAME_PERIOD_US);
+DirtyBand dirtyBands[MAX_DIRTY_BANDS];    // meter bands waiting to be pushed (panel rows)
+uint8_t dirtyBandCount = 0;
+uint32_t rowWriteUs = 4;                  // measured time to push one meter row (µs)
+volatile uint32_t teVsyncUs = 0;          // timestamp of the last TE pulse (set from ISR)
+
+// Backlight (power figures are estimates for the T-Display-S3 panel at 3.3V)
+const BacklightConfig backlightConfig = {
+  BACKLIGHT_DIM_AFTER_MS, BACKLIGHT_SLEEP_AFTER_MS, ACTIVITY_THRESHOLD_MM,
+  255, 40,     // active / dimmed duty
+  330, 60, 5   // active / dimmed / asleep power (mW)
+};
+BacklightManager backlight(backlightConfig);
+
+// Presence detection (4 sigma to enter, 2 sigma to leave, 3 readings to confirm)
+const PresenceConfig presenceConfig = {
+  PRESENCE_LEARN_SHIFT, 4, 2, PRESENCE_MIN_DELTA_MM, 3, PRESENCE_LEAVE_MS, PRESENCE_ABSORB_MS
+};
+PresenceDetector presence(presenceConfig);
+
+// Tank volume
+#if TANK_TYPE == TANK_STRAPPING
+const StrapPoint tankStrapping[] = {     // (level mm, volume mL) from the tank's calibration chart
+  { 0, 0 }, { 100, 60000 }, { 300, 220000 }, { 600, 480000 }, { 900, 750000 }, { 1200, 1010000 }
+};
+#endif
+VolumeTable tankTable;
+FlowEstimator tankFlow;
+uint32_t currentVolumeMl = 0;             // volume at the latest usable reading
+
+// Modbus (holding register limits: telemetry, hi-res pings, view)
+#if MODBUS_ENABLED
+const uint16_t modbusHoldingMax[MODBUS_HOLDING_REGS] = { 1, OVERSAMPLE_MAX_PINGS, TREND_LEVELS };
+ModbusRtuSlave modbus(MODBUS_ADDRESS, modbusHoldingMax);
+ModbusSnapshot modbusSnapshot;
+#endif
+
+// MQTT
+#if MQTT_ENABLED
+WiFiClient wifiClient;
+PubSubClient mqttClient(wifiClient);
+BatchPublisher<MQTT_BUFFER_SAMPLES> samplePublisher(MQTT_COMPRESSED);
+char mqttClientId[24];                    // "distance-<mac>"
+char mqttTopic[64];                       // "<MQTT_TOPIC>/<client id>/samples"
+unsigned long lastQueuedMillis = 0;       // time of the last sample queued for MQTT
+#endif
+
+// Web dashboard
+#if WEB_ENABLED
+AsyncWebServer webServer(WEB_PORT);
+AsyncWebSocket webSocket("/ws");
+StreamClients<AsyncWebSocketClient> streamClients; // changed on the async_tcp task, guarded by streamMutex
+SemaphoreHandle_t streamMutex;            // recursive: closing a client may raise its disconnect event in place
+BatchPublisher<WEB_BUFFER_SAMPLES> liveStream;
+uint8_t liveBatch[BATCH_PAYLOAD_MAX];     // newest stream batch, handed from the loop to the viewers' requests
+size_t liveBatchLength = 0;               // (both guarded by streamMutex)
+unsigned long lastStreamMillis = 0;       // time of the last stream batch
+#endif
+
+// Pipeline health (exported as metrics)
+uint32_t timeoutCount = 0;                // measurements without an echo
+uint32_t renderDeadlineMisses = 0;        // display updates over RENDER_DEADLINE_US
+uint32_t renderStartUs = 0;               // start of the current display update
+const uint32_t renderBucketsUs[] = { 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+LatencyHistogram<7> renderTime(renderBucketsUs);
+#if WEB_ENABLED && METRICS_ENABLED
+// Values the loop owns, copied for the web server task through metricsSnapshot
+struct DeviceMetrics {
+  DeviceMetrics() : renderTime(renderBucketsUs) {}
+
+  uint32_t samples = 0;
+  uint32_t timeouts = 0;
+  uint32_t echoGlitches = 0;
+  uint32_t renderDeadlineMisses = 0;
+  LatencyHistogram<7> renderTime;
+  int32_t distanceMm = 0;
+  uint8_t flags = 0;
+  uint8_t confidence = 0;
+  uint32_t pingIntervalUs = 0;
+  bool present = false;
+  uint8_t streamViewers = 0;
+  uint32_t streamSkippedBatches = 0;
+  uint32_t modbusCrcErrors = 0;
+  uint32_t mqttDroppedSamples = 0;
+  uint32_t mqttBufferedSamples = 0;
+};
+MetricsSnapshot<DeviceMetrics> metricsSnapshot;
+char metricsBuffer[METRICS_BUFFER_SIZE];
+bool metricsBusy = false;                 // a scrape is still being sent from metricsBuffer (async_tcp task only)
+#endif
+
+// Distance readout glyphs (white = trusted, yellow = highlighted) and the strip they are composed in
+GlyphAtlas<READOUT_CELL_WIDTH, READOUT_HEIGHT> readoutGlyphs[2];
+uint16_t readoutStrip[READOUT_WIDTH * READOUT_HEIGHT];
+bool readoutShowsValue = false;           // strip holds digits (false: status text)
+
+// Rolling statistics over usable readings
+WindowStats<STATS_CAPACITY> recentStats(STATS_WINDOW_MS);
+
+// Trend pyramid and view selection
+const uint32_t trendDurationsMs[TREND_LEVELS] = { 1000, 10000, 60000, 600000 };
+const char* const trendLabels[TREND_LEVELS] = { "1s", "10s", "1min", "10min" };
+TrendPyramid<TREND_LEVELS, TREND_COLUMNS> trendPyramid(trendDurationsMs);
+int8_t displayView = VIEW_METER;          // VIEW_METER or the trend level shown
+int8_t requestedView = VIEW_METER;        // view selected with the button, applied on the next update
+
+// Acquisition scheduling
+#if ADAPTIVE_RETRIGGER
+const RetriggerConfig retriggerConfig = {
+  RETRIGGER_MIN_US, RETRIGGER_MAX_US, RETRIGGER_DECAY_MARGIN_US, RETRIGGER_DECAY_PERCENT
+};
+#else
+const RetriggerConfig retriggerConfig = { updateInterval * 1000, updateInterval * 1000, 0, 0 };
+#endif
+RetriggerScheduler retrigger(retriggerConfig);
+
+// Range sensor
+#if RANGE_SENSOR == RANGE_SENSOR_US100
+Us100SerialDriver<TRIGGER_PIN, ECHO_PIN> rangeSensor(Serial1);
+#elif RANGE_SENSOR == RANGE_SENSOR_JSNSR04T
+JsnSr04tDriver<TRIGGER_PIN, ECHO_PIN> rangeSensor;
+#else
+HcSr04Driver<TRIGGER_PIN, ECHO_PIN> rangeSensor;
+#endif
+
+// Calibration
+Preferences preferences;
+Calibration calibration = CAL_IDENTITY;
+CalibrationRoutine calibrationRoutine;
+
+// Blanking windows
+RangeGate rangeGate;
+GateLearner gateLearner;
+bool gateLearning = false;                // learn mode running
+unsigned long gateLearnEndMillis = 0;     // time learn mode finishes
+
+// High-resolution mode
+bool hiResMode = false;                   // average dithered pings instead of single readings
+Oversampler oversampler;
+unsigned long hiResStartMillis = 0;       // time the current estimate started
 
 
 /*************************************************************
 ********************** HELPER FUNCTIONS **********************
 **************************************************************/
 
-// Function to create gradient colours
-uint16_t getGradientColour(float distance) {
-  // Normalize distance to 0.0-1.0 range
-  float ratio = constrain(distance / MAX_DISTANCE_CM, 0.0, 1.0);
-  
-  // Calculate colour components (red to green gradient)
-  uint8_t red = 255 * (1.0 - ratio); // lower distances towards red
-  uint8_t green = 255 * ratio;       // higher distances towards green
-  uint8_t blue = 0;
-  
-  // Convert to 16-bit colour (RGB565)
-  return ((red & 0xF8) << 8) | ((green & 0xFC) << 3) | (blue >> 3);
+// TE interrupt: the panel raises TE at the start of vertical blanking
+void IRAM_ATTR onTearingEffect() {
+  teVsyncUs = micros();
 }
 
-// Function to draw the static screen elements
-void drawStaticScreen() {
-  tft.fillScreen(TFT_BLACK);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+// Function to queue a band of sprite rows to be pushed to the panel
+void queueMeterBand(int spriteRow0, int spriteRow1) {
+  if (spriteRow1 <= spriteRow0 || dirtyBandCount >= MAX_DIRTY_BANDS) return;
+
+  dirtyBands[dirtyBandCount].y0 = LEVEL_METER_Y + 1 + spriteRow0;
+  dirtyBands[dirtyBandCount].y1 = LEVEL_METER_Y + 1 + spriteRow1;
+  dirtyBandCount++;
+}
+
+// Function to push queued bands once the scan line is clear of them (returns true when all pushed)
+bool pushDirtyBands() {
+#if TEAR_SYNC_MODE == 2
+  // Re-anchor the scan line model on each new TE pulse
+  static uint32_t lastTeUs = 0;
+  uint32_t te = teVsyncUs;
+  if (te != lastTeUs) {
+    tearScheduler.onVsync(te);
+    lastTeUs = te;
+  }
+#endif
+
+#if TEAR_SYNC_MODE != 0
+  tearScheduler.orderBands(dirtyBands, dirtyBandCount, rowWriteUs, micros());
+#endif
+
+  while (dirtyBandCount > 0) {
+    DirtyBand band = dirtyBands[0];
+
+#if TEAR_SYNC_MODE != 0
+    // Not safe yet: come back on the next loop pass instead of blocking
+    if (tearScheduler.delayForBand(band.y0, band.y1, rowWriteUs, micros()) > 0) return false;
+#endif
+
+    uint32_t startUs = micros();
+    meterFillSprite.pushSprite(LEVEL_METER_X + 1, band.y0, 0, band.y0 - (LEVEL_METER_Y + 1),
+                               LEVEL_METER_WIDTH - 2, band.y1 - band.y0);
+    uint32_t perRow = (micros() - startUs) / (band.y1 - band.y0);
+    rowWriteUs = (rowWriteUs * 3 + perRow + 1) / 4; // track actual bus speed
+
+    // Drop the pushed band
+    for (uint8_t i = 1; i < dirtyBandCount; i++) dirtyBands[i - 1] = dirtyBands[i];
+    dirtyBandCount--;
+  }
+  return true;
+}
+
+// Function to apply the backlight state (PWM duty and panel sleep)
+void applyDisplayPower() {
+  static bool panelAsleep = false;
+  bool sleep = !backlight.renderingEnabled();
+
+  if (sleep && !panelAsleep) {
+    tft.writecommand(ST7789_DISPOFF);
+    tft.writecommand(ST7789_SLPIN);
+  }
+  else if (!sleep && panelAsleep) {
+    tft.writecommand(ST7789_SLPOUT);
+    delay(5); // panel needs 5ms after sleep out before the next command
+    tft.writecommand(ST7789_DISPON);
+  }
+  panelAsleep = sleep;
+
+  ledcWrite(BACKLIGHT_PWM_CHANNEL, backlight.duty());
+
+  Serial.printf("Display %s, est. energy saved: %llu mJ\n",
+                backlight.powerState() == DisplayPower::ACTIVE ? "active" :
+                backlight.powerState() == DisplayPower::DIMMED ? "dimmed" : "asleep",
+                (unsigned long long)backlight.savedMillijoules());
+}
+
+// Function to load the stored calibration from NVS
+void loadCalibration() {
+  preferences.begin("calib", true);
+  calibration.gainQ16 = preferences.getInt("gain", CAL_GAIN_ONE);
+  calibration.offsetMm = preferences.getInt("offset", 0);
+  preferences.end();
+}
+
+// Function to store the calibration in NVS
+void saveCalibration() {
+  preferences.begin("calib", false);
+  preferences.putInt("gain", calibration.gainQ16);
+  preferences.putInt("offset", calibration.offsetMm);
+  preferences.end();
+}
+
+// Function to print the active calibration
+void printCalibration() {
+  Serial.printf("Calibration: gain %ld/65536, offset %ld mm\n",
+                (long)calibration.gainQ16, (long)calibration.offsetMm);
+}
+
+// Function to load the blanking windows from NVS
+void loadRangeGate() {
+  GateWindow table[GATE_MAX_WINDOWS];
+  preferences.begin("gate", true);
+  uint8_t count = preferences.getUChar("count", 0);
+  if (count > GATE_MAX_WINDOWS ||
+      preferences.getBytes("windows", table, count * sizeof(GateWindow)) != count * sizeof(GateWindow)) {
+    count = 0;
+  }
+  preferences.end();
+  rangeGate.load(table, count);
+}
+
+// Function to store the blanking windows in NVS
+void saveRangeGate() {
+  preferences.begin("gate", false);
+  preferences.putUChar("count", rangeGate.size());
+  preferences.putBytes("windows", rangeGate.table(), rangeGate.size() * sizeof(GateWindow));
+  preferences.end();
+}
+
+// Function to print the blanking windows
+void printRangeGate() {
+  if (rangeGate.size() == 0) {
+    Serial.println("No blanking windows");
+    return;
+  }
+  for (uint8_t i = 0; i < rangeGate.size(); i++) {
+    Serial.printf("Window %u: %ld - %ld mm\n", i, (long)rangeGate.window(i).fromMm, (long)rangeGate.window(i).toMm);
+  }
+}
+
+// Function to run a "gate" console command
+void runGateCommand(char* arg) {
+  if (strcmp(arg, "list") == 0) {
+    printRangeGate();
+    return;
+  }
+  if (strcmp(arg, "clear") == 0) {
+    rangeGate.clear();
+  }
+  else if (strncmp(arg, "add ", 4) == 0) {
+    char* end;
+    long fromMm = strtol(arg + 4, &end, 10);
+    long toMm = strtol(end, nullptr, 10);
+    if (fromMm < 0 || toMm < fromMm || !rangeGate.add(fromMm, toMm)) {
+      Serial.println("Window rejected (bad range or table full)");
+      return;
+    }
+  }
+  else if (strncmp(arg, "del ", 4) == 0) {
+    if (!rangeGate.remove(atoi(arg + 4))) {
+      Serial.println("No such window");
+      return;
+    }
+  }
+  else if (strncmp(arg, "learn", 5) == 0) {
+    int seconds = atoi(arg + 5);
+    if (seconds <= 0) seconds = 10;
+    gateLearner.begin();
+    gateLearnEndMillis = millis() + seconds * 1000UL;
+    gateLearning = true;
+    Serial.printf("Learning static echoes for %d s, keep the beam clear of targets...\n", seconds);
+    return;
+  }
+  else {
+    Serial.println("Usage: gate list | gate add <from> <to> | gate del <n> | gate clear | gate learn <s>");
+    return;
+  }
+  saveRangeGate();
+  printRangeGate();
+}
+
+// Function to set high-resolution mode (0 pings = off)
+void setHighResolution(int pings) {
+  if (pings <= 0) {
+    hiResMode = false;
+    Serial.println("High-resolution mode off");
+    return;
+  }
+
+  // 1 (e.g. a Modbus write) is clamped to 2, the smallest average, rather than reset to the default
+  oversampler.begin(pings);
+  hiResStartMillis = millis();
+  hiResMode = true;
+  Serial.printf("High-resolution mode: %u pings per estimate\n", oversampler.pingsPerEstimate());
+}
+
+// Function to run a console command
+void runCommand(char* line) {
+  if (strncmp(line, "hires ", 6) == 0) {
+    int pings = atoi(line + 6);
+    setHighResolution(strcmp(line + 6, "off") == 0 ? 0 : pings > 0 ? pings : HIRES_DEFAULT_PINGS);
+    return;
+  }
+  if (strcmp(line, "stats") == 0) {
+    Serial.printf("Samples: %lu, ping interval: %lu us, echo glitches rejected: %lu\n",
+                  (unsigned long)sampleCount, (unsigned long)retrigger.intervalUs(),
+                  (unsigned long)rangeSensor.glitches());
+#if MODBUS_ENABLED
+    Serial.printf("Modbus: %lu frames, %lu CRC errors, %lu exceptions\n", (unsigned long)modbus.frames(),
+                  (unsigned long)modbus.crcErrors(), (unsigned long)modbus.exceptions());
+#endif
+#if MQTT_ENABLED
+    Serial.printf("MQTT: %s, %lu batches sent, %lu samples buffered, %lu dropped\n",
+                  mqttClient.connected() ? "connected" : "offline", (unsigned long)samplePublisher.batchesSent(),
+                  (unsigned long)samplePublisher.pending(), (unsigned long)samplePublisher.droppedSamples());
+#endif
+#if WEB_ENABLED
+    xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+    uint8_t viewers = streamClients.size();
+    uint32_t skippedBatches = streamClients.skippedBatches(), slowViewers = streamClients.slowClientsDropped();
+    xSemaphoreGiveRecursive(streamMutex);
+    Serial.printf("Web: %u viewers, %lu batches skipped, %lu slow viewers dropped\n", viewers,
+                  (unsigned long)skippedBatches, (unsigned long)slowViewers);
+#endif
+    char text[48];
+    TextBuilder background(text, sizeof(text));
+    background.text("Background: ").signedValue(presence.backgroundMm()).text(" mm +/- ")
+      .fixed(lroundf(presence.sigmaMm() * 10), 1).text(" mm, ").text(presence.isPresent() ? "present" : "empty");
+    Serial.println(text);
+    return;
+  }
+  if (strncmp(line, "gate ", 5) == 0) {
+    runGateCommand(line + 5);
+    return;
+  }
+  if (strcmp(line, "tele on") == 0 || strcmp(line, "tele off") == 0) {
+    telemetryEnabled = line[6] == 'n';
+    return;
+  }
+  if (strncmp(line, "cal ", 4) != 0) {
+    Serial.println("Unknown command");
+    return;
+  }
+
+  char* arg = line + 4;
+  if (strcmp(arg, "show") == 0) {
+    printCalibration();
+  }
+  else if (strcmp(arg, "reset") == 0) {
+    calibration = CAL_IDENTITY;
+    saveCalibration();
+    printCalibration();
+  }
+  else {
+    int32_t referenceMm = atoi(arg);
+    if (referenceMm <= 0) {
+      Serial.println("Usage: cal <mm> | cal show | cal reset");
+      return;
+    }
+    calibrationRoutine.beginCapture(referenceMm);
+    Serial.printf("Capturing point %u at %ld mm...\n", calibrationRoutine.pointsCaptured() + 1, (long)referenceMm);
+  }
+}
+
+// Function to collect serial console input without blocking
+void handleConsole() {
+  static char line[CONSOLE_LINE_LENGTH];
+  static uint8_t length = 0;
+
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+
+    if (c == '\n') {
+      line[length] = '\0';
+      if (length > 0) runCommand(line);
+      length = 0;
+    }
+    else if (length < CONSOLE_LINE_LENGTH - 1) {
+      line[length++] = c;
+    }
+  }
+}
+
+#if MODBUS_ENABLED
+// Modbus receive handler (UART event task): the UART's receive timeout has ended the frame
+void onModbusReceive() {
+  static uint8_t response[MODBUS_FRAME_MAX];
   
-  // Draw the title
-  tft.setCursor(0, 0);
-  tft.println("----------------------------");
-  tft.println(" HC-SR04 Distance Sensor");
-  tft.println("----------------------------");
-  tft.println("Distance:");
+  while (MODBUS_SERIAL.available() > 0) {
+    modbus.feed(MODBUS_SERIAL.read());
+  }
+  ModbusRegisters registers;
+  modbusSnapshot.read(registers);
+  uint16_t length = modbus.process(registers, response);
+  if (length > 0) {
+    MODBUS_SERIAL.write(response, length);
+  }
+}
+
+// Function to apply holding register writes received over Modbus
+void handleModbusWrites() {
+  ModbusWrite write;
+  while (modbus.takeWrite(write)) {
+    if (write.address == 0) {
+      telemetryEnabled = write.value != 0;
+    }
+    else if (write.address == 1) {
+      setHighResolution(write.value);
+    }
+    else if (write.address == 2) {
+      requestedView = write.value == 0 ? VIEW_METER : write.value - 1;
+    }
+  }
+}
+#endif
+
+// Function to feed the calibration routine with the latest raw reading
+void updateCalibration() {
+  if (!currentSample.inRange() || !calibrationRoutine.addReading(raw_distance_mm)) return;
+
+  if (calibrationRoutine.pointsCaptured() < 2) {
+    Serial.println("Point 1 captured, move the target and send \"cal <mm>\" again");
+    return;
+  }
+
+  Calibration result;
+  if (calibrationRoutine.result(result)) {
+    calibration = result;
+    saveCalibration();
+    printCalibration();
+  }
+  else {
+    Serial.println("Calibration rejected: use reference points at least 100mm apart");
+  }
+}
+
+// Function to feed learn mode with the latest reading and store the result when it finishes
+void updateGateLearning(unsigned long currentMillis) {
+  if (!gateLearning) return;
+  if (currentSample.inRange()) gateLearner.addReading(currentSample.distanceMm);
+  if ((long)(currentMillis - gateLearnEndMillis) < 0) return;
+
+  gateLearning = false;
+  uint8_t found = gateLearner.apply(rangeGate);
+  Serial.printf("Learned %u window(s) from %lu readings\n", found, (unsigned long)gateLearner.readings());
+  saveRangeGate();
+  printRangeGate();
+}
+
+// Function to build the tank volume table from the configured geometry
+void buildTankTable() {
+#if TANK_TYPE == TANK_STRAPPING
+  bool built = tankTable.build(tankStrapping, sizeof(tankStrapping) / sizeof(tankStrapping[0]));
+#elif TANK_TYPE != TANK_NONE
+  const TankGeometry tank = {
+    TANK_TYPE == TANK_VERTICAL_CYLINDER ? TankShape::VERTICAL_CYLINDER :
+    TANK_TYPE == TANK_HORIZONTAL_CYLINDER ? TankShape::HORIZONTAL_CYLINDER : TankShape::RECTANGULAR,
+    TANK_HEIGHT_MM, TANK_DIAMETER_MM, TANK_LENGTH_MM, TANK_WIDTH_MM
+  };
+  bool built = tankTable.build(tank);
+#else
+  bool built = true;
+#endif
+  if (!built) Serial.println("Tank geometry rejected, volume disabled");
+}
+
+// Function to look up the meter colour for a distance (cm)
+uint16_t getMeterColour(float distance) {
+  return meterColours.colour[colormapIndex(distance, MAX_DISTANCE_CM)];
+}
 
+// Function to draw the meter borders and markers and reset its fill
+void drawMeterFrame() {
   // Draw 2 meter borders to make it thicker
   tft.drawRect(LEVEL_METER_X, LEVEL_METER_Y, LEVEL_METER_WIDTH, LEVEL_METER_HEIGHT, TFT_DARKGREY); // inner
   tft.drawRect(LEVEL_METER_X - 1, LEVEL_METER_Y - 1, LEVEL_METER_WIDTH + 2, LEVEL_METER_HEIGHT + 2, TFT_DARKGREY); // outer
@@ -137,70 +879,737 @@ void drawStaticScreen() {
   meterFillSprite.createSprite(LEVEL_METER_WIDTH - 2, LEVEL_METER_HEIGHT - 2);
   meterFillSprite.fillSprite(TFT_BLACK);
   meterFillSprite.pushSprite(LEVEL_METER_X + 1, LEVEL_METER_Y + 1);
+  prevFillHeight = 0;
+  prev_distance_cm = -1;
+}
+
+// Glyph source for the readout atlas: a sprite holding one character of the source font
+struct SpriteGlyph {
+  TFT_eSprite& sprite;
+  bool ink(int x, int y) const { return sprite.readPixel(x, y) != TFT_BLACK; }
+};
+
+// Function to render the readout digits once into the glyph atlases (scaled down and anti-aliased)
+void buildReadoutGlyphs() {
+  const uint16_t colours[2] = { TFT_WHITE, TFT_YELLOW };
+  int sourceHeight = tft.fontHeight(READOUT_SOURCE_FONT);
+  TFT_eSprite glyphSprite = TFT_eSprite(&tft);
+  glyphSprite.setColorDepth(8);
+  glyphSprite.createSprite(READOUT_CELL_WIDTH * sourceHeight / READOUT_HEIGHT, sourceHeight);
+  glyphSprite.setTextColor(TFT_WHITE, TFT_BLACK);
+  SpriteGlyph source = { glyphSprite };
+
+  for (int i = 0; i < 2; i++) readoutGlyphs[i].begin(colours[i], TFT_BLACK);
+  for (const char* c = GLYPH_ATLAS_CHARSET; *c; c++) {
+    char text[2] = { *c, '\0' };
+    glyphSprite.fillSprite(TFT_BLACK);
+    glyphSprite.drawString(text, 0, 0, READOUT_SOURCE_FONT);
+    int width = glyphSprite.textWidth(text, READOUT_SOURCE_FONT);
+    for (int i = 0; i < 2; i++) readoutGlyphs[i].addGlyph(*c, source, width, sourceHeight);
+  }
+  glyphSprite.deleteSprite();
+}
+
+// Function to draw the distance digits (composed from the atlas and pushed in one write)
+void drawReadoutValue(const char* text, bool trusted) {
+  readoutGlyphs[trusted ? 0 : 1].compose(text, readoutStrip, READOUT_WIDTH);
+  tft.pushImage(READOUT_X, READOUT_Y, READOUT_WIDTH, READOUT_HEIGHT, readoutStrip);
+
+  // The unit only changes when the strip held status text
+  if (!readoutShowsValue) {
+    tft.drawString("mm", READOUT_X + READOUT_WIDTH + 2, READOUT_Y + READOUT_HEIGHT - 16);
+    readoutShowsValue = true;
+  }
+}
+
+// Function to replace the distance digits with status text
+void drawReadoutStatus(const char* text) {
+  tft.fillRect(0, READOUT_Y, 170, READOUT_HEIGHT, TFT_BLACK);
+  tft.setTextColor(TFT_RED, TFT_BLACK);
+  tft.drawString(text, READOUT_X, READOUT_Y + (READOUT_HEIGHT - 16) / 2);
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  readoutShowsValue = false;
+}
+
+// Function to draw the static screen elements
+void drawStaticScreen() {
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  
+  // Draw the title (the distance readout sits below it)
+  tft.setCursor(0, 0);
+  tft.println(" HC-SR04 Distance Sensor");
+  readoutShowsValue = false;
+
+  drawMeterFrame();
+}
+
+// Function to draw the trend plot (one pyramid bucket per pixel column, newest on the right)
+void drawTrendView() {
+  uint8_t level = displayView;
+  uint16_t columns = min((uint16_t)(trendPyramid.available(level) + 1), (uint16_t)TREND_COLUMNS);
+  
+  // Scale to the range of the visible buckets
+  int32_t lo = INT32_MAX;
+  int32_t hi = INT32_MIN;
+  for (uint16_t col = 0; col < columns; col++) {
+    const TrendBucket& bucket = col == 0 ? trendPyramid.openBucket(level) : trendPyramid.bucket(level, col - 1);
+    if (bucket.count == 0) continue;
+    lo = min(lo, bucket.min);
+    hi = max(hi, bucket.max);
+  }
+  if (lo > hi) return; // nothing recorded yet
+  if (hi - lo < 20) {
+    hi = lo + 20; // keep a minimum 20mm span so sensor jitter does not fill the plot
+  }
+  
+  // Draw each column, bar from min to max in the meter colours with the mean in white
+  for (uint16_t col = 0; col < TREND_COLUMNS; col++) {
+    int x = TREND_X + TREND_COLUMNS - 1 - col;
+    tft.drawFastVLine(x, LEVEL_METER_Y, LEVEL_METER_HEIGHT, TFT_BLACK);
+    if (col >= columns) continue;
+    
+    const TrendBucket& bucket = col == 0 ? trendPyramid.openBucket(level) : trendPyramid.bucket(level, col - 1);
+    if (bucket.count == 0) continue;
+    
+    int yMax = map(bucket.max, lo, hi, LEVEL_METER_Y + LEVEL_METER_HEIGHT - 1, LEVEL_METER_Y);
+    int yMin = map(bucket.min, lo, hi, LEVEL_METER_Y + LEVEL_METER_HEIGHT - 1, LEVEL_METER_Y);
+    int yMean = map(bucket.mean(), lo, hi, LEVEL_METER_Y + LEVEL_METER_HEIGHT - 1, LEVEL_METER_Y);
+    tft.drawFastVLine(x, yMax, yMin - yMax + 1, getMeterColour(bucket.mean() / 10.0f));
+    tft.drawPixel(x, yMean, TFT_WHITE);
+  }
+  
+  // Scale and resolution labels
+  tft.setTextFont(1);
+  tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  tft.setCursor(TREND_X, LEVEL_METER_Y + 1);
+  tft.printf("%ld mm  (%s/col)  ", (long)hi, trendLabels[level]);
+  tft.setCursor(TREND_X, LEVEL_METER_Y + LEVEL_METER_HEIGHT + 1);
+  tft.printf("%ld mm  ", (long)lo);
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.setTextFont(2);
+}
+
+// Function to switch between the meter and trend views
+void applyRequestedView() {
+  if (requestedView == displayView) return;
+  displayView = requestedView;
+  
+  // Clear the area shared by the meter, its labels and the trend plot
+  tft.fillRect(0, LEVEL_METER_Y - 1, 170, MOTION_READOUT_Y - LEVEL_METER_Y + 1, TFT_BLACK);
+  if (displayView == VIEW_METER) {
+    drawMeterFrame();
+  }
+}
+
+// Function to cycle the view on a KEY button press (debounced, non-blocking)
+void handleViewButton(unsigned long currentMillis) {
+  static bool lastPressed = false;
+  static unsigned long lastChangeMillis = 0;
+  
+  bool pressed = digitalRead(VIEW_BUTTON_PIN) == LOW;
+  if (pressed == lastPressed || currentMillis - lastChangeMillis < BUTTON_DEBOUNCE_MS) return;
+  lastPressed = pressed;
+  lastChangeMillis = currentMillis;
+  
+  // meter -> 1s -> 10s -> 1min -> 10min -> meter
+  if (pressed) {
+    requestedView = requestedView + 1 < TREND_LEVELS ? requestedView + 1 : VIEW_METER;
+  }
+}
+
+// Function to draw the velocity / time-to-contact readout below the meter
+void drawMotionReadout() {
+  const MotionState& state = motion.current();
+
+  tft.fillRect(0, MOTION_READOUT_Y, 170, 16, TFT_BLACK);
+  if (!state.valid) return;
+
+  tft.setCursor(0, MOTION_READOUT_Y);
+  tft.printf("v %ld mm/s", (long)state.velocityMmS);
+  if (state.timeToContactMs != MOTION_NO_CONTACT) {
+    char text[20];
+    TextBuilder ttc(text, sizeof(text));
+    ttc.text("  TTC ").fixed(roundedQuotient(state.timeToContactMs, 100), 1).character('s');
+    tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+    tft.print(text);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  }
+}
+
+// Function to draw the volume / fill rate readout below the meter (replaces the motion readout)
+void drawVolumeReadout() {
+  tft.fillRect(0, MOTION_READOUT_Y, 170, 16, TFT_BLACK);
+  if (!tankTable.valid()) return;
+
+  // Litres and litres per minute in tenths (mL/s x 60 / 100)
+  char text[32];
+  TextBuilder readout(text, sizeof(text));
+  readout.fixed(roundedQuotient(currentVolumeMl, 100), 1).text(" L");
+  if (tankFlow.valid()) {
+    int32_t flowTenths = roundedQuotient((int64_t)tankFlow.mlPerSecond() * 6, 10);
+    readout.text(flowTenths < 0 ? "  " : "  +").fixed(flowTenths, 1).text(" L/min");
+  }
+  tft.setCursor(0, MOTION_READOUT_Y);
+  tft.print(text);
+}
+
+// Function to draw the rolling min/max readout above the meter
+void drawStatisticsReadout() {
+  tft.fillRect(0, STATS_READOUT_Y, 170, 8, TFT_BLACK);
+  if (recentStats.empty()) return;
+
+  tft.setTextFont(1);
+  tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
+  tft.setCursor(0, STATS_READOUT_Y);
+  tft.printf("10s min %ld  max %ld mm", (long)recentStats.min(), (long)recentStats.max());
+  tft.setTextColor(TFT_WHITE, TFT_BLACK);
+  tft.setTextFont(2);
 }
 
 // Function to update distance display (in mm)
 void updateDistanceDisplay() {
   // Convert cm to mm (1cm = 10mm)
   float distance_mm = distance_cm * 10;
+
+#if PREDICTIVE_DISPLAY
+  // A value stays on screen for one update interval: extrapolate to the middle of that period
+  // (high-resolution mode averages a static target, so it is never extrapolated)
+  bool predicted = false;
+  int32_t predicted_mm = predictDistance(currentSample, motion.current(), millis() + updateInterval / 2, predicted);
+  if (predicted && !hiResMode) {
+    distance_mm = predicted_mm;
+  }
+#endif
+  float display_distance_cm = distance_mm / 10;
   
-  // Update measured value
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setCursor(60, 48);
-  tft.fillRect(60, 48, 80, 15, TFT_BLACK);
-  tft.print(distance_mm, 0); // 0 decimal places for mm
-  tft.println(" mm");
+  // Readings that are out of range show their status instead of a clamped value
+  markStale(currentSample, millis(), SAMPLE_STALE_MS);
+  if (!currentSample.inRange()) {
+    drawReadoutStatus(sampleStatusText(currentSample.flags));
+  }
+  else {
+    // Outliers, stale and low-confidence readings are highlighted
+    bool trusted = currentSample.accepts(TRUSTED_REJECT_FLAGS) && currentSample.confidence >= LOW_CONFIDENCE;
+    char text[12];                        // 0 decimal places for mm (1 in high-resolution mode)
+    TextBuilder value(text, sizeof(text));
+    value.fixed(lroundf(hiResMode ? distance_mm * 10 : distance_mm), hiResMode ? 1 : 0);
+    drawReadoutValue(text, trusted);
+  }
+
+  drawStatisticsReadout();
+
+#if TANK_TYPE != TANK_NONE
+  drawVolumeReadout();
+#elif SHOW_MOTION_READOUT
+  drawMotionReadout();
+#endif
+  
+  // Trend views replace the meter
+  applyRequestedView();
+  if (displayView != VIEW_METER) {
+    drawTrendView();
+    return;
+  }
   
   // Rest of the function remains the same
-  float meter_distance_cm = constrain(distance_cm, MIN_DISTANCE_CM, MAX_DISTANCE_CM);
+  float meter_distance_cm = constrain(display_distance_cm, MIN_DISTANCE_CM, MAX_DISTANCE_CM);
   
   if (abs(meter_distance_cm - prev_distance_cm) > 1.0) {
     // Calculate fill height accounting for 1px buffer at bottom
     int fillHeight = map(meter_distance_cm, MIN_DISTANCE_CM, MAX_DISTANCE_CM, 0, LEVEL_METER_HEIGHT - 2);
     
-    // Clear sprite
-    meterFillSprite.fillSprite(TFT_BLACK);
+    // Only the levels between the old and new fill heights change
+    int lowLevel = min(fillHeight, prevFillHeight);
+    int highLevel = max(fillHeight, prevFillHeight);
     
-    // Draw gradient fill (red at bottom, green at top)
-    for (int y = 0; y < fillHeight; y++) {
-      // Calculate current distance position (0 at bottom, 100 at top)
-      float current_dist = map(y, 0, LEVEL_METER_HEIGHT - 2, MIN_DISTANCE_CM, MAX_DISTANCE_CM);
+    // Redraw changed rows (red at bottom, green at top)
+    for (int y = lowLevel; y < highLevel; y++) {
+      uint16_t colour = TFT_BLACK;
       
-      // Get gradient colour for this position
-      uint16_t colour = getGradientColour(current_dist);
+      if (y < fillHeight) {
+        // Calculate current distance position (0 at bottom, 100 at top)
+        float current_dist = map(y, 0, LEVEL_METER_HEIGHT - 2, MIN_DISTANCE_CM, MAX_DISTANCE_CM);
+        
+        // Get the colormap colour for this position
+        colour = getMeterColour(current_dist);
+      }
       
       // Draw horizontal line (starting from bottom)
       meterFillSprite.drawFastHLine(0, (LEVEL_METER_HEIGHT - 2) - y - 1, LEVEL_METER_WIDTH - 2, colour);
     }
     
-    // Push sprite to display
-    meterFillSprite.pushSprite(LEVEL_METER_X + 1, LEVEL_METER_Y + 1);
+    // Queue the changed rows to be pushed in sync with the panel refresh
+    queueMeterBand((LEVEL_METER_HEIGHT - 2) - highLevel, (LEVEL_METER_HEIGHT - 2) - lowLevel);
     
+    prevFillHeight = fillHeight;
     prev_distance_cm = meter_distance_cm;
   }
 }
 
-// Function to read distance from sensor
-void readDistance() {
-  // Trigger the sensor with clean pulse
-  digitalWrite(TRIGGER_PIN, LOW);
-  delayMicroseconds(2);
-  digitalWrite(TRIGGER_PIN, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(TRIGGER_PIN, LOW);
-  
-  // Read the echo pulse duration
-  duration = pulseIn(ECHO_PIN, HIGH);
-  
-  // Calculate distance (cm)
-  distance_cm = (duration / 2) * 0.0343; // speed of sound 343 m/s (0.0343 cm/µs)
+// Function to process a completed measurement from the sensor
+void processReading(const RawReading& reading) {
+  duration = reading.echoUs;
   
-  // Handle cases where sensor reads beyond its effective range
-  if (distance_cm > 400) { // sensor max range is ~400cm
-    distance_cm = 400;
+  // Apply the per-unit calibration to the fixed-point distance (mm)
+  raw_distance_mm = reading.rawMm;
+  int32_t distance_mm = calibration.apply(raw_distance_mm);
+
+  // Flag and clamp readings beyond the sensor's effective range, score consistency
+  currentSample = sampleClassifier.classify(measurementMillis, duration, distance_mm, rangeSensor.MIN_RANGE_MM);
+  distance_cm = currentSample.distanceMm / 10.0f;
+}
+
+// Function to add a dithered ping to the estimate, returns true when a high-resolution estimate is ready
+bool processHighResolution(const RawReading& reading, unsigned long currentMillis) {
+  // Timed-out pings are skipped rather than averaged in
+  duration = reading.echoUs;
+  if (duration <= 0 || !oversampler.addEcho(duration)) return false;
+
+  // Decimate: echo Q8 -> mm Q8, then calibrate
+  OversampleEstimate estimate = oversampler.estimate();
+  int32_t rawMmQ8 = (int32_t)(((uint64_t)estimate.meanEchoQ8 * ECHO_US_TO_MM_Q16 + (1 << 15)) >> 16);
+  int32_t ciMmQ8 = (int32_t)(((uint64_t)estimate.ci95EchoQ8 * ECHO_US_TO_MM_Q16 + (1 << 15)) >> 16);
+  int32_t distanceMmQ8 = calibration.applyQ8(rawMmQ8);
+  raw_distance_mm = rawMmQ8 >> 8;
+  currentSample = sampleClassifier.classify(currentMillis, estimate.meanEchoQ8 >> 8, (distanceMmQ8 + 128) >> 8,
+                                            rangeSensor.MIN_RANGE_MM);
+  distance_cm = currentSample.inRange() ? distanceMmQ8 / 2560.0f : currentSample.distanceMm / 10.0f;
+
+  // Report the estimate and the throughput cost of the averaging
+  unsigned long elapsed = currentMillis - hiResStartMillis;
+  char text[80];
+  TextBuilder report(text, sizeof(text));
+  report.text("Hi-res: ").fixed(roundedQuotient((int64_t)distanceMmQ8 * 100, 256), 2)
+    .text(" mm +/- ").fixed(roundedQuotient((int64_t)ciMmQ8 * 100, 256), 2)
+    .text(" mm (95%), ").unsignedValue(estimate.pings).text(" pings in ").unsignedValue(elapsed).text(" ms");
+  Serial.println(text);
+
+  oversampler.begin(estimate.pings);
+  hiResStartMillis = currentMillis;
+  return true;
+}
+
+// Function to update the motion estimate with the latest reading
+void updateMotion() {
+  if (!currentSample.accepts(MOTION_REJECT_FLAGS)) return;
+  if (motion.current().valid && currentSample.timestampMs - lastUsableMillis < MOTION_MIN_SPACING_MS) return;
+
+  // Do not fit a line across a gap in usable readings
+  if (currentSample.timestampMs - lastUsableMillis > MOTION_GAP_RESET_MS) {
+    motion.reset();
+  }
+  lastUsableMillis = currentSample.timestampMs;
+  motion.update(currentSample.timestampMs, currentSample.distanceMm);
+}
+
+// Function to update presence detection and report enter/leave events
+void updatePresence() {
+  // Timeouts, clamped and blanked readings say nothing about the scene (a clamp is not the background);
+  // stray echoes are skipped here too, a person stays in the beam for longer than the outlier filter
+  if (!currentSample.accepts(PRESENCE_REJECT_FLAGS)) return;
+
+  PresenceEvent event = presence.update(currentSample.timestampMs, currentSample.distanceMm);
+  if (event == PresenceEvent::NONE) return;
+
+  digitalWrite(ALARM_PIN, presence.isPresent() ? HIGH : LOW);
+  if (telemetryEnabled) {
+    Serial.printf("P,%lu,%s,%ld\n", (unsigned long)currentSample.timestampMs,
+                  event == PresenceEvent::ENTER ? "ENTER" : "LEAVE", (long)currentSample.distanceMm);
+  }
+}
+
+// Function to convert the latest reading to a tank volume and update the fill rate
+void updateVolume() {
+  if (!tankTable.valid() || !currentSample.accepts(VOLUME_REJECT_FLAGS)) return;
+
+  currentVolumeMl = tankTable.volumeMl(TANK_EMPTY_DISTANCE_MM - currentSample.distanceMm);
+  tankFlow.update(currentSample.timestampMs, currentVolumeMl);
+}
+
+// Function to add the latest reading to the rolling window
+void updateStatistics() {
+  if (currentSample.accepts(STATS_REJECT_FLAGS)) {
+    recentStats.add(currentSample.timestampMs, currentSample.distanceMm);
+    trendPyramid.add(currentSample.timestampMs, currentSample.distanceMm);
+  }
+  else {
+    recentStats.expire(currentSample.timestampMs);
+  }
+}
+
+#if MODBUS_ENABLED
+// Function to publish the latest reading, statistics and settings to the Modbus register snapshot
+void updateModbusRegisters() {
+  ModbusRegisters& registers = modbusSnapshot.edit();
+  uint16_t* input = registers.input;
+  int32_t volumeDl = currentVolumeMl / 100;
+  int32_t flowDlMin = tankFlow.mlPerSecond() * 60 / 100;
+
+  input[0] = (uint16_t)currentSample.distanceMm;
+  input[1] = currentSample.flags;
+  input[2] = currentSample.confidence;
+  input[3] = currentSample.timestampMs >> 16;
+  input[4] = currentSample.timestampMs & 0xFFFF;
+  input[5] = (uint16_t)(int16_t)constrain(motion.current().velocityMmS, INT16_MIN, INT16_MAX);
+  input[6] = (uint16_t)recentStats.min();
+  input[7] = (uint16_t)recentStats.max();
+  input[8] = (uint16_t)recentStats.mean();
+  input[9] = (uint16_t)(recentStats.stddev() * 10);
+  input[10] = sampleCount >> 16;
+  input[11] = sampleCount & 0xFFFF;
+  input[12] = (uint16_t)min(rangeSensor.glitches(), (uint32_t)UINT16_MAX);
+  input[13] = presence.isPresent() ? 1 : 0;
+  input[14] = (uint32_t)volumeDl >> 16;
+  input[15] = (uint32_t)volumeDl & 0xFFFF;
+  input[16] = (uint16_t)(int16_t)constrain(flowDlMin, INT16_MIN, INT16_MAX);
+  input[17] = (uint16_t)min(retrigger.intervalUs() / 100, (uint32_t)UINT16_MAX);
+  input[18] = (uint16_t)presence.backgroundMm();
+  input[19] = (uint16_t)min(modbus.crcErrors(), (uint32_t)UINT16_MAX);
+
+  registers.holding[0] = telemetryEnabled ? 1 : 0;
+  registers.holding[1] = hiResMode ? oversampler.pingsPerEstimate() : 0;
+  registers.holding[2] = requestedView == VIEW_METER ? 0 : requestedView + 1;
+  modbusSnapshot.publish();
+}
+#endif
+
+#if MQTT_ENABLED
+// Publish sink for the batch publisher
+struct MqttSink {
+  bool publish(const uint8_t* payload, size_t length) {
+    return mqttClient.publish(mqttTopic, payload, length);
+  }
+};
+
+// Function to queue the latest reading for MQTT (decimated, never blocks)
+void queueMqttSample() {
+  if (currentSample.timestampMs - lastQueuedMillis < MQTT_SAMPLE_INTERVAL_MS) return;
+  lastQueuedMillis = currentSample.timestampMs;
+
+  SampleRecord record = {
+    currentSample.timestampMs, (uint16_t)currentSample.distanceMm, currentSample.flags, currentSample.confidence
+  };
+  samplePublisher.push(record);
+}
+
+// MQTT task (core 0): keeps the broker connection up and drains the sample ring
+void mqttTask(void*) {
+  MqttSink sink;
+  unsigned long lastAttemptMillis = 0;
+  unsigned long lastBatchMillis = 0;
+
+  for (;;) {
+    unsigned long now = millis();
+    if (WiFi.status() == WL_CONNECTED && !mqttClient.connected() && now - lastAttemptMillis >= MQTT_RECONNECT_MS) {
+      lastAttemptMillis = now;
+      mqttClient.connect(mqttClientId);
+    }
+
+    if (mqttClient.connected()) {
+      mqttClient.loop();
+
+      // Partial batches go out on the interval, a backlog of full batches drains straight away
+      if (samplePublisher.pending() >= BATCH_MAX_SAMPLES || now - lastBatchMillis >= MQTT_BATCH_INTERVAL_MS) {
+        lastBatchMillis = now;
+        samplePublisher.drain(sink, MQTT_MAX_BATCHES_PER_PASS);
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
   }
-  else if (distance_cm < 2) { // sensor min range is ~2cm
-    distance_cm = 0;
+}
+
+// Function to start the MQTT task (connection happens in the background)
+void beginMqtt() {
+  String mac = WiFi.macAddress();
+  const char* m = mac.c_str();
+  snprintf(mqttClientId, sizeof(mqttClientId), "distance-%c%c%c%c%c%c", m[9], m[10], m[12], m[13], m[15], m[16]);
+  snprintf(mqttTopic, sizeof(mqttTopic), "%s/%s/samples", MQTT_TOPIC, mqttClientId);
+
+  mqttClient.setServer(MQTT_HOST, MQTT_PORT);
+  mqttClient.setBufferSize(BATCH_PAYLOAD_MAX + 128); // payload plus topic and header
+  xTaskCreatePinnedToCore(mqttTask, "mqtt", 6144, nullptr, 1, nullptr, MQTT_TASK_CORE);
+}
+#endif
+
+#if WEB_ENABLED
+// Stream sink: keeps the batch as the newest one for the viewers to ask for (call with streamMutex held)
+struct LiveBatchSink {
+  bool publish(const uint8_t* payload, size_t length) {
+    memcpy(liveBatch, payload, length);
+    liveBatchLength = length;
+    return true; // live data: batches are never held back for viewers
+  }
+};
+
+// Function to answer a viewer's request with the newest batch, unless the viewer already has it (the
+// request is the first timestamp of its last batch). Runs on the async_tcp task, which owns the server's
+// client list and the client's send queue, so nothing else touches the client during the send
+void sendLiveBatch(AsyncWebSocketClient* client, const uint8_t* request) {
+  uint32_t have = (uint32_t)request[0] | ((uint32_t)request[1] << 8) | ((uint32_t)request[2] << 16) |
+                  ((uint32_t)request[3] << 24);
+  xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+  uint32_t newest = (uint32_t)liveBatch[2] | ((uint32_t)liveBatch[3] << 8) | ((uint32_t)liveBatch[4] << 16) |
+                    ((uint32_t)liveBatch[5] << 24);
+  if (liveBatchLength > 0 && newest != have) {
+    StreamAction action = streamClients.onBatch(client->id(), client->canSend());
+    if (action == StreamAction::SEND) client->binary(liveBatch, liveBatchLength);
+    else if (action == StreamAction::DROP) client->close();
+  }
+  xSemaphoreGiveRecursive(streamMutex);
+}
+
+// WebSocket events (async_tcp task): admit up to STREAM_MAX_CLIENTS viewers and answer their batch
+// requests. Every call on a client is made here, never from the loop
+void onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                      void* arg, uint8_t* data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+    bool admitted = streamClients.admit(client->id(), client);
+    xSemaphoreGiveRecursive(streamMutex);
+    if (!admitted) client->close();
+  }
+  else if (type == WS_EVT_DISCONNECT) {
+    xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+    streamClients.remove(client->id());
+    xSemaphoreGiveRecursive(streamMutex);
+  }
+  else if (type == WS_EVT_DATA) {
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    if (info->final && info->index == 0 && info->len == 4 && len == 4) sendLiveBatch(client, data);
+  }
+}
+
+// Function to queue the latest reading for the live stream (never blocks)
+void queueLiveSample() {
+  SampleRecord record = {
+    currentSample.timestampMs, (uint16_t)currentSample.distanceMm, currentSample.flags, currentSample.confidence
+  };
+  liveStream.push(record);
+}
+
+// Function to publish the queued samples as the newest stream batch on the stream interval
+void streamLiveSamples(unsigned long currentMillis) {
+  if (currentMillis - lastStreamMillis < WEB_STREAM_INTERVAL_MS) return;
+  lastStreamMillis = currentMillis;
+
+  // Only the batch changes hands here: the loop never calls into the WebSocket server, whose client list
+  // and send queues belong to the async_tcp task (admission already caps the number of clients)
+  xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+  LiveBatchSink sink;
+  liveStream.drain(sink, 1);
+  xSemaphoreGiveRecursive(streamMutex);
+}
+
+#if METRICS_ENABLED
+// Function to publish the pipeline health to the metrics snapshot (loop task, after each reading)
+void updateMetricsSnapshot() {
+  DeviceMetrics& m = metricsSnapshot.edit();
+  m.samples = sampleCount;
+  m.timeouts = timeoutCount;
+  m.echoGlitches = rangeSensor.glitches();
+  m.renderDeadlineMisses = renderDeadlineMisses;
+  m.renderTime = renderTime;
+  m.distanceMm = currentSample.distanceMm;
+  m.flags = currentSample.flags;
+  m.confidence = currentSample.confidence;
+  m.pingIntervalUs = retrigger.intervalUs();
+  m.present = presence.isPresent();
+
+  // Changed by the WebSocket events on the async_tcp task: read under the same mutex as the stream
+  xSemaphoreTakeRecursive(streamMutex, portMAX_DELAY);
+  m.streamViewers = streamClients.size();
+  m.streamSkippedBatches = streamClients.skippedBatches();
+  xSemaphoreGiveRecursive(streamMutex);
+#if MODBUS_ENABLED
+  m.modbusCrcErrors = modbus.crcErrors();
+#endif
+#if MQTT_ENABLED
+  m.mqttDroppedSamples = samplePublisher.droppedSamples();
+  m.mqttBufferedSamples = samplePublisher.pending();
+#endif
+  metricsSnapshot.publish();
+}
+
+// Function to render the Prometheus metrics from a snapshot (no heap allocation)
+void renderMetrics(MetricsWriter& out, const DeviceMetrics& m) {
+  out.counter("distance_sensor_samples_total", "Measurements completed", m.samples);
+  out.counter("distance_sensor_timeouts_total", "Measurements without an echo", m.timeouts);
+  out.counter("distance_sensor_echo_glitches_total", "Rejected echo glitches", m.echoGlitches);
+  out.counter("distance_sensor_render_deadline_misses_total", "Display updates over budget", m.renderDeadlineMisses);
+  out.histogramSeconds("distance_sensor_render_seconds", "Display update time (draw and push)", m.renderTime);
+
+  out.family("distance_sensor_distance_meters", "gauge", "Latest distance");
+  out.scaledSample("distance_sensor_distance_meters", m.distanceMm, 3);
+  out.gauge("distance_sensor_flags", "Quality flags of the latest reading", m.flags);
+  out.gauge("distance_sensor_confidence", "Confidence of the latest reading (0-255)", m.confidence);
+  out.family("distance_sensor_ping_interval_seconds", "gauge", "Current re-trigger interval");
+  out.scaledSample("distance_sensor_ping_interval_seconds", m.pingIntervalUs, 6);
+  out.gauge("distance_sensor_presence", "1 while presence is detected", m.present ? 1 : 0);
+  out.gauge("distance_sensor_stream_viewers", "Live-stream viewers connected", m.streamViewers);
+  out.counter("distance_sensor_stream_skipped_batches_total", "Live-stream batches skipped for slow viewers",
+              m.streamSkippedBatches);
+#if MODBUS_ENABLED
+  out.counter("distance_sensor_modbus_crc_errors_total", "Modbus frames dropped (CRC / length)", m.modbusCrcErrors);
+#endif
+#if MQTT_ENABLED
+  out.counter("distance_sensor_mqtt_dropped_samples_total", "Samples lost to a full MQTT buffer",
+              m.mqttDroppedSamples);
+  out.gauge("distance_sensor_mqtt_buffered_samples", "Samples waiting to be published", m.mqttBufferedSamples);
+#endif
+  out.gauge("esp_free_heap_bytes", "Free heap", ESP.getFreeHeap());
+  out.gauge("esp_min_free_heap_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+  out.gauge("esp_uptime_seconds", "Time since boot", millis() / 1000);
+}
+#endif
+
+// Function to start the web server (dashboard page, live stream and metrics)
+void beginWebServer() {
+  webServer.on("/", HTTP_GET, [](AsyncWebServerRequest* request) {
+    request->send_P(200, "text/html", DASHBOARD_HTML);
+  });
+#if METRICS_ENABLED
+  // Rendered into a static buffer and sent from it without copying, so a second scrape while a response
+  // is still going out is refused instead of overwriting it; the buffer is free once the request ends
+  webServer.on("/metrics", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (metricsBusy) {
+      request->send(503, "text/plain", "Scrape in progress\n");
+      return;
+    }
+    metricsBusy = true;
+    request->onDisconnect([]() { metricsBusy = false; });
+
+    DeviceMetrics metrics;
+    metricsSnapshot.read(metrics);
+    MetricsWriter out(metricsBuffer, METRICS_BUFFER_SIZE);
+    renderMetrics(out, metrics);
+    request->send_P(200, "text/plain; version=0.0.4", (const uint8_t*)out.data(), out.length());
+  });
+#endif
+  streamMutex = xSemaphoreCreateRecursiveMutex();
+  webSocket.onEvent(onWebSocketEvent);
+  webServer.addHandler(&webSocket);
+  webServer.begin();
+}
+#endif
+
+#if WIFI_ENABLED
+// Function to start Wi-Fi (connects and reconnects in the background)
+void beginWiFi() {
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+}
+#endif
+
+// Function to start a telemetry line: "<type>,<timestamp>"
+TextBuilder& beginTelemetryLine(TextBuilder& line, char type) {
+  return line.character(type).character(',').unsignedValue(currentSample.timestampMs);
+}
+
+// Function to send a finished telemetry line
+void sendTelemetryLine(TextBuilder& line) {
+  line.character('\n');
+  Serial.write((const uint8_t*)line.c_str(), line.length());
+}
+
+// Function to print a telemetry line for the latest reading (once per display update)
+void printTelemetry() {
+  if (!telemetryEnabled) return;
+  char text[64];
+
+  TextBuilder sampleLine(text, sizeof(text));
+  beginTelemetryLine(sampleLine, 'S').character(',').signedValue(currentSample.distanceMm)
+    .character(',').hex2(currentSample.flags).character(',').unsignedValue(currentSample.confidence);
+  sendTelemetryLine(sampleLine);
+
+  const MotionState& state = motion.current();
+  if (state.valid) {
+    TextBuilder line(text, sizeof(text));
+    beginTelemetryLine(line, 'M').character(',').signedValue(state.velocityMmS)
+      .character(',').signedValue(state.accelMmS2).character(',').unsignedValue(state.timeToContactMs);
+    sendTelemetryLine(line);
+  }
+
+  if (!recentStats.empty()) {
+    TextBuilder line(text, sizeof(text));
+    beginTelemetryLine(line, 'W').character(',').signedValue(recentStats.min())
+      .character(',').signedValue(recentStats.max())
+      .character(',').fixed(lroundf(recentStats.mean() * 10), 1)
+      .character(',').fixed(lroundf(recentStats.stddev() * 10), 1);
+    sendTelemetryLine(line);
+  }
+
+  if (tankTable.valid()) {
+    // Litres and litres per minute, one decimal (tenths rounded half away from zero)
+    TextBuilder line(text, sizeof(text));
+    beginTelemetryLine(line, 'V').character(',').fixed(roundedQuotient(currentVolumeMl, 100), 1)
+      .character(',').fixed(roundedQuotient((int64_t)tankFlow.mlPerSecond() * 6, 10), 1);
+    sendTelemetryLine(line);
+  }
+}
+
+
+// Function to run the acquisition state machine (one step per loop pass)
+void runAcquisition(unsigned long currentMillis) {
+  switch (acquisitionState) {
+    case AcquisitionState::TRIGGER_SENSOR: {
+        // Wait until the previous burst has decayed
+        if (!retrigger.ready(micros())) break;
+        
+        // Start a measurement (the driver refuses while its minimum cycle is still running)
+        uint32_t phaseDelayUs = hiResMode ? randomTriggerDelayUs(esp_random()) : 0;
+        uint32_t triggerUs = micros();
+        if (rangeSensor.startMeasurement(phaseDelayUs)) {
+          measurementMillis = currentMillis;
+          measurementMicros = triggerUs;
+          acquisitionState = AcquisitionState::AWAIT_ECHO;
+        }
+        break;
+      }
+      
+    case AcquisitionState::AWAIT_ECHO: {
+        // Wait for the echo (or timeout) without blocking
+        if (!rangeSensor.poll(micros())) break;
+        
+        RawReading reading = rangeSensor.reading();
+        retrigger.onMeasurement(measurementMicros, reading.echoUs);
+        sampleCount++;
+        if (reading.echoUs == 0) timeoutCount++;
+        acquisitionState = AcquisitionState::TRIGGER_SENSOR;
+        
+        // High-resolution mode keeps pinging until enough pings are averaged
+        if (hiResMode) {
+          if (!processHighResolution(reading, currentMillis)) break;
+        }
+        else {
+          processReading(reading);
+        }
+        updateCalibration();
+        updateGateLearning(currentMillis);
+        updateMotion();
+        updatePresence();
+        updateVolume();
+        updateStatistics();
+#if MQTT_ENABLED
+        queueMqttSample();
+#endif
+#if WEB_ENABLED
+        queueLiveSample();
+#endif
+#if MODBUS_ENABLED
+        updateModbusRegisters();
+#endif
+#if WEB_ENABLED && METRICS_ENABLED
+        updateMetricsSnapshot();
+#endif
+        
+        // Track activity for backlight dimming / panel sleep (readings without a target distance are no change)
+        if (currentSample.accepts(BACKLIGHT_REJECT_FLAGS) && backlight.update(currentMillis, currentSample.distanceMm)) {
+          applyDisplayPower();
+        }
+        break;
+      }
   }
 }
 
@@ -211,6 +1620,13 @@ void readDistance() {
 
 // SETUP
 void setup() {
+  Serial.begin(115200);
+
+  // Initialize the backlight PWM at full brightness
+  ledcSetup(BACKLIGHT_PWM_CHANNEL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_BITS);
+  ledcAttachPin(BACKLIGHT_PIN, BACKLIGHT_PWM_CHANNEL);
+  ledcWrite(BACKLIGHT_PWM_CHANNEL, backlight.duty());
+
   // Initialize the TFT display
   tft.init();
   tft.setRotation(0);                     // adjust rotation (0 & 2 portrait | 1 & 3 landscape)
@@ -221,44 +1637,111 @@ void setup() {
   tft.println("Initialising...\n");
   delay(1000);
   
-  // Set button pin with pullup
-  pinMode(TRIGGER_PIN, OUTPUT);
-  pinMode(ECHO_PIN, INPUT);
+  // Set up the range sensor (pins / UART and echo interrupt)
+  rangeSensor.begin();
+  
+  // View button and alarm output
+  pinMode(VIEW_BUTTON_PIN, INPUT_PULLUP);
+  pinMode(ALARM_PIN, OUTPUT);
+  digitalWrite(ALARM_PIN, LOW);
+  
+  // Load the per-unit calibration
+  loadCalibration();
+  loadRangeGate();
+  sampleClassifier.setGate(&rangeGate);
+  buildTankTable();
+
+#if WIFI_ENABLED
+  beginWiFi();
+#endif
+#if MQTT_ENABLED
+  beginMqtt();
+#endif
+#if WEB_ENABLED
+  beginWebServer();
+#endif
+
+#if MODBUS_ENABLED
+  // Modbus RTU on RS-485: the UART drives DE/RE and its receive timeout marks the end of each frame
+  MODBUS_SERIAL.begin(MODBUS_BAUD, SERIAL_8N1, MODBUS_RX_PIN, MODBUS_TX_PIN);
+  MODBUS_SERIAL.setPins(-1, -1, -1, MODBUS_DE_PIN);
+  MODBUS_SERIAL.setMode(UART_MODE_RS485_HALF_DUPLEX);
+  MODBUS_SERIAL.setRxTimeout(MODBUS_RX_TIMEOUT_SYMBOLS);
+  MODBUS_SERIAL.onReceive(onModbusReceive, true);
+#endif
   
   // Draw the initial static screen
+  buildReadoutGlyphs();
   drawStaticScreen();
+
+  // Enable the TE output (V-blank only) and anchor the scan line model
+#if TEAR_SYNC_MODE == 2
+  tft.writecommand(0x35); // TEON
+  tft.writedata(0x00);
+  pinMode(LCD_TE_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(LCD_TE_PIN), onTearingEffect, RISING);
+#endif
+  tearScheduler.onVsync(micros());
 }
 
 // MAIN LOOP
 void loop() {
   unsigned long currentMillis = millis(); // get the current millis time
 
-  // State Machine Logic
+  // Serial console (calibration commands) and view button
+  handleConsole();
+  handleViewButton(currentMillis);
+
+  // Acquisition runs independently of the display refresh
+  runAcquisition(currentMillis);
+
+  // The idle timer keeps running when no usable readings arrive (empty beam, hi-res averaging)
+  if (backlight.tick(currentMillis)) {
+    applyDisplayPower();
+  }
+#if MODBUS_ENABLED
+  handleModbusWrites();
+#endif
+#if WEB_ENABLED
+  streamLiveSamples(currentMillis);
+#endif
+
+  // Display State Machine Logic
   switch (currentState) {
-    case State::READ_SENSOR: {
-        // Read sensor data
-        readDistance();
-        currentState = State::UPDATE_DISPLAY;
-        break;
-      }
-      
     case State::UPDATE_DISPLAY: {
         // Update display
+        renderStartUs = micros();
         updateDistanceDisplay();
-        currentState = State::WAIT;
-        previousMillis = currentMillis;
+        currentState = State::PUSH_DISPLAY;
+        break;
+      }
+      
+    case State::PUSH_DISPLAY: {
+        // Push dirty bands when the scan line is clear of them
+        if (pushDirtyBands()) {
+          uint32_t elapsedUs = micros() - renderStartUs;
+          renderTime.observe(elapsedUs);
+          if (elapsedUs > RENDER_DEADLINE_US) renderDeadlineMisses++;
+          currentState = State::WAIT;
+        }
         break;
       }
       
     case State::WAIT:
-      // Wait for the specified interval before next reading
+      // Wait for the specified interval before next update
       if (currentMillis - previousMillis >= updateInterval) {
-        currentState = State::READ_SENSOR;
+        previousMillis = currentMillis;
+        printTelemetry();
+        
+        // Rendering is suspended while the panel sleeps
+        if (backlight.renderingEnabled()) {
+          currentState = State::UPDATE_DISPLAY;
+        }
       }
       break;
 
     default:
-      currentState = State::READ_SENSOR;
+      currentState = State::WAIT;
       break;
   }
 }
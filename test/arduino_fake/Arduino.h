@@ -0,0 +1,122 @@
+/*********************************************************************************************************
+ * Arduino Stand-In for Host Tests
+ *
+ * Description:
+ *   Just enough of the Arduino core for the range sensor drivers to run on the PC: a simulated clock,
+ *   pins that record trigger pulses, echo edges that fire the attached interrupt, and a HardwareSerial
+ *   fed from a scripted byte stream.
+ *
+ * How It Works:
+ *   1. Clock: micros()/millis() read fake::nowUs; delayMicroseconds() and fake::advance() move it on
+ *   2. Pins: digitalWrite() records the width and end time of each HIGH pulse on a pin
+ *   3. Interrupts: fake::setPin() changes an input level and calls its CHANGE handler, as the echo line
+ *      does on the device
+ *   4. Serial: fake::uart receives scripted bytes (receive()) and keeps what the driver writes
+ *
+ * Notes:
+ *   - Only for the native test environment (on the include path through build_flags in platformio.ini)
+ *   - Call fake::reset() at the start of each test
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define CHANGE 3
+#define SERIAL_8N1 0x800001c
+#define FAKE_PINS 64
+#define FAKE_SERIAL_BUFFER 64
+
+class HardwareSerial {
+public:
+  HardwareSerial() { clear(); }
+
+  void begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    baudRate = baud;
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+  }
+  int available() const { return rxCount - rxRead; }
+  int read() { return rxRead < rxCount ? rx[rxRead++] : -1; }
+  size_t write(uint8_t byte) {
+    if (txCount < FAKE_SERIAL_BUFFER) tx[txCount++] = byte;
+    return 1;
+  }
+
+  // Test side: queue bytes as if they arrived on the line
+  void receive(const uint8_t* bytes, int n) {
+    for (int i = 0; i < n && rxCount < FAKE_SERIAL_BUFFER; i++) rx[rxCount++] = bytes[i];
+  }
+  void clear() {
+    rxCount = rxRead = txCount = 0;
+    baudRate = 0;
+  }
+
+  uint8_t rx[FAKE_SERIAL_BUFFER];
+  uint8_t tx[FAKE_SERIAL_BUFFER];
+  int rxCount, rxRead, txCount;
+  unsigned long baudRate;
+};
+
+namespace fake {
+  inline uint64_t nowUs = 0;
+  inline uint8_t level[FAKE_PINS];
+  inline uint8_t mode[FAKE_PINS];
+  inline void (*handler[FAKE_PINS])() = {};
+  inline uint64_t pulseStartUs[FAKE_PINS];
+  inline uint32_t lastPulseUs[FAKE_PINS];     // width of the last HIGH pulse written
+  inline uint64_t lastPulseEndUs[FAKE_PINS];  // time it went LOW
+  inline uint32_t pulses[FAKE_PINS];          // HIGH pulses written
+  inline HardwareSerial uart;
+
+  inline void reset(uint64_t startUs = 1000000) {
+    nowUs = startUs;
+    memset(level, 0, sizeof(level));
+    memset(mode, 0, sizeof(mode));
+    memset(pulseStartUs, 0, sizeof(pulseStartUs));
+    memset(lastPulseUs, 0, sizeof(lastPulseUs));
+    memset(lastPulseEndUs, 0, sizeof(lastPulseEndUs));
+    memset(pulses, 0, sizeof(pulses));
+    for (int i = 0; i < FAKE_PINS; i++) handler[i] = nullptr;
+    uart.clear();
+  }
+
+  inline void advance(uint64_t us) { nowUs += us; }
+
+  // Drive an input pin at the current time, firing its interrupt on a change
+  inline void setPin(uint8_t pin, uint8_t value) {
+    if (level[pin] == value) return;
+    level[pin] = value;
+    if (handler[pin]) handler[pin]();
+  }
+}
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)fake::nowUs; }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(fake::nowUs / 1000); }
+inline void delayMicroseconds(uint32_t us) { fake::nowUs += us; }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { fake::mode[pin] = mode; }
+inline int digitalRead(uint8_t pin) { return fake::level[pin]; }
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  if (value && !fake::level[pin]) fake::pulseStartUs[pin] = fake::nowUs;
+  if (!value && fake::level[pin]) {
+    fake::lastPulseUs[pin] = (uint32_t)(fake::nowUs - fake::pulseStartUs[pin]);
+    fake::lastPulseEndUs[pin] = fake::nowUs;
+    fake::pulses[pin]++;
+  }
+  fake::level[pin] = value;
+}
+
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(int interrupt, void (*isr)(), int mode) {
+  (void)mode;
+  fake::handler[interrupt] = isr;
+}
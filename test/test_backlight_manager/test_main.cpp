@@ -0,0 +1,90 @@
+/*********************************************************************************************************
+ * Backlight Manager Tests
+ *
+ * Replays synthetic distance traces through BacklightManager with the device configuration (dim after
+ * 30s, sleep after 2min, 20mm activity threshold) and checks the state machine and the energy estimate.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "backlight_manager.h"
+
+static const BacklightConfig config = { 30000, 120000, 20, 255, 40, 330, 60, 5 };
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Feed a reading every stepMs from fromMs to toMs (exclusive)
+static void replay(BacklightManager& backlight, uint32_t fromMs, uint32_t toMs, uint32_t stepMs, int32_t mm) {
+  for (uint32_t t = fromMs; t < toMs; t += stepMs) backlight.update(t, mm);
+}
+
+void test_motion_keeps_display_active(void) {
+  BacklightManager backlight(config);
+  for (uint32_t t = 0; t < 600000; t += 250) {
+    backlight.update(t, 1000 + (int32_t)(t / 10000 % 2) * 100); // moves 100mm every 10s
+    TEST_ASSERT_EQUAL(DisplayPower::ACTIVE, backlight.powerState());
+  }
+  TEST_ASSERT_EQUAL_UINT8(255, backlight.duty());
+}
+
+void test_jitter_below_threshold_is_not_activity(void) {
+  BacklightManager backlight(config);
+  for (uint32_t t = 0; t < 29000; t += 250) backlight.update(t, 1000 + (int32_t)(t / 250 % 3) * 10);
+  TEST_ASSERT_EQUAL(DisplayPower::ACTIVE, backlight.powerState());
+  replay(backlight, 29000, 31000, 250, 1015);
+  TEST_ASSERT_EQUAL(DisplayPower::DIMMED, backlight.powerState());
+  TEST_ASSERT_EQUAL_UINT8(40, backlight.duty());
+  replay(backlight, 31000, 121000, 250, 1005);
+  TEST_ASSERT_EQUAL(DisplayPower::ASLEEP, backlight.powerState());
+  TEST_ASSERT_FALSE(backlight.renderingEnabled());
+  TEST_ASSERT_EQUAL_UINT8(0, backlight.duty());
+}
+
+void test_motion_wakes_immediately(void) {
+  BacklightManager backlight(config);
+  replay(backlight, 0, 200000, 250, 1000);
+  TEST_ASSERT_EQUAL(DisplayPower::ASLEEP, backlight.powerState());
+  TEST_ASSERT_TRUE(backlight.update(200000, 900));
+  TEST_ASSERT_EQUAL(DisplayPower::ACTIVE, backlight.powerState());
+  TEST_ASSERT_FALSE(backlight.update(200250, 900));             // no change: no state transition
+}
+
+// Empty beam: only timeouts after the last usable reading, the idle timer must still run
+void test_tick_without_readings_dims_and_sleeps(void) {
+  BacklightManager backlight(config);
+  backlight.update(0, 1500);
+  int transitions = 0;
+  for (uint32_t t = 10; t <= 30000; t += 10) transitions += backlight.tick(t);
+  TEST_ASSERT_EQUAL(DisplayPower::DIMMED, backlight.powerState());
+  for (uint32_t t = 30010; t <= 120000; t += 10) transitions += backlight.tick(t);
+  TEST_ASSERT_EQUAL(DisplayPower::ASLEEP, backlight.powerState());
+  TEST_ASSERT_EQUAL_INT(2, transitions);
+}
+
+void test_energy_saved_matches_time_in_each_state(void) {
+  BacklightManager backlight(config);
+  backlight.update(0, 1000);
+  for (uint32_t t = 100; t <= 3720000; t += 100) backlight.tick(t);
+  // 0-30s active (saves nothing), 30-120s dimmed (270mW), 120-3720s asleep (325mW)
+  TEST_ASSERT_TRUE(backlight.savedMillijoules() == 270ull * 90 + 325ull * 3600);
+}
+
+void test_timers_survive_millis_wrap(void) {
+  BacklightManager backlight(config);
+  uint32_t start = 0xFFFFFFFFu - 10000;
+  backlight.update(start, 1000);
+  for (uint32_t i = 1; i <= 40; i++) backlight.tick(start + i * 1000);
+  TEST_ASSERT_EQUAL(DisplayPower::DIMMED, backlight.powerState());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_motion_keeps_display_active);
+  RUN_TEST(test_jitter_below_threshold_is_not_activity);
+  RUN_TEST(test_motion_wakes_immediately);
+  RUN_TEST(test_tick_without_readings_dims_and_sleeps);
+  RUN_TEST(test_energy_saved_matches_time_in_each_state);
+  RUN_TEST(test_timers_survive_millis_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,202 @@
+/*********************************************************************************************************
+ * Batch Publisher Tests
+ *
+ * BatchPublisher against a fake broker: backpressure (a refused publish keeps the records buffered),
+ * the per-pass batch limit, dropped samples on a full ring and batch splits on long gaps, then S1 and S2
+ * payloads round-tripped through decodeBatch(), which must reject truncated and oversized payloads.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include <vector>
+#include "batch_publisher.h"
+#include "sample.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Stand-in for the MQTT client: keeps every accepted payload, refuses while offline
+struct FakeBroker {
+  bool online = true;
+  uint32_t refused = 0;
+  std::vector<std::vector<uint8_t>> payloads;
+
+  bool publish(const uint8_t* payload, size_t length) {
+    if (!online) {
+      refused++;
+      return false;
+    }
+    payloads.emplace_back(payload, payload + length);
+    return true;
+  }
+};
+
+static SampleRecord record(uint32_t timestampMs, uint16_t mm) {
+  return { timestampMs, mm, SAMPLE_OK, (uint8_t)(mm & 0xFF) };
+}
+
+// Decode every payload the broker accepted, in order
+static std::vector<SampleRecord> decodeAll(const FakeBroker& broker) {
+  std::vector<SampleRecord> records;
+  for (const std::vector<uint8_t>& payload : broker.payloads) {
+    int samples = decodeBatch(payload.data(), payload.size(), [&](const SampleRecord& r) { records.push_back(r); });
+    TEST_ASSERT_TRUE(samples > 0);
+  }
+  return records;
+}
+
+static void assertRecordsEqual(const SampleRecord& expected, const SampleRecord& actual) {
+  TEST_ASSERT_EQUAL_UINT32(expected.timestampMs, actual.timestampMs);
+  TEST_ASSERT_EQUAL_UINT16(expected.distanceMm, actual.distanceMm);
+  TEST_ASSERT_EQUAL_UINT8(expected.flags, actual.flags);
+  TEST_ASSERT_EQUAL_UINT8(expected.confidence, actual.confidence);
+}
+
+void test_refused_publish_keeps_records(void) {
+  BatchPublisher<256> publisher;
+  FakeBroker broker;
+  for (uint32_t i = 0; i < 50; i++) publisher.push(record(i * 20, (uint16_t)(1000 + i)));
+
+  broker.online = false;
+  TEST_ASSERT_EQUAL_UINT8(0, publisher.drain(broker, 4));
+  TEST_ASSERT_EQUAL_UINT32(1, broker.refused);                 // the refusal ends the pass
+  TEST_ASSERT_EQUAL_UINT32(50, publisher.pending());
+  TEST_ASSERT_EQUAL_UINT32(0, publisher.batchesSent());
+
+  // Back online: the same records go out, oldest first
+  broker.online = true;
+  TEST_ASSERT_EQUAL_UINT8(1, publisher.drain(broker, 4));
+  TEST_ASSERT_EQUAL_UINT32(0, publisher.pending());
+  std::vector<SampleRecord> sent = decodeAll(broker);
+  TEST_ASSERT_EQUAL_UINT32(50, sent.size());
+  for (uint32_t i = 0; i < 50; i++) assertRecordsEqual(record(i * 20, (uint16_t)(1000 + i)), sent[i]);
+}
+
+void test_drain_limited_per_pass(void) {
+  BatchPublisher<1024> publisher;
+  FakeBroker broker;
+  for (uint32_t i = 0; i < 5 * BATCH_MAX_SAMPLES + 10; i++) publisher.push(record(i * 20, 1500));
+
+  TEST_ASSERT_EQUAL_UINT8(2, publisher.drain(broker, 2));
+  TEST_ASSERT_EQUAL_UINT32(2, broker.payloads.size());
+  TEST_ASSERT_EQUAL_UINT32(3 * BATCH_MAX_SAMPLES + 10, publisher.pending());
+  TEST_ASSERT_EQUAL_UINT32(BATCH_PAYLOAD_MAX, broker.payloads[0].size());  // a full S1 batch
+
+  TEST_ASSERT_EQUAL_UINT8(3, publisher.drain(broker, 3));
+  TEST_ASSERT_EQUAL_UINT8(1, publisher.drain(broker, 3));      // the 10 left over, then nothing to send
+  TEST_ASSERT_EQUAL_UINT32(0, publisher.pending());
+  TEST_ASSERT_EQUAL_UINT32(6, publisher.batchesSent());
+  TEST_ASSERT_EQUAL_UINT8(0, publisher.drain(broker, 3));
+  TEST_ASSERT_EQUAL_UINT32(5 * BATCH_MAX_SAMPLES + 10, decodeAll(broker).size());
+}
+
+void test_full_ring_counts_dropped(void) {
+  BatchPublisher<64> publisher;
+  FakeBroker broker;
+  for (uint32_t i = 0; i < 64; i++) TEST_ASSERT_TRUE(publisher.push(record(i * 20, (uint16_t)i)));
+  for (uint32_t i = 64; i < 70; i++) TEST_ASSERT_FALSE(publisher.push(record(i * 20, (uint16_t)i)));
+  TEST_ASSERT_EQUAL_UINT32(6, publisher.droppedSamples());
+  TEST_ASSERT_EQUAL_UINT32(64, publisher.pending());
+
+  // The backlog is kept intact: the first 64, not the newest
+  publisher.drain(broker, 1);
+  std::vector<SampleRecord> sent = decodeAll(broker);
+  TEST_ASSERT_EQUAL_UINT32(64, sent.size());
+  TEST_ASSERT_EQUAL_UINT32(63 * 20, sent[63].timestampMs);
+
+  // Room again after the drain
+  TEST_ASSERT_TRUE(publisher.push(record(70 * 20, 70)));
+  TEST_ASSERT_EQUAL_UINT32(6, publisher.droppedSamples());
+}
+
+void test_long_gap_starts_new_batch(void) {
+  const uint32_t times[] = { 1000, 1000 + 0xFFFF, 1000 + 0xFFFF + 0x10000, 1000 + 0xFFFF + 0x10020 };
+  for (int compressed = 0; compressed < 2; compressed++) {
+    BatchPublisher<256> publisher(compressed != 0);
+    FakeBroker broker;
+    for (uint32_t t : times) publisher.push(record(t, 800));   // dt 0xFFFF fits S1, 0x10000 does not
+
+    // S1 splits at the gap; S2 codes any interval and keeps one batch
+    TEST_ASSERT_EQUAL_UINT8(compressed ? 1 : 2, publisher.drain(broker, 4));
+    if (!compressed) {
+      std::vector<uint8_t>& first = broker.payloads[0];
+      TEST_ASSERT_EQUAL_INT(2, decodeBatch(first.data(), first.size(), [](const SampleRecord&) {}));
+    }
+    std::vector<SampleRecord> sent = decodeAll(broker);
+    TEST_ASSERT_EQUAL_UINT32(4, sent.size());
+    for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_EQUAL_UINT32(times[i], sent[i].timestampMs);
+  }
+}
+
+void test_payloads_round_trip(void) {
+  // A mixed stream: jittered timing, timeouts, a jump in distance
+  SampleRecord records[300];
+  uint32_t seed = 11, t = 5000;
+  for (uint32_t i = 0; i < 300; i++) {
+    seed = seed * 1103515245u + 12345u;
+    t += 18 + (seed >> 16) % 5;
+    bool timeout = (seed >> 8) % 20 == 0;
+    uint16_t mm = (uint16_t)((i < 150 ? 1200 : 400) + (seed >> 20) % 9);
+    records[i] = { t, timeout ? (uint16_t)0 : mm, (uint8_t)(timeout ? SAMPLE_TIMEOUT : SAMPLE_OK),
+                   (uint8_t)(timeout ? 0 : 200 + (seed >> 24) % 50) };
+  }
+
+  for (int compressed = 0; compressed < 2; compressed++) {
+    BatchPublisher<512> publisher(compressed != 0);
+    FakeBroker broker;
+    for (const SampleRecord& r : records) publisher.push(r);
+    while (publisher.drain(broker, 8) > 0) {}
+
+    size_t bytes = 0;
+    for (const std::vector<uint8_t>& payload : broker.payloads) {
+      TEST_ASSERT_EQUAL_UINT8('S', payload[0]);
+      TEST_ASSERT_EQUAL_UINT8(compressed ? '2' : '1', payload[1]);
+      bytes += payload.size();
+    }
+    std::vector<SampleRecord> sent = decodeAll(broker);
+    TEST_ASSERT_EQUAL_UINT32(300, sent.size());
+    for (uint32_t i = 0; i < 300; i++) assertRecordsEqual(records[i], sent[i]);
+    if (compressed) TEST_ASSERT_LESS_THAN(300 * BATCH_RECORD_BYTES, bytes);
+  }
+}
+
+void test_decode_rejects_malformed(void) {
+  for (int compressed = 0; compressed < 2; compressed++) {
+    BatchPublisher<256> publisher(compressed != 0);
+    FakeBroker broker;
+    for (uint32_t i = 0; i < 100; i++) publisher.push(record(i * 20 + (i * 7) % 5, (uint16_t)(1000 + i * 13)));
+    publisher.drain(broker, 1);
+    std::vector<uint8_t> payload = broker.payloads[0];
+    uint32_t calls = 0;
+    auto count = [&](const SampleRecord&) { calls++; };
+    TEST_ASSERT_EQUAL_INT(100, decodeBatch(payload.data(), payload.size(), count));
+
+    // Truncated anywhere, including inside the header
+    for (size_t length : { payload.size() - 1, payload.size() / 2, (size_t)5, (size_t)2, (size_t)0 }) {
+      TEST_ASSERT_EQUAL_INT(-1, decodeBatch(payload.data(), length, count));
+    }
+
+    // A count larger than a batch can hold
+    uint16_t tooMany = BATCH_MAX_SAMPLES + 1;
+    std::vector<uint8_t> oversized = payload;
+    oversized[compressed ? 2 : 6] = tooMany & 0xFF;
+    oversized[compressed ? 3 : 7] = tooMany >> 8;
+    if (!compressed) oversized.resize(BATCH_HEADER_BYTES + tooMany * BATCH_RECORD_BYTES);  // length consistent
+    TEST_ASSERT_EQUAL_INT(-1, decodeBatch(oversized.data(), oversized.size(), count));
+  }
+
+  // Unknown format
+  const uint8_t unknown[BATCH_HEADER_BYTES] = { 'S', '3', 0, 0, 0, 0, 0, 0 };
+  TEST_ASSERT_EQUAL_INT(-1, decodeBatch(unknown, sizeof(unknown), [](const SampleRecord&) {}));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_refused_publish_keeps_records);
+  RUN_TEST(test_drain_limited_per_pass);
+  RUN_TEST(test_full_ring_counts_dropped);
+  RUN_TEST(test_long_gap_starts_new_batch);
+  RUN_TEST(test_payloads_round_trip);
+  RUN_TEST(test_decode_rejects_malformed);
+  return UNITY_END();
+}
@@ -0,0 +1,142 @@
+/*********************************************************************************************************
+ * Calibration Tests
+ *
+ * Checks the echo conversion and the two-point fit, then calibrates a fleet of simulated sensors with
+ * their own trigger delay (fixed bias), scale error and reading noise and checks the residual error.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "calibration.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Simulated sensor: echo time for a true distance with a fixed bias, a scale error and +/-noiseMm jitter
+struct BiasedSensor {
+  int32_t biasMm;
+  float scale;
+  int32_t noiseMm;
+  uint32_t seed;
+
+  int32_t rawReading(int32_t trueMm) {
+    seed = seed * 1103515245u + 12345u;
+    int32_t noise = noiseMm > 0 ? (int32_t)((seed >> 16) % (2 * noiseMm + 1)) - noiseMm : 0;
+    float mm = trueMm * scale + biasMm + noise;
+    return echoToRawMm((uint32_t)(mm / 0.1715f + 0.5f));
+  }
+};
+
+static int32_t absolute(int32_t v) { return v < 0 ? -v : v; }
+
+void test_echo_conversion(void) {
+  TEST_ASSERT_EQUAL_INT32(0, echoToRawMm(0));
+  TEST_ASSERT_EQUAL_INT32(1000, echoToRawMm(5831));           // 343 m/s round trip
+  TEST_ASSERT_EQUAL_INT32(4000, echoToRawMm(23324));
+  for (uint32_t us = 1; us < 30000; us++) TEST_ASSERT_TRUE(echoToRawMm(us) >= echoToRawMm(us - 1));
+}
+
+void test_identity_changes_nothing(void) {
+  for (int32_t mm = 0; mm <= 5000; mm += 7) {
+    TEST_ASSERT_EQUAL_INT32(mm, CAL_IDENTITY.apply(mm));
+    TEST_ASSERT_EQUAL_INT32(mm * 256 + 100, CAL_IDENTITY.applyQ8(mm * 256 + 100));
+  }
+}
+
+void test_exact_line_is_recovered(void) {
+  const int32_t gainsPermille[] = { 850, 950, 1000, 1030, 1150 };
+  const int32_t offsets[] = { -40, -7, 0, 12, 35 };
+  for (int32_t g : gainsPermille) {
+    for (int32_t offset : offsets) {
+      // raw = (ref - offset) / gain
+      int32_t raw1 = (100 - offset) * 1000 / g, raw2 = (1500 - offset) * 1000 / g;
+      Calibration cal;
+      TEST_ASSERT_TRUE(computeTwoPointCalibration(raw1, 100, raw2, 1500, cal));
+      TEST_ASSERT_EQUAL_INT32(100, cal.apply(raw1));
+      TEST_ASSERT_INT32_WITHIN(2, 1500, cal.apply(raw2));
+      TEST_ASSERT_INT32_WITHIN(2, 800, cal.apply((800 - offset) * 1000 / g));
+    }
+  }
+}
+
+void test_point_order_does_not_matter(void) {
+  Calibration a, b;
+  TEST_ASSERT_TRUE(computeTwoPointCalibration(110, 100, 1030, 1000, a));
+  TEST_ASSERT_TRUE(computeTwoPointCalibration(1030, 1000, 110, 100, b));
+  TEST_ASSERT_EQUAL_INT32(a.gainQ16, b.gainQ16);
+  TEST_ASSERT_INT32_WITHIN(1, a.apply(500), b.apply(500));
+}
+
+void test_bad_captures_are_rejected(void) {
+  Calibration cal = CAL_IDENTITY;
+  TEST_ASSERT_FALSE(computeTwoPointCalibration(500, 500, 550, 550, cal));   // points too close
+  TEST_ASSERT_FALSE(computeTwoPointCalibration(100, 1000, 1000, 100, cal)); // reference order reversed
+  TEST_ASSERT_FALSE(computeTwoPointCalibration(100, 100, 1000, 1500, cal)); // gain 1.56
+  TEST_ASSERT_FALSE(computeTwoPointCalibration(100, 100, 1000, 700, cal));  // gain 0.67
+  TEST_ASSERT_EQUAL_INT32(CAL_GAIN_ONE, cal.gainQ16);                        // left untouched
+}
+
+void test_q8_matches_integer_path(void) {
+  Calibration cal;
+  TEST_ASSERT_TRUE(computeTwoPointCalibration(95, 100, 1062, 1000, cal));
+  for (int32_t mm = 20; mm <= 4000; mm += 13) {
+    TEST_ASSERT_INT32_WITHIN(1, cal.apply(mm), (cal.applyQ8(mm * 256) + 128) >> 8);
+  }
+}
+
+void test_routine_averages_each_point(void) {
+  CalibrationRoutine routine;
+  Calibration cal;
+  TEST_ASSERT_FALSE(routine.addReading(123));                  // not capturing
+  routine.beginCapture(100);
+  for (int i = 0; i < CAL_CAPTURE_SAMPLES - 1; i++) TEST_ASSERT_FALSE(routine.addReading(108 + (i % 3) - 1));
+  TEST_ASSERT_TRUE(routine.addReading(108));
+  TEST_ASSERT_FALSE(routine.result(cal));                      // one point only
+  routine.beginCapture(1000);
+  for (int i = 0; i < CAL_CAPTURE_SAMPLES; i++) routine.addReading(1035);
+  TEST_ASSERT_EQUAL_UINT8(2, routine.pointsCaptured());
+  TEST_ASSERT_TRUE(routine.result(cal));
+  TEST_ASSERT_INT32_WITHIN(1, 100, cal.apply(108));
+  TEST_ASSERT_INT32_WITHIN(1, 1000, cal.apply(1035));
+}
+
+// Fleet of biased sensors: calibrated at 100mm and 1000mm, checked from 50mm to 3000mm
+void test_biased_sensor_fleet(void) {
+  uint32_t seed = 99;
+  int32_t worstBefore = 0, worstAfter = 0;
+  for (int unit = 0; unit < 50; unit++) {
+    seed = seed * 1103515245u + 12345u;
+    BiasedSensor sensor = { (int32_t)(seed >> 16) % 41 - 20, 0.97f + (seed >> 8) % 60 / 1000.0f, 2, seed };
+
+    CalibrationRoutine routine;
+    routine.beginCapture(100);
+    while (!routine.addReading(sensor.rawReading(100))) {}
+    routine.beginCapture(1000);
+    while (!routine.addReading(sensor.rawReading(1000))) {}
+    Calibration cal;
+    TEST_ASSERT_TRUE(routine.result(cal));
+
+    for (int32_t mm = 50; mm <= 3000; mm += 50) {
+      sensor.noiseMm = 0;                                      // residual bias only
+      int32_t raw = sensor.rawReading(mm);
+      if (absolute(raw - mm) > worstBefore) worstBefore = absolute(raw - mm);
+      if (absolute(cal.apply(raw) - mm) > worstAfter) worstAfter = absolute(cal.apply(raw) - mm);
+      sensor.noiseMm = 2;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(50, worstBefore);
+  TEST_ASSERT_LESS_OR_EQUAL(8, worstAfter);                    // averaged +/-2mm noise extrapolated 3x the span
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_echo_conversion);
+  RUN_TEST(test_identity_changes_nothing);
+  RUN_TEST(test_exact_line_is_recovered);
+  RUN_TEST(test_point_order_does_not_matter);
+  RUN_TEST(test_bad_captures_are_rejected);
+  RUN_TEST(test_q8_matches_integer_path);
+  RUN_TEST(test_routine_averages_each_point);
+  RUN_TEST(test_biased_sensor_fleet);
+  return UNITY_END();
+}
@@ -0,0 +1,107 @@
+/*********************************************************************************************************
+ * Colormap Tests
+ *
+ * Table end points and RGB565 rounding, the stop brightness check of the ordered maps, withZones() bands
+ * with no, one and two thresholds, the zonesIncreasing() threshold check, and colormapIndex() clamping.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "colormap.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// The check must be usable where the firmware uses it: in a static_assert
+static_assert(zonesIncreasing(0, 0), "no thresholds");
+static_assert(zonesIncreasing(51, 127), "two increasing thresholds");
+static_assert(!zonesIncreasing(127, 51), "decreasing thresholds");
+
+constexpr ColormapTable redGreen = makeColormap(RED_GREEN_STOPS, false);
+constexpr ColormapTable viridis = makeColormap(VIRIDIS_STOPS, true);
+constexpr ColormapTable trafficLight = makeColormap(TRAFFIC_LIGHT_STOPS, false);
+constexpr ColormapTable monochrome = makeColormap(MONOCHROME_STOPS, true);
+
+void test_end_points(void) {
+  TEST_ASSERT_EQUAL_HEX16(0xF800, rgb565(255, 0, 0));
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, rgb565(0, 255, 0));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, rgb565(255, 255, 255));
+  TEST_ASSERT_EQUAL_HEX16(0xF800, redGreen.colour[0]);
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, redGreen.colour[COLORMAP_SIZE - 1]);
+  TEST_ASSERT_EQUAL_HEX16(rgb565(68, 1, 84), viridis.colour[0]);
+  TEST_ASSERT_EQUAL_HEX16(rgb565(253, 231, 37), viridis.colour[COLORMAP_SIZE - 1]);
+  TEST_ASSERT_EQUAL_HEX16(rgb565(255, 191, 0), trafficLight.colour[(COLORMAP_SIZE - 1) / 2]); // middle stop
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, monochrome.colour[COLORMAP_SIZE - 1]);
+}
+
+// Checked at compile time, as the header does for the ordered maps
+static_assert(stopsBrighten(VIRIDIS_STOPS), "viridis");
+static_assert(!stopsBrighten(TRAFFIC_LIGHT_STOPS), "traffic-light is not an ordered map");
+
+void test_stops_brighten(void) {
+  TEST_ASSERT_TRUE(stopsBrighten(MONOCHROME_STOPS));
+  TEST_ASSERT_TRUE(stopsBrighten(RED_GREEN_STOPS));                    // green is brighter than red
+
+  // A stop out of order fails, and so does one only as bright as the one before
+  constexpr ColourStop swapped[] = { { 68, 1, 84 }, { 59, 81, 139 }, { 71, 44, 122 }, { 253, 231, 37 } };
+  constexpr ColourStop flat[] = { { 48, 48, 48 }, { 48, 48, 48 }, { 255, 255, 255 } };
+  TEST_ASSERT_FALSE(stopsBrighten(swapped));
+  TEST_ASSERT_FALSE(stopsBrighten(flat));
+}
+
+void test_zones(void) {
+  // No thresholds: the map itself
+  constexpr ColormapTable plain = withZones(trafficLight, 0, 0);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(trafficLight.colour, plain.colour, COLORMAP_SIZE);
+
+  // Two thresholds: pure red, amber and green
+  constexpr ColormapTable three = withZones(trafficLight, 51, 127);
+  for (int i = 0; i < COLORMAP_SIZE; i++) {
+    uint16_t expected = i < 51 ? rgb565(255, 0, 0) : i < 127 ? rgb565(255, 191, 0) : rgb565(0, 255, 0);
+    TEST_ASSERT_EQUAL_HEX16(expected, three.colour[i]);
+  }
+
+  // One threshold, given as either: the two ends of the map
+  constexpr ColormapTable lowOnly = withZones(redGreen, 64, 0);
+  constexpr ColormapTable highOnly = withZones(redGreen, 0, 64);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(lowOnly.colour, highOnly.colour, COLORMAP_SIZE);
+  TEST_ASSERT_EQUAL_HEX16(0xF800, lowOnly.colour[63]);
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, lowOnly.colour[64]);
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, lowOnly.colour[COLORMAP_SIZE - 1]);
+}
+
+void test_zones_increasing(void) {
+  TEST_ASSERT_TRUE(zonesIncreasing(0, 0));
+  TEST_ASSERT_TRUE(zonesIncreasing(64, 0));                    // one threshold, either slot
+  TEST_ASSERT_TRUE(zonesIncreasing(0, 64));
+  TEST_ASSERT_TRUE(zonesIncreasing(1, 2));
+  TEST_ASSERT_TRUE(zonesIncreasing(1, COLORMAP_SIZE - 1));
+  TEST_ASSERT_FALSE(zonesIncreasing(64, 64));                  // equal: an empty middle band
+  TEST_ASSERT_FALSE(zonesIncreasing(128, 64));
+  TEST_ASSERT_FALSE(zonesIncreasing(COLORMAP_SIZE, 0));         // past the table (threshold beyond the range)
+  TEST_ASSERT_FALSE(zonesIncreasing(64, COLORMAP_SIZE));
+
+  // As src/main.cpp derives the indices: 20cm and 50cm of a 100cm range
+  TEST_ASSERT_TRUE(zonesIncreasing(20 * (COLORMAP_SIZE - 1) / 100, 50 * (COLORMAP_SIZE - 1) / 100));
+  TEST_ASSERT_FALSE(zonesIncreasing(50 * (COLORMAP_SIZE - 1) / 100, 20 * (COLORMAP_SIZE - 1) / 100));
+  TEST_ASSERT_FALSE(zonesIncreasing(20 * (COLORMAP_SIZE - 1) / 100, 150 * (COLORMAP_SIZE - 1) / 100));
+}
+
+void test_index_clamped(void) {
+  TEST_ASSERT_EQUAL_UINT16(0, colormapIndex(-5.0f, 100.0f));
+  TEST_ASSERT_EQUAL_UINT16(0, colormapIndex(0.0f, 100.0f));
+  TEST_ASSERT_EQUAL_UINT16(0, colormapIndex(0.0f / 0.0f, 100.0f));   // NaN
+  TEST_ASSERT_EQUAL_UINT16(127, colormapIndex(50.0f, 100.0f));
+  TEST_ASSERT_EQUAL_UINT16(COLORMAP_SIZE - 1, colormapIndex(100.0f, 100.0f));
+  TEST_ASSERT_EQUAL_UINT16(COLORMAP_SIZE - 1, colormapIndex(250.0f, 100.0f));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_end_points);
+  RUN_TEST(test_stops_brighten);
+  RUN_TEST(test_zones);
+  RUN_TEST(test_zones_increasing);
+  RUN_TEST(test_index_clamped);
+  return UNITY_END();
+}
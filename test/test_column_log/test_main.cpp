@@ -0,0 +1,210 @@
+/*********************************************************************************************************
+ * Column Log Tests
+ *
+ * ColumnLogWriter / ColumnLogReader round trip, and recovery of the index from the block headers when it
+ * cannot be trusted: a missing or truncated .idx, an entry that overlaps or skips a block, a torn final
+ * block, and a torn block followed by the blocks of a restarted server. In every case a query must see
+ * exactly the samples of the intact blocks, in order.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../tools/ingest/column_log.h"
+#include "sample.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define BLOCKS 6
+#define BLOCK_SAMPLES 50
+
+static char directory[] = "/tmp/column_log_XXXXXX";
+static std::string basePath;
+
+// Samples of block b: distinct timestamps, the distance rising through the block
+static SampleRecord sampleOf(uint32_t block, uint32_t i) {
+  return { block * 10000 + i * 20, (uint16_t)(1000 + block * 100 + i), SAMPLE_OK, (uint8_t)(200 + block) };
+}
+
+// Write blocks [first, last) with one writer (one write of the blocks, then one of their index entries)
+static void writeBlocks(uint32_t first, uint32_t last) {
+  ColumnLogWriter writer;
+  TEST_ASSERT_TRUE(writer.open(basePath));
+  SampleRecord records[BLOCK_SAMPLES];
+  for (uint32_t b = first; b < last; b++) {
+    for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) records[i] = sampleOf(b, i);
+    writer.append(b % 2, records, BLOCK_SAMPLES);
+  }
+  TEST_ASSERT_TRUE(writer.close());
+}
+
+static void freshLog() {
+  remove((basePath + ".col").c_str());
+  remove((basePath + ".idx").c_str());
+  writeBlocks(0, BLOCKS);
+}
+
+static off_t fileSize(const std::string& path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 ? info.st_size : -1;
+}
+
+static std::vector<ColumnIndexEntry> readIndex() {
+  std::vector<ColumnIndexEntry> index((size_t)fileSize(basePath + ".idx") / sizeof(ColumnIndexEntry));
+  FILE* file = fopen((basePath + ".idx").c_str(), "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  TEST_ASSERT_EQUAL_UINT32(index.size(), fread(index.data(), sizeof(ColumnIndexEntry), index.size(), file));
+  fclose(file);
+  return index;
+}
+
+static void writeIndex(const std::vector<ColumnIndexEntry>& index) {
+  FILE* file = fopen((basePath + ".idx").c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fwrite(index.data(), sizeof(ColumnIndexEntry), index.size(), file);
+  fclose(file);
+}
+
+// Query everything as log_query does: every block the reader lists, decoded sample by sample
+static std::vector<SampleRecord> queryAll(bool& rebuilt, uint32_t& damaged) {
+  std::vector<SampleRecord> samples;
+  ColumnLogReader log;
+  TEST_ASSERT_TRUE(log.open(basePath, rebuilt));
+  damaged = 0;
+  for (size_t i = 0; i < log.blocks(); i++) {
+    TEST_ASSERT_EQUAL_UINT32(log.entry(i).count, log.header(i).count);
+    if (!readColumnBlock(log.header(i), log.body(i), [&](const SampleRecord& r) { samples.push_back(r); })) {
+      damaged++;
+    }
+  }
+  return samples;
+}
+
+// The query returns exactly the given blocks' samples, none damaged
+static void assertBlocks(const std::vector<uint32_t>& blocks, bool expectRebuilt) {
+  bool rebuilt;
+  uint32_t damaged;
+  std::vector<SampleRecord> samples = queryAll(rebuilt, damaged);
+  TEST_ASSERT_EQUAL(expectRebuilt, rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(0, damaged);
+  TEST_ASSERT_EQUAL_UINT32(blocks.size() * BLOCK_SAMPLES, samples.size());
+  size_t n = 0;
+  for (uint32_t b : blocks) {
+    for (uint32_t i = 0; i < BLOCK_SAMPLES; i++, n++) {
+      SampleRecord expected = sampleOf(b, i);
+      TEST_ASSERT_EQUAL_UINT32(expected.timestampMs, samples[n].timestampMs);
+      TEST_ASSERT_EQUAL_UINT16(expected.distanceMm, samples[n].distanceMm);
+      TEST_ASSERT_EQUAL_UINT8(expected.confidence, samples[n].confidence);
+    }
+  }
+}
+
+static const std::vector<uint32_t> ALL_BLOCKS = { 0, 1, 2, 3, 4, 5 };
+
+void test_round_trip(void) {
+  freshLog();
+  assertBlocks(ALL_BLOCKS, false);
+
+  // The index describes the blocks as written
+  std::vector<ColumnIndexEntry> index = readIndex();
+  TEST_ASSERT_EQUAL_UINT32(BLOCKS, index.size());
+  TEST_ASSERT_EQUAL_UINT32(0, index[0].offset);
+  TEST_ASSERT_EQUAL_UINT32(1, index[3].deviceId);
+  TEST_ASSERT_EQUAL_UINT32(3 * 10000, index[3].firstMs);
+  TEST_ASSERT_EQUAL_UINT16(1000 + 300 + BLOCK_SAMPLES - 1, index[3].maxMm);
+}
+
+void test_truncated_index(void) {
+  // Cut inside an entry (the server stopped while writing the index), then missing altogether
+  freshLog();
+  TEST_ASSERT_EQUAL_INT(0, truncate((basePath + ".idx").c_str(), 2 * sizeof(ColumnIndexEntry) + 12));
+  assertBlocks(ALL_BLOCKS, true);
+
+  TEST_ASSERT_EQUAL_INT(0, truncate((basePath + ".idx").c_str(), 0));
+  assertBlocks(ALL_BLOCKS, true);
+  remove((basePath + ".idx").c_str());
+  assertBlocks(ALL_BLOCKS, true);
+
+  // A rebuilt index saved next to the log is trusted again as it is
+  ColumnLogReader log;
+  bool rebuilt;
+  TEST_ASSERT_TRUE(log.open(basePath, rebuilt));
+  TEST_ASSERT_TRUE(log.saveIndex(basePath));
+  assertBlocks(ALL_BLOCKS, false);
+}
+
+void test_entry_overlaps_or_skips_block(void) {
+  freshLog();
+  std::vector<ColumnIndexEntry> original = readIndex();
+
+  // Entry 2 starts inside block 1
+  std::vector<ColumnIndexEntry> index = original;
+  index[2].offset -= 8;
+  writeIndex(index);
+  assertBlocks(ALL_BLOCKS, true);
+
+  // Entry 2 starts past block 2's header
+  index = original;
+  index[2].offset += 8;
+  writeIndex(index);
+  assertBlocks(ALL_BLOCKS, true);
+
+  // Entry 2 missing: entry 3 skips a block
+  index = original;
+  index.erase(index.begin() + 2);
+  writeIndex(index);
+  assertBlocks(ALL_BLOCKS, true);
+
+  // Entry 4 claims a longer block than is there
+  index = original;
+  index[4].bytes += 16;
+  writeIndex(index);
+  assertBlocks(ALL_BLOCKS, true);
+}
+
+void test_torn_final_block(void) {
+  // Cut inside the last block's body, then inside its header: its index entry runs past the log end
+  freshLog();
+  std::vector<ColumnIndexEntry> index = readIndex();
+  TEST_ASSERT_EQUAL_INT(0, truncate((basePath + ".col").c_str(), (off_t)(index[5].offset + index[5].bytes - 3)));
+  assertBlocks({ 0, 1, 2, 3, 4 }, true);
+  TEST_ASSERT_EQUAL_INT(0, truncate((basePath + ".col").c_str(), (off_t)(index[5].offset + 10)));
+  assertBlocks({ 0, 1, 2, 3, 4 }, true);
+
+  // Without the index entries of the last two blocks either
+  index.resize(4);
+  writeIndex(index);
+  assertBlocks({ 0, 1, 2, 3, 4 }, true);
+}
+
+void test_torn_block_then_restart(void) {
+  // Blocks 0-2 complete, block 3 torn with no index entry, then a restarted server appends blocks 4-5
+  remove((basePath + ".col").c_str());
+  remove((basePath + ".idx").c_str());
+  writeBlocks(0, 4);
+  std::vector<ColumnIndexEntry> index = readIndex();
+  index.resize(3);
+  writeIndex(index);
+  TEST_ASSERT_EQUAL_INT(0, truncate((basePath + ".col").c_str(), (off_t)(index[2].offset + index[2].bytes + 40)));
+  writeBlocks(4, BLOCKS);
+
+  assertBlocks({ 0, 1, 2, 4, 5 }, true);
+}
+
+int main() {
+  TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+  basePath = std::string(directory) + "/test";
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_truncated_index);
+  RUN_TEST(test_entry_overlaps_or_skips_block);
+  RUN_TEST(test_torn_final_block);
+  RUN_TEST(test_torn_block_then_restart);
+  int failures = UNITY_END();
+  remove((basePath + ".col").c_str());
+  remove((basePath + ".idx").c_str());
+  rmdir(directory);
+  return failures;
+}
@@ -0,0 +1,182 @@
+/*********************************************************************************************************
+ * Echo Timing Tests
+ *
+ * EchoPulseTimer fed with scripted edge sequences: clean pulses, injected glitches of each kind (rise
+ * outside the latency window, short pulses, dropouts inside the pulse), timeouts and micros() wrap.
+ * Also the EdgeRing between ISR and loop and the US-100 reply parser.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "echo_timing.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Feed edges given as (offset from trigger, level) and return the timer's result once finished
+struct Scripted {
+  EchoPulseTimer timer;
+  uint32_t triggerUs;
+
+  explicit Scripted(uint32_t startUs = 1000) : triggerUs(startUs) { timer.arm(startUs); }
+
+  void edge(uint32_t offsetUs, uint8_t level) {
+    EchoEdge e = { triggerUs + offsetUs, level };
+    timer.onEdge(e);
+  }
+  void pulse(uint32_t riseUs, uint32_t widthUs) {
+    edge(riseUs, 1);
+    edge(riseUs + widthUs, 0);
+  }
+  bool finishedAt(uint32_t offsetUs) { return timer.finished(triggerUs + offsetUs); }
+};
+
+void test_clean_pulse(void) {
+  Scripted s;
+  s.pulse(450, 5831);
+  TEST_ASSERT_FALSE(s.finishedAt(450 + 5831));                 // waits out the bridge gap
+  TEST_ASSERT_FALSE(s.finishedAt(450 + 5831 + ECHO_BRIDGE_GAP_US - 1));
+  TEST_ASSERT_TRUE(s.finishedAt(450 + 5831 + ECHO_BRIDGE_GAP_US));
+  TEST_ASSERT_EQUAL_UINT32(5831, s.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(0, s.timer.glitches());
+}
+
+void test_rise_outside_latency_window(void) {
+  Scripted early;
+  early.pulse(ECHO_RISE_MIN_US - 1, 500);                      // crosstalk right after the trigger
+  early.pulse(450, 1000);
+  TEST_ASSERT_TRUE(early.finishedAt(2000));
+  TEST_ASSERT_EQUAL_UINT32(1000, early.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(1, early.timer.glitches());
+
+  Scripted late;
+  late.pulse(ECHO_RISE_MAX_US + 1, 1000);
+  TEST_ASSERT_FALSE(late.finishedAt(10000));
+  TEST_ASSERT_TRUE(late.finishedAt(ECHO_TIMEOUT_US + 1));
+  TEST_ASSERT_EQUAL_UINT32(0, late.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(1, late.timer.glitches());
+}
+
+void test_short_pulse_then_real_echo(void) {
+  Scripted s;
+  s.pulse(300, ECHO_MIN_PULSE_US - 1);
+  s.pulse(600, 2000);
+  TEST_ASSERT_TRUE(s.finishedAt(3000));
+  TEST_ASSERT_EQUAL_UINT32(2000, s.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(1, s.timer.glitches());
+}
+
+void test_dropouts_inside_the_pulse_are_bridged(void) {
+  Scripted s;
+  s.edge(450, 1);
+  s.edge(1450, 0);
+  s.edge(1450 + ECHO_BRIDGE_GAP_US - 1, 1);                    // dropout
+  s.edge(3000, 0);
+  s.edge(3005, 1);                                             // and another
+  s.edge(4450, 0);
+  TEST_ASSERT_TRUE(s.finishedAt(5000));
+  TEST_ASSERT_EQUAL_UINT32(4000, s.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(2, s.timer.glitches());
+}
+
+void test_gap_at_the_bridge_limit_ends_the_pulse(void) {
+  Scripted s;
+  s.edge(450, 1);
+  s.edge(1450, 0);
+  s.edge(1450 + ECHO_BRIDGE_GAP_US, 1);                        // a second echo, not a dropout
+  s.edge(2450, 0);
+  TEST_ASSERT_TRUE(s.finishedAt(3000));
+  TEST_ASSERT_EQUAL_UINT32(1000, s.timer.echoUs());
+  TEST_ASSERT_EQUAL_UINT32(0, s.timer.glitches());
+}
+
+void test_random_glitch_injection(void) {
+  // Real echoes of random length with noise pulses and dropouts injected: the echo is always recovered
+  uint32_t seed = 3;
+  for (int trial = 0; trial < 2000; trial++) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t rise = 400 + (seed >> 20) % 200;
+    uint32_t width = 200 + (seed >> 8) % 20000;
+    Scripted s(seed);                                          // any micros() value, including near wrap
+
+    uint32_t noiseAt = (seed >> 4) % 140;                      // noise before the latency window opens
+    s.pulse(noiseAt, 5);
+    s.pulse(rise / 2 + 150, 40);                               // a short pulse inside the window
+    s.edge(rise, 1);
+    uint32_t dropAt = rise + ECHO_MIN_PULSE_US + (seed >> 12) % (width - ECHO_MIN_PULSE_US);
+    s.edge(dropAt, 0);
+    s.edge(dropAt + 3, 1);
+    s.edge(rise + width, 0);
+
+    TEST_ASSERT_TRUE(s.finishedAt(rise + width + ECHO_BRIDGE_GAP_US));
+    TEST_ASSERT_EQUAL_UINT32(width, s.timer.echoUs());
+  }
+}
+
+void test_timeout_across_micros_wrap(void) {
+  Scripted s(0xFFFFF000u);
+  TEST_ASSERT_FALSE(s.finishedAt(ECHO_TIMEOUT_US));
+  TEST_ASSERT_TRUE(s.finishedAt(ECHO_TIMEOUT_US + 1));
+  TEST_ASSERT_EQUAL_UINT32(0, s.timer.echoUs());
+
+  EchoPulseTimer idle;
+  TEST_ASSERT_FALSE(idle.finished(123456));                    // never armed
+}
+
+void test_edge_ring_order_overflow_and_clear(void) {
+  EdgeRing ring;
+  EchoEdge e;
+  TEST_ASSERT_FALSE(ring.pop(e));
+  for (int round = 0; round < 40; round++) {                   // indices wrap many times
+    TEST_ASSERT_TRUE(ring.push(round * 10, round & 1));
+    TEST_ASSERT_TRUE(ring.pop(e));
+    TEST_ASSERT_EQUAL_UINT32(round * 10, e.timeUs);
+    TEST_ASSERT_EQUAL_UINT8(round & 1, e.level);
+  }
+  for (int i = 0; i < EDGE_RING_SIZE; i++) TEST_ASSERT_TRUE(ring.push(i, 1));
+  TEST_ASSERT_FALSE(ring.push(99, 0));
+  TEST_ASSERT_FALSE(ring.push(99, 0));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.droppedEdges());
+  TEST_ASSERT_TRUE(ring.pop(e));
+  TEST_ASSERT_EQUAL_UINT32(0, e.timeUs);
+  ring.clear();
+  TEST_ASSERT_FALSE(ring.pop(e));
+}
+
+void test_us100_parser(void) {
+  Us100Parser parser;
+  TEST_ASSERT_FALSE(parser.complete());
+  TEST_ASSERT_EQUAL_UINT16(0, parser.distanceMm());
+  TEST_ASSERT_FALSE(parser.feed(0x0F));
+  TEST_ASSERT_EQUAL_UINT16(0, parser.distanceMm());            // half a reply is no distance
+  TEST_ASSERT_TRUE(parser.feed(0xA0));
+  TEST_ASSERT_EQUAL_UINT16(4000, parser.distanceMm());
+  TEST_ASSERT_TRUE(parser.feed(0x55));                         // extra bytes do not corrupt the value
+  TEST_ASSERT_EQUAL_UINT16(4000, parser.distanceMm());
+  parser.reset();
+  parser.feed(0x00);
+  parser.feed(0x14);
+  TEST_ASSERT_EQUAL_UINT16(20, parser.distanceMm());
+}
+
+void test_mm_to_echo(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, mmToEchoUs(0));
+  TEST_ASSERT_EQUAL_UINT32(0, mmToEchoUs(-5));
+  TEST_ASSERT_EQUAL_UINT32(5831, mmToEchoUs(1000));
+  TEST_ASSERT_EQUAL_UINT32(23324, mmToEchoUs(4000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_pulse);
+  RUN_TEST(test_rise_outside_latency_window);
+  RUN_TEST(test_short_pulse_then_real_echo);
+  RUN_TEST(test_dropouts_inside_the_pulse_are_bridged);
+  RUN_TEST(test_gap_at_the_bridge_limit_ends_the_pulse);
+  RUN_TEST(test_random_glitch_injection);
+  RUN_TEST(test_timeout_across_micros_wrap);
+  RUN_TEST(test_edge_ring_order_overflow_and_clear);
+  RUN_TEST(test_us100_parser);
+  RUN_TEST(test_mm_to_echo);
+  return UNITY_END();
+}
@@ -0,0 +1,164 @@
+/*********************************************************************************************************
+ * Glyph Atlas Tests
+ *
+ * Colour blending and panel byte order, coverage anti-aliasing of a synthetic source font, and compose():
+ * right alignment, background fill, skipped characters and clipping on the left, down to glyphs that lie
+ * wholly outside the strip.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "glyph_atlas.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define CELL_W 8
+#define CELL_H 8
+#define WHITE 0xFFFF
+#define BLACK 0x0000
+
+// Source font 16px high: digit n is a solid block 2n+2 px wide, '.' a 4px block, ' ' 8px of nothing
+struct BlockFont {
+  int inkWidth;
+  bool ink(int x, int) const { return x < inkWidth; }
+};
+
+// Source with the left half of a 16 x 16 glyph inked
+struct HalfFont {
+  bool ink(int x, int) const { return x < 8; }
+};
+
+typedef GlyphAtlas<CELL_W, CELL_H> TestAtlas;
+
+static TestAtlas atlas;
+
+static void buildAtlas() {
+  atlas.begin(WHITE, BLACK);
+  for (char c = '0'; c <= '9'; c++) {
+    int n = c - '0';
+    BlockFont source = { 2 * n + 2 };
+    atlas.addGlyph(c, source, source.inkWidth, 16);            // advance n + 1 px
+  }
+  BlockFont dot = { 4 };
+  atlas.addGlyph('.', dot, 4, 16);
+  BlockFont space = { 0 };
+  atlas.addGlyph(' ', space, 8, 16);
+}
+
+void test_blend_and_byte_order(void) {
+  TEST_ASSERT_EQUAL_HEX16(0xF800, blend565(0xF800, 0x001F, 255));
+  TEST_ASSERT_EQUAL_HEX16(0x001F, blend565(0xF800, 0x001F, 0));
+  TEST_ASSERT_EQUAL_HEX16(0x8410, blend565(WHITE, BLACK, 128));  // 16/32, 32/64, 16/32 per channel
+  TEST_ASSERT_EQUAL_HEX16(0x3412, panelOrder565(0x1234));
+  TEST_ASSERT_EQUAL_INT(10, glyphIndex('.'));
+  TEST_ASSERT_EQUAL_INT(-1, glyphIndex('-'));
+}
+
+void test_coverage_anti_aliasing(void) {
+  buildAtlas();
+  TEST_ASSERT_EQUAL_UINT8(1, atlas.advance('0'));
+  TEST_ASSERT_EQUAL_UINT8(8, atlas.advance('7'));
+  TEST_ASSERT_EQUAL_UINT8(8, atlas.advance('9'));              // 10px clamped to the cell
+  TEST_ASSERT_EQUAL_UINT8(0, atlas.advance('-'));
+
+  // '9' is fully inked across the cell, ' ' not at all
+  const uint16_t* nine = atlas.glyph('9');
+  const uint16_t* space = atlas.glyph(' ');
+  for (int i = 0; i < CELL_W * CELL_H; i++) {
+    TEST_ASSERT_EQUAL_HEX16(panelOrder565(WHITE), nine[i]);
+    TEST_ASSERT_EQUAL_HEX16(panelOrder565(BLACK), space[i]);
+  }
+
+  // An edge on a pixel boundary stays sharp
+  TestAtlas edge;
+  edge.begin(WHITE, BLACK);
+  HalfFont half;
+  edge.addGlyph('1', half, 10, 16);                           // 5 output px, ink ends at x = 4
+  const uint16_t* cell = edge.glyph('1');
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(WHITE), cell[3]);
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(BLACK), cell[4]);
+
+  // One inside a pixel is blended: ink ending at source x = 5 (output x = 2.5) covers 8 of 16 samples
+  TestAtlas partial;
+  partial.begin(WHITE, BLACK);
+  BlockFont thin = { 5 };
+  partial.addGlyph('2', thin, 14, 16);
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(WHITE), partial.glyph('2')[1]);
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(blend565(WHITE, BLACK, 128)), partial.glyph('2')[2]);
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(BLACK), partial.glyph('2')[3]);
+}
+
+// Reference: text composed pixel by pixel into a strip wide enough for all of it, then cut to the right
+static void reference(const char* text, uint16_t* strip, int stripWidth) {
+  int total = atlas.textWidth(text);
+  int x = stripWidth - total;
+  for (int i = 0; i < stripWidth * CELL_H; i++) strip[i] = panelOrder565(BLACK);
+  for (const char* p = text; *p; p++) {
+    const uint16_t* cell = atlas.glyph(*p);
+    int width = atlas.advance(*p);
+    if (cell == nullptr) continue;
+    for (int y = 0; y < CELL_H; y++) {
+      for (int gx = 0; gx < width; gx++) {
+        if (x + gx >= 0) strip[y * stripWidth + x + gx] = cell[y * CELL_W + gx];
+      }
+    }
+    x += width;
+  }
+}
+
+void test_compose_right_aligned(void) {
+  buildAtlas();
+  uint16_t strip[32 * CELL_H], expected[32 * CELL_H];
+  for (uint16_t& pixel : strip) pixel = 0xAAAA;                 // every pixel must be written
+
+  atlas.compose("12.5", strip, 32);                            // 2 + 3 + 2 + 6 = 13 px
+  TEST_ASSERT_EQUAL_INT(13, atlas.textWidth("12.5"));
+  reference("12.5", expected, 32);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, strip, 32 * CELL_H);
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(BLACK), strip[18]);     // background up to x0 = 19
+  TEST_ASSERT_EQUAL_HEX16(panelOrder565(WHITE), strip[19]);
+
+  // Characters the atlas does not hold take no space
+  atlas.compose("-12.5", strip, 32);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, strip, 32 * CELL_H);
+
+  atlas.compose("", strip, 32);
+  reference("", expected, 32);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, strip, 32 * CELL_H);
+}
+
+void test_compose_clips_left(void) {
+  buildAtlas();
+  const char* const texts[] = {
+    "4500.0",        // 5 + 6 + 1 + 1 + 2 + 1 = 16 px: the last glyphs only
+    "99999",         // 40 px
+    "78",            // exactly the strip
+    "1999",          // first glyph wholly outside, second cut
+    "0000000078",    // ten glyphs, eight of them wholly outside
+  };
+  uint16_t strip[10 * CELL_H], expected[10 * CELL_H];
+  for (const char* text : texts) {
+    for (int width = 1; width <= 10; width++) {
+      for (uint16_t& pixel : strip) pixel = 0xAAAA;
+      atlas.compose(text, strip, width);
+      reference(text, expected, width);
+      TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, strip, width * CELL_H);
+    }
+  }
+
+  // Nothing is written past the strip
+  uint16_t guarded[4 * CELL_H + 4];
+  for (uint16_t& pixel : guarded) pixel = 0xAAAA;
+  atlas.compose("99999", guarded, 4);
+  for (int i = 4 * CELL_H; i < 4 * CELL_H + 4; i++) TEST_ASSERT_EQUAL_HEX16(0xAAAA, guarded[i]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blend_and_byte_order);
+  RUN_TEST(test_coverage_anti_aliasing);
+  RUN_TEST(test_compose_right_aligned);
+  RUN_TEST(test_compose_clips_left);
+  return UNITY_END();
+}
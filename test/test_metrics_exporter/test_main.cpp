@@ -0,0 +1,124 @@
+/*********************************************************************************************************
+ * Metrics Exporter Tests
+ *
+ * The Prometheus text exposition produced by MetricsWriter (families, signed and scaled values,
+ * cumulative histogram buckets with +Inf, _sum and _count), truncation at a line boundary when the
+ * buffer is full, and the snapshot a scrape renders from.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "metrics_exporter.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const uint32_t bucketsUs[] = { 1000, 5000, 20000 };
+
+void test_counter_and_gauge_lines(void) {
+  char buffer[512];
+  MetricsWriter out(buffer, sizeof(buffer));
+  out.counter("samples_total", "Measurements completed", (uint64_t)18446744073709551615ULL);
+  out.gauge("offset_mm", "Signed value", -42);
+  out.gauge("zero", "Zero", 0);
+  TEST_ASSERT_EQUAL_STRING("# HELP samples_total Measurements completed\n"
+                           "# TYPE samples_total counter\n"
+                           "samples_total 18446744073709551615\n"
+                           "# HELP offset_mm Signed value\n"
+                           "# TYPE offset_mm gauge\n"
+                           "offset_mm -42\n"
+                           "# HELP zero Zero\n"
+                           "# TYPE zero gauge\n"
+                           "zero 0\n", out.data());
+  TEST_ASSERT_EQUAL_UINT32(strlen(buffer), out.length());
+  TEST_ASSERT_FALSE(out.overflowed());
+}
+
+void test_scaled_values(void) {
+  char buffer[256];
+  MetricsWriter out(buffer, sizeof(buffer));
+  out.scaledSample("m", 1234, 3);                              // mm as metres
+  out.scaledSample("m", 1200, 3);                              // trailing zeros dropped
+  out.scaledSample("m", 2000, 3);                              // whole number: no point
+  out.scaledSample("m", 7, 3);
+  out.scaledSample("m", -5, 3);
+  out.scaledSample("s", 60000, 6);                             // µs as seconds
+  out.scaledSample("s", 5, 0);
+  TEST_ASSERT_EQUAL_STRING("m 1.234\nm 1.2\nm 2\nm 0.007\nm -0.005\ns 0.06\ns 5\n", out.data());
+}
+
+void test_histogram_is_cumulative(void) {
+  LatencyHistogram<3> histogram(bucketsUs);
+  const uint32_t observations[] = { 500, 1000, 1001, 4000, 30000, 30000 };
+  for (uint32_t us : observations) histogram.observe(us);
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.bucketCount(0));       // bounds are inclusive
+  TEST_ASSERT_EQUAL_UINT32(2, histogram.bucketCount(3));       // overflow bucket
+
+  char buffer[512];
+  MetricsWriter out(buffer, sizeof(buffer));
+  out.histogramSeconds("render_seconds", "Render time", histogram);
+  TEST_ASSERT_EQUAL_STRING("# HELP render_seconds Render time\n"
+                           "# TYPE render_seconds histogram\n"
+                           "render_seconds_bucket{le=\"0.001\"} 2\n"
+                           "render_seconds_bucket{le=\"0.005\"} 4\n"
+                           "render_seconds_bucket{le=\"0.02\"} 4\n"
+                           "render_seconds_bucket{le=\"+Inf\"} 6\n"
+                           "render_seconds_sum 0.066501\n"
+                           "render_seconds_count 6\n", out.data());
+}
+
+void test_truncates_at_line_boundary(void) {
+  char buffer[40];
+  MetricsWriter out(buffer, sizeof(buffer));
+  out.sample("first_metric", (uint64_t)1);                     // 15 bytes
+  out.sample("second_metric", (uint64_t)2);                    // 16 bytes: 31 in all
+  out.sample("third_metric", (uint64_t)123456);                // does not fit
+  TEST_ASSERT_TRUE(out.overflowed());
+  TEST_ASSERT_EQUAL_STRING("first_metric 1\nsecond_metric 2\n", out.data());
+  out.sample("x", (uint64_t)1);                                // nothing more once full
+  TEST_ASSERT_EQUAL_UINT32(31, out.length());
+
+  MetricsWriter empty(buffer, 0);
+  empty.gauge("g", "help", 1);
+  TEST_ASSERT_TRUE(empty.overflowed());
+  TEST_ASSERT_EQUAL_UINT32(0, empty.length());
+}
+
+struct Values {
+  Values() : histogram(bucketsUs) {}
+  uint32_t samples = 0;
+  LatencyHistogram<3> histogram;
+};
+
+void test_snapshot_copies_whole_values(void) {
+  MetricsSnapshot<Values> snapshot;
+  Values out;
+  Values& edit = snapshot.edit();
+  edit.samples = 10;
+  edit.histogram.observe(3000);
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT32(0, out.samples);                    // not visible before publish()
+  snapshot.publish();
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT32(10, out.samples);
+  TEST_ASSERT_EQUAL_UINT32(1, out.histogram.count());
+
+  // The next edit starts from the published values; the copy renders on its own
+  snapshot.edit().histogram.observe(50000);
+  snapshot.publish();
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT32(10, out.samples);
+  TEST_ASSERT_EQUAL_UINT32(2, out.histogram.count());
+  TEST_ASSERT_EQUAL_UINT32(5000, out.histogram.bound(1));
+  TEST_ASSERT_EQUAL_UINT32(1, out.histogram.bucketCount(3));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_counter_and_gauge_lines);
+  RUN_TEST(test_scaled_values);
+  RUN_TEST(test_histogram_is_cumulative);
+  RUN_TEST(test_truncates_at_line_boundary);
+  RUN_TEST(test_snapshot_copies_whole_values);
+  return UNITY_END();
+}
@@ -0,0 +1,207 @@
+/*********************************************************************************************************
+ * Modbus RTU Tests
+ *
+ * CRC-16/MODBUS against published check values, the three supported functions and their exceptions,
+ * framing as the receive handler sees it (one process() per UART receive timeout: frames cut by a
+ * silence or run together), corrupted frames, and the register snapshot.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "modbus_rtu.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const uint16_t holdingMax[MODBUS_HOLDING_REGS] = { 1, 1024, 4 };   // as in src/main.cpp
+
+// Build a request frame (address, function, two big-endian words, CRC), returns its length
+static uint16_t request(uint8_t* frame, uint8_t address, uint8_t function, uint16_t a, uint16_t b) {
+  frame[0] = address;
+  frame[1] = function;
+  frame[2] = a >> 8;
+  frame[3] = a & 0xFF;
+  frame[4] = b >> 8;
+  frame[5] = b & 0xFF;
+  uint16_t crc = modbusCrc16(frame, 6);
+  frame[6] = crc & 0xFF;
+  frame[7] = crc >> 8;
+  return 8;
+}
+
+// Feed bytes as one UART receive timeout would deliver them, then process
+static uint16_t deliver(ModbusRtuSlave& slave, const ModbusRegisters& registers, const uint8_t* bytes, uint16_t n,
+                        uint8_t* response) {
+  for (uint16_t i = 0; i < n; i++) slave.feed(bytes[i]);
+  return slave.process(registers, response);
+}
+
+static bool crcValid(const uint8_t* frame, uint16_t length) {
+  uint16_t crc = modbusCrc16(frame, length - 2);
+  return frame[length - 2] == (crc & 0xFF) && frame[length - 1] == (crc >> 8);
+}
+
+static ModbusRegisters testRegisters() {
+  ModbusRegisters registers;
+  for (uint16_t i = 0; i < MODBUS_INPUT_REGS; i++) registers.input[i] = (uint16_t)(0x1000 + i);
+  registers.holding[0] = 1;
+  registers.holding[1] = 64;
+  registers.holding[2] = 0;
+  return registers;
+}
+
+void test_crc_check_values(void) {
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  TEST_ASSERT_EQUAL_HEX16(0x4B37, modbusCrc16(check, 9));      // CRC-16/MODBUS catalogue check value
+  const uint8_t spec[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+  TEST_ASSERT_EQUAL_HEX16(0xCDC5, modbusCrc16(spec, 6));       // sent low byte first: C5 CD
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, modbusCrc16(spec, 0));
+}
+
+void test_read_registers(void) {
+  ModbusRtuSlave slave(7, holdingMax);
+  ModbusRegisters registers = testRegisters();
+  uint8_t frame[8], response[MODBUS_FRAME_MAX];
+
+  uint16_t length = deliver(slave, registers, frame, request(frame, 7, 0x04, 2, 3), response);
+  TEST_ASSERT_EQUAL_UINT16(3 + 6 + 2, length);
+  const uint8_t expected[] = { 7, 0x04, 6, 0x10, 0x02, 0x10, 0x03, 0x10, 0x04 };
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, response, 9);
+  TEST_ASSERT_TRUE(crcValid(response, length));
+
+  length = deliver(slave, registers, frame, request(frame, 7, 0x03, 0, MODBUS_HOLDING_REGS), response);
+  TEST_ASSERT_EQUAL_UINT16(3 + 2 * MODBUS_HOLDING_REGS + 2, length);
+  TEST_ASSERT_EQUAL_UINT8(64, response[6]);
+  TEST_ASSERT_EQUAL_UINT32(2, slave.frames());
+}
+
+// Exception response code for a request (0 = normal response)
+static uint8_t exceptionFor(ModbusRtuSlave& slave, uint8_t function, uint16_t a, uint16_t b) {
+  uint8_t frame[8], response[MODBUS_FRAME_MAX];
+  ModbusRegisters registers = testRegisters();
+  uint16_t length = deliver(slave, registers, frame, request(frame, 7, function, a, b), response);
+  TEST_ASSERT_TRUE(crcValid(response, length));
+  if ((response[1] & 0x80) == 0) return 0;
+  TEST_ASSERT_EQUAL_UINT16(5, length);
+  TEST_ASSERT_EQUAL_UINT8(function, response[1] & 0x7F);
+  return response[2];
+}
+
+void test_exceptions(void) {
+  ModbusRtuSlave slave(7, holdingMax);
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_FUNCTION, exceptionFor(slave, 0x10, 0, 1));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_ADDRESS, exceptionFor(slave, 0x04, MODBUS_INPUT_REGS - 1, 2));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_ADDRESS, exceptionFor(slave, 0x03, 0xFFFF, 2));   // no wrap
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_VALUE, exceptionFor(slave, 0x04, 0, 0));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_VALUE, exceptionFor(slave, 0x04, 0, MODBUS_MAX_READ + 1));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_ADDRESS, exceptionFor(slave, 0x06, MODBUS_HOLDING_REGS, 0));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_ILLEGAL_VALUE, exceptionFor(slave, 0x06, 1, 1025));
+  TEST_ASSERT_EQUAL_UINT32(7, slave.exceptions());
+}
+
+void test_writes_are_queued(void) {
+  ModbusRtuSlave slave(7, holdingMax);
+  ModbusRegisters registers = testRegisters();
+  uint8_t frame[8], response[MODBUS_FRAME_MAX];
+
+  uint16_t n = request(frame, 7, 0x06, 1, 256);
+  TEST_ASSERT_EQUAL_UINT16(8, deliver(slave, registers, frame, n, response));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, response, 8);           // normal response echoes the request
+
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, frame, request(frame, 0, 0x06, 2, 3), response));  // broadcast
+  for (int i = 0; i < MODBUS_WRITE_QUEUE - 2; i++) TEST_ASSERT_EQUAL_UINT8(0, exceptionFor(slave, 0x06, 0, 1));
+  TEST_ASSERT_EQUAL_UINT8(MODBUS_BUSY, exceptionFor(slave, 0x06, 0, 0));
+
+  ModbusWrite write;
+  TEST_ASSERT_TRUE(slave.takeWrite(write));
+  TEST_ASSERT_EQUAL_UINT16(1, write.address);
+  TEST_ASSERT_EQUAL_UINT16(256, write.value);
+  TEST_ASSERT_TRUE(slave.takeWrite(write));
+  TEST_ASSERT_EQUAL_UINT16(2, write.address);
+  TEST_ASSERT_EQUAL_UINT16(3, write.value);
+  int remaining = 0;
+  while (slave.takeWrite(write)) remaining++;
+  TEST_ASSERT_EQUAL_INT(MODBUS_WRITE_QUEUE - 2, remaining);
+}
+
+void test_inter_frame_timing(void) {
+  ModbusRtuSlave slave(7, holdingMax);
+  ModbusRegisters registers = testRegisters();
+  uint8_t frame[8], second[8], both[16], response[MODBUS_FRAME_MAX];
+  uint16_t n = request(frame, 7, 0x04, 0, 1);
+
+  // A silence inside a frame (the master stalled): each part ends at a receive timeout and is dropped
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, frame, 5, response));
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, frame + 5, 3, response));
+  TEST_ASSERT_EQUAL_UINT32(2, slave.crcErrors());
+
+  // The next whole frame is answered: nothing of the broken one is carried over
+  TEST_ASSERT_EQUAL_UINT16(7, deliver(slave, registers, frame, n, response));
+
+  // Two frames without the 3.5 character gap between them arrive as one and are dropped
+  request(second, 7, 0x03, 0, 1);
+  memcpy(both, frame, 8);
+  memcpy(both + 8, second, 8);
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, both, 16, response));
+  TEST_ASSERT_EQUAL_UINT32(3, slave.crcErrors());
+
+  // An overlong burst of line noise is dropped without overrunning the frame buffer
+  for (int i = 0; i < MODBUS_FRAME_MAX + 40; i++) slave.feed((uint8_t)i);
+  TEST_ASSERT_EQUAL_UINT16(0, slave.process(registers, response));
+  TEST_ASSERT_EQUAL_UINT16(7, deliver(slave, registers, frame, n, response));
+  TEST_ASSERT_EQUAL_UINT32(2, slave.frames());
+}
+
+void test_corrupted_frames(void) {
+  ModbusRtuSlave slave(7, holdingMax);
+  ModbusRegisters registers = testRegisters();
+  uint8_t frame[8], response[MODBUS_FRAME_MAX];
+  uint16_t n = request(frame, 7, 0x06, 1, 32);
+
+  // Every single-bit error is caught: no response and no queued write
+  for (uint16_t bit = 0; bit < n * 8; bit++) {
+    uint8_t corrupted[8];
+    memcpy(corrupted, frame, n);
+    corrupted[bit / 8] ^= (uint8_t)(1 << (bit % 8));
+    TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, corrupted, n, response));
+  }
+  TEST_ASSERT_EQUAL_UINT32(n * 8, slave.crcErrors());
+  TEST_ASSERT_EQUAL_UINT32(0, slave.frames());
+  ModbusWrite write;
+  TEST_ASSERT_FALSE(slave.takeWrite(write));
+
+  // Too short to carry a CRC, and valid frames for another slave (ignored, not errors)
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, frame, 3, response));
+  TEST_ASSERT_EQUAL_UINT32(n * 8 + 1, slave.crcErrors());
+  TEST_ASSERT_EQUAL_UINT16(0, deliver(slave, registers, frame, request(frame, 8, 0x04, 0, 1), response));
+  TEST_ASSERT_EQUAL_UINT32(n * 8 + 1, slave.crcErrors());
+  TEST_ASSERT_EQUAL_UINT32(0, slave.frames());
+}
+
+void test_snapshot(void) {
+  ModbusSnapshot snapshot;
+  ModbusRegisters out;
+  snapshot.edit().input[0] = 11;
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT16(0, out.input[0]);                   // not visible before publish()
+  snapshot.publish();
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT16(11, out.input[0]);
+  snapshot.edit().input[1] = 22;                               // the next edit starts from the published copy
+  snapshot.publish();
+  snapshot.read(out);
+  TEST_ASSERT_EQUAL_UINT16(11, out.input[0]);
+  TEST_ASSERT_EQUAL_UINT16(22, out.input[1]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_check_values);
+  RUN_TEST(test_read_registers);
+  RUN_TEST(test_exceptions);
+  RUN_TEST(test_writes_are_queued);
+  RUN_TEST(test_inter_frame_timing);
+  RUN_TEST(test_corrupted_frames);
+  RUN_TEST(test_snapshot);
+  return UNITY_END();
+}
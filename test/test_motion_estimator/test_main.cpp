@@ -0,0 +1,139 @@
+/*********************************************************************************************************
+ * Motion Estimator Tests
+ *
+ * Velocity, acceleration and time-to-contact on analytic motion profiles, and the O(1) sliding regression
+ * against a brute-force least-squares fit over irregular timestamps, millis() wrap-around and long runs
+ * (the re-based sums must not drift).
+ *
+ **********************************************************************************************************/
+
+#include <math.h>
+#include <unity.h>
+#include "motion_estimator.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Least-squares slope (per second) over the last n points, in doubles
+static double bruteSlope(const uint32_t* t, const int32_t* y, int end, int n) {
+  double st = 0, sy = 0, sty = 0, stt = 0;
+  for (int i = end - n; i < end; i++) {
+    double ti = (double)(uint32_t)(t[i] - t[end - n]);
+    st += ti;
+    sy += y[i];
+    sty += ti * y[i];
+    stt += ti * ti;
+  }
+  return (n * sty - st * sy) / (n * stt - st * st) * 1000;
+}
+
+void test_static_target(void) {
+  MotionEstimator motion;
+  for (int i = 0; i < 20; i++) motion.update(i * 100, 1234);
+  TEST_ASSERT_TRUE(motion.current().valid);
+  TEST_ASSERT_EQUAL_INT32(0, motion.current().velocityMmS);
+  TEST_ASSERT_EQUAL_INT32(0, motion.current().accelMmS2);
+  TEST_ASSERT_TRUE(motion.current().timeToContactMs == MOTION_NO_CONTACT);
+}
+
+void test_valid_after_three_samples(void) {
+  MotionEstimator motion;
+  TEST_ASSERT_FALSE(motion.update(0, 1000).valid);
+  TEST_ASSERT_FALSE(motion.update(100, 990).valid);
+  TEST_ASSERT_TRUE(motion.update(200, 980).valid);
+  motion.reset();
+  TEST_ASSERT_FALSE(motion.current().valid);
+}
+
+void test_constant_approach(void) {
+  // 500 mm/s towards the sensor, 50ms apart
+  MotionEstimator motion;
+  MotionState state = {};
+  for (int i = 0; i < 30; i++) state = motion.update(i * 50, 3000 - 25 * i);
+  TEST_ASSERT_EQUAL_INT32(-500, state.velocityMmS);
+  TEST_ASSERT_EQUAL_INT32(0, state.accelMmS2);
+  TEST_ASSERT_EQUAL_UINT32((3000 - 25 * 29) * 2, state.timeToContactMs);
+}
+
+void test_receding_and_slow_targets_have_no_contact(void) {
+  MotionEstimator motion;
+  for (int i = 0; i < 20; i++) motion.update(i * 100, 1000 + 30 * i);
+  TEST_ASSERT_EQUAL_INT32(300, motion.current().velocityMmS);
+  TEST_ASSERT_TRUE(motion.current().timeToContactMs == MOTION_NO_CONTACT);
+
+  motion.reset();
+  for (int i = 0; i < 20; i++) motion.update(i * 100, 1000 - i);    // 10 mm/s, below the threshold
+  TEST_ASSERT_EQUAL_INT32(-10, motion.current().velocityMmS);
+  TEST_ASSERT_TRUE(motion.current().timeToContactMs == MOTION_NO_CONTACT);
+}
+
+void test_constant_acceleration(void) {
+  // y = 3000 - 0.5 * 400 t²: velocity -400 t, acceleration -400 mm/s²
+  MotionEstimator motion;
+  MotionState state = {};
+  for (int i = 0; i <= 30; i++) {
+    double t = i * 0.05;
+    state = motion.update(i * 50, (int32_t)lround(3000 - 200 * t * t));
+  }
+  // The window centre is 3.5 samples behind the newest one
+  TEST_ASSERT_INT32_WITHIN(3, (int32_t)(-400 * (1.5 - 3.5 * 0.05)), state.velocityMmS);
+  TEST_ASSERT_INT32_WITHIN(8, -400, state.accelMmS2);
+}
+
+void test_savitzky_golay_quadratic(void) {
+  MotionEstimator motion(true);
+  MotionState state = {};
+  // y = 2000 + 100 t - 200 t² (whole millimetres at 100ms spacing): exact for a quadratic fit
+  for (int i = 0; i <= 20; i++) state = motion.update(i * 100, 2000 + 10 * i - 2 * i * i);
+  // Derivatives at the centre of the last 5 points (t = 1.8s)
+  TEST_ASSERT_EQUAL_INT32(100 - 400 * 18 / 10, state.velocityMmS);
+  TEST_ASSERT_EQUAL_INT32(-400, state.accelMmS2);
+}
+
+void test_slope_window_matches_brute_force(void) {
+  const int n = 5000;
+  static uint32_t times[n];
+  static int32_t values[n];
+  uint32_t seed = 42, t = 0xFFFFF000u;                         // wraps after ~4s
+  SlopeWindow<MOTION_WINDOW> window;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    t += 5 + (seed >> 24) % 200;                               // irregular spacing
+    times[i] = t;
+    values[i] = 1500 + (int32_t)((seed >> 8) % 2000) - 1000;
+    window.add(times[i], values[i]);
+    int count = i + 1 < MOTION_WINDOW ? i + 1 : MOTION_WINDOW;
+    if (count < 3) continue;
+    double expected = bruteSlope(times, values, i + 1, count);
+    TEST_ASSERT_INT32_WITHIN(1, (int32_t)expected, window.slopePerSecond());
+  }
+}
+
+void test_long_run_does_not_drift(void) {
+  // A million evictions, then a clean line: the re-based sums must give the exact slope
+  SlopeWindow<MOTION_WINDOW> window;
+  uint32_t t = 0;
+  for (int i = 0; i < 1000000; i++) window.add(t += 7 + i % 13, (int32_t)((i * 7919LL) % 4000));
+  for (int i = 0; i < MOTION_WINDOW; i++) window.add(t += 100, 100 * i);
+  TEST_ASSERT_EQUAL_INT32(1000, window.slopePerSecond());
+}
+
+void test_identical_timestamps_give_zero_slope(void) {
+  SlopeWindow<MOTION_WINDOW> window;
+  for (int i = 0; i < 5; i++) window.add(500, 1000 + i);
+  TEST_ASSERT_EQUAL_INT32(0, window.slopePerSecond());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_static_target);
+  RUN_TEST(test_valid_after_three_samples);
+  RUN_TEST(test_constant_approach);
+  RUN_TEST(test_receding_and_slow_targets_have_no_contact);
+  RUN_TEST(test_constant_acceleration);
+  RUN_TEST(test_savitzky_golay_quadratic);
+  RUN_TEST(test_slope_window_matches_brute_force);
+  RUN_TEST(test_long_run_does_not_drift);
+  RUN_TEST(test_identical_timestamps_give_zero_slope);
+  return UNITY_END();
+}
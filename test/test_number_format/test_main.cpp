@@ -0,0 +1,143 @@
+/*********************************************************************************************************
+ * Number Format Tests
+ *
+ * TextBuilder's integer, fixed-point and hex output at the digit-pair and sign edges, truncation of
+ * output that does not fit, and roundedQuotient() against printf's "%.1f" / "%.2f" for the quantities
+ * the readout and the serial reports print (mL as litres, ms as seconds, Q8 mm as hundredths).
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include <stdio.h>
+#include "number_format.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_integers(void) {
+  char text[64];
+  TextBuilder out(text, sizeof(text));
+  out.unsignedValue(0).character(' ').unsignedValue(9).character(' ').unsignedValue(10).character(' ')
+    .unsignedValue(99).character(' ').unsignedValue(100).character(' ').unsignedValue(4294967295u);
+  TEST_ASSERT_EQUAL_STRING("0 9 10 99 100 4294967295", text);
+
+  TextBuilder signedOut(text, sizeof(text));
+  signedOut.signedValue(-1).character(' ').signedValue(2147483647).character(' ')
+    .signedValue((int32_t)0x80000000u);
+  TEST_ASSERT_EQUAL_STRING("-1 2147483647 -2147483648", text);
+  TEST_ASSERT_EQUAL_UINT32(strlen(text), signedOut.length());
+}
+
+void test_fixed_point(void) {
+  char text[64];
+  TextBuilder out(text, sizeof(text));
+  out.fixed(1234, 1).character(' ').fixed(105, 2).character(' ').fixed(7, 3).character(' ').fixed(-5, 1)
+    .character(' ').fixed(0, 2).character(' ').fixed(-1200, 0).character(' ').fixed(1, 12);
+  TEST_ASSERT_EQUAL_STRING("123.4 1.05 0.007 -0.5 0.00 -1200 0.000000001", text);  // decimals capped at 9
+}
+
+void test_hex_and_text(void) {
+  char text[16];
+  TextBuilder out(text, sizeof(text));
+  out.hex2(0x00).character(',').hex2(0x2A).character(',').hex2(0xFF).text(" ok");
+  TEST_ASSERT_EQUAL_STRING("00,2A,FF ok", text);
+}
+
+void test_overflow_keeps_terminator(void) {
+  char text[8];
+  TextBuilder out(text, sizeof(text));
+  out.text("abc").unsignedValue(1234);                         // 7 characters + NUL: fits exactly
+  TEST_ASSERT_FALSE(out.overflowed());
+  out.character('x');                                          // dropped
+  TEST_ASSERT_TRUE(out.overflowed());
+  TEST_ASSERT_EQUAL_STRING("abc1234", text);
+
+  TextBuilder number(text, 4);
+  number.unsignedValue(12345);                                 // a number is dropped whole, not cut
+  TEST_ASSERT_EQUAL_STRING("", text);
+  TEST_ASSERT_TRUE(number.overflowed());
+
+  TextBuilder empty(text, 0);
+  empty.text("a");
+  TEST_ASSERT_TRUE(empty.overflowed());
+  TEST_ASSERT_EQUAL_UINT32(0, empty.length());
+}
+
+void test_rounded_quotient(void) {
+  // Half away from zero, symmetric around 0
+  TEST_ASSERT_EQUAL_INT32(1, roundedQuotient(149, 100));
+  TEST_ASSERT_EQUAL_INT32(2, roundedQuotient(150, 100));
+  TEST_ASSERT_EQUAL_INT32(-1, roundedQuotient(-149, 100));
+  TEST_ASSERT_EQUAL_INT32(-2, roundedQuotient(-150, 100));
+  TEST_ASSERT_EQUAL_INT32(0, roundedQuotient(-4, 10));
+  TEST_ASSERT_EQUAL_INT32(0, roundedQuotient(0, 256));
+  TEST_ASSERT_EQUAL_INT32(1, roundedQuotient(128, 256));
+  TEST_ASSERT_EQUAL_INT32(-1, roundedQuotient(-128, 256));
+
+  // Numerators past int32_t (a scaled value before the divide)
+  TEST_ASSERT_EQUAL_INT32(429496730, roundedQuotient(4294967295LL, 10));
+  TEST_ASSERT_EQUAL_INT32(-2147483647, roundedQuotient(-21474836474LL, 10));
+}
+
+// Format tenths / hundredths the way the firmware does, and with printf
+static void formatBoth(int64_t value, int32_t divisor, uint8_t decimals, char* ours, char* reference) {
+  TextBuilder out(ours, 32);
+  out.fixed(roundedQuotient(value * (decimals == 1 ? 10 : 100), divisor), decimals);
+  snprintf(reference, 32, decimals == 1 ? "%.1f" : "%.2f", (double)value / divisor);
+
+  // printf keeps the sign of a negative value that rounds to zero; the readout shows plain zero
+  if (strcmp(reference, "-0.0") == 0 || strcmp(reference, "-0.00") == 0) memmove(reference, reference + 1, 5);
+}
+
+void test_matches_printf(void) {
+  char ours[32], reference[32];
+  uint32_t compared = 0;
+
+  // Volume (mL as L), time to contact (ms as s), and flow in mL/s as L/min, including negative flow
+  for (int64_t ml = -5000; ml <= 250000; ml += 7) {
+    if (ml % 100 == 50 || ml % 100 == -50) continue;           // exact ties: printf sees the binary value
+    formatBoth(ml, 1000, 1, ours, reference);
+    TEST_ASSERT_EQUAL_STRING(reference, ours);
+    compared++;
+  }
+
+  // High-resolution distance and interval: Q8 mm as hundredths
+  for (int64_t q8 = -2560; q8 <= 4000 * 256; q8 += 13) {
+    if ((q8 * 100) % 256 == 128 || (q8 * 100) % 256 == -128) continue;
+    formatBoth(q8, 256, 2, ours, reference);
+    TEST_ASSERT_EQUAL_STRING(reference, ours);
+    compared++;
+  }
+  TEST_ASSERT_GREATER_THAN(100000, compared);
+}
+
+void test_readout_lines(void) {
+  // As drawVolumeReadout() and processHighResolution() in src/main.cpp
+  char text[80];
+  int32_t volumeMl = 1234567, flowMlPerSecond = -17;
+  TextBuilder readout(text, sizeof(text));
+  int32_t flowTenths = roundedQuotient((int64_t)flowMlPerSecond * 6, 10);
+  readout.fixed(roundedQuotient(volumeMl, 100), 1).text(" L")
+    .text(flowTenths < 0 ? "  " : "  +").fixed(flowTenths, 1).text(" L/min");
+  TEST_ASSERT_EQUAL_STRING("1234.6 L  -1.0 L/min", text);
+
+  int32_t distanceMmQ8 = 1234 * 256 + 50, ciMmQ8 = 77;
+  TextBuilder report(text, sizeof(text));
+  report.text("Hi-res: ").fixed(roundedQuotient((int64_t)distanceMmQ8 * 100, 256), 2)
+    .text(" mm +/- ").fixed(roundedQuotient((int64_t)ciMmQ8 * 100, 256), 2)
+    .text(" mm (95%), ").unsignedValue(16).text(" pings in ").unsignedValue(412).text(" ms");
+  TEST_ASSERT_EQUAL_STRING("Hi-res: 1234.20 mm +/- 0.30 mm (95%), 16 pings in 412 ms", text);
+  TEST_ASSERT_FALSE(report.overflowed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_integers);
+  RUN_TEST(test_fixed_point);
+  RUN_TEST(test_hex_and_text);
+  RUN_TEST(test_overflow_keeps_terminator);
+  RUN_TEST(test_rounded_quotient);
+  RUN_TEST(test_matches_printf);
+  RUN_TEST(test_readout_lines);
+  return UNITY_END();
+}
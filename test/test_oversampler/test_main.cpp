@@ -0,0 +1,138 @@
+/*********************************************************************************************************
+ * Oversampler Tests
+ *
+ * Checks the integer statistics against known sets, then measures a static target on the ultrasonic
+ * simulator: with dithered trigger phase the error of the mean falls with sqrt(N), without it the
+ * quantisation step stays, and the 95% interval covers the true echo time.
+ *
+ **********************************************************************************************************/
+
+#include <math.h>
+#include <unity.h>
+#include "oversampler.h"
+#include "../../tools/bench/ultrasonic_sim.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define PING_SPACING_US 35000      // a whole number of sensor steps, so the phase only moves by dither
+
+void test_isqrt64(void) {
+  for (uint64_t v = 0; v < 100000; v++) {
+    uint64_t r = isqrt64(v);
+    TEST_ASSERT_TRUE(r * r <= v && (r + 1) * (r + 1) > v);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, isqrt64(0xFFFFFFFFFFFFFFFFull));
+  TEST_ASSERT_EQUAL_UINT32(3037000499u, isqrt64(9223372030926249001ull));
+}
+
+void test_begin_clamps_ping_count(void) {
+  Oversampler o;
+  o.begin(1);
+  TEST_ASSERT_EQUAL_UINT16(2, o.pingsPerEstimate());
+  o.begin(1000);
+  TEST_ASSERT_EQUAL_UINT16(OVERSAMPLE_MAX_PINGS, o.pingsPerEstimate());
+}
+
+void test_constant_echo_has_zero_interval(void) {
+  Oversampler o;
+  o.begin(16);
+  for (int i = 0; i < 15; i++) TEST_ASSERT_FALSE(o.addEcho(5831));
+  TEST_ASSERT_TRUE(o.addEcho(5831));
+  TEST_ASSERT_TRUE(o.addEcho(9999));                           // ignored once complete
+  OversampleEstimate e = o.estimate();
+  TEST_ASSERT_EQUAL_UINT32(5831u * 256, e.meanEchoQ8);
+  TEST_ASSERT_EQUAL_UINT32(0, e.ci95EchoQ8);
+  TEST_ASSERT_EQUAL_UINT16(16, e.pings);
+}
+
+void test_known_set(void) {
+  // 1000 and 1010 alternating: mean 1005, sample sd 5.345 (n = 8), standard error 1.890, ci 3.704
+  Oversampler o;
+  o.begin(8);
+  for (int i = 0; i < 8; i++) o.addEcho(i % 2 ? 1010 : 1000);
+  OversampleEstimate e = o.estimate();
+  TEST_ASSERT_EQUAL_UINT32(1005u * 256, e.meanEchoQ8);
+  TEST_ASSERT_UINT32_WITHIN(2, (uint32_t)(3.704 * 256), e.ci95EchoQ8);
+}
+
+void test_large_echoes_do_not_overflow(void) {
+  Oversampler o;
+  o.begin(OVERSAMPLE_MAX_PINGS);
+  for (int i = 0; i < OVERSAMPLE_MAX_PINGS; i++) o.addEcho(60000 + (i % 3));
+  OversampleEstimate e = o.estimate();
+  TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)(60000.996 * 256), e.meanEchoQ8);
+  TEST_ASSERT_UINT32_WITHIN(8, (uint32_t)(1.96 * 0.8181 / 16 * 256), e.ci95EchoQ8);
+}
+
+void test_dither_spread_is_whole_steps(void) {
+  uint32_t counts[OVERSAMPLE_DITHER_US + 1] = { 0 };
+  for (uint32_t r = 0; r < 35000; r++) counts[randomTriggerDelayUs(r * 2654435761u)]++;
+  for (int d = 0; d <= OVERSAMPLE_DITHER_US; d++) TEST_ASSERT_UINT32_WITHIN(120, 1000, counts[d]);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, fmodf(OVERSAMPLE_DITHER_US + 1, SIM_HC_SR04.quantUs));
+}
+
+// RMS error (µs) of N-ping estimates of random static targets, trigger dithered or not
+static float rmsError(uint16_t pings, bool dither, float* coverage) {
+  UltrasonicSimConfig config = SIM_HC_SR04;
+  config.noiseUs = 0;
+  config.seed = 7;
+  UltrasonicSim sim(config);
+
+  const int trials = 400;
+  float sumSq = 0;
+  int covered = 0;
+  uint64_t now = 0;
+  for (int t = 0; t < trials; t++) {
+    sim.setDistance(500 + sim.uniform() * 1000);
+    now += 1000000 + (uint64_t)(sim.uniform() * 1000000);        // random phase, time keeps running
+    Oversampler o;
+    o.begin(pings);
+    while (!o.addEcho(sim.ping(now, dither ? randomTriggerDelayUs(sim.random()) : 0))) now += PING_SPACING_US;
+    OversampleEstimate e = o.estimate();
+    float error = e.meanEchoQ8 / 256.0f - sim.trueEchoUs();
+    sumSq += error * error;
+    if (fabsf(error) <= e.ci95EchoQ8 / 256.0f + 0.5f) covered++;   // + integer µs capture rounding
+  }
+  if (coverage) *coverage = (float)covered / trials;
+  return sqrtf(sumSq / trials);
+}
+
+void test_resolution_improves_with_sqrt_n(void) {
+  float e4 = rmsError(4, true, nullptr);
+  float e16 = rmsError(16, true, nullptr);
+  float e64 = rmsError(64, true, nullptr);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 2.0f, e4 / e16);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 2.0f, e16 / e64);
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, e64);                      // ~0.12mm against a ~3mm step
+}
+
+void test_without_dither_the_step_remains(void) {
+  float e4 = rmsError(4, false, nullptr);
+  float e64 = rmsError(64, false, nullptr);
+  TEST_ASSERT_GREATER_THAN_FLOAT(4.0f, e64);                   // ~17.5 / sqrt(12)
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, e4, e64);
+  TEST_ASSERT_GREATER_THAN_FLOAT(4 * rmsError(64, true, nullptr), e64);
+}
+
+void test_interval_covers_true_echo(void) {
+  float coverage;
+  rmsError(16, true, &coverage);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.9f, coverage);
+  rmsError(64, true, &coverage);
+  TEST_ASSERT_GREATER_THAN_FLOAT(0.9f, coverage);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_isqrt64);
+  RUN_TEST(test_begin_clamps_ping_count);
+  RUN_TEST(test_constant_echo_has_zero_interval);
+  RUN_TEST(test_known_set);
+  RUN_TEST(test_large_echoes_do_not_overflow);
+  RUN_TEST(test_dither_spread_is_whole_steps);
+  RUN_TEST(test_resolution_improves_with_sqrt_n);
+  RUN_TEST(test_without_dither_the_step_remains);
+  RUN_TEST(test_interval_covers_true_echo);
+  return UNITY_END();
+}
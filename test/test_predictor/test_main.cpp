@@ -0,0 +1,111 @@
+/*********************************************************************************************************
+ * Predictor Tests
+ *
+ * The fallbacks (rejected flags, low confidence, no velocity), the horizon, step and range limits, and
+ * a simulated moving load: the extrapolated readout must track the true position better than the raw
+ * reading it started from.
+ *
+ **********************************************************************************************************/
+
+#include <math.h>
+#include <unity.h>
+#include "calibration.h"
+#include "predictor.h"
+#include "../../tools/bench/ultrasonic_sim.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const MotionState approaching = { -400, 0, 2500, true };
+
+void test_extrapolates_along_velocity(void) {
+  Sample s = { 1000, 1000, 5831, SAMPLE_OK, 255 };
+  bool predicted = false;
+  TEST_ASSERT_EQUAL_INT32(1000 - 100, predictDistance(s, approaching, 1250, predicted));
+  TEST_ASSERT_TRUE(predicted);
+  MotionState receding = { 250, 0, MOTION_NO_CONTACT, true };
+  TEST_ASSERT_EQUAL_INT32(1000 + 50, predictDistance(s, receding, 1200, predicted));
+}
+
+void test_falls_back_to_the_reading(void) {
+  bool predicted = true;
+  Sample outlier = { 1000, 1000, 5831, SAMPLE_OUTLIER, 255 };
+  TEST_ASSERT_EQUAL_INT32(1000, predictDistance(outlier, approaching, 1250, predicted));
+  TEST_ASSERT_FALSE(predicted);
+
+  Sample timeout = { 1000, SAMPLE_MAX_MM, 0, SAMPLE_TIMEOUT, 0 };
+  TEST_ASSERT_EQUAL_INT32(SAMPLE_MAX_MM, predictDistance(timeout, approaching, 1250, predicted));
+  TEST_ASSERT_FALSE(predicted);
+
+  Sample unsure = { 1000, 1000, 5831, SAMPLE_OK, PREDICT_MIN_CONFIDENCE - 1 };
+  TEST_ASSERT_EQUAL_INT32(1000, predictDistance(unsure, approaching, 1250, predicted));
+  TEST_ASSERT_FALSE(predicted);
+
+  Sample good = { 1000, 1000, 5831, SAMPLE_OK, 255 };
+  MotionState none = { -400, 0, 2500, false };
+  TEST_ASSERT_EQUAL_INT32(1000, predictDistance(good, none, 1250, predicted));
+  TEST_ASSERT_FALSE(predicted);
+}
+
+void test_stale_sample_is_still_predicted(void) {
+  // Staleness is a display state; the horizon cap already bounds old readings
+  Sample stale = { 1000, 1000, 5831, SAMPLE_STALE, 255 };
+  bool predicted = false;
+  TEST_ASSERT_EQUAL_INT32(1000 - 400 * PREDICT_MAX_HORIZON_MS / 1000, predictDistance(stale, approaching, 9000, predicted));
+  TEST_ASSERT_TRUE(predicted);
+}
+
+void test_step_and_range_limits(void) {
+  bool predicted;
+  Sample s = { 0, 1000, 5831, SAMPLE_OK, 255 };
+  MotionState fast = { -3000, 0, 333, true };
+  TEST_ASSERT_EQUAL_INT32(1000 - PREDICT_MAX_STEP_MM, predictDistance(s, fast, 400, predicted));
+  MotionState fastAway = { 3000, 0, MOTION_NO_CONTACT, true };
+  TEST_ASSERT_EQUAL_INT32(1000 + PREDICT_MAX_STEP_MM, predictDistance(s, fastAway, 400, predicted));
+
+  Sample near = { 0, 100, 583, SAMPLE_OK, 255 };
+  TEST_ASSERT_EQUAL_INT32(SAMPLE_MIN_MM, predictDistance(near, fast, 400, predicted));
+  Sample far = { 0, 3950, 23032, SAMPLE_OK, 255 };
+  TEST_ASSERT_EQUAL_INT32(SAMPLE_MAX_MM, predictDistance(far, fastAway, 400, predicted));
+}
+
+void test_moving_load_error_is_reduced(void) {
+  // A load swinging 1.0-2.0m with a 6s period, pinged every 40ms, shown every 250ms half an interval
+  // after the newest reading (as the readout does)
+  UltrasonicSim sim(SIM_HC_SR04);
+  SampleClassifier classifier;
+  MotionEstimator motion;
+  double rawError = 0, predictedError = 0;
+  int shown = 0;
+  uint32_t lastMotionMs = 0;
+  for (uint32_t t = 0; t < 60000; t += 40) {
+    sim.setDistance(1500 - 500 * cosf(6.2831853f * t / 6000));
+    uint32_t echo = sim.ping((uint64_t)t * 1000);
+    Sample s = classifier.classify(t, echo, echoToRawMm(echo));
+    if (s.accepts(SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER) && t - lastMotionMs >= 50) {
+      motion.update(t, s.distanceMm);
+      lastMotionMs = t;
+    }
+    if (t % 250 >= 40 || t < 2000) continue;
+
+    uint32_t renderMs = t + 125;
+    double truth = 1500 - 500 * cos(6.2831853 * renderMs / 6000);
+    bool predicted;
+    int32_t mm = predictDistance(s, motion.current(), renderMs, predicted);
+    rawError += fabs(s.distanceMm - truth);
+    predictedError += fabs(mm - truth);
+    shown++;
+  }
+  TEST_ASSERT_GREATER_THAN(200, shown);
+  TEST_ASSERT_LESS_THAN_FLOAT(0.5f * (float)rawError, (float)predictedError);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_extrapolates_along_velocity);
+  RUN_TEST(test_falls_back_to_the_reading);
+  RUN_TEST(test_stale_sample_is_still_predicted);
+  RUN_TEST(test_step_and_range_limits);
+  RUN_TEST(test_moving_load_error_is_reduced);
+  return UNITY_END();
+}
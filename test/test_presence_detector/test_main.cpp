@@ -0,0 +1,173 @@
+/*********************************************************************************************************
+ * Presence Detector Tests
+ *
+ * Replays scripted distance traces through PresenceDetector with the device configuration (enter at 4
+ * sigma + 50mm for 3 readings, leave below 2 sigma for 1s, absorb after 5min) to check the hysteresis,
+ * then runs simulated pings through the classifier and the device's reject mask: dropouts, clamps and
+ * stray echoes neither raise false events nor drag the background.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "calibration.h"
+#include "presence_detector.h"
+#include "sample.h"
+#include "../../tools/bench/ultrasonic_sim.h"
+
+// As in src/main.cpp
+static const PresenceConfig config = { 10, 4, 2, 50, 3, 1000, 300000 };
+#define PRESENCE_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED)
+
+#define STEP_MS 20                  // 50Hz pings
+
+void setUp(void) {}
+void tearDown(void) {}
+
+struct EventCount {
+  int enters;
+  int leaves;
+};
+
+// Feed a constant reading every STEP_MS from fromMs to toMs (exclusive), counting events
+static EventCount replay(PresenceDetector& presence, uint32_t fromMs, uint32_t toMs, int32_t mm) {
+  EventCount count = { 0, 0 };
+  for (uint32_t t = fromMs; t < toMs; t += STEP_MS) {
+    PresenceEvent event = presence.update(t, mm + (int32_t)(t / STEP_MS % 3) * 4 - 4);  // ±4mm jitter
+    if (event == PresenceEvent::ENTER) count.enters++;
+    if (event == PresenceEvent::LEAVE) count.leaves++;
+  }
+  return count;
+}
+
+void test_seeds_background_without_events(void) {
+  PresenceDetector presence(config);
+  for (int i = 0; i < PRESENCE_SEED_READINGS - 1; i++) presence.update(i * STEP_MS, 1500);
+  TEST_ASSERT_FALSE(presence.ready());
+  EventCount count = replay(presence, 1000, 60000, 1500);
+  TEST_ASSERT_TRUE(presence.ready());
+  TEST_ASSERT_EQUAL_INT(0, count.enters);
+  TEST_ASSERT_INT32_WITHIN(3, 1500, presence.backgroundMm());
+}
+
+void test_enter_needs_consecutive_readings(void) {
+  PresenceDetector presence(config);
+  replay(presence, 0, 10000, 1500);
+  TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(10000, 900));
+  TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(10020, 900));
+  TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(10040, 1500));   // interrupted: starts over
+  TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(10060, 900));
+  TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(10080, 900));
+  TEST_ASSERT_EQUAL(PresenceEvent::ENTER, presence.update(10100, 900));
+  TEST_ASSERT_TRUE(presence.isPresent());
+}
+
+void test_leave_hysteresis(void) {
+  PresenceDetector presence(config), empty(config);
+  replay(presence, 0, 10000, 1500);
+  replay(empty, 0, 10000, 1500);
+
+  // Between the leave (2 sigma) and enter (4 sigma) thresholds: not enough to enter...
+  int32_t hover = presence.backgroundMm() - config.minDeltaMm - (int32_t)(3 * presence.sigmaMm() + 0.5f);
+  for (uint32_t t = 10000; t < 15000; t += STEP_MS) TEST_ASSERT_EQUAL(PresenceEvent::NONE, empty.update(t, hover));
+
+  // ...but enough to hold presence
+  EventCount count = replay(presence, 10000, 15000, 900);
+  TEST_ASSERT_EQUAL_INT(1, count.enters);
+  for (uint32_t t = 15000; t < 30000; t += STEP_MS) TEST_ASSERT_EQUAL(PresenceEvent::NONE, presence.update(t, hover));
+  TEST_ASSERT_TRUE(presence.isPresent());
+
+  // Back at the background: leave only after leaveMs, and a stray echo does not restart the timer
+  count = replay(presence, 30000, 30500, 1500);
+  presence.update(30500, 900);
+  count.leaves += replay(presence, 30520, 31000, 1500).leaves;
+  TEST_ASSERT_EQUAL_INT(0, count.leaves);
+  TEST_ASSERT_EQUAL(PresenceEvent::LEAVE, presence.update(31000, 1500));
+  TEST_ASSERT_FALSE(presence.isPresent());
+
+  // Leaving does not chatter back in
+  count = replay(presence, 31020, 60000, 1500);
+  TEST_ASSERT_EQUAL_INT(0, count.enters);
+}
+
+void test_long_presence_is_absorbed(void) {
+  PresenceDetector presence(config);
+  replay(presence, 0, 10000, 1500);
+  EventCount count = replay(presence, 10000, 10000 + config.absorbMs + 1000, 600);  // a parked trolley
+  TEST_ASSERT_EQUAL_INT(1, count.enters);
+  TEST_ASSERT_EQUAL_INT(1, count.leaves);
+  TEST_ASSERT_FALSE(presence.isPresent());
+  TEST_ASSERT_INT32_WITHIN(10, 600, presence.backgroundMm());
+  TEST_ASSERT_EQUAL_INT(0, replay(presence, 320000, 340000, 600).enters);
+}
+
+// Ping the simulated scene and feed the detector the way updatePresence() does
+struct Pipeline {
+  UltrasonicSim sim;
+  SampleClassifier classifier;
+  PresenceDetector presence;
+  EventCount count;
+  int skipped;
+
+  explicit Pipeline(const UltrasonicSimConfig& simConfig) : sim(simConfig), presence(config), count{ 0, 0 }, skipped(0) {}
+
+  void step(uint32_t timeMs, float targetMm, bool dropout, bool mask) {
+    sim.setDistance(targetMm);
+    uint32_t echoUs = dropout ? 0 : sim.ping((uint64_t)timeMs * 1000);
+    Sample sample = classifier.classify(timeMs, echoUs, echoToRawMm(echoUs));
+    if (mask && !sample.accepts(PRESENCE_REJECT_FLAGS)) {
+      skipped++;
+      return;
+    }
+    PresenceEvent event = presence.update(timeMs, sample.distanceMm);
+    if (event == PresenceEvent::ENTER) count.enters++;
+    if (event == PresenceEvent::LEAVE) count.leaves++;
+  }
+};
+
+// Wall at 2.5m; a curtain sways through the beam every 5s and swallows four echoes in a row
+static bool curtainDropout(uint32_t timeMs) { return timeMs % 5000 < 4 * STEP_MS; }
+
+void test_dropouts_are_not_presence(void) {
+  Pipeline masked(SIM_HC_SR04), unmasked(SIM_HC_SR04);
+  for (uint32_t t = 0; t < 120000; t += STEP_MS) {
+    masked.step(t, 2500, curtainDropout(t), true);
+    unmasked.step(t, 2500, curtainDropout(t), false);
+  }
+  TEST_ASSERT_EQUAL_INT(0, masked.count.enters);
+  TEST_ASSERT_GREATER_THAN(0, masked.skipped);
+  TEST_ASSERT_INT32_WITHIN(5, 2500, masked.presence.backgroundMm());
+
+  // Fed as the 4m clamp, every burst of timeouts would read as someone in the beam
+  TEST_ASSERT_GREATER_THAN(10, unmasked.count.enters);
+}
+
+void test_simulated_visits_with_dropouts_and_strays(void) {
+  UltrasonicSimConfig noisy = SIM_HC_SR04;
+  noisy.timeoutPercent = 3;                                    // clothing absorbs the odd ping
+  noisy.seed = 11;
+  Pipeline pipeline(noisy);
+  uint32_t strays = 7;
+  for (uint32_t t = 0; t < 300000; t += STEP_MS) {
+    bool visiting = t % 60000 >= 30000 && t % 60000 < 40000;  // 10s every minute, 5 visits
+    float mm = visiting ? 1100 : 2500;
+    strays = strays * 1664525u + 1013904223u;
+    if (strays >> 24 < 3) mm = 300;                            // isolated stray echoes, ~1%
+    pipeline.step(t, mm, curtainDropout(t), true);
+    if (t % 60000 == 35000) TEST_ASSERT_TRUE(pipeline.presence.isPresent());
+    if (t % 60000 == 50000) TEST_ASSERT_FALSE(pipeline.presence.isPresent());
+  }
+  TEST_ASSERT_EQUAL_INT(5, pipeline.count.enters);
+  TEST_ASSERT_EQUAL_INT(5, pipeline.count.leaves);
+  TEST_ASSERT_INT32_WITHIN(5, 2500, pipeline.presence.backgroundMm());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_seeds_background_without_events);
+  RUN_TEST(test_enter_needs_consecutive_readings);
+  RUN_TEST(test_leave_hysteresis);
+  RUN_TEST(test_long_presence_is_absorbed);
+  RUN_TEST(test_dropouts_are_not_presence);
+  RUN_TEST(test_simulated_visits_with_dropouts_and_strays);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/*********************************************************************************************************
+ * Range Sensor Driver Tests
+ *
+ * Runs the drivers against the Arduino stand-in (test/arduino_fake): trigger pulses are checked on the
+ * fake pins, echo edges fire the driver's interrupt at scripted times, and the US-100 reply arrives as
+ * a scripted byte stream.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "range_driver.h"
+
+#define TRIG_PIN 5
+#define ECHO_PIN 6
+
+void setUp(void) { fake::reset(); }
+void tearDown(void) {}
+
+// Echo pulse of widthUs rising riseUs after the end of the trigger pulse
+static void echoPulse(uint32_t riseUs, uint32_t widthUs) {
+  fake::nowUs = fake::lastPulseEndUs[TRIG_PIN] + riseUs;
+  fake::setPin(ECHO_PIN, HIGH);
+  fake::advance(widthUs);
+  fake::setPin(ECHO_PIN, LOW);
+}
+
+// Poll until the driver finishes (10µs steps), returns false if it did not within limitUs
+template <class Driver>
+static bool pollUntilDone(Driver& driver, uint32_t limitUs) {
+  for (uint32_t waited = 0; waited <= limitUs; waited += 10) {
+    if (driver.poll(micros())) return true;
+    fake::advance(10);
+  }
+  return false;
+}
+
+void test_hc_sr04_trigger_and_echo(void) {
+  HcSr04Driver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  TEST_ASSERT_EQUAL_UINT8(OUTPUT, fake::mode[TRIG_PIN]);
+  TEST_ASSERT_EQUAL_UINT8(INPUT, fake::mode[ECHO_PIN]);
+  TEST_ASSERT_EQUAL_INT32(20, (int32_t)driver.MIN_RANGE_MM);
+
+  TEST_ASSERT_TRUE(driver.startMeasurement(0));
+  TEST_ASSERT_EQUAL_UINT32(1, fake::pulses[TRIG_PIN]);
+  TEST_ASSERT_EQUAL_UINT32(10, fake::lastPulseUs[TRIG_PIN]);
+  TEST_ASSERT_FALSE(driver.poll(micros()));
+
+  echoPulse(450, 5831);
+  TEST_ASSERT_FALSE(driver.poll(micros()));                    // a dropout could still follow
+  TEST_ASSERT_TRUE(pollUntilDone(driver, 100));
+  TEST_ASSERT_EQUAL_UINT32(5831, driver.reading().echoUs);
+  TEST_ASSERT_EQUAL_INT32(1000, driver.reading().rawMm);
+  TEST_ASSERT_EQUAL_UINT32(0, driver.glitches());
+}
+
+void test_trigger_phase_delay(void) {
+  HcSr04Driver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  uint64_t before = fake::nowUs;
+  driver.startMeasurement(17);
+  TEST_ASSERT_TRUE(fake::pulseStartUs[TRIG_PIN] - before == 2 + 17);
+}
+
+void test_no_echo_times_out(void) {
+  HcSr04Driver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  driver.startMeasurement(0);
+  fake::advance(ECHO_TIMEOUT_US - 10);
+  TEST_ASSERT_FALSE(driver.poll(micros()));
+  fake::advance(20);
+  TEST_ASSERT_TRUE(driver.poll(micros()));
+  TEST_ASSERT_EQUAL_UINT32(0, driver.reading().echoUs);
+  TEST_ASSERT_EQUAL_INT32(0, driver.reading().rawMm);
+}
+
+void test_noise_pulse_is_rejected(void) {
+  HcSr04Driver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  driver.startMeasurement(0);
+  echoPulse(300, 30);                                          // too short for an echo
+  fake::advance(200);
+  fake::setPin(ECHO_PIN, HIGH);
+  fake::advance(2915);
+  fake::setPin(ECHO_PIN, LOW);
+  TEST_ASSERT_TRUE(pollUntilDone(driver, 100));
+  TEST_ASSERT_EQUAL_UINT32(2915, driver.reading().echoUs);
+  TEST_ASSERT_EQUAL_UINT32(1, driver.glitches());
+}
+
+void test_late_edges_do_not_leak_into_the_next_measurement(void) {
+  HcSr04Driver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  driver.startMeasurement(0);
+  fake::advance(ECHO_TIMEOUT_US + 10);
+  TEST_ASSERT_TRUE(driver.poll(micros()));
+
+  // A far echo of the timed-out ping arrives before the next trigger
+  fake::setPin(ECHO_PIN, HIGH);
+  fake::advance(1000);
+  fake::setPin(ECHO_PIN, LOW);
+
+  driver.startMeasurement(0);
+  echoPulse(450, 1166);
+  TEST_ASSERT_TRUE(pollUntilDone(driver, 100));
+  TEST_ASSERT_EQUAL_UINT32(1166, driver.reading().echoUs);
+}
+
+void test_jsn_sr04t_quirks(void) {
+  JsnSr04tDriver<TRIG_PIN, ECHO_PIN> driver;
+  driver.begin();
+  TEST_ASSERT_EQUAL_INT32(250, (int32_t)driver.MIN_RANGE_MM);
+
+  TEST_ASSERT_TRUE(driver.startMeasurement(0));
+  TEST_ASSERT_EQUAL_UINT32(20, fake::lastPulseUs[TRIG_PIN]);  // longer trigger pulse
+  echoPulse(600, 11662);
+  TEST_ASSERT_TRUE(pollUntilDone(driver, 100));
+  TEST_ASSERT_EQUAL_INT32(2000, driver.reading().rawMm);
+
+  // The 60ms measurement cycle is enforced
+  TEST_ASSERT_FALSE(driver.startMeasurement(0));
+  TEST_ASSERT_EQUAL_UINT32(1, fake::pulses[TRIG_PIN]);
+  fake::advance(60000);
+  TEST_ASSERT_TRUE(driver.startMeasurement(0));
+  TEST_ASSERT_EQUAL_UINT32(2, fake::pulses[TRIG_PIN]);
+}
+
+void test_us100_reply_across_polls(void) {
+  Us100SerialDriver<17, 18> driver(fake::uart);
+  driver.begin();
+  TEST_ASSERT_EQUAL_UINT32(US100_BAUD, fake::uart.baudRate);
+
+  const uint8_t late[] = { 0x07 };                             // left over from a lost reply
+  fake::uart.receive(late, 1);
+  TEST_ASSERT_TRUE(driver.startMeasurement(0));
+  TEST_ASSERT_EQUAL_INT(1, fake::uart.txCount);
+  TEST_ASSERT_EQUAL_HEX8(US100_REQUEST_DISTANCE, fake::uart.tx[0]);
+  TEST_ASSERT_FALSE(driver.poll(micros()));
+
+  const uint8_t high[] = { 0x03 }, low[] = { 0xE8 };
+  fake::advance(1000);
+  fake::uart.receive(high, 1);
+  TEST_ASSERT_FALSE(driver.poll(micros()));
+  fake::advance(1000);
+  fake::uart.receive(low, 1);
+  TEST_ASSERT_TRUE(driver.poll(micros()));
+  TEST_ASSERT_EQUAL_INT32(1000, driver.reading().rawMm);
+  TEST_ASSERT_EQUAL_UINT32(mmToEchoUs(1000), driver.reading().echoUs);
+  TEST_ASSERT_EQUAL_UINT32(0, driver.glitches());
+}
+
+void test_us100_without_reply_times_out(void) {
+  Us100SerialDriver<17, 18> driver(fake::uart);
+  driver.begin();
+  driver.startMeasurement(0);
+  const uint8_t half[] = { 0x03 };
+  fake::uart.receive(half, 1);
+  fake::advance(US100_TIMEOUT_US);
+  TEST_ASSERT_FALSE(driver.poll(micros()));
+  fake::advance(1);
+  TEST_ASSERT_TRUE(driver.poll(micros()));
+  TEST_ASSERT_EQUAL_UINT32(0, driver.reading().echoUs);
+  TEST_ASSERT_EQUAL_INT32(0, driver.reading().rawMm);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hc_sr04_trigger_and_echo);
+  RUN_TEST(test_trigger_phase_delay);
+  RUN_TEST(test_no_echo_times_out);
+  RUN_TEST(test_noise_pulse_is_rejected);
+  RUN_TEST(test_late_edges_do_not_leak_into_the_next_measurement);
+  RUN_TEST(test_jsn_sr04t_quirks);
+  RUN_TEST(test_us100_reply_across_polls);
+  RUN_TEST(test_us100_without_reply_times_out);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+/*********************************************************************************************************
+ * Range Gate Tests
+ *
+ * The window table (merging, limits, inclusive bounds, lookups against a linear scan) and learn mode on
+ * the ultrasonic simulator: static clutter is learned and blanked in the capture path, while a moving
+ * target is neither learned nor blanked outside the clutter windows.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "calibration.h"
+#include "range_gate.h"
+#include "sample.h"
+#include "../../tools/bench/ultrasonic_sim.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_windows_merge_and_stay_sorted(void) {
+  RangeGate gate;
+  TEST_ASSERT_TRUE(gate.add(1000, 1100));
+  TEST_ASSERT_TRUE(gate.add(300, 400));
+  TEST_ASSERT_TRUE(gate.add(2000, 2100));
+  TEST_ASSERT_EQUAL_UINT8(3, gate.size());
+  TEST_ASSERT_EQUAL_INT32(300, gate.window(0).fromMm);
+  TEST_ASSERT_EQUAL_INT32(2000, gate.window(2).fromMm);
+
+  TEST_ASSERT_TRUE(gate.add(401, 450));                        // touches: merged
+  TEST_ASSERT_EQUAL_UINT8(3, gate.size());
+  TEST_ASSERT_EQUAL_INT32(450, gate.window(0).toMm);
+  TEST_ASSERT_TRUE(gate.add(1050, 2050));                      // spans two: all three become one
+  TEST_ASSERT_EQUAL_UINT8(2, gate.size());
+  TEST_ASSERT_EQUAL_INT32(1000, gate.window(1).fromMm);
+  TEST_ASSERT_EQUAL_INT32(2100, gate.window(1).toMm);
+  TEST_ASSERT_FALSE(gate.add(500, 499));
+
+  TEST_ASSERT_TRUE(gate.remove(0));
+  TEST_ASSERT_FALSE(gate.remove(1));
+  TEST_ASSERT_EQUAL_INT32(1000, gate.window(0).fromMm);
+}
+
+void test_full_table(void) {
+  RangeGate gate;
+  for (int i = 0; i < GATE_MAX_WINDOWS; i++) TEST_ASSERT_TRUE(gate.add(i * 100, i * 100 + 10));
+  TEST_ASSERT_FALSE(gate.add(2000, 2010));                     // no room for a new window
+  TEST_ASSERT_TRUE(gate.add(5, 50));                           // merging needs none
+  TEST_ASSERT_EQUAL_UINT8(GATE_MAX_WINDOWS, gate.size());
+
+  RangeGate copy;
+  copy.load(gate.table(), gate.size());
+  TEST_ASSERT_EQUAL_UINT8(gate.size(), copy.size());
+  TEST_ASSERT_EQUAL_INT32(50, copy.window(0).toMm);
+}
+
+void test_lookup_matches_linear_scan(void) {
+  uint32_t seed = 9;
+  for (int round = 0; round < 200; round++) {
+    RangeGate gate;
+    for (int i = 0; i < 12; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      int32_t from = (int32_t)((seed >> 8) % 4000);
+      gate.add(from, from + (int32_t)((seed >> 4) % 120));
+    }
+    for (uint8_t i = 1; i < gate.size(); i++) TEST_ASSERT_TRUE(gate.window(i - 1).toMm + 1 < gate.window(i).fromMm);
+    for (int32_t mm = -10; mm <= 4200; mm++) {
+      bool inside = false;
+      for (uint8_t i = 0; i < gate.size(); i++) inside |= gate.window(i).fromMm <= mm && mm <= gate.window(i).toMm;
+      TEST_ASSERT_TRUE(inside == gate.blanked(mm));
+    }
+  }
+}
+
+void test_learner_needs_enough_readings(void) {
+  GateLearner learner;
+  RangeGate gate;
+  for (int i = 0; i < GATE_LEARN_MIN_READINGS - 1; i++) learner.addReading(370);
+  TEST_ASSERT_EQUAL_UINT8(0, learner.apply(gate));
+  learner.addReading(-5);                                      // ignored
+  learner.addReading(4500);
+  TEST_ASSERT_EQUAL_UINT32(GATE_LEARN_MIN_READINGS - 1, learner.readings());
+  learner.addReading(370);
+  TEST_ASSERT_EQUAL_UINT8(1, learner.apply(gate));
+  TEST_ASSERT_EQUAL_INT32(370 - GATE_LEARN_MARGIN_MM, gate.window(0).fromMm);
+  TEST_ASSERT_EQUAL_INT32(379 + GATE_LEARN_MARGIN_MM, gate.window(0).toMm);
+
+  learner.begin();
+  for (int i = 0; i < 50; i++) learner.addReading(5);
+  RangeGate nearGate;
+  learner.apply(nearGate);
+  TEST_ASSERT_EQUAL_INT32(0, nearGate.window(0).fromMm);        // margin clipped at zero
+}
+
+// Simulated scene: a bracket at 370mm catches the beam on 60% of pings, the wall at 2.5m answers otherwise
+static int32_t sceneReading(UltrasonicSim& sim, uint64_t nowUs, float targetMm) {
+  float mm = targetMm;
+  if (targetMm > 370 && sim.uniform() < 0.6f) mm = 370;
+  sim.setDistance(mm);
+  return echoToRawMm(sim.ping(nowUs));
+}
+
+void test_learned_clutter_is_blanked_but_targets_are_not(void) {
+  UltrasonicSim sim(SIM_HC_SR04);
+  GateLearner learner;
+  uint64_t now = 0;
+  for (int i = 0; i < 400; i++) learner.addReading(sceneReading(sim, now += 60000, 2500));
+  RangeGate gate;
+  TEST_ASSERT_EQUAL_UINT8(2, learner.apply(gate));             // the bracket and the wall
+  TEST_ASSERT_TRUE(gate.blanked(370));
+  TEST_ASSERT_TRUE(gate.blanked(2500));
+
+  // Blank only the bracket (the wall is the background a presence detector needs)
+  TEST_ASSERT_TRUE(gate.remove(1));
+
+  // A person walks from 2.4m to 0.5m and back through the cluttered beam
+  SampleClassifier classifier;
+  classifier.setGate(&gate);
+  int clutter = 0, clutterBlanked = 0, target = 0, targetBlanked = 0;
+  for (int i = 0; i < 4000; i++) {
+    float person = 1450 + 950 * cosf(6.2831853f * i / 400);
+    int32_t mm = sceneReading(sim, now += 20000, person);
+    Sample s = classifier.classify((uint32_t)(now / 1000), mm > 0 ? (uint32_t)(mm / SIM_MM_PER_US) : 0, mm);
+    bool fromBracket = mm < 420;
+    if (fromBracket) {
+      clutter++;
+      if (s.flags & SAMPLE_BLANKED) clutterBlanked++;
+    }
+    else {
+      target++;
+      if (s.flags & SAMPLE_BLANKED) targetBlanked++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(1000, clutter);
+  TEST_ASSERT_EQUAL_INT(clutter, clutterBlanked);
+  TEST_ASSERT_GREATER_THAN(1000, target);
+  TEST_ASSERT_EQUAL_INT(0, targetBlanked);
+}
+
+void test_moving_target_is_not_learned(void) {
+  UltrasonicSim sim(SIM_HC_SR04);
+  GateLearner learner;
+  uint64_t now = 0;
+  for (int i = 0; i < 1000; i++) {
+    sim.setDistance(600 + 1400 * (0.5f - 0.5f * cosf(6.2831853f * i / 250)));
+    learner.addReading(echoToRawMm(sim.ping(now += 20000)));
+  }
+  RangeGate gate;
+  TEST_ASSERT_EQUAL_UINT8(0, learner.apply(gate));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_windows_merge_and_stay_sorted);
+  RUN_TEST(test_full_table);
+  RUN_TEST(test_lookup_matches_linear_scan);
+  RUN_TEST(test_learner_needs_enough_readings);
+  RUN_TEST(test_learned_clutter_is_blanked_but_targets_are_not);
+  RUN_TEST(test_moving_target_is_not_learned);
+  return UNITY_END();
+}
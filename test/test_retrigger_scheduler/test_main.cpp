@@ -0,0 +1,115 @@
+/*********************************************************************************************************
+ * Re-Trigger Scheduler Tests
+ *
+ * Interval arithmetic, clamps, timeouts and micros() wrap, then the device settings on the ultrasonic
+ * simulator with multipath and a reverberant tail: short-range targets are pinged several times faster
+ * than the fixed cycle without ghost echoes, and pinging faster does produce them.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "retrigger_scheduler.h"
+#include "../../tools/bench/ultrasonic_sim.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const RetriggerConfig deviceConfig = { 5000, 60000, 8000, 100 };   // as in src/main.cpp
+static const UltrasonicSimConfig roomConfig = { 2.0f, 17.5f, 0.0f, 1500.0f, 30.0f, 5 };
+
+void test_interval_from_echo(void) {
+  RetriggerScheduler retrigger(deviceConfig);
+  retrigger.onMeasurement(0, 5831);                            // 1m
+  TEST_ASSERT_EQUAL_UINT32(5831 * 2 + 8000, retrigger.intervalUs());
+  retrigger.onMeasurement(0, 23324);                           // 4m
+  TEST_ASSERT_EQUAL_UINT32(23324 * 2 + 8000, retrigger.intervalUs());
+}
+
+void test_clamps_and_timeout(void) {
+  RetriggerConfig config = { 10000, 40000, 1000, 100 };
+  RetriggerScheduler retrigger(config);
+  TEST_ASSERT_EQUAL_UINT32(40000, retrigger.intervalUs());     // before any measurement
+  retrigger.onMeasurement(0, 1000);
+  TEST_ASSERT_EQUAL_UINT32(10000, retrigger.intervalUs());
+  retrigger.onMeasurement(0, 30000);
+  TEST_ASSERT_EQUAL_UINT32(40000, retrigger.intervalUs());
+  retrigger.onMeasurement(0, 5000);
+  retrigger.onMeasurement(0, 0);                               // timeout: a far reflector may still answer
+  TEST_ASSERT_EQUAL_UINT32(40000, retrigger.intervalUs());
+}
+
+void test_ready_is_wrap_safe(void) {
+  RetriggerScheduler retrigger(deviceConfig);
+  TEST_ASSERT_TRUE(retrigger.ready(12345));                    // first ping is never held back
+  uint32_t trigger = 0xFFFFF000u;
+  retrigger.onMeasurement(trigger, 1000);                      // interval 10000
+  TEST_ASSERT_FALSE(retrigger.ready(trigger + 9999));
+  TEST_ASSERT_TRUE(retrigger.ready(trigger + 10000));
+}
+
+void test_fixed_rate_configuration(void) {
+  RetriggerConfig fixed = { 250000, 250000, 0, 0 };
+  RetriggerScheduler retrigger(fixed);
+  retrigger.onMeasurement(0, 600);
+  TEST_ASSERT_EQUAL_UINT32(250000, retrigger.intervalUs());
+  retrigger.onMeasurement(0, 0);
+  TEST_ASSERT_EQUAL_UINT32(250000, retrigger.intervalUs());
+}
+
+// Ping a static target for 20s, returning pings per second and ghosts per thousand
+static void simulate(const RetriggerConfig& config, float distanceMm, uint32_t& rate, uint32_t& ghostsPerMille) {
+  UltrasonicSim sim(roomConfig);
+  RetriggerScheduler retrigger(config);
+  sim.setDistance(distanceMm);
+  uint32_t pings = 0, ghosts = 0;
+  for (uint64_t now = 0; now < 20000000; now += 50) {
+    if (!retrigger.ready((uint32_t)now)) continue;
+    retrigger.onMeasurement((uint32_t)now, sim.ping(now));
+    pings++;
+    if (sim.lastWasGhost()) ghosts++;
+  }
+  rate = pings / 20;
+  ghostsPerMille = ghosts * 1000 / pings;
+}
+
+void test_no_ghosts_across_the_range(void) {
+  const float distances[] = { 200, 500, 1000, 2000, 3000, 3800 };
+  for (float mm : distances) {
+    uint32_t rate, ghosts;
+    simulate(deviceConfig, mm, rate, ghosts);
+    TEST_ASSERT_LESS_OR_EQUAL(5, ghosts);                      // only the rare diffuse tail
+    TEST_ASSERT_GREATER_OR_EQUAL(17, rate);                    // never slower than the fixed 60ms cycle
+  }
+}
+
+void test_near_targets_ping_faster(void) {
+  uint32_t nearRate, farRate, ghosts;
+  simulate(deviceConfig, 300, nearRate, ghosts);
+  simulate(deviceConfig, 3000, farRate, ghosts);
+  TEST_ASSERT_GREATER_THAN(5 * 17, nearRate);
+  TEST_ASSERT_GREATER_THAN(farRate * 3, nearRate);
+}
+
+void test_pinging_too_fast_hears_ghosts(void) {
+  uint32_t rate, ghosts;
+  RetriggerConfig fixedFast = { 5000, 5000, 0, 0 };
+  simulate(fixedFast, 1000, rate, ghosts);
+  TEST_ASSERT_GREATER_THAN(900, ghosts);
+
+  // Half the proportional allowance lets the second bounce of a far target into the next ping
+  RetriggerConfig halfAllowance = { 5000, 60000, 8000, 50 };
+  simulate(halfAllowance, 3000, rate, ghosts);
+  TEST_ASSERT_GREATER_THAN(200, ghosts);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_interval_from_echo);
+  RUN_TEST(test_clamps_and_timeout);
+  RUN_TEST(test_ready_is_wrap_safe);
+  RUN_TEST(test_fixed_rate_configuration);
+  RUN_TEST(test_no_ghosts_across_the_range);
+  RUN_TEST(test_near_targets_ping_faster);
+  RUN_TEST(test_pinging_too_fast_hears_ghosts);
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+/*********************************************************************************************************
+ * Sample Classifier Tests
+ *
+ * Each classification path (timeout, too close, beyond range, blanked, outlier), the confidence ramp,
+ * steady motion against the trend, staleness and the per-consumer accepts() test.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "sample.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Feed n readings at distanceMm + stepMm * i, 100ms apart
+static Sample feed(SampleClassifier& classifier, int n, int32_t distanceMm, int32_t stepMm = 0) {
+  Sample sample = {};
+  for (int i = 0; i < n; i++) {
+    int32_t mm = distanceMm + stepMm * i;
+    sample = classifier.classify(i * 100, (uint32_t)(mm / 0.1715f), mm);
+  }
+  return sample;
+}
+
+void test_timeout_is_flagged_and_clamped_to_max(void) {
+  SampleClassifier classifier;
+  Sample s = classifier.classify(10, 0, 123);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_TIMEOUT, s.flags);
+  TEST_ASSERT_EQUAL_INT32(SAMPLE_MAX_MM, s.distanceMm);
+  TEST_ASSERT_EQUAL_UINT16(0, s.echoUs);
+  TEST_ASSERT_FALSE(s.inRange());
+  TEST_ASSERT_EQUAL_STRING("timeout", sampleStatusText(s.flags));
+}
+
+void test_range_limits(void) {
+  SampleClassifier classifier;
+  Sample close = classifier.classify(0, 100, 17);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_BELOW_MIN, close.flags);
+  TEST_ASSERT_EQUAL_INT32(0, close.distanceMm);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, classifier.classify(0, 117, SAMPLE_MIN_MM).flags);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_BELOW_MIN, classifier.classify(0, 2000, 300, 400).flags); // driver minimum
+
+  Sample far = classifier.classify(0, 30000, 5100);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_ABOVE_MAX, far.flags);
+  TEST_ASSERT_EQUAL_INT32(SAMPLE_MAX_MM, far.distanceMm);
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, classifier.classify(0, 70000, 5100).echoUs);            // saturates
+}
+
+void test_blanked_readings_stay_out_of_history(void) {
+  RangeGate gate;
+  TEST_ASSERT_TRUE(gate.add(900, 1100));
+  SampleClassifier classifier;
+  classifier.setGate(&gate);
+  feed(classifier, 8, 2000);
+  for (int i = 0; i < 10; i++) {
+    Sample s = classifier.classify(1000 + i, 5831, 1000);
+    TEST_ASSERT_EQUAL_HEX8(SAMPLE_BLANKED, s.flags);
+    TEST_ASSERT_EQUAL_INT32(1000, s.distanceMm);
+  }
+  // The trend is still 2000mm
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, classifier.classify(2000, 11662, 2000).flags);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OUTLIER, classifier.classify(2100, 7000, 1200).flags);
+}
+
+void test_confidence_ramps_while_history_fills(void) {
+  SampleClassifier classifier;
+  uint8_t previous = 0;
+  for (int i = 0; i <= SAMPLE_HISTORY; i++) {
+    Sample s = classifier.classify(i * 100, 5831, 1000);
+    TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+    TEST_ASSERT_TRUE(s.confidence > previous || s.confidence == 255);
+    previous = s.confidence;
+  }
+  TEST_ASSERT_EQUAL_UINT8(255, previous);
+}
+
+void test_jump_is_outlier_then_accepted(void) {
+  SampleClassifier classifier;
+  feed(classifier, 10, 1000);
+  Sample jump = classifier.classify(2000, 11662, 2000);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OUTLIER, jump.flags);
+  TEST_ASSERT_EQUAL_UINT8(0, jump.confidence);
+  TEST_ASSERT_EQUAL_STRING("outlier", sampleStatusText(jump.flags));
+
+  // A real step: once most of the history is at the new distance it is the trend
+  Sample s = jump;
+  for (int i = 0; i < SAMPLE_HISTORY && s.flags != SAMPLE_OK; i++) s = classifier.classify(2100 + i * 100, 11662, 2000);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+}
+
+void test_steady_motion_is_not_penalised(void) {
+  // 80mm per reading is more than half the outlier threshold, but it is the trend
+  SampleClassifier classifier;
+  Sample s = feed(classifier, 20, 400, 80);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+  TEST_ASSERT_EQUAL_UINT8(255, s.confidence);
+}
+
+void test_small_deviation_lowers_confidence(void) {
+  SampleClassifier classifier;
+  feed(classifier, 10, 1000);
+  Sample s = classifier.classify(2000, 6200, 1075);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+  TEST_ASSERT_UINT32_WITHIN(2, 255 - 75 * 255 / SAMPLE_OUTLIER_MM, s.confidence);
+}
+
+void test_reset_forgets_history(void) {
+  SampleClassifier classifier;
+  feed(classifier, 10, 1000);
+  classifier.reset();
+  Sample s = classifier.classify(5000, 17500, 3000);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+  TEST_ASSERT_LESS_THAN(255 / SAMPLE_HISTORY + 1, s.confidence);
+}
+
+void test_stale(void) {
+  Sample s = { 1000, 500, 2915, SAMPLE_OK, 255 };
+  markStale(s, 2000, 1000);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_OK, s.flags);
+  markStale(s, 2001, 1000);
+  TEST_ASSERT_EQUAL_HEX8(SAMPLE_STALE, s.flags);
+  TEST_ASSERT_TRUE(s.inRange());
+  TEST_ASSERT_EQUAL_STRING("stale", sampleStatusText(s.flags));
+  s.flags |= SAMPLE_TIMEOUT;
+  TEST_ASSERT_EQUAL_STRING("timeout", sampleStatusText(s.flags));  // most significant flag wins
+}
+
+void test_each_consumer_picks_its_flags(void) {
+  Sample outlier = { 0, 1500, 8746, SAMPLE_OUTLIER, 0 };
+  Sample timeout = { 0, SAMPLE_MAX_MM, 0, SAMPLE_TIMEOUT, 0 };
+  Sample stale = { 0, 1500, 8746, SAMPLE_STALE, 255 };
+
+  // A line fit rejects jumps, activity tracking counts them
+  TEST_ASSERT_FALSE(outlier.accepts(SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED));
+  TEST_ASSERT_TRUE(outlier.accepts(SAMPLE_NO_DISTANCE | SAMPLE_BLANKED));
+  // A timeout is never a distance, but nothing hides it from a consumer that wants it
+  TEST_ASSERT_FALSE(timeout.accepts(SAMPLE_NO_DISTANCE));
+  TEST_ASSERT_TRUE(timeout.accepts(SAMPLE_BLANKED));
+  TEST_ASSERT_TRUE(timeout.accepts(0));
+  // Staleness only matters to consumers that ask for it
+  TEST_ASSERT_TRUE(stale.accepts(SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER));
+  TEST_ASSERT_FALSE(stale.accepts(SAMPLE_STALE));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_timeout_is_flagged_and_clamped_to_max);
+  RUN_TEST(test_range_limits);
+  RUN_TEST(test_blanked_readings_stay_out_of_history);
+  RUN_TEST(test_confidence_ramps_while_history_fills);
+  RUN_TEST(test_jump_is_outlier_then_accepted);
+  RUN_TEST(test_steady_motion_is_not_penalised);
+  RUN_TEST(test_small_deviation_lowers_confidence);
+  RUN_TEST(test_reset_forgets_history);
+  RUN_TEST(test_stale);
+  RUN_TEST(test_each_consumer_picks_its_flags);
+  return UNITY_END();
+}
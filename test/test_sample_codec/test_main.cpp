@@ -0,0 +1,202 @@
+/*********************************************************************************************************
+ * Sample Codec Tests
+ *
+ * Round trips through SampleEncoder / SampleDecoder, every bucket edge of the timestamp and distance
+ * coders (including the raw escapes and millis() wrap-around), the encoded sizes the bucket tables
+ * promise, rollback of a sample that does not fit, and truncated streams.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "sample_codec.h"
+#include "sample.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Encode records into buffer, returns the stream length (fails the test if any record is refused)
+static size_t encode(const SampleRecord* records, uint32_t count, uint8_t* buffer, size_t capacity) {
+  SampleEncoder encoder(buffer, capacity);
+  for (uint32_t i = 0; i < count; i++) TEST_ASSERT_TRUE(encoder.append(records[i]));
+  return encoder.finish();
+}
+
+// Decode and compare field by field
+static void assertRoundTrip(const SampleRecord* records, uint32_t count) {
+  static uint8_t buffer[16384];
+  size_t length = encode(records, count, buffer, sizeof(buffer));
+  SampleDecoder decoder(buffer, length, count);
+  SampleRecord out;
+  for (uint32_t i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(decoder.next(out));
+    TEST_ASSERT_EQUAL_UINT32(records[i].timestampMs, out.timestampMs);
+    TEST_ASSERT_EQUAL_UINT16(records[i].distanceMm, out.distanceMm);
+    TEST_ASSERT_EQUAL_UINT8(records[i].flags, out.flags);
+    TEST_ASSERT_EQUAL_UINT8(records[i].confidence, out.confidence);
+  }
+  TEST_ASSERT_FALSE(decoder.next(out));
+}
+
+// Bits one timestamp costs after a first delta of 20ms, given the second delta
+static uint32_t timestampBits(int32_t secondDelta) {
+  uint8_t buffer[16];
+  BitWriter out(buffer, sizeof(buffer));
+  TimestampCoder coder;
+  coder.encode(out, 1000);
+  coder.encode(out, 1020);
+  uint64_t before = out.usedBits();
+  coder.encode(out, 1020 + (uint32_t)secondDelta);
+  return (uint32_t)(out.usedBits() - before);
+}
+
+// Bits one distance costs after 2000mm, given the next reading
+static uint32_t distanceBits(uint16_t nextMm) {
+  uint8_t buffer[16];
+  BitWriter out(buffer, sizeof(buffer));
+  DistanceCoder coder;
+  coder.encode(out, 2000);
+  uint64_t before = out.usedBits();
+  coder.encode(out, nextMm);
+  return (uint32_t)(out.usedBits() - before);
+}
+
+void test_steady_stream_round_trip(void) {
+  // 50Hz with a slowly moving target, a timeout and a clamp (as the firmware flags them)
+  SampleRecord records[500];
+  for (uint32_t i = 0; i < 500; i++) {
+    records[i] = { 10000 + i * 20, (uint16_t)(1500 + i / 4), SAMPLE_OK, 200 };
+  }
+  records[100] = { records[100].timestampMs, 0, SAMPLE_TIMEOUT, 0 };
+  records[300] = { records[300].timestampMs, SAMPLE_MAX_MM, SAMPLE_ABOVE_MAX, 40 };
+  assertRoundTrip(records, 500);
+
+  // Mostly one bit per field: well under 1 byte per sample plus the raw first sample
+  uint8_t buffer[4096];
+  TEST_ASSERT_LESS_THAN(500, encode(records, 500, buffer, sizeof(buffer)));
+}
+
+void test_timestamp_bucket_edges(void) {
+  // Change of interval at each edge: 1, 2+7, 3+9, 4+12 bits, then the 4+32 raw escape
+  TEST_ASSERT_EQUAL_UINT32(1, timestampBits(20));
+  TEST_ASSERT_EQUAL_UINT32(9, timestampBits(20 - 63));
+  TEST_ASSERT_EQUAL_UINT32(9, timestampBits(20 + 64));
+  TEST_ASSERT_EQUAL_UINT32(12, timestampBits(20 - 64));
+  TEST_ASSERT_EQUAL_UINT32(12, timestampBits(20 + 65));
+  TEST_ASSERT_EQUAL_UINT32(12, timestampBits(20 + 256));
+  TEST_ASSERT_EQUAL_UINT32(16, timestampBits(20 + 257));
+  TEST_ASSERT_EQUAL_UINT32(16, timestampBits(20 + 2048));
+  TEST_ASSERT_EQUAL_UINT32(36, timestampBits(20 + 2049));
+  TEST_ASSERT_EQUAL_UINT32(36, timestampBits(20 - 2048));
+
+  // The same edges decode exactly, including a backwards step and millis() wrapping past 2^32
+  const int64_t deltas[] = { 20, 20, 20 - 63, 20 + 64, 20 - 64, 20 + 65, 20 + 256, 20 + 257, 20 + 2048,
+                             20 + 2049, 20, 0xFFFFF000u, 0x7FFFFFFFu, 5, 0x80000000u, 20 };
+  SampleRecord records[17];
+  uint32_t t = 0xFFFFFF00u;
+  records[0] = { t, 1000, SAMPLE_OK, 200 };
+  for (uint8_t i = 0; i < 16; i++) {
+    t += (uint32_t)deltas[i];
+    records[i + 1] = { t, 1000, SAMPLE_OK, 200 };
+  }
+  assertRoundTrip(records, 17);
+}
+
+void test_distance_bucket_edges(void) {
+  // Difference at each edge: 1, 2+4, 3+7, 4+10 bits, then the 4+16 raw escape
+  TEST_ASSERT_EQUAL_UINT32(1, distanceBits(2000));
+  TEST_ASSERT_EQUAL_UINT32(6, distanceBits(2000 - 8));
+  TEST_ASSERT_EQUAL_UINT32(6, distanceBits(2000 + 7));
+  TEST_ASSERT_EQUAL_UINT32(10, distanceBits(2000 + 8));
+  TEST_ASSERT_EQUAL_UINT32(10, distanceBits(2000 - 64));
+  TEST_ASSERT_EQUAL_UINT32(14, distanceBits(2000 + 64));
+  TEST_ASSERT_EQUAL_UINT32(14, distanceBits(2000 - 512));
+  TEST_ASSERT_EQUAL_UINT32(20, distanceBits(2000 + 512));
+  TEST_ASSERT_EQUAL_UINT32(20, distanceBits(0));
+
+  // The full 16-bit range: jumps between 0 and 65535 and every edge in between
+  const uint16_t distances[] = { 0, 65535, 65535, 0, 7, 0xFFFF - 8, 0xFFFF, 1000, 992, 999, 1063, 999, 1510,
+                                 999, 488, 20, SAMPLE_MAX_MM };
+  SampleRecord records[17];
+  for (uint8_t i = 0; i < 17; i++) records[i] = { (uint32_t)i * 20, distances[i], SAMPLE_OK, 200 };
+  assertRoundTrip(records, 17);
+}
+
+void test_random_fields_round_trip(void) {
+  // Worst case: every field random, every coder on its escape path most of the time
+  SampleRecord records[1000];
+  uint32_t seed = 7;
+  for (uint32_t i = 0; i < 1000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t a = seed;
+    seed = seed * 1103515245u + 12345u;
+    records[i] = { a, (uint16_t)(seed >> 16), (uint8_t)(seed >> 8), (uint8_t)seed };
+  }
+  assertRoundTrip(records, 1000);
+
+  // Bounded by 36 + 20 + 9 + 9 bits per sample
+  static uint8_t buffer[16384];
+  TEST_ASSERT_LESS_OR_EQUAL(1000 * 74 / 8 + 1, encode(records, 1000, buffer, sizeof(buffer)));
+}
+
+void test_full_buffer_rolls_back(void) {
+  SampleRecord records[64];
+  for (uint32_t i = 0; i < 64; i++) records[i] = { i * 20, (uint16_t)(1000 + (i % 2) * 300), SAMPLE_OK, 200 };
+
+  // Fill a small buffer: the sample that does not fit is refused whole, the stream stays decodable
+  uint8_t buffer[20];
+  SampleEncoder encoder(buffer, sizeof(buffer));
+  uint32_t accepted = 0;
+  while (accepted < 64 && encoder.append(records[accepted])) accepted++;
+  TEST_ASSERT_TRUE(accepted > 0 && accepted < 64);
+  TEST_ASSERT_EQUAL_UINT32(accepted, encoder.count());
+  TEST_ASSERT_FALSE(encoder.append(records[accepted]));       // still refused, nothing half-written
+  TEST_ASSERT_TRUE(encoder.bits() <= sizeof(buffer) * 8);
+  size_t length = encoder.finish();
+  TEST_ASSERT_TRUE(length <= sizeof(buffer));
+
+  SampleDecoder decoder(buffer, length, accepted);
+  SampleRecord out;
+  for (uint32_t i = 0; i < accepted; i++) {
+    TEST_ASSERT_TRUE(decoder.next(out));
+    TEST_ASSERT_EQUAL_UINT32(records[i].timestampMs, out.timestampMs);
+    TEST_ASSERT_EQUAL_UINT16(records[i].distanceMm, out.distanceMm);
+  }
+  TEST_ASSERT_FALSE(decoder.next(out));
+
+  // A zero-sized buffer takes nothing
+  SampleEncoder none(buffer, 0);
+  TEST_ASSERT_FALSE(none.append(records[0]));
+  TEST_ASSERT_EQUAL_UINT32(0, none.finish());
+}
+
+void test_truncated_stream(void) {
+  SampleRecord records[100];
+  for (uint32_t i = 0; i < 100; i++) records[i] = { i * 37, (uint16_t)(i * 101), (uint8_t)i, (uint8_t)(255 - i) };
+  uint8_t buffer[2048];
+  size_t length = encode(records, 100, buffer, sizeof(buffer));
+
+  // A stream cut short ends early instead of reading past its end
+  SampleDecoder decoder(buffer, length / 2, 100);
+  SampleRecord out;
+  uint32_t decoded = 0;
+  while (decoder.next(out)) {
+    TEST_ASSERT_EQUAL_UINT32(records[decoded].timestampMs, out.timestampMs);
+    decoded++;
+  }
+  TEST_ASSERT_TRUE(decoded > 0 && decoded < 100);
+  TEST_ASSERT_FALSE(decoder.next(out));
+
+  SampleDecoder empty(buffer, 0, 100);
+  TEST_ASSERT_FALSE(empty.next(out));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_stream_round_trip);
+  RUN_TEST(test_timestamp_bucket_edges);
+  RUN_TEST(test_distance_bucket_edges);
+  RUN_TEST(test_random_fields_round_trip);
+  RUN_TEST(test_full_buffer_rolls_back);
+  RUN_TEST(test_truncated_stream);
+  return UNITY_END();
+}
@@ -0,0 +1,168 @@
+/*********************************************************************************************************
+ * Stream Clients Tests
+ *
+ * StreamClients admission and backpressure with viewers on local socket pairs: refusal past
+ * STREAM_MAX_CLIENTS, SKIP while a viewer's socket is full and DROP after STREAM_MAX_SKIPS in a row, the
+ * skip count starting over once a batch goes out, and remove() freeing the slot for the next viewer.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "stream_clients.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// A viewer: the server's non-blocking end of a socket pair, the viewer reads the other end
+struct SocketClient {
+  int server = -1;
+  int viewer = -1;
+
+  void open() {
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    server = fds[0];
+    viewer = fds[1];
+    int size = 4096;
+    setsockopt(server, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    fcntl(server, F_SETFL, fcntl(server, F_GETFL) | O_NONBLOCK);
+  }
+
+  void close() {
+    ::close(server);
+    ::close(viewer);
+  }
+
+  bool writable() const {
+    pollfd p = { server, POLLOUT, 0 };
+    return poll(&p, 1, 0) == 1 && (p.revents & POLLOUT);
+  }
+
+  // Write until the socket refuses more (a viewer that stopped reading)
+  void fill() {
+    static const char batch[512] = {};
+    while (write(server, batch, sizeof(batch)) > 0) {}
+    TEST_ASSERT_FALSE(writable());
+  }
+
+  // The viewer catches up
+  void drainViewer() {
+    char buffer[4096];
+    fcntl(viewer, F_SETFL, fcntl(viewer, F_GETFL) | O_NONBLOCK);
+    while (read(viewer, buffer, sizeof(buffer)) > 0) {}
+  }
+};
+
+// One batch for every admitted viewer, as the device's sender does (newest slot first, so a drop
+// does not skip the viewer moved into its place); returns the number sent
+static uint8_t sendBatch(StreamClients<SocketClient>& clients) {
+  static const char payload[64] = {};
+  uint8_t sent = 0;
+  for (int8_t i = (int8_t)clients.size() - 1; i >= 0; i--) {
+    SocketClient* client = clients.client(i);
+    StreamAction action = clients.onBatch(clients.id(i), client->writable());
+    if (action == StreamAction::SEND) {
+      TEST_ASSERT_TRUE(write(client->server, payload, sizeof(payload)) > 0);
+      sent++;
+    }
+  }
+  return sent;
+}
+
+void test_admission_capped(void) {
+  StreamClients<SocketClient> clients;
+  SocketClient sockets[STREAM_MAX_CLIENTS + 1];
+  for (uint8_t i = 0; i < STREAM_MAX_CLIENTS; i++) TEST_ASSERT_TRUE(clients.admit(100 + i, &sockets[i]));
+  TEST_ASSERT_FALSE(clients.admit(200, &sockets[STREAM_MAX_CLIENTS]));
+  TEST_ASSERT_EQUAL_UINT8(STREAM_MAX_CLIENTS, clients.size());
+
+  // An id already admitted is not a new viewer
+  TEST_ASSERT_TRUE(clients.admit(100, &sockets[0]));
+  TEST_ASSERT_EQUAL_UINT8(STREAM_MAX_CLIENTS, clients.size());
+
+  // Unknown ids are never sent to
+  TEST_ASSERT_TRUE(clients.onBatch(200, true) == StreamAction::DROP);
+  TEST_ASSERT_EQUAL_UINT32(0, clients.slowClientsDropped());
+}
+
+void test_slow_viewer_skipped_then_dropped(void) {
+  StreamClients<SocketClient> clients;
+  SocketClient fast, slow;
+  fast.open();
+  slow.open();
+  clients.admit(1, &fast);
+  clients.admit(2, &slow);
+  slow.fill();
+
+  // The full viewer skips, the other keeps receiving every batch
+  for (uint8_t batch = 1; batch < STREAM_MAX_SKIPS; batch++) {
+    TEST_ASSERT_EQUAL_UINT8(1, sendBatch(clients));
+    fast.drainViewer();
+    TEST_ASSERT_EQUAL_UINT8(2, clients.size());
+  }
+  TEST_ASSERT_EQUAL_UINT32(STREAM_MAX_SKIPS - 1, clients.skippedBatches());
+
+  // One more skip in a row drops it
+  TEST_ASSERT_TRUE(clients.onBatch(2, slow.writable()) == StreamAction::DROP);
+  TEST_ASSERT_EQUAL_UINT8(1, clients.size());
+  TEST_ASSERT_EQUAL_UINT32(1, clients.id(0));
+  TEST_ASSERT_EQUAL_UINT32(STREAM_MAX_SKIPS, clients.skippedBatches());
+  TEST_ASSERT_EQUAL_UINT32(1, clients.slowClientsDropped());
+  fast.close();
+  slow.close();
+}
+
+void test_sent_batch_resets_skips(void) {
+  StreamClients<SocketClient> clients;
+  SocketClient viewer;
+  viewer.open();
+  clients.admit(7, &viewer);
+
+  // Falls behind for all but one batch, catches up, then falls behind again: never dropped
+  for (int round = 0; round < 3; round++) {
+    viewer.fill();
+    for (uint8_t batch = 1; batch < STREAM_MAX_SKIPS; batch++) {
+      TEST_ASSERT_TRUE(clients.onBatch(7, viewer.writable()) == StreamAction::SKIP);
+    }
+    viewer.drainViewer();
+    TEST_ASSERT_TRUE(clients.onBatch(7, viewer.writable()) == StreamAction::SEND);
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, clients.size());
+  TEST_ASSERT_EQUAL_UINT32(0, clients.slowClientsDropped());
+  TEST_ASSERT_EQUAL_UINT32(3 * (STREAM_MAX_SKIPS - 1), clients.skippedBatches());
+  viewer.close();
+}
+
+void test_remove_frees_slot(void) {
+  StreamClients<SocketClient> clients;
+  SocketClient sockets[STREAM_MAX_CLIENTS + 1];
+  for (SocketClient& socket : sockets) socket.open();
+  for (uint8_t i = 0; i < STREAM_MAX_CLIENTS; i++) clients.admit(10 + i, &sockets[i]);
+  TEST_ASSERT_FALSE(clients.admit(99, &sockets[STREAM_MAX_CLIENTS]));
+
+  // A viewer leaves from the middle of the table; the newcomer takes its slot
+  clients.remove(11);
+  clients.remove(11);                                          // a second disconnect event is harmless
+  TEST_ASSERT_EQUAL_UINT8(STREAM_MAX_CLIENTS - 1, clients.size());
+  TEST_ASSERT_TRUE(clients.onBatch(11, true) == StreamAction::DROP);
+  TEST_ASSERT_TRUE(clients.admit(99, &sockets[STREAM_MAX_CLIENTS]));
+  TEST_ASSERT_EQUAL_UINT8(STREAM_MAX_CLIENTS, clients.size());
+
+  // Every remaining viewer, the newcomer included, gets the next batch
+  TEST_ASSERT_EQUAL_UINT8(STREAM_MAX_CLIENTS, sendBatch(clients));
+  for (uint8_t i = 0; i < clients.size(); i++) TEST_ASSERT_TRUE(clients.id(i) != 11);
+  for (SocketClient& socket : sockets) socket.close();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_admission_capped);
+  RUN_TEST(test_slow_viewer_skipped_then_dropped);
+  RUN_TEST(test_sent_batch_resets_skips);
+  RUN_TEST(test_remove_frees_slot);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/*********************************************************************************************************
+ * Tank Volume Tests
+ *
+ * The fixed-point volume table against the closed-form volume of each tank shape at every millimetre of
+ * level (the device's default dimensions), strapping tables, clamping and degenerate input, and the flow
+ * estimate for steady filling and draw-off.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "tank_volume.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// As in src/main.cpp
+#define TANK_HEIGHT_MM 1200
+#define TANK_DIAMETER_MM 1000
+#define TANK_LENGTH_MM 2000
+#define TANK_WIDTH_MM 1000
+
+// Largest difference between the table and the exact volume over the whole level range (mL)
+template <typename Exact>
+static double worstError(const VolumeTable& table, int32_t fullMm, Exact exact) {
+  double worst = 0;
+  for (int32_t level = 0; level <= fullMm; level++) {
+    double error = fabs((double)table.volumeMl(level) - exact(level));
+    if (error > worst) worst = error;
+  }
+  return worst;
+}
+
+void test_vertical_cylinder(void) {
+  VolumeTable table;
+  TankGeometry tank = { TankShape::VERTICAL_CYLINDER, TANK_HEIGHT_MM, TANK_DIAMETER_MM, 0, 0 };
+  TEST_ASSERT_TRUE(table.build(tank));
+  const double r = TANK_DIAMETER_MM / 2.0;
+  auto exact = [r](double level) { return M_PI * r * r * level / 1000.0; };
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)(exact(TANK_HEIGHT_MM) + 0.5), table.capacityMl());
+  TEST_ASSERT_EQUAL_INT32(TANK_HEIGHT_MM, table.fullLevelMm());
+  TEST_ASSERT_LESS_THAN_FLOAT(2.0f, (float)worstError(table, TANK_HEIGHT_MM, exact));  // rounding only
+}
+
+void test_horizontal_cylinder(void) {
+  VolumeTable table;
+  TankGeometry tank = { TankShape::HORIZONTAL_CYLINDER, 0, TANK_DIAMETER_MM, TANK_LENGTH_MM, 0 };
+  TEST_ASSERT_TRUE(table.build(tank));
+  const double r = TANK_DIAMETER_MM / 2.0;
+  auto exact = [r](double h) {
+    return (r * r * acos((r - h) / r) - (r - h) * sqrt(2 * r * h - h * h)) * TANK_LENGTH_MM / 1000.0;
+  };
+  TEST_ASSERT_EQUAL_INT32(TANK_DIAMETER_MM, table.fullLevelMm());
+  TEST_ASSERT_UINT32_WITHIN(1, (uint32_t)(M_PI * r * r * TANK_LENGTH_MM / 1000.0), table.capacityMl());
+  TEST_ASSERT_UINT32_WITHIN(1, table.capacityMl() / 2, table.volumeMl(TANK_DIAMETER_MM / 2));
+
+  // Piecewise-linear chords of the segment area: under 0.05% of capacity, and as level (error over the
+  // surface area at that level) under a millimetre even where the surface is narrow
+  TEST_ASSERT_LESS_THAN_FLOAT(table.capacityMl() * 0.0005f, (float)worstError(table, TANK_DIAMETER_MM, exact));
+  double worstMm = 0;
+  for (int32_t h = 1; h < TANK_DIAMETER_MM; h++) {
+    double surfaceMlPerMm = 2 * sqrt(2 * r * h - (double)h * h) * TANK_LENGTH_MM / 1000.0;
+    double errorMm = fabs((double)table.volumeMl(h) - exact(h)) / surfaceMlPerMm;
+    if (errorMm > worstMm) worstMm = errorMm;
+  }
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, (float)worstMm);
+}
+
+void test_rectangular(void) {
+  VolumeTable table;
+  TankGeometry tank = { TankShape::RECTANGULAR, TANK_HEIGHT_MM, 0, TANK_LENGTH_MM, TANK_WIDTH_MM };
+  TEST_ASSERT_TRUE(table.build(tank));
+  auto exact = [](double level) { return (double)TANK_LENGTH_MM * TANK_WIDTH_MM * level / 1000.0; };
+  TEST_ASSERT_EQUAL_UINT32(2400000, table.capacityMl());
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, (float)worstError(table, TANK_HEIGHT_MM, exact));
+}
+
+void test_strapping_table(void) {
+  // A tapered tank measured by filling in steps
+  const StrapPoint points[] = { { 0, 0 }, { 100, 12000 }, { 400, 60000 }, { 900, 160000 }, { 1000, 185000 } };
+  VolumeTable table;
+  TEST_ASSERT_TRUE(table.build(points, 5));
+  for (const StrapPoint& p : points) TEST_ASSERT_EQUAL_UINT32(p.volumeMl, table.volumeMl(p.levelMm));
+  auto exact = [&points](double level) {
+    uint8_t i = 0;
+    while (i < 3 && points[i + 1].levelMm <= level) i++;
+    return points[i].volumeMl + (level - points[i].levelMm) * (double)(points[i + 1].volumeMl - points[i].volumeMl) /
+                                  (points[i + 1].levelMm - points[i].levelMm);
+  };
+  TEST_ASSERT_LESS_THAN_FLOAT(1.0f, (float)worstError(table, 1000, exact));
+
+  // Clamped outside the table
+  TEST_ASSERT_EQUAL_UINT32(0, table.volumeMl(-50));
+  TEST_ASSERT_EQUAL_UINT32(185000, table.volumeMl(1500));
+  TEST_ASSERT_EQUAL_UINT32(185000, table.capacityMl());
+}
+
+void test_invalid_input(void) {
+  VolumeTable table;
+  TankGeometry empty = { TankShape::VERTICAL_CYLINDER, 0, TANK_DIAMETER_MM, 0, 0 };
+  TEST_ASSERT_FALSE(table.build(empty));
+  TEST_ASSERT_FALSE(table.valid());
+  TEST_ASSERT_EQUAL_UINT32(0, table.volumeMl(500));
+
+  const StrapPoint unsorted[] = { { 0, 0 }, { 200, 1000 }, { 200, 2000 } };
+  const StrapPoint draining[] = { { 0, 0 }, { 200, 1000 }, { 300, 900 } };
+  TEST_ASSERT_FALSE(table.build(unsorted, 3));
+  TEST_ASSERT_FALSE(table.build(draining, 3));
+  TEST_ASSERT_FALSE(table.build(unsorted, 1));
+  TEST_ASSERT_FALSE(table.valid());
+}
+
+void test_flow_rate(void) {
+  VolumeTable table;
+  TankGeometry tank = { TankShape::RECTANGULAR, TANK_HEIGHT_MM, 0, TANK_LENGTH_MM, TANK_WIDTH_MM };
+  table.build(tank);
+
+  // Filling at 0.5mm/s (1 L/s) with ±3mm ripple, read at 50Hz
+  FlowEstimator flow;
+  TEST_ASSERT_FALSE(flow.valid());
+  for (uint32_t t = 0; t < 60000; t += 20) {
+    int32_t level = 200 + (int32_t)(t / 2000) + (int32_t)(t / 20 % 7) - 3;
+    flow.update(t, table.volumeMl(level));
+  }
+  TEST_ASSERT_TRUE(flow.valid());
+  TEST_ASSERT_INT32_WITHIN(150, 1000, flow.mlPerSecond());
+
+  // Draw-off at the same rate: sign flips once the window has turned over
+  for (uint32_t t = 60000; t < 90000; t += 20) flow.update(t, table.volumeMl(230 - (int32_t)((t - 60000) / 2000)));
+  TEST_ASSERT_INT32_WITHIN(150, -1000, flow.mlPerSecond());
+
+  // A full tank standing still
+  flow.reset();
+  for (uint32_t t = 90000; t < 120000; t += 20) flow.update(t, table.volumeMl(TANK_HEIGHT_MM + 20));
+  TEST_ASSERT_EQUAL_INT32(0, flow.mlPerSecond());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_vertical_cylinder);
+  RUN_TEST(test_horizontal_cylinder);
+  RUN_TEST(test_rectangular);
+  RUN_TEST(test_strapping_table);
+  RUN_TEST(test_invalid_input);
+  RUN_TEST(test_flow_rate);
+  return UNITY_END();
+}
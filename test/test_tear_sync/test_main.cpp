@@ -0,0 +1,127 @@
+/*********************************************************************************************************
+ * Tear Scheduler Tests
+ *
+ * Drives TearScheduler with a simulated scan line clock: bands are written at rowWriteUs per row after
+ * the delay the scheduler asks for, and every written row is checked against the scan line position.
+ *
+ **********************************************************************************************************/
+
+#include <unity.h>
+#include "tear_sync.h"
+
+#define ROWS 320
+#define PERIOD_US 16667
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// True if the scan line is inside rows [y0, y1) at any time in [startUs, startUs + writeUs)
+static bool scanlineInside(const TearScheduler& scheduler, uint16_t y0, uint16_t y1, uint32_t startUs,
+                           uint32_t writeUs) {
+  for (uint32_t t = startUs; t < startUs + writeUs; t++) {
+    uint16_t row = scheduler.scanline(t);
+    if (row >= y0 && row < y1) return true;
+  }
+  return false;
+}
+
+void test_scanline_follows_vsync(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(1000);
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.scanline(1000));
+  TEST_ASSERT_EQUAL_UINT16(ROWS / 2, scheduler.scanline(1000 + PERIOD_US / 2 + 1));
+  TEST_ASSERT_EQUAL_UINT16(0, scheduler.scanline(1000 + PERIOD_US));
+  TEST_ASSERT_EQUAL_UINT16(ROWS - 1, scheduler.scanline(1000 + PERIOD_US - 1));
+}
+
+void test_period_tracks_drift_and_rejects_outliers(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  uint32_t t = 500;
+  scheduler.onVsync(t);
+  for (int i = 0; i < 100; i++) scheduler.onVsync(t += 17000); // panel oscillator 2% slow
+  TEST_ASSERT_UINT32_WITHIN(20, 17000, scheduler.framePeriodUs());
+
+  scheduler.onVsync(t += 34000);                               // missed pulse
+  scheduler.onVsync(t += 3000);                                // glitch
+  TEST_ASSERT_UINT32_WITHIN(20, 17000, scheduler.framePeriodUs());
+}
+
+void test_band_behind_scanline_is_pushed_now(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(0);
+  // Scan line at row 200, band rows 20-40 (20 rows x 4us) finishes long before it comes round again
+  uint32_t now = PERIOD_US * 200 / ROWS;
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.delayForBand(20, 40, 4, now));
+}
+
+void test_band_written_ahead_of_scanline_when_fast_enough(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(0);
+  uint32_t now = PERIOD_US * 100 / ROWS;                       // scan line at row 100 (52us per row)
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.delayForBand(110, 150, 4, now)); // 160us, done before row 110
+}
+
+void test_band_ahead_of_scanline_waits_for_it_to_pass(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(0);
+  uint32_t now = PERIOD_US * 100 / ROWS;                       // scan line at row 100
+  uint32_t wait = scheduler.delayForBand(105, 150, 20, now);   // 900us: the scan line would catch up
+  TEST_ASSERT_GREATER_THAN(0, wait);
+  TEST_ASSERT_EQUAL_UINT16(150, scheduler.scanline(now + wait));
+  TEST_ASSERT_FALSE(scanlineInside(scheduler, 105, 150, now + wait, 45 * 20));
+}
+
+void test_empty_band_needs_no_wait(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.delayForBand(50, 50, 4, 1234));
+}
+
+// Every band that fits between two scans is written without the scan line entering it
+void test_simulated_pushes_never_tear(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(0);
+  uint32_t seed = 12345;
+  for (int i = 0; i < 2000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    uint16_t y0 = (seed >> 8) % (ROWS - 1);
+    uint16_t y1 = y0 + 1 + (seed >> 20) % 100;
+    if (y1 > ROWS) y1 = ROWS;
+    uint32_t rowWriteUs = 2 + (seed >> 4) % 20;
+    uint32_t now = (seed >> 3) % 100000;
+
+    uint32_t startUs = now + scheduler.delayForBand(y0, y1, rowWriteUs, now);
+    uint32_t writeUs = (y1 - y0) * rowWriteUs;
+    uint32_t bandUs = (uint32_t)((uint64_t)(y1 - y0) * PERIOD_US / ROWS);
+    if (writeUs > PERIOD_US - bandUs) continue;                // too tall to avoid the scan line
+
+    // The scan line stays outside the band for the whole write
+    TEST_ASSERT_FALSE_MESSAGE(scanlineInside(scheduler, y0, y1, startUs, writeUs),
+                              "scan line entered the band during the write");
+  }
+}
+
+void test_order_bands_soonest_first(void) {
+  TearScheduler scheduler(ROWS, PERIOD_US);
+  scheduler.onVsync(0);
+  uint32_t now = PERIOD_US * 100 / ROWS;                       // scan line at row 100
+  DirtyBand bands[3] = { { 105, 150 }, { 10, 30 }, { 200, 220 } };
+  scheduler.orderBands(bands, 3, 20, now);
+  for (int i = 1; i < 3; i++) {
+    TEST_ASSERT_GREATER_OR_EQUAL(scheduler.delayForBand(bands[i - 1].y0, bands[i - 1].y1, 20, now),
+                                 scheduler.delayForBand(bands[i].y0, bands[i].y1, 20, now));
+  }
+  TEST_ASSERT_EQUAL_UINT16(105, bands[2].y0);                  // just ahead of the scan line: waits longest
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_scanline_follows_vsync);
+  RUN_TEST(test_period_tracks_drift_and_rejects_outliers);
+  RUN_TEST(test_band_behind_scanline_is_pushed_now);
+  RUN_TEST(test_band_written_ahead_of_scanline_when_fast_enough);
+  RUN_TEST(test_band_ahead_of_scanline_waits_for_it_to_pass);
+  RUN_TEST(test_empty_band_needs_no_wait);
+  RUN_TEST(test_simulated_pushes_never_tear);
+  RUN_TEST(test_order_bands_soonest_first);
+  return UNITY_END();
+}
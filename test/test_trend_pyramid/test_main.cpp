@@ -0,0 +1,129 @@
+/*********************************************************************************************************
+ * Trend Pyramid Tests
+ *
+ * Every closed bucket at every level is compared with the min, max, sum and count of the raw samples in
+ * its time slot, over an irregular stream with long gaps (empty slots, ring wrap, skipped gaps). Also
+ * the open bucket, the bucket arithmetic and a single slow sample cascading through all levels.
+ *
+ **********************************************************************************************************/
+
+#include <algorithm>
+#include <unity.h>
+#include "trend_pyramid.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define LEVELS 4
+#define COLUMNS 32
+#define SAMPLES 60000
+
+static const uint32_t durations[LEVELS] = { 1000, 10000, 60000, 600000 };
+static uint32_t times[SAMPLES];
+static int32_t values[SAMPLES];
+
+// Raw samples in [fromMs, toMs) summarised as a bucket
+static TrendBucket bruteBucket(int count, uint32_t fromMs, uint32_t toMs) {
+  TrendBucket b;
+  b.clear();
+  int i = (int)(std::lower_bound(times, times + count, fromMs) - times);
+  for (; i < count && times[i] < toMs; i++) b.add(values[i]);
+  return b;
+}
+
+static void assertBucket(const TrendBucket& expected, const TrendBucket& actual) {
+  TEST_ASSERT_EQUAL_UINT32(expected.count, actual.count);
+  if (expected.count == 0) return;
+  TEST_ASSERT_EQUAL_INT32(expected.min, actual.min);
+  TEST_ASSERT_EQUAL_INT32(expected.max, actual.max);
+  TEST_ASSERT_TRUE(expected.sum == actual.sum);
+}
+
+// Check every closed bucket and the finest open bucket after sample count - 1
+static void checkPyramid(const TrendPyramid<LEVELS, COLUMNS>& pyramid, int count) {
+  // Open slot of each level: level 0 holds the newest sample, a coarser level holds the slot of the
+  // finer level's newest closed bucket (coarser buckets are built from closed buckets only)
+  uint32_t open[LEVELS];
+  for (int level = 0; level < LEVELS; level++) {
+    uint32_t d = durations[level];
+    uint32_t first = times[0] - times[0] % d;
+    if (level == 0) {
+      open[0] = times[count - 1] - times[count - 1] % d;
+    }
+    else {
+      uint32_t finerFirst = times[0] - times[0] % durations[level - 1];
+      bool finerClosed = open[level - 1] > finerFirst;
+      uint32_t newestClosed = open[level - 1] - durations[level - 1];
+      open[level] = finerClosed ? newestClosed - newestClosed % d : first;
+    }
+
+    uint32_t closed = (open[level] - first) / d;
+    TEST_ASSERT_EQUAL_UINT16(closed < COLUMNS ? closed : COLUMNS, pyramid.available(level));
+    for (uint16_t back = 0; back < pyramid.available(level); back++) {
+      uint32_t slot = open[level] - (back + 1) * d;
+      assertBucket(bruteBucket(count, slot, slot + d), pyramid.bucket(level, back));
+    }
+  }
+  assertBucket(bruteBucket(count, open[0], open[0] + durations[0]), pyramid.openBucket(0));
+}
+
+void test_buckets_match_raw_samples(void) {
+  uint32_t seed = 11, t = 123;
+  int32_t v = 2000;
+  for (int i = 0; i < SAMPLES; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    uint32_t r = seed >> 16;
+    if (r % 5000 == 0) t += 700000 + r % 300000;               // gap longer than a ring at the finer levels
+    else if (r % 500 == 0) t += 5000 + r % 20000;              // a few empty slots
+    else t += 20 + r % 80;
+    v += (int32_t)((seed >> 8) % 61) - 30;
+    times[i] = t;
+    values[i] = v;
+  }
+
+  TrendPyramid<LEVELS, COLUMNS> pyramid(durations);
+  for (int i = 0; i < SAMPLES; i++) {
+    pyramid.add(times[i], values[i]);
+    if (i % 499 == 0 || i == SAMPLES - 1) checkPyramid(pyramid, i + 1);
+  }
+}
+
+void test_single_samples_cascade(void) {
+  // One sample per 10min slot: each closes a bucket at every level in turn
+  TrendPyramid<LEVELS, COLUMNS> pyramid(durations);
+  for (int i = 0; i < 5; i++) pyramid.add(i * 600000 + 500, 100 * (i + 1));
+  TEST_ASSERT_EQUAL_UINT16(COLUMNS, pyramid.available(0));
+  TEST_ASSERT_EQUAL_UINT16(3, pyramid.available(3));           // the fourth sample's slot is still open
+  TEST_ASSERT_EQUAL_UINT32(1, pyramid.bucket(3, 0).count);
+  TEST_ASSERT_EQUAL_INT32(300, pyramid.bucket(3, 0).mean());
+  TEST_ASSERT_EQUAL_INT32(100, pyramid.bucket(3, 2).min);
+  TEST_ASSERT_EQUAL_UINT32(0, pyramid.bucket(0, 0).count);     // the finest slots between are empty
+  TEST_ASSERT_EQUAL_UINT32(1, pyramid.openBucket(0).count);
+  TEST_ASSERT_EQUAL_UINT32(600000, pyramid.durationMs(3));
+}
+
+void test_bucket_arithmetic(void) {
+  TrendBucket a, b, empty;
+  a.clear();
+  b.clear();
+  empty.clear();
+  TEST_ASSERT_EQUAL_INT32(0, a.mean());
+  a.add(-5);
+  a.add(15);
+  b.add(40);
+  a.merge(empty);
+  TEST_ASSERT_EQUAL_UINT32(2, a.count);
+  a.merge(b);
+  TEST_ASSERT_EQUAL_INT32(-5, a.min);
+  TEST_ASSERT_EQUAL_INT32(40, a.max);
+  TEST_ASSERT_EQUAL_INT32(16, a.mean());
+  TEST_ASSERT_EQUAL_UINT32(3, a.count);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_buckets_match_raw_samples);
+  RUN_TEST(test_single_samples_cascade);
+  RUN_TEST(test_bucket_arithmetic);
+  return UNITY_END();
+}
@@ -0,0 +1,138 @@
+/*********************************************************************************************************
+ * Window Statistics Tests
+ *
+ * Min, max, mean and standard deviation against a brute-force rescan of the same window, for time-
+ * bounded, count-bounded and capacity-bounded windows, monotonic runs (worst case for the deques) and
+ * expiry without new samples.
+ *
+ **********************************************************************************************************/
+
+#include <math.h>
+#include <unity.h>
+#include "window_stats.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define HISTORY 20000
+
+static uint32_t times[HISTORY];
+static int32_t values[HISTORY];
+
+// Rescan the window ending at sample end - 1 (span 0 = no time bound) and compare
+template <uint16_t CAPACITY>
+static void checkAgainstBruteForce(const WindowStats<CAPACITY>& stats, int end, uint32_t nowMs, uint32_t spanMs,
+                                   uint16_t limit) {
+  int32_t lo = 0, hi = 0;
+  double sum = 0, sumSq = 0;
+  int n = 0;
+  for (int i = end - 1; i >= 0 && n < limit; i--) {
+    if (spanMs != 0 && nowMs - times[i] > spanMs) break;
+    if (n == 0 || values[i] < lo) lo = values[i];
+    if (n == 0 || values[i] > hi) hi = values[i];
+    sum += values[i];
+    sumSq += (double)values[i] * values[i];
+    n++;
+  }
+  TEST_ASSERT_EQUAL_UINT16(n, stats.size());
+  TEST_ASSERT_EQUAL_INT32(lo, stats.min());
+  TEST_ASSERT_EQUAL_INT32(hi, stats.max());
+  double mean = n ? sum / n : 0;
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, (float)mean, stats.mean());
+  float sd = n >= 2 ? (float)sqrt(fmax(0, sumSq / n - mean * mean)) : 0;
+  TEST_ASSERT_FLOAT_WITHIN(0.01f + sd * 1e-4f, sd, stats.stddev());
+}
+
+// Random walk with occasional spikes and irregular spacing
+static void generate(uint32_t seed, uint32_t maxGapMs) {
+  uint32_t t = 0xFFFF0000u;                                    // millis() wraps part way through
+  int32_t v = 1500;
+  for (int i = 0; i < HISTORY; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    t += (seed >> 24) % (maxGapMs + 1);
+    v += (int32_t)((seed >> 8) % 41) - 20;
+    times[i] = t;
+    values[i] = (seed >> 16) % 50 == 0 ? (int32_t)((seed >> 4) % 4000) : v;
+  }
+}
+
+void test_time_bounded_window(void) {
+  generate(1, 40);
+  WindowStats<1024> stats(2000);
+  for (int i = 0; i < HISTORY; i++) {
+    stats.add(times[i], values[i]);
+    checkAgainstBruteForce(stats, i + 1, times[i], 2000, 1024);
+  }
+}
+
+void test_count_bounded_window(void) {
+  generate(2, 10);
+  WindowStats<256> stats(0, 100);
+  for (int i = 0; i < HISTORY; i++) {
+    stats.add(times[i], values[i]);
+    checkAgainstBruteForce(stats, i + 1, times[i], 0, 100);
+  }
+}
+
+void test_capacity_limits_a_fast_stream(void) {
+  // 1kHz into a 10s window of 1024 samples: the window is count-limited
+  generate(3, 1);
+  WindowStats<1024> stats(10000);
+  for (int i = 0; i < HISTORY; i++) {
+    stats.add(times[i], values[i]);
+    checkAgainstBruteForce(stats, i + 1, times[i], 10000, 1024);
+  }
+  TEST_ASSERT_EQUAL_UINT16(1024, stats.size());
+}
+
+void test_monotonic_runs(void) {
+  WindowStats<64> stats(0, 50);
+  for (int i = 0; i < 1000; i++) {
+    times[i] = i;
+    values[i] = (i / 200) % 2 ? 5000 - i : i;                   // rising then falling runs
+    stats.add(times[i], values[i]);
+    checkAgainstBruteForce(stats, i + 1, times[i], 0, 50);
+  }
+}
+
+void test_expire_without_new_samples(void) {
+  WindowStats<128> stats(1000);
+  for (int i = 0; i < 10; i++) {
+    times[i] = 1000 + i * 100;
+    values[i] = 100 * (i + 1);
+    stats.add(times[i], values[i]);
+  }
+  stats.expire(1900 + 1000);                                   // newest is exactly at the edge
+  TEST_ASSERT_EQUAL_UINT16(1, stats.size());
+  TEST_ASSERT_EQUAL_INT32(1000, stats.min());
+  TEST_ASSERT_EQUAL_INT32(1000, stats.max());
+  stats.expire(1900 + 1001);
+  TEST_ASSERT_TRUE(stats.empty());
+  TEST_ASSERT_EQUAL_INT32(0, stats.min());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.mean());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.stddev());
+}
+
+void test_known_values_and_clear(void) {
+  WindowStats<16> stats(0);
+  const int32_t set[] = { 2, 4, 4, 4, 5, 5, 7, 9 };            // mean 5, population sd 2
+  for (int i = 0; i < 8; i++) stats.add(i, set[i]);
+  TEST_ASSERT_EQUAL_FLOAT(5.0f, stats.mean());
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, stats.stddev());
+  stats.clear();
+  TEST_ASSERT_TRUE(stats.empty());
+  stats.add(0, -7);
+  TEST_ASSERT_EQUAL_INT32(-7, stats.min());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.stddev());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_time_bounded_window);
+  RUN_TEST(test_count_bounded_window);
+  RUN_TEST(test_capacity_limits_a_fast_stream);
+  RUN_TEST(test_monotonic_runs);
+  RUN_TEST(test_expire_without_new_samples);
+  RUN_TEST(test_known_values_and_clear);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+/*********************************************************************************************************
+ * Backlight Trace Replay
+ *
+ * Description:
+ *   Replays a distance trace through BacklightManager with the device configuration and reports how long
+ *   the display spends active, dimmed and asleep, and the estimated energy saved against a backlight that
+ *   is always on. Traces are serial captures of the telemetry "S,<ms>,<mm>,<flags>,<confidence>" lines;
+ *   without input a synthetic day is generated (a few visits an hour, an empty beam in between).
+ *
+ * How It Works:
+ *   1. Readings: Readings the backlight accepts (a target distance, outliers included) go through
+ *      update(), the rest through tick(), as on the device
+ *   2. Ticks: Between readings the manager is ticked every 10ms, like the loop on the device
+ *   3. Report: Time per state, average display power and energy saved
+ *
+ * Notes:
+ *   - The configuration mirrors backlightConfig in src/main.cpp
+ *   - Build: g++ -O2 -std=c++17 -o backlight_replay backlight_replay.cpp
+ *   - Usage: backlight_replay < serial-capture.txt   or   backlight_replay --synthetic [hours]
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/backlight_manager.h"
+#include "../../include/sample.h"
+
+#define TICK_MS 10                  // loop pass interval modelled between readings
+#define BACKLIGHT_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_BLANKED) // as in src/main.cpp
+
+static const BacklightConfig config = { 30000, 120000, 20, 255, 40, 330, 60, 5 };
+
+struct Replay {
+  BacklightManager backlight{config};
+  uint64_t stateMs[3] = { 0, 0, 0 };
+  uint32_t lastMs = 0;
+  bool started = false;
+  uint64_t readings = 0;
+};
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to advance the replay to nowMs, ticking like the device loop
+static void advance(Replay& replay, uint32_t nowMs) {
+  if (!replay.started) {
+    replay.lastMs = nowMs;
+    replay.started = true;
+  }
+  while ((int32_t)(nowMs - replay.lastMs) > 0) {
+    uint32_t step = nowMs - replay.lastMs < TICK_MS ? nowMs - replay.lastMs : TICK_MS;
+    replay.stateMs[(int)replay.backlight.powerState()] += step;
+    replay.lastMs += step;
+    replay.backlight.tick(replay.lastMs);
+  }
+}
+
+// Function to feed one reading
+static void feed(Replay& replay, uint32_t timeMs, int32_t mm, uint8_t flags) {
+  advance(replay, timeMs);
+  Sample sample = { timeMs, mm, 0, flags, 0 };
+  if (sample.accepts(BACKLIGHT_REJECT_FLAGS)) replay.backlight.update(timeMs, mm);
+  replay.readings++;
+}
+
+// Function to generate a synthetic trace: visits of 20-90s a few times an hour, timeouts otherwise
+static void generate(Replay& replay, uint32_t hours) {
+  uint32_t seed = 1;
+  uint32_t endMs = hours * 3600000u;
+  uint32_t nextVisitMs = 60000;
+  for (uint32_t t = 0; t < endMs; t += 250) {
+    if (t >= nextVisitMs) {
+      seed = seed * 1103515245u + 12345u;
+      uint32_t visitMs = 20000 + (seed >> 8) % 70000;
+      for (uint32_t v = 0; v < visitMs && t < endMs; v += 250, t += 250) {
+        feed(replay, t, 600 + (int32_t)((v / 1000 * 37) % 400), SAMPLE_OK);
+      }
+      nextVisitMs = t + 300000 + (seed >> 16) % 1200000;
+    }
+    feed(replay, t, SAMPLE_MAX_MM, SAMPLE_TIMEOUT);
+  }
+}
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main(int argc, char** argv) {
+  Replay replay;
+  if (argc > 1 && strcmp(argv[1], "--synthetic") == 0) {
+    generate(replay, argc > 2 ? (uint32_t)atoi(argv[2]) : 24);
+  }
+  else {
+    char line[128];
+    while (fgets(line, sizeof(line), stdin)) {
+      unsigned long ms;
+      long mm;
+      unsigned flags;
+      if (sscanf(line, "S,%lu,%ld,%x", &ms, &mm, &flags) == 3) feed(replay, (uint32_t)ms, (int32_t)mm, (uint8_t)flags);
+    }
+  }
+  if (replay.readings == 0) {
+    fprintf(stderr, "no telemetry S lines on stdin (or use --synthetic [hours])\n");
+    return 1;
+  }
+
+  uint64_t totalMs = replay.stateMs[0] + replay.stateMs[1] + replay.stateMs[2];
+  double hours = totalMs / 3600000.0;
+  double alwaysOnJ = config.activeMw * (totalMs / 1000.0) / 1000.0;
+  double savedJ = replay.backlight.savedMillijoules() / 1000.0;
+  printf("%llu readings over %.1f h\n", (unsigned long long)replay.readings, hours);
+  printf("active %.1f%%  dimmed %.1f%%  asleep %.1f%%\n", 100.0 * replay.stateMs[0] / totalMs,
+         100.0 * replay.stateMs[1] / totalMs, 100.0 * replay.stateMs[2] / totalMs);
+  printf("display energy %.0f J vs %.0f J always on: saved %.0f J (%.1f%%), average %.0f mW\n",
+         alwaysOnJ - savedJ, alwaysOnJ, savedJ, 100.0 * savedJ / alwaysOnJ,
+         (alwaysOnJ - savedJ) * 1000.0 / (totalMs / 1000.0));
+  return 0;
+}
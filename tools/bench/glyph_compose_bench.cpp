@@ -0,0 +1,170 @@
+/*********************************************************************************************************
+ * Glyph Compose Benchmark
+ *
+ * Description:
+ *   Cost of drawing the distance readout from the glyph atlas (glyph_atlas.h) against blending the same
+ *   anti-aliased digits per pixel on every update, as a smooth font does, and how many panel writes each
+ *   needs.
+ *
+ * How It Works:
+ *   1. Atlas: The digits of a synthetic 7-segment source font (72px high) are rendered once into cells of
+ *      the readout's size, timed as the start-up cost
+ *   2. Compose: compose() builds the readout strip for a set of readings (memcpy per glyph row, one
+ *      pushImage of the strip)
+ *   3. Per-pixel: The same text blended from the coverage (alpha) of each glyph pixel on every update,
+ *      with one panel write per run of inked pixels, as smooth-font rendering sends them
+ *   4. Clipped: compose() with text wider than the strip, most glyphs wholly outside on the left
+ *
+ * Notes:
+ *   - Host timings: the ratio carries over to the ESP32-S3, the absolute times do not
+ *   - Build: g++ -O2 -std=c++17 -o glyph_compose_bench glyph_compose_bench.cpp
+ *   - Usage: glyph_compose_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+
+#include "../../include/glyph_atlas.h"
+
+// As in src/main.cpp
+#define READOUT_WIDTH 144
+#define READOUT_HEIGHT 36
+#define READOUT_CELL_WIDTH 28
+
+#define SOURCE_HEIGHT 72
+#define SOURCE_WIDTH 48
+#define ITERATIONS 20000
+#define COLOUR_WHITE 0xFFFF
+#define COLOUR_BLACK 0x0000
+
+typedef std::chrono::steady_clock Clock;
+typedef GlyphAtlas<READOUT_CELL_WIDTH, READOUT_HEIGHT> ReadoutAtlas;
+
+// Segments lit per digit (bits a..g), a '.' is drawn as a square at the bottom left
+static const uint8_t SEGMENTS[10] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F };
+
+// Synthetic source font: 7-segment digits with 8px strokes
+struct SegmentGlyph {
+  char c;
+
+  bool ink(int x, int y) const {
+    const int t = 8, w = SOURCE_WIDTH - 8, h = SOURCE_HEIGHT, mid = h / 2;
+    if (c == '.') return x < t + 4 && y >= h - t - 4;
+    if (c < '0' || c > '9') return false;
+    uint8_t s = SEGMENTS[c - '0'];
+    bool left = x < t, right = x >= w - t && x < w, across = x < w;
+    return ((s & 0x01) && y < t && across) || ((s & 0x02) && right && y < mid) ||
+           ((s & 0x04) && right && y >= mid) || ((s & 0x08) && y >= h - t && across) ||
+           ((s & 0x10) && left && y >= mid) || ((s & 0x20) && left && y < mid) ||
+           ((s & 0x40) && y >= mid - t / 2 && y < mid + t / 2 && across);
+  }
+};
+
+static ReadoutAtlas atlas;
+static uint8_t coverage[GLYPH_ATLAS_GLYPHS][READOUT_CELL_WIDTH * READOUT_HEIGHT]; // alpha per cell pixel
+static uint16_t strip[READOUT_WIDTH * READOUT_HEIGHT];
+static volatile uint32_t sink;      // keeps the timed work from being optimised away
+
+static const char* const readings[] = { "123.0", "4500.0", "87.5", "2034.9", "999.9", "20.0", "3141.6", "   0.0" };
+#define READING_COUNT (sizeof(readings) / sizeof(readings[0]))
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to build the atlas, returns the time taken (µs)
+static double buildAtlas() {
+  auto start = Clock::now();
+  atlas.begin(COLOUR_WHITE, COLOUR_BLACK);
+  for (const char* c = GLYPH_ATLAS_CHARSET; *c; c++) {
+    SegmentGlyph source = { *c };
+    atlas.addGlyph(*c, source, *c == '.' ? 16 : SOURCE_WIDTH, SOURCE_HEIGHT);
+  }
+  double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+  // Coverage maps for the per-pixel path, recovered from the white-on-black cells
+  for (const char* c = GLYPH_ATLAS_CHARSET; *c; c++) {
+    const uint16_t* cell = atlas.glyph(*c);
+    for (int i = 0; i < READOUT_CELL_WIDTH * READOUT_HEIGHT; i++) {
+      uint16_t colour = panelOrder565(cell[i]);
+      coverage[glyphIndex(*c)][i] = (uint8_t)(((colour >> 5) & 0x3F) * 255 / 63);
+    }
+  }
+  return us;
+}
+
+// Function to draw text per pixel (blend on every update), returns the number of panel writes
+static uint32_t drawPerPixel(const char* text) {
+  int x = READOUT_WIDTH - atlas.textWidth(text);
+  uint32_t writes = 1;                                      // clearing the background
+  for (int i = 0; i < READOUT_WIDTH * READOUT_HEIGHT; i++) strip[i] = COLOUR_BLACK;
+  for (const char* p = text; *p; p++) {
+    int index = glyphIndex(*p);
+    if (index < 0) continue;
+    int width = atlas.advance(*p);
+    for (int y = 0; y < READOUT_HEIGHT; y++) {
+      bool inRun = false;
+      for (int gx = 0; gx < width; gx++) {
+        uint8_t alpha = coverage[index][y * READOUT_CELL_WIDTH + gx];
+        if (alpha == 0 || x + gx < 0) {
+          inRun = false;
+          continue;
+        }
+        strip[y * READOUT_WIDTH + x + gx] = panelOrder565(blend565(COLOUR_WHITE, COLOUR_BLACK, alpha));
+        if (!inRun) writes++;
+        inRun = true;
+      }
+    }
+    x += width;
+  }
+  return writes;
+}
+
+// Function to time a draw over all readings (ns per update)
+template <typename Draw>
+static double timeNs(Draw draw) {
+  uint32_t check = 0;
+  auto start = Clock::now();
+  for (uint32_t i = 0; i < ITERATIONS; i++) {
+    draw(readings[i % READING_COUNT]);
+    check += strip[(i * 37) % (READOUT_WIDTH * READOUT_HEIGHT)];
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+  sink = check;
+  return ns;
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  double buildUs = buildAtlas();
+  printf("atlas      %8.1f us once at start-up, %zu bytes\n", buildUs, sizeof(ReadoutAtlas));
+
+  double composeNs = timeNs([](const char* text) { atlas.compose(text, strip, READOUT_WIDTH); });
+  uint32_t writes = 0;
+  for (const char* text : readings) writes += drawPerPixel(text);
+  double perPixelNs = timeNs([](const char* text) { drawPerPixel(text); });
+  printf("compose    %8.1f ns per update, 1 panel write\n", composeNs);
+  printf("per-pixel  %8.1f ns per update, %u panel writes on average (%.1fx the time)\n", perPixelNs,
+         (unsigned)(writes / READING_COUNT), perPixelNs / composeNs);
+
+  // Eight more glyphs in front: wholly outside the strip
+  static char wide[READING_COUNT][32];
+  for (size_t i = 0; i < READING_COUNT; i++) snprintf(wide[i], sizeof(wide[i]), "88888888%s", readings[i]);
+  double clippedNs = timeNs([](const char* text) {
+    for (size_t i = 0; i < READING_COUNT; i++) {
+      if (readings[i] == text) atlas.compose(wide[i], strip, READOUT_WIDTH);
+    }
+  });
+  printf("clipped    %8.1f ns per update (text wider than the strip)\n", clippedNs);
+  return 0;
+}
@@ -0,0 +1,199 @@
+/*********************************************************************************************************
+ * Metrics Scrape Benchmark
+ *
+ * Description:
+ *   Cost of serving /metrics: copying the snapshot, rendering the device's metric set into the exposition
+ *   buffer, and the loop-side cost of publishing a snapshot after every reading. Also reports how much of
+ *   METRICS_BUFFER_SIZE a scrape uses.
+ *
+ * How It Works:
+ *   1. Publish: The loop's side, filling the idle copy and publishing it (once per reading)
+ *   2. Scrape: The web server's side, reading the snapshot and rendering it with MetricsWriter, against
+ *      the same text built with snprintf
+ *
+ * Notes:
+ *   - The metric set mirrors renderMetrics() in src/main.cpp with Modbus and MQTT enabled
+ *   - Build: g++ -O2 -std=c++17 -o metrics_scrape_bench metrics_scrape_bench.cpp
+ *   - Usage: metrics_scrape_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "../../include/metrics_exporter.h"
+
+#define METRICS_BUFFER_SIZE 4096    // as in src/main.cpp
+#define ITERATIONS 200000
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint32_t renderBucketsUs[] = { 1000, 2000, 5000, 10000, 20000, 50000, 100000 };
+
+struct DeviceMetrics {
+  DeviceMetrics() : renderTime(renderBucketsUs) {}
+
+  uint32_t samples = 0;
+  uint32_t timeouts = 0;
+  uint32_t echoGlitches = 0;
+  uint32_t renderDeadlineMisses = 0;
+  LatencyHistogram<7> renderTime;
+  int32_t distanceMm = 0;
+  uint8_t flags = 0;
+  uint8_t confidence = 0;
+  uint32_t pingIntervalUs = 0;
+  bool present = false;
+  uint8_t streamViewers = 0;
+  uint32_t streamSkippedBatches = 0;
+  uint32_t modbusCrcErrors = 0;
+  uint32_t mqttDroppedSamples = 0;
+  uint32_t mqttBufferedSamples = 0;
+};
+
+static MetricsSnapshot<DeviceMetrics> snapshot;
+static char buffer[METRICS_BUFFER_SIZE];
+static volatile uint32_t sink;      // keeps the timed work from being optimised away
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to render the device's metric set (as renderMetrics() in src/main.cpp)
+static size_t render(const DeviceMetrics& m) {
+  MetricsWriter out(buffer, METRICS_BUFFER_SIZE);
+  out.counter("distance_sensor_samples_total", "Measurements completed", m.samples);
+  out.counter("distance_sensor_timeouts_total", "Measurements without an echo", m.timeouts);
+  out.counter("distance_sensor_echo_glitches_total", "Rejected echo glitches", m.echoGlitches);
+  out.counter("distance_sensor_render_deadline_misses_total", "Display updates over budget", m.renderDeadlineMisses);
+  out.histogramSeconds("distance_sensor_render_seconds", "Display update time (draw and push)", m.renderTime);
+  out.family("distance_sensor_distance_meters", "gauge", "Latest distance");
+  out.scaledSample("distance_sensor_distance_meters", m.distanceMm, 3);
+  out.gauge("distance_sensor_flags", "Quality flags of the latest reading", m.flags);
+  out.gauge("distance_sensor_confidence", "Confidence of the latest reading (0-255)", m.confidence);
+  out.family("distance_sensor_ping_interval_seconds", "gauge", "Current re-trigger interval");
+  out.scaledSample("distance_sensor_ping_interval_seconds", m.pingIntervalUs, 6);
+  out.gauge("distance_sensor_presence", "1 while presence is detected", m.present ? 1 : 0);
+  out.gauge("distance_sensor_stream_viewers", "Live-stream viewers connected", m.streamViewers);
+  out.counter("distance_sensor_stream_skipped_batches_total", "Live-stream batches skipped for slow viewers",
+              m.streamSkippedBatches);
+  out.counter("distance_sensor_modbus_crc_errors_total", "Modbus frames dropped (CRC / length)", m.modbusCrcErrors);
+  out.counter("distance_sensor_mqtt_dropped_samples_total", "Samples lost to a full MQTT buffer",
+              m.mqttDroppedSamples);
+  out.gauge("distance_sensor_mqtt_buffered_samples", "Samples waiting to be published", m.mqttBufferedSamples);
+  out.gauge("esp_free_heap_bytes", "Free heap", 181234);
+  out.gauge("esp_min_free_heap_bytes", "Lowest free heap since boot", 150321);
+  out.gauge("esp_uptime_seconds", "Time since boot", 864000);
+  return out.overflowed() ? 0 : out.length();
+}
+
+// Function to render the same text with snprintf (for comparison)
+static size_t renderPrintf(const DeviceMetrics& m) {
+  size_t n = 0;
+#define LINE(...) n += snprintf(buffer + n, METRICS_BUFFER_SIZE - n, __VA_ARGS__)
+  LINE("# HELP distance_sensor_samples_total Measurements completed\n# TYPE distance_sensor_samples_total counter\n"
+       "distance_sensor_samples_total %" PRIu32 "\n", m.samples);
+  LINE("# HELP distance_sensor_timeouts_total Measurements without an echo\n"
+       "# TYPE distance_sensor_timeouts_total counter\ndistance_sensor_timeouts_total %" PRIu32 "\n", m.timeouts);
+  LINE("# HELP distance_sensor_echo_glitches_total Rejected echo glitches\n"
+       "# TYPE distance_sensor_echo_glitches_total counter\ndistance_sensor_echo_glitches_total %" PRIu32 "\n",
+       m.echoGlitches);
+  LINE("# HELP distance_sensor_render_deadline_misses_total Display updates over budget\n"
+       "# TYPE distance_sensor_render_deadline_misses_total counter\n"
+       "distance_sensor_render_deadline_misses_total %" PRIu32 "\n", m.renderDeadlineMisses);
+  LINE("# HELP distance_sensor_render_seconds Display update time (draw and push)\n"
+       "# TYPE distance_sensor_render_seconds histogram\n");
+  uint64_t cumulative = 0;
+  for (uint8_t i = 0; i <= 7; i++) {
+    cumulative += m.renderTime.bucketCount(i);
+    if (i < 7) LINE("distance_sensor_render_seconds_bucket{le=\"%g\"} %" PRIu64 "\n", renderBucketsUs[i] / 1e6, cumulative);
+    else LINE("distance_sensor_render_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", cumulative);
+  }
+  LINE("distance_sensor_render_seconds_sum %g\ndistance_sensor_render_seconds_count %" PRIu32 "\n",
+       m.renderTime.sum() / 1e6, m.renderTime.count());
+  LINE("# HELP distance_sensor_distance_meters Latest distance\n# TYPE distance_sensor_distance_meters gauge\n"
+       "distance_sensor_distance_meters %g\n", m.distanceMm / 1e3);
+  LINE("# HELP distance_sensor_flags Quality flags of the latest reading\n# TYPE distance_sensor_flags gauge\n"
+       "distance_sensor_flags %u\n", m.flags);
+  LINE("# HELP distance_sensor_confidence Confidence of the latest reading (0-255)\n"
+       "# TYPE distance_sensor_confidence gauge\ndistance_sensor_confidence %u\n", m.confidence);
+  LINE("# HELP distance_sensor_ping_interval_seconds Current re-trigger interval\n"
+       "# TYPE distance_sensor_ping_interval_seconds gauge\ndistance_sensor_ping_interval_seconds %g\n",
+       m.pingIntervalUs / 1e6);
+  LINE("# HELP distance_sensor_presence 1 while presence is detected\n# TYPE distance_sensor_presence gauge\n"
+       "distance_sensor_presence %d\n", m.present ? 1 : 0);
+  LINE("# HELP distance_sensor_stream_viewers Live-stream viewers connected\n"
+       "# TYPE distance_sensor_stream_viewers gauge\ndistance_sensor_stream_viewers %u\n", m.streamViewers);
+  LINE("# HELP distance_sensor_stream_skipped_batches_total Live-stream batches skipped for slow viewers\n"
+       "# TYPE distance_sensor_stream_skipped_batches_total counter\n"
+       "distance_sensor_stream_skipped_batches_total %" PRIu32 "\n", m.streamSkippedBatches);
+  LINE("# HELP distance_sensor_modbus_crc_errors_total Modbus frames dropped (CRC / length)\n"
+       "# TYPE distance_sensor_modbus_crc_errors_total counter\n"
+       "distance_sensor_modbus_crc_errors_total %" PRIu32 "\n", m.modbusCrcErrors);
+  LINE("# HELP distance_sensor_mqtt_dropped_samples_total Samples lost to a full MQTT buffer\n"
+       "# TYPE distance_sensor_mqtt_dropped_samples_total counter\n"
+       "distance_sensor_mqtt_dropped_samples_total %" PRIu32 "\n", m.mqttDroppedSamples);
+  LINE("# HELP distance_sensor_mqtt_buffered_samples Samples waiting to be published\n"
+       "# TYPE distance_sensor_mqtt_buffered_samples gauge\ndistance_sensor_mqtt_buffered_samples %" PRIu32 "\n",
+       m.mqttBufferedSamples);
+  LINE("# HELP esp_free_heap_bytes Free heap\n# TYPE esp_free_heap_bytes gauge\nesp_free_heap_bytes %d\n", 181234);
+  LINE("# HELP esp_min_free_heap_bytes Lowest free heap since boot\n# TYPE esp_min_free_heap_bytes gauge\n"
+       "esp_min_free_heap_bytes %d\n", 150321);
+  LINE("# HELP esp_uptime_seconds Time since boot\n# TYPE esp_uptime_seconds gauge\nesp_uptime_seconds %d\n", 864000);
+#undef LINE
+  return n;
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  // Loop side: one publish per reading
+  uint32_t seed = 1;
+  auto start = Clock::now();
+  for (uint32_t i = 0; i < ITERATIONS; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    DeviceMetrics& m = snapshot.edit();
+    m.samples = i;
+    m.timeouts = i / 50;
+    m.distanceMm = 500 + (int32_t)(seed >> 20);
+    m.pingIntervalUs = 10000 + (seed >> 16) % 50000;
+    m.renderTime.observe((seed >> 8) % 60000);
+    snapshot.publish();
+  }
+  double publishNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+
+  // Web server side: read the snapshot and render it
+  DeviceMetrics m;
+  size_t bytes = 0;
+  start = Clock::now();
+  for (uint32_t i = 0; i < ITERATIONS; i++) {
+    snapshot.read(m);
+    bytes = render(m);
+    sink = buffer[bytes / 2];
+  }
+  double scrapeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+
+  size_t printfBytes = 0;
+  start = Clock::now();
+  for (uint32_t i = 0; i < ITERATIONS; i++) {
+    snapshot.read(m);
+    printfBytes = renderPrintf(m);
+    sink = buffer[printfBytes / 2];
+  }
+  double printfNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+
+  printf("snapshot   %zu bytes per copy\n", sizeof(DeviceMetrics));
+  printf("publish    %8.1f ns per reading (loop task)\n", publishNs);
+  printf("scrape     %8.1f ns, %zu of %d bytes (%.0f%% of the buffer)\n", scrapeNs, bytes, METRICS_BUFFER_SIZE,
+         100.0 * bytes / METRICS_BUFFER_SIZE);
+  printf("snprintf   %8.1f ns, %zu bytes (%.1fx)\n", printfNs, printfBytes, printfNs / scrapeNs);
+  return bytes > 0 ? 0 : 1;
+}
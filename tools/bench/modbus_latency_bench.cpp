@@ -0,0 +1,122 @@
+/*********************************************************************************************************
+ * Modbus RTU Latency Benchmark
+ *
+ * Description:
+ *   Time from the last request byte on the wire to the last response byte, split into the parts the
+ *   device controls and the parts the line imposes, for the requests a PLC typically polls.
+ *
+ * How It Works:
+ *   1. Processing: CRC check, snapshot copy and response build (what onModbusReceive does after the
+ *      bytes are read), timed on the host over many requests
+ *   2. Line: The receive timeout that ends the frame (MODBUS_RX_TIMEOUT_SYMBOLS characters) and the
+ *      response transmit time, at 11 bits per character as the standard counts them, for common baud rates
+ *   3. Report: Per request and baud rate, the total and the share spent processing
+ *
+ * Notes:
+ *   - Host processing time is a lower bound for the ESP32-S3 (scale by roughly 10-20x); it stays far
+ *     below the character times either way
+ *   - Build: g++ -O2 -std=c++17 -o modbus_latency_bench modbus_latency_bench.cpp
+ *   - Usage: modbus_latency_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+
+#include "../../include/modbus_rtu.h"
+
+#define MODBUS_RX_TIMEOUT_SYMBOLS 4 // as in src/main.cpp
+#define BITS_PER_CHAR 11
+#define ITERATIONS 1000000
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint16_t holdingMax[MODBUS_HOLDING_REGS] = { 1, 1024, 4 };
+static const uint32_t bauds[] = { 9600, 19200, 38400, 115200 };
+static volatile uint32_t sink;      // keeps the timed work from being optimised away
+
+struct Request {
+  const char* name;
+  uint8_t function;
+  uint16_t a;
+  uint16_t b;
+};
+
+static const Request requests[] = {
+  { "read 1 input", 0x04, 0, 1 },
+  { "read 20 inputs", 0x04, 0, MODBUS_INPUT_REGS },
+  { "read 3 holding", 0x03, 0, MODBUS_HOLDING_REGS },
+  { "write holding", 0x06, 2, 1 },
+};
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to build a request frame with its CRC
+static void buildRequest(const Request& r, uint8_t* frame) {
+  frame[0] = 1;
+  frame[1] = r.function;
+  frame[2] = r.a >> 8;
+  frame[3] = r.a & 0xFF;
+  frame[4] = r.b >> 8;
+  frame[5] = r.b & 0xFF;
+  uint16_t crc = modbusCrc16(frame, 6);
+  frame[6] = crc & 0xFF;
+  frame[7] = crc >> 8;
+}
+
+// Function to time the receive handler's work for one request (ns), returning the response length
+static double processNs(const Request& r, uint16_t& responseLength) {
+  ModbusRtuSlave slave(1, holdingMax);
+  ModbusSnapshot snapshot;
+  for (uint16_t i = 0; i < MODBUS_INPUT_REGS; i++) snapshot.edit().input[i] = i * 37;
+  snapshot.publish();
+
+  uint8_t frame[8], response[MODBUS_FRAME_MAX];
+  buildRequest(r, frame);
+  uint32_t check = 0;
+  auto start = Clock::now();
+  for (uint32_t i = 0; i < ITERATIONS; i++) {
+    for (uint8_t b = 0; b < 8; b++) slave.feed(frame[b]);
+    ModbusRegisters registers;
+    snapshot.read(registers);
+    responseLength = slave.process(registers, response);
+    check += response[responseLength - 1];
+    ModbusWrite write;
+    while (slave.takeWrite(write)) check += write.value;
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS;
+  sink = check;
+  return ns;
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  printf("%-16s %9s %6s", "request", "process", "bytes");
+  for (uint32_t baud : bauds) printf("  %13u", baud);
+  printf("\n");
+
+  for (const Request& r : requests) {
+    uint16_t responseLength = 0;
+    double ns = processNs(r, responseLength);
+    printf("%-16s %7.0fns %6u", r.name, ns, responseLength);
+    for (uint32_t baud : bauds) {
+      double charUs = BITS_PER_CHAR * 1e6 / baud;
+      double totalUs = MODBUS_RX_TIMEOUT_SYMBOLS * charUs + ns / 1000 + responseLength * charUs;
+      printf("  %6.2fms %5.3f%%", totalUs / 1000, 100 * ns / 1000 / totalUs);
+    }
+    printf("\n");
+  }
+  printf("(total = receive timeout + processing + response on the wire)\n");
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*********************************************************************************************************
+ * Oversampler Throughput Benchmark
+ *
+ * Description:
+ *   The trade-off of high-resolution mode: more pings per estimate resolve finer, but each estimate
+ *   takes longer. For each ping count this measures the resolution on the ultrasonic simulator (RMS error
+ *   of the mean, with and without dither), the estimate period on the device at two ranges, and the host
+ *   cost of the accumulate and decimate steps.
+ *
+ * How It Works:
+ *   1. Resolution: 2000 static targets between 0.5m and 1.5m per ping count, trigger phase dithered
+ *   2. Period: Pings are spaced as the adaptive re-trigger scheduler spaces them (src/main.cpp settings)
+ *   3. Cost: addEcho() and estimate() timed on the host with std::chrono
+ *
+ * Notes:
+ *   - Build: g++ -O2 -std=c++17 -o oversampler_bench oversampler_bench.cpp
+ *   - Usage: oversampler_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "../../include/oversampler.h"
+#include "../../include/retrigger_scheduler.h"
+#include "ultrasonic_sim.h"
+
+#define TRIALS 2000                 // static targets per ping count
+
+static const RetriggerConfig retriggerConfig = { 5000, 60000, 8000, 100 };
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// RMS error (mm) of the mean of N pings
+float resolutionMm(uint16_t pings, bool dither) {
+  UltrasonicSim sim(SIM_HC_SR04);
+  double sumSq = 0;
+  uint64_t now = 0;
+  for (int t = 0; t < TRIALS; t++) {
+    sim.setDistance(500 + sim.uniform() * 1000);
+    now += 1000000 + (uint64_t)(sim.uniform() * 1000000);        // random phase, time keeps running
+    Oversampler o;
+    o.begin(pings);
+    while (!o.addEcho(sim.ping(now, dither ? randomTriggerDelayUs(sim.random()) : 0))) now += 35000;
+    double error = (o.estimate().meanEchoQ8 / 256.0 - sim.trueEchoUs()) * SIM_MM_PER_US;
+    sumSq += error * error;
+  }
+  return (float)sqrt(sumSq / TRIALS);
+}
+
+// Time (ms) for one estimate of a target at distanceMm, pings spaced by the re-trigger scheduler
+float estimatePeriodMs(uint16_t pings, float distanceMm) {
+  RetriggerScheduler retrigger(retriggerConfig);
+  retrigger.onMeasurement(0, (uint32_t)(distanceMm / SIM_MM_PER_US));
+  return pings * (retrigger.intervalUs() + OVERSAMPLE_DITHER_US / 2.0f) / 1000.0f;
+}
+
+// Host nanoseconds per ping (accumulate, plus the decimate step shared by the N pings)
+float hostNsPerPing(uint16_t pings) {
+  const int rounds = 20000;
+  volatile uint32_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    Oversampler o;
+    o.begin(pings);
+    for (uint32_t i = 0; !o.addEcho(5800 + ((i * 7 + r) & 31)); i++) {}
+    sink = sink + o.estimate().ci95EchoQ8;
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+  return (float)(elapsed.count() / rounds / pings);
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  printf("pings  rms no dither  rms dithered  period @1m  period @3m  host ns/ping\n");
+  for (uint16_t pings = 4; pings <= OVERSAMPLE_MAX_PINGS; pings *= 2) {
+    printf("%5u  %10.3f mm  %9.3f mm  %7.0f ms  %7.0f ms  %11.1f\n", pings, resolutionMm(pings, false),
+           resolutionMm(pings, true), estimatePeriodMs(pings, 1000), estimatePeriodMs(pings, 3000),
+           hostNsPerPing(pings));
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+/*********************************************************************************************************
+ * Predictor Simulation
+ *
+ * Description:
+ *   Measures how far the displayed distance is from the true position of a moving target, with and
+ *   without the latency-compensating predictor. The target moves on the ultrasonic simulator, pings are
+ *   spaced by the re-trigger scheduler and the readout is drawn every update interval, as on the device.
+ *
+ * How It Works:
+ *   1. Pipeline: sim ping -> calibration-free mm -> SampleClassifier -> MotionEstimator (decimated to
+ *      one sample per MOTION_MIN_SPACING_MS) -> predictDistance() at each readout
+ *   2. Readout: Every UPDATE_MS the newest sample is shown; it stays on screen for one interval, so the
+ *      error is taken against the true position half an interval after the draw
+ *   3. Profiles: Steady travel, a swinging load and a stop-and-go lift (accelerations and stops are
+ *      where extrapolation overshoots)
+ *
+ * Notes:
+ *   - Settings mirror src/main.cpp (4Hz readout, adaptive re-trigger)
+ *   - Build: g++ -O2 -std=c++17 -o predictor_sim predictor_sim.cpp
+ *   - Usage: predictor_sim
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "../../include/calibration.h"
+#include "../../include/predictor.h"
+#include "../../include/retrigger_scheduler.h"
+#include "ultrasonic_sim.h"
+
+#define UPDATE_MS 250               // readout interval
+#define MOTION_MIN_SPACING_MS 50    // motion estimator decimation
+#define RUN_MS 120000               // simulated time per profile
+#define MOTION_REJECT_FLAGS (SAMPLE_NO_DISTANCE | SAMPLE_OUTLIER | SAMPLE_BLANKED) // as in src/main.cpp
+
+static const RetriggerConfig retriggerConfig = { 5000, 60000, 8000, 100 };
+
+typedef double (*Profile)(double seconds);
+
+// 400mm/s between 3m and 0.6m, turning round every 6s
+static double steadyTravel(double s) {
+  double p = fmod(s, 12.0);
+  return p < 6 ? 3000 - 400 * p : 600 + 400 * (p - 6);
+}
+
+// Load swinging between 1m and 2m, 6s period
+static double swingingLoad(double s) { return 1500 - 500 * cos(6.2831853 * s / 6); }
+
+// Lift: 2s stopped, 1s accelerate, 2s at 600mm/s, 1s decelerate (between 0.5m and 3.5m)
+static double stopAndGo(double s) {
+  double phase = fmod(s, 12.0), direction = phase < 6 ? 1 : -1, p = fmod(phase, 6.0);
+  double travelled;
+  if (p < 2) travelled = 0;
+  else if (p < 3) travelled = 300 * (p - 2) * (p - 2);
+  else if (p < 5) travelled = 300 + 600 * (p - 3);
+  else travelled = 1500 + 600 * (p - 5) - 300 * (p - 5) * (p - 5);
+  return direction > 0 ? 500 + 2 * travelled : 3500 - 2 * travelled;
+}
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+struct Errors {
+  std::vector<double> raw;
+  std::vector<double> predicted;
+};
+
+// Function to run one profile through the acquisition and display pipeline
+static Errors run(Profile profile) {
+  UltrasonicSim sim(SIM_HC_SR04);
+  SampleClassifier classifier;
+  MotionEstimator motion;
+  RetriggerScheduler retrigger(retriggerConfig);
+  Sample latest = { 0, 0, 0, SAMPLE_TIMEOUT, 0 };
+  Errors errors;
+  uint32_t lastMotionMs = 0, nextDrawMs = 2000;
+
+  for (uint64_t nowUs = 0; nowUs < (uint64_t)RUN_MS * 1000; nowUs += 100) {
+    uint32_t nowMs = (uint32_t)(nowUs / 1000);
+    if (retrigger.ready((uint32_t)nowUs)) {
+      sim.setDistance((float)profile(nowUs / 1e6));
+      uint32_t echo = sim.ping(nowUs);
+      retrigger.onMeasurement((uint32_t)nowUs, echo);
+      latest = classifier.classify(nowMs, echo, echoToRawMm(echo));
+      if (latest.accepts(MOTION_REJECT_FLAGS) &&
+          (!motion.current().valid || nowMs - lastMotionMs >= MOTION_MIN_SPACING_MS)) {
+        motion.update(nowMs, latest.distanceMm);
+        lastMotionMs = nowMs;
+      }
+    }
+    if (nowMs < nextDrawMs) continue;
+
+    nextDrawMs += UPDATE_MS;
+    uint32_t renderMs = nowMs + UPDATE_MS / 2;
+    double truth = profile(renderMs / 1000.0);
+    bool predicted;
+    int32_t shown = predictDistance(latest, motion.current(), renderMs, predicted);
+    errors.raw.push_back(fabs(latest.distanceMm - truth));
+    errors.predicted.push_back(fabs(shown - truth));
+  }
+  return errors;
+}
+
+// Function to average the errors
+static double mean(const std::vector<double>& values) {
+  double sum = 0;
+  for (double v : values) sum += v;
+  return sum / values.size();
+}
+
+// Function to pick the p-quantile of the errors
+static double percentile(std::vector<double> values, double p) {
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  const struct { const char* name; Profile profile; } profiles[] = {
+    { "steady travel", steadyTravel }, { "swinging load", swingingLoad }, { "stop and go", stopAndGo }
+  };
+
+  printf("profile            raw mean  raw p95  predicted mean  predicted p95  reduction\n");
+  for (const auto& p : profiles) {
+    Errors e = run(p.profile);
+    printf("%-17s  %5.1f mm  %4.0f mm  %11.1f mm  %10.0f mm  %8.0f%%\n", p.name, mean(e.raw),
+           percentile(e.raw, 0.95), mean(e.predicted), percentile(e.predicted, 0.95),
+           100 * (1 - mean(e.predicted) / mean(e.raw)));
+  }
+  return 0;
+}
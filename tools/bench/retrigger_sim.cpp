@@ -0,0 +1,91 @@
+/*********************************************************************************************************
+ * Re-Trigger Scheduler Simulation
+ *
+ * Description:
+ *   Sample rate against ghost echoes for ping spacing policies, on the ultrasonic simulator with
+ *   multipath and a reverberant tail. A policy is only useful if it pings fast at short range without
+ *   hearing the previous burst.
+ *
+ * How It Works:
+ *   1. Policies: Fixed 60ms (datasheet cycle), fixed 5ms (as fast as the scheduler allows), and the
+ *      adaptive scheduler with the device settings (src/main.cpp) and with half the proportional
+ *      allowance, which lets the second bounce of far targets into the next ping
+ *   2. Targets: Static targets from 0.2m to 3.8m, 20 simulated seconds each
+ *   3. Report: Pings per second and the share of pings that returned a ghost
+ *
+ * Notes:
+ *   - Multipath: the second bounce off the sensor face arrives at twice the echo time
+ *   - Build: g++ -O2 -std=c++17 -o retrigger_sim retrigger_sim.cpp
+ *   - Usage: retrigger_sim
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <stdio.h>
+
+#include "../../include/retrigger_scheduler.h"
+#include "ultrasonic_sim.h"
+
+#define RUN_US 20000000             // simulated time per target
+#define STEP_US 50                  // loop pass spacing
+
+static const UltrasonicSimConfig roomConfig = { 2.0f, 17.5f, 0.0f, 1500.0f, 30.0f, 5 };
+static const float distancesMm[] = { 200, 500, 1000, 2000, 3000, 3800 };
+
+struct Policy {
+  const char* name;
+  RetriggerConfig config;
+};
+
+static const Policy policies[] = {
+  { "fixed 60ms", { 60000, 60000, 0, 0 } },
+  { "fixed 5ms", { 5000, 5000, 0, 0 } },
+  { "adaptive +50% +8ms", { 5000, 60000, 8000, 50 } },
+  { "adaptive (device)", { 5000, 60000, 8000, 100 } },
+};
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to run one policy against one static target
+static void run(const RetriggerConfig& config, float distanceMm, float& pingsPerSecond, float& ghostPercent) {
+  UltrasonicSim sim(roomConfig);
+  RetriggerScheduler retrigger(config);
+  sim.setDistance(distanceMm);
+  uint32_t pings = 0, ghosts = 0;
+  for (uint64_t nowUs = 0; nowUs < RUN_US; nowUs += STEP_US) {
+    if (!retrigger.ready((uint32_t)nowUs)) continue;
+    uint32_t echo = sim.ping(nowUs);
+    retrigger.onMeasurement((uint32_t)nowUs, echo);
+    pings++;
+    if (sim.lastWasGhost()) ghosts++;
+  }
+  pingsPerSecond = pings * 1e6f / RUN_US;
+  ghostPercent = 100.0f * ghosts / pings;
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  printf("%-21s", "pings/s  ghosts");
+  for (float mm : distancesMm) printf("  %12.1fm", mm / 1000);
+  printf("\n");
+  for (const Policy& policy : policies) {
+    printf("%-21s", policy.name);
+    for (float mm : distancesMm) {
+      float rate, ghosts;
+      run(policy.config, mm, rate, ghosts);
+      printf("  %5.0f %5.1f%%", rate, ghosts);
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+/*********************************************************************************************************
+ * Sample Codec Benchmark
+ *
+ * Description:
+ *   Size and speed of the delta-of-delta sample codec (sample_codec.h) on the streams the device and the
+ *   ingest host actually see, against the 6-byte S1 batch record.
+ *
+ * How It Works:
+ *   1. Traces: Four sample streams of TRACE_SAMPLES each
+ *        regular 50Hz      fixed 20ms timing, a slowly drifting level
+ *        device retrigger  the simulated sensor pinged by the adaptive RetriggerScheduler and classified
+ *                          by SampleClassifier as the firmware does (timeouts, ghosts, a passing target)
+ *        MQTT 10Hz         100ms timing with ±2ms loop jitter and 0.5% timeouts
+ *        random fields     every field random (the codec's worst case)
+ *   2. Codec: Encode and decode each trace into one stream, checking the round trip, timed over several
+ *      passes (MB/s of 8-byte SampleRecords)
+ *   3. Batches: The device trace through BatchPublisher as S1 and as S2 payloads, headers included
+ *
+ * Notes:
+ *   - Build: g++ -O2 -std=c++17 -o sample_codec_bench sample_codec_bench.cpp
+ *   - Usage: sample_codec_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "../../include/batch_publisher.h"
+#include "../../include/calibration.h"
+#include "../../include/retrigger_scheduler.h"
+#include "../../include/sample.h"
+#include "ultrasonic_sim.h"
+
+// As in src/main.cpp
+#define RETRIGGER_MIN_US 5000
+#define RETRIGGER_MAX_US 60000
+#define RETRIGGER_DECAY_MARGIN_US 8000
+#define RETRIGGER_DECAY_PERCENT 100
+
+#define TRACE_SAMPLES 200000
+#define PASSES 10
+#define STEP_US 50                  // loop pass spacing of the device trace
+
+typedef std::chrono::steady_clock Clock;
+
+static const UltrasonicSimConfig roomConfig = { 2.0f, 17.5f, 1.0f, 1500.0f, 30.0f, 11 };
+static volatile uint32_t sink;      // keeps the timed work from being optimised away
+
+// Collects drained batch payloads
+struct PayloadSink {
+  uint64_t bytes = 0;
+  uint32_t batches = 0;
+  bool publish(const uint8_t*, size_t length) {
+    bytes += length;
+    batches++;
+    return true;
+  }
+};
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to build the regular 50Hz trace
+static std::vector<SampleRecord> regularTrace() {
+  std::vector<SampleRecord> trace(TRACE_SAMPLES);
+  for (uint32_t i = 0; i < TRACE_SAMPLES; i++) {
+    uint16_t mm = (uint16_t)(1500 + 200 * sin(i / 3000.0));
+    trace[i] = { i * 20, mm, SAMPLE_OK, 255 };
+  }
+  return trace;
+}
+
+// Function to build the device trace: simulated pings at the adaptive re-trigger rate, classified
+static std::vector<SampleRecord> deviceTrace() {
+  const RetriggerConfig config = { RETRIGGER_MIN_US, RETRIGGER_MAX_US, RETRIGGER_DECAY_MARGIN_US,
+                                   RETRIGGER_DECAY_PERCENT };
+  UltrasonicSim sim(roomConfig);
+  RetriggerScheduler retrigger(config);
+  SampleClassifier classifier;
+  std::vector<SampleRecord> trace;
+  trace.reserve(TRACE_SAMPLES);
+  for (uint64_t nowUs = 0; trace.size() < TRACE_SAMPLES; nowUs += STEP_US) {
+    if (!retrigger.ready((uint32_t)nowUs)) continue;
+
+    // A wall at 2.5m, and every 20s someone walking up to 600mm and away again
+    double cycle = fmod(nowUs / 1e6, 20.0);
+    sim.setDistance(cycle < 6.0 ? (float)(2500 - 1900 * sin(cycle * M_PI / 6.0)) : 2500.0f);
+    uint32_t echo = sim.ping(nowUs);
+    retrigger.onMeasurement((uint32_t)nowUs, echo);
+
+    Sample sample = classifier.classify((uint32_t)(nowUs / 1000), echo, echo > 0 ? echoToRawMm(echo) : 0);
+    trace.push_back({ sample.timestampMs, (uint16_t)sample.distanceMm, sample.flags, sample.confidence });
+  }
+  return trace;
+}
+
+// Function to build the 10Hz MQTT trace
+static std::vector<SampleRecord> mqttTrace() {
+  std::vector<SampleRecord> trace(TRACE_SAMPLES);
+  uint32_t seed = 3, t = 0;
+  for (uint32_t i = 0; i < TRACE_SAMPLES; i++) {
+    seed = seed * 1103515245u + 12345u;
+    t += 98 + (seed >> 16) % 5;
+    bool timeout = (seed >> 8) % 200 == 0;
+    uint16_t mm = (uint16_t)(900 + 150 * sin(i / 500.0) + (int)((seed >> 20) % 7) - 3);
+    trace[i] = { t, timeout ? (uint16_t)0 : mm, (uint8_t)(timeout ? SAMPLE_TIMEOUT : SAMPLE_OK),
+                 timeout ? (uint8_t)0 : (uint8_t)(220 + (seed >> 24) % 4) };
+  }
+  return trace;
+}
+
+// Function to build the all-random trace
+static std::vector<SampleRecord> randomTrace() {
+  std::vector<SampleRecord> trace(TRACE_SAMPLES);
+  uint32_t seed = 7;
+  for (uint32_t i = 0; i < TRACE_SAMPLES; i++) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t t = seed;
+    seed = seed * 1103515245u + 12345u;
+    trace[i] = { t, (uint16_t)(seed >> 16), (uint8_t)(seed >> 8), (uint8_t)seed };
+  }
+  return trace;
+}
+
+// Function to encode and decode a trace, printing size and throughput
+static void measure(const char* name, const std::vector<SampleRecord>& trace) {
+  std::vector<uint8_t> stream(trace.size() * 10 + 16);
+  size_t length = 0;
+  auto start = Clock::now();
+  for (int pass = 0; pass < PASSES; pass++) {
+    SampleEncoder encoder(stream.data(), stream.size());
+    for (const SampleRecord& record : trace) encoder.append(record);
+    length = encoder.finish();
+  }
+  double encodeS = std::chrono::duration<double>(Clock::now() - start).count() / PASSES;
+
+  uint32_t mismatches = 0;
+  start = Clock::now();
+  for (int pass = 0; pass < PASSES; pass++) {
+    SampleDecoder decoder(stream.data(), length, (uint32_t)trace.size());
+    SampleRecord record;
+    uint32_t i = 0, check = 0;
+    while (decoder.next(record)) {
+      check += record.distanceMm;
+      if (pass == 0 && (record.timestampMs != trace[i].timestampMs || record.distanceMm != trace[i].distanceMm ||
+                        record.flags != trace[i].flags || record.confidence != trace[i].confidence)) {
+        mismatches++;
+      }
+      i++;
+    }
+    if (i != trace.size()) mismatches++;
+    sink = check;
+  }
+  double decodeS = std::chrono::duration<double>(Clock::now() - start).count() / PASSES;
+
+  double rawMb = trace.size() * sizeof(SampleRecord) / 1e6;
+  double bytesPerSample = (double)length / trace.size();
+  printf("%-17s %5.2f B/sample %5.1fx vs S1  enc %5.0f  dec %5.0f MB/s  %s\n", name, bytesPerSample,
+         BATCH_RECORD_BYTES / bytesPerSample, rawMb / encodeS, rawMb / decodeS,
+         mismatches == 0 ? "round-trip exact" : "ROUND-TRIP MISMATCH");
+}
+
+// Function to push a trace through a BatchPublisher, returns payload bytes per sample
+static double batchBytes(const std::vector<SampleRecord>& trace, bool compressed) {
+  BatchPublisher<1024> publisher(compressed);
+  PayloadSink out;
+  for (const SampleRecord& record : trace) {
+    if (publisher.pending() >= BATCH_MAX_SAMPLES) publisher.drain(out, 1);
+    publisher.push(record);
+  }
+  while (publisher.pending() > 0) publisher.drain(out, 1);
+  return (double)out.bytes / trace.size();
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  std::vector<SampleRecord> device = deviceTrace();
+  measure("regular 50Hz", regularTrace());
+  measure("device retrigger", device);
+  measure("MQTT 10Hz", mqttTrace());
+  measure("random fields", randomTrace());
+
+  double s1 = batchBytes(device, false), s2 = batchBytes(device, true);
+  printf("BatchPublisher (device trace): S1 %.2f vs S2 %.2f bytes/sample with headers (%.1fx)\n", s1, s2, s1 / s2);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*********************************************************************************************************
+ * Trend Pyramid Benchmark
+ *
+ * Description:
+ *   Per-sample update cost of the trend pyramid with the device's levels (1s, 10s, 1min, 10min by 160
+ *   columns), and the cost of reading one view against summarising raw history for every redraw.
+ *
+ * How It Works:
+ *   1. Update: 24 simulated hours at 200Hz (the fastest adaptive ping rate) through add(), reporting the
+ *      mean cost and the worst single add (a slot closing at every level)
+ *   2. Render: Reading 160 buckets of a level against min/max over the raw samples of each column
+ *
+ * Notes:
+ *   - Build: g++ -O2 -std=c++17 -o trend_pyramid_bench trend_pyramid_bench.cpp
+ *   - Usage: trend_pyramid_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+#include "../../include/trend_pyramid.h"
+
+#define TREND_LEVELS 4              // as in src/main.cpp
+#define TREND_COLUMNS 160
+#define RATE_HZ 200
+#define HOURS 24
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint32_t trendDurationsMs[TREND_LEVELS] = { 1000, 10000, 60000, 600000 };
+static const char* const trendLabels[TREND_LEVELS] = { "1s", "10s", "1min", "10min" };
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  const uint32_t samples = RATE_HZ * 3600u * HOURS;
+  const uint32_t stepUs = 1000000 / RATE_HZ;
+  std::vector<int32_t> values(samples);
+  uint32_t seed = 1;
+  int32_t v = 2000;
+  for (uint32_t i = 0; i < samples; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    v += (int32_t)((seed >> 8) % 41) - 20;
+    values[i] = v;
+  }
+
+  // Update cost
+  static TrendPyramid<TREND_LEVELS, TREND_COLUMNS> pyramid(trendDurationsMs);
+  double worstNs = 0;
+  auto start = Clock::now();
+  for (uint32_t i = 0; i < samples; i++) {
+    uint32_t t = (uint32_t)((uint64_t)i * stepUs / 1000);
+    if (i % 200000 == 0 || t % 600000 == 0) {
+      // Time a sample on its own now and then, and every 10min slot boundary (the full cascade)
+      auto one = Clock::now();
+      pyramid.add(t, values[i]);
+      double ns = std::chrono::duration<double, std::nano>(Clock::now() - one).count();
+      if (ns > worstNs) worstNs = ns;
+    }
+    else {
+      pyramid.add(t, values[i]);
+    }
+  }
+  double addNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+  printf("%u samples (%d h at %d Hz)\n", samples, HOURS, RATE_HZ);
+  printf("add        %8.1f ns mean, %.0f ns worst timed (cascade through all levels)\n", addNs, worstNs);
+
+  // Render cost: one view from buckets against min/max of the raw samples per column
+  uint32_t endMs = (uint32_t)((uint64_t)samples * stepUs / 1000);
+  for (uint8_t level = 0; level < TREND_LEVELS; level++) {
+    int64_t check = 0;
+    auto from = Clock::now();
+    for (uint16_t col = 0; col < pyramid.available(level) && col < TREND_COLUMNS; col++) {
+      const TrendBucket& b = pyramid.bucket(level, col);
+      check += b.min + b.max + b.mean();
+    }
+    double bucketNs = std::chrono::duration<double, std::nano>(Clock::now() - from).count();
+
+    from = Clock::now();
+    uint32_t perColumn = trendDurationsMs[level] * RATE_HZ / 1000;
+    for (uint16_t col = 0; col < TREND_COLUMNS; col++) {
+      uint64_t last = (uint64_t)endMs * RATE_HZ / 1000 - (uint64_t)col * perColumn;
+      if (last < perColumn) break;
+      int32_t lo = values[last - perColumn], hi = lo;
+      int64_t sum = 0;
+      for (uint64_t i = last - perColumn; i < last; i++) {
+        if (values[i] < lo) lo = values[i];
+        if (values[i] > hi) hi = values[i];
+        sum += values[i];
+      }
+      check += lo + hi + sum / perColumn;
+    }
+    double rawNs = std::chrono::duration<double, std::nano>(Clock::now() - from).count();
+    printf("view %-5s buckets %8.0f ns, raw rescan %12.0f ns (%7.0fx)  [%lld]\n", trendLabels[level], bucketNs,
+           rawNs, rawNs / bucketNs, (long long)(check & 0xF));
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*********************************************************************************************************
+ * Ultrasonic Sensor Simulator
+ *
+ * Description:
+ *   Host model of an HC-SR04 style ranger for the tests and benchmark drivers. A ping returns the echo
+ *   time the capture path would measure for the simulated target, including the sensor's timing step,
+ *   jitter, dropped echoes and ghost echoes from the previous burst when pings are spaced too closely.
+ *
+ * How It Works:
+ *   1. Echo: The round trip at 343 m/s (0.1715 mm/µs one way) plus Gaussian jitter
+ *   2. Timing Step: The sensor times the echo edge on a free-running clock of quantUs, so the measured
+ *      time depends on the trigger phase against that clock (what dithering spreads out)
+ *   3. Timeouts: Each ping loses its echo with probability timeoutPercent
+ *   4. Ghosts: A ping fired too soon hears the previous burst before its own echo: the previous echo
+ *      itself if it has not arrived yet, its second bounce (target -> sensor face -> target, at twice the
+ *      echo time) with probability multipathPercent, or the diffuse tail with probability
+ *      exp(-(gap - previous echo) / reverbUs), read as a short random echo
+ *
+ * Notes:
+ *   - Deterministic for a given seed (xorshift32), so tests are repeatable
+ *   - Times are µs on the simulator's own clock; pass a monotonically increasing nowUs to ping()
+ *   - Used by test/ (via ../../tools/bench/ultrasonic_sim.h) and the drivers in tools/bench
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#define SIM_MM_PER_US 0.1715f       // one-way distance per µs of echo time (343 m/s round trip)
+
+struct UltrasonicSimConfig {
+  float noiseUs;         // echo jitter (1 sigma)
+  float quantUs;         // sensor timing step (~3mm)
+  float timeoutPercent;  // chance a ping returns no echo
+  float reverbUs;        // decay time constant of the diffuse tail (0 = none)
+  float multipathPercent; // chance the second bounce is strong enough to be heard
+  uint32_t seed;
+};
+
+const UltrasonicSimConfig SIM_HC_SR04 = { 2.0f, 17.5f, 0.0f, 0.0f, 0.0f, 1 };
+
+class UltrasonicSim {
+public:
+  explicit UltrasonicSim(const UltrasonicSimConfig& config)
+    : cfg(config), state(config.seed ? config.seed : 1), targetMm(1000.0f),
+      previousTriggerUs(0), previousEchoUs(0), ghost(false) {}
+
+  void setDistance(float mm) { targetMm = mm; }
+  float distance() const { return targetMm; }
+  float trueEchoUs() const { return targetMm / SIM_MM_PER_US; }
+
+  // Measured echo time (µs, 0 = timeout) of a ping triggered at nowUs + triggerDelayUs
+  uint32_t ping(uint64_t nowUs, uint32_t triggerDelayUs = 0) {
+    double triggerUs = (double)nowUs + triggerDelayUs;
+    double echoUs = trueEchoUs() + cfg.noiseUs * gaussian();
+    ghost = false;
+
+    // The previous burst heard before this burst's own echo (times after this trigger)
+    if (previousEchoUs > 0) {
+      double gap = triggerUs - previousTriggerUs;
+      double lateEcho = previousEchoUs - gap;
+      double secondBounce = lateEcho + previousEchoUs;
+      if (lateEcho > 0 && lateEcho < echoUs) {
+        echoUs = lateEcho;
+        ghost = true;
+      }
+      else if (secondBounce > 0 && secondBounce < echoUs && uniform() * 100 < cfg.multipathPercent) {
+        echoUs = secondBounce;
+        ghost = true;
+      }
+      else if (cfg.reverbUs > 0 && uniform() < expf((float)(-(gap - previousEchoUs) / cfg.reverbUs))) {
+        echoUs = uniform() * echoUs;
+        ghost = true;
+      }
+    }
+
+    previousTriggerUs = triggerUs;
+    if (cfg.timeoutPercent > 0 && uniform() * 100 < cfg.timeoutPercent) {
+      previousEchoUs = 0;
+      return 0;
+    }
+    previousEchoUs = trueEchoUs();
+
+    // The echo edge lands on the sensor clock, the start is the trigger
+    if (cfg.quantUs > 0) {
+      double edge = floor((triggerUs + echoUs) / cfg.quantUs + 0.5) * cfg.quantUs;
+      echoUs = edge - triggerUs;
+    }
+    return echoUs > 0 ? (uint32_t)(echoUs + 0.5) : 1;
+  }
+
+  // True if the last ping returned a ghost instead of the target
+  bool lastWasGhost() const { return ghost; }
+
+  // Uniform in [0, 1)
+  float uniform() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state >> 8) * (1.0f / 16777216.0f);
+  }
+
+  // Standard normal (Box-Muller)
+  float gaussian() {
+    float u = uniform();
+    float v = uniform();
+    return sqrtf(-2.0f * logf(1.0f - u)) * cosf(6.2831853f * v);
+  }
+
+  uint32_t random() {
+    uniform();
+    return state;
+  }
+
+private:
+  UltrasonicSimConfig cfg;
+  uint32_t state;
+  float targetMm;
+  double previousTriggerUs;
+  double previousEchoUs;
+  bool ghost;
+};
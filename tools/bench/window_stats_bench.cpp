@@ -0,0 +1,102 @@
+/*********************************************************************************************************
+ * Window Statistics Benchmark
+ *
+ * Description:
+ *   Cost per sample of the rolling min/max/mean/stddev at a 1kHz ping rate, against rescanning the
+ *   window for every reading. The window is the device's (10s span, 1024 samples), so at 1kHz it is
+ *   count-limited and every add also evicts.
+ *
+ * How It Works:
+ *   1. Stream: One simulated hour at 1kHz, a random walk with occasional spikes and monotonic runs
+ *   2. Per Sample: add() plus one read of all four statistics, as the readout does
+ *   3. Baseline: The same window kept as a plain ring and rescanned per sample
+ *
+ * Notes:
+ *   - Build: g++ -O2 -std=c++17 -o window_stats_bench window_stats_bench.cpp
+ *   - Usage: window_stats_bench
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "../../include/window_stats.h"
+
+#define STATS_WINDOW_MS 10000       // as in src/main.cpp
+#define STATS_CAPACITY 1024
+#define SAMPLES 3600000             // one hour at 1kHz
+
+typedef std::chrono::steady_clock Clock;
+
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to generate the 1kHz stream
+static std::vector<int32_t> generate() {
+  std::vector<int32_t> stream(SAMPLES);
+  uint32_t seed = 1;
+  int32_t v = 1500;
+  for (int i = 0; i < SAMPLES; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    if ((i / 5000) % 4 == 3) v += 1;                           // slow monotonic run (worst case for the deques)
+    else v += (int32_t)((seed >> 8) % 41) - 20;
+    stream[i] = (seed >> 16) % 100 == 0 ? (int32_t)((seed >> 4) % 4000) : v;
+  }
+  return stream;
+}
+
+// Function to time the rolling statistics, returns ns per sample
+static double rolling(const std::vector<int32_t>& stream, double& checksum) {
+  static WindowStats<STATS_CAPACITY> stats(STATS_WINDOW_MS);
+  auto start = Clock::now();
+  for (int i = 0; i < SAMPLES; i++) {
+    stats.add((uint32_t)i, stream[i]);
+    checksum += stats.min() + stats.max() + stats.mean() + stats.stddev();
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / SAMPLES;
+}
+
+// Function to time a rescan of the same window per sample, returns ns per sample
+static double rescan(const std::vector<int32_t>& stream, double& checksum) {
+  auto start = Clock::now();
+  for (int i = 0; i < SAMPLES; i++) {
+    int from = i + 1 > STATS_CAPACITY ? i + 1 - STATS_CAPACITY : 0;
+    int32_t lo = stream[from], hi = stream[from];
+    int64_t sum = 0, sumSq = 0;
+    for (int j = from; j <= i; j++) {
+      if (stream[j] < lo) lo = stream[j];
+      if (stream[j] > hi) hi = stream[j];
+      sum += stream[j];
+      sumSq += (int64_t)stream[j] * stream[j];
+    }
+    int n = i + 1 - from;
+    double mean = (double)sum / n;
+    checksum += lo + hi + mean + sqrt(fmax(0, (double)sumSq / n - mean * mean));
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / SAMPLES;
+}
+
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+int main() {
+  std::vector<int32_t> stream = generate();
+  double a = 0, b = 0;
+  double fast = rolling(stream, a);
+  double slow = rescan(stream, b);
+  printf("%d samples at 1kHz, window %d ms / %d samples\n", SAMPLES, STATS_WINDOW_MS, STATS_CAPACITY);
+  printf("rolling   %8.1f ns per sample (%.4f%% of the 1ms budget)\n", fast, fast / 10000);
+  printf("rescan    %8.1f ns per sample (%.4f%% of the 1ms budget)\n", slow, slow / 10000);
+  printf("speed-up  %8.0fx   (checksum difference %.3g)\n", slow / fast, fabs(a - b) / SAMPLES);
+  return 0;
+}
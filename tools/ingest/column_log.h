@@ -0,0 +1,343 @@
+/*********************************************************************************************************
+ * Columnar Sample Log
+ *
+ * Description:
+ *   On-disk store written by the ingest server. Samples are appended in blocks, one device per block, and
+ *   inside a block each field is stored as its own compressed column, coded with the same delta-of-delta
+ *   coders the device uses for S2 batches (include/sample_codec.h). Every block also gets an entry in a
+ *   sparse index file, so queries can rule blocks out by time range or distance range without touching
+ *   them. Blocks are collected in a large buffer and written with a single write() call.
+ *
+ * How It Works:
+ *   1. Block: ColumnBlockHeader { magic "CLB3", device id, count, first ms, last ms, min/max mm, column
+ *      lengths } followed by three bit streams: timestamps (TimestampCoder) | distances (DistanceCoder) |
+ *      status (flags and confidence interleaved, ByteCoder)
+ *   2. Index: <name>.idx holds one 32-byte ColumnIndexEntry per block (file offset, length, device, time
+ *      range, distance range), i.e. a few bytes per thousand samples. It is written after the blocks it
+ *      describes, so it never points past the end of the log
+ *   3. Reading: ColumnLogReader maps both files read-only; blocks are decoded straight from the mapping
+ *      with readColumnBlock(), one sample at a time. A missing index, or one with a gap, a wrong entry or
+ *      a short tail, is rebuilt from the block headers after the last entry that continues the one before it
+ *   4. Buffering: append() encodes into the write buffer; the buffer goes to the file once it exceeds
+ *      COLUMN_WRITE_BUFFER bytes or when flush() is called
+ *
+ * Notes:
+ *   - Min/max distance covers valid readings only (flags == 0); a block without any has min > max
+ *   - Headers are stored in host byte order (little-endian on the x86/ARM hosts this runs on)
+ *   - Device ids map to names through devices.txt in the same directory
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "../../include/batch_publisher.h"
+
+#define COLUMN_BLOCK_MAGIC 0x33424C43u  // "CLB3"
+#define COLUMN_WRITE_BUFFER (1 << 20)   // bytes buffered before a write()
+
+struct ColumnBlockHeader {
+  uint32_t magic;
+  uint32_t deviceId;
+  uint32_t count;
+  uint32_t firstMs;
+  uint32_t lastMs;
+  uint16_t minMm;
+  uint16_t maxMm;
+  uint32_t timeBytes;
+  uint32_t distanceBytes;
+  uint32_t statusBytes;
+};
+
+struct ColumnIndexEntry {
+  uint64_t offset;                  // of the block header in the log
+  uint32_t bytes;                   // block length including the header
+  uint32_t deviceId;
+  uint32_t count;
+  uint32_t firstMs;
+  uint32_t lastMs;
+  uint16_t minMm;
+  uint16_t maxMm;
+};
+
+static_assert(sizeof(ColumnIndexEntry) == 32, "index entries are 32 bytes on disk");
+
+// Total size of a block including its header
+inline size_t columnBlockBytes(const ColumnBlockHeader& header) {
+  return sizeof(ColumnBlockHeader) + header.timeBytes + header.distanceBytes + header.statusBytes;
+}
+
+// Decode a block's columns, calling out(record) per sample; false if a column is truncated
+template <class Output>
+bool readColumnBlock(const ColumnBlockHeader& header, const uint8_t* body, Output out) {
+  BitReader timeColumn(body, header.timeBytes);
+  BitReader distanceColumn(body + header.timeBytes, header.distanceBytes);
+  BitReader statusColumn(body + header.timeBytes + header.distanceBytes, header.statusBytes);
+  TimestampCoder time;
+  DistanceCoder distance;
+  ByteCoder flags, confidence;
+
+  SampleRecord record;
+  for (uint32_t i = 0; i < header.count; i++) {
+    record.timestampMs = time.decode(timeColumn);
+    record.distanceMm = distance.decode(distanceColumn);
+    record.flags = flags.decode(statusColumn);
+    record.confidence = confidence.decode(statusColumn);
+    if (timeColumn.exhausted() || distanceColumn.exhausted() || statusColumn.exhausted()) return false;
+    out(record);
+  }
+  return true;
+}
+
+class ColumnLogWriter {
+public:
+  ColumnLogWriter() : fd(-1), indexFd(-1), startOffset(0), written(0), rawBytes(0), blockCount(0),
+                      writeFailed(false) {
+    buffer.reserve(COLUMN_WRITE_BUFFER + 65536);
+  }
+  ~ColumnLogWriter() { close(); }
+
+  // Open (or continue) <basePath>.col and its index <basePath>.idx
+  bool open(const std::string& basePath) {
+    fd = ::open((basePath + ".col").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    indexFd = ::open((basePath + ".idx").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    if (fd < 0 || indexFd < 0 || fstat(fd, &info) != 0) return false;
+    startOffset = (uint64_t)info.st_size;
+    return true;
+  }
+
+  // Append one block of time-ordered samples for a device
+  void append(uint32_t deviceId, const SampleRecord* records, uint32_t count) {
+    if (count == 0) return;
+
+    // Worst case per sample: 36 bits of timestamp, 20 of distance, 18 of status
+    size_t start = buffer.size();
+    size_t timeMax = (size_t)count * 5 + 4;
+    size_t distanceMax = (size_t)count * 3 + 2;
+    size_t statusMax = (size_t)count * 3;
+    buffer.resize(start + sizeof(ColumnBlockHeader) + timeMax + distanceMax + statusMax);
+    uint8_t* body = buffer.data() + start + sizeof(ColumnBlockHeader);
+
+    BitWriter timeColumn(body, timeMax);
+    TimestampCoder time;
+    for (uint32_t i = 0; i < count; i++) time.encode(timeColumn, records[i].timestampMs);
+    size_t timeBytes = timeColumn.finish();
+
+    BitWriter distanceColumn(body + timeBytes, distanceMax);
+    DistanceCoder distance;
+    uint16_t minMm = 0xFFFF, maxMm = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      distance.encode(distanceColumn, records[i].distanceMm);
+      if (records[i].flags != 0) continue;
+      if (records[i].distanceMm < minMm) minMm = records[i].distanceMm;
+      if (records[i].distanceMm > maxMm) maxMm = records[i].distanceMm;
+    }
+    size_t distanceBytes = distanceColumn.finish();
+
+    BitWriter statusColumn(body + timeBytes + distanceBytes, statusMax);
+    ByteCoder flags, confidence;
+    for (uint32_t i = 0; i < count; i++) {
+      flags.encode(statusColumn, records[i].flags);
+      confidence.encode(statusColumn, records[i].confidence);
+    }
+    size_t statusBytes = statusColumn.finish();
+
+    ColumnBlockHeader header = { COLUMN_BLOCK_MAGIC, deviceId, count, records[0].timestampMs,
+                                 records[count - 1].timestampMs, minMm, maxMm, (uint32_t)timeBytes,
+                                 (uint32_t)distanceBytes, (uint32_t)statusBytes };
+    memcpy(buffer.data() + start, &header, sizeof(header));
+    buffer.resize(start + columnBlockBytes(header));
+
+    ColumnIndexEntry entry = { startOffset + written + start, (uint32_t)columnBlockBytes(header), deviceId, count,
+                               header.firstMs, header.lastMs, minMm, maxMm };
+    index.push_back(entry);
+    rawBytes += (uint64_t)count * BATCH_RECORD_BYTES;
+    blockCount++;
+    if (buffer.size() >= COLUMN_WRITE_BUFFER) flush();
+  }
+
+  // Write everything buffered so far (blocks first, then their index entries). Once a write has failed
+  // (including one started by append()) this keeps returning false: the log may end in a partial block
+  bool flush() {
+    if (writeFailed) return false;
+    if (!writeAll(fd, buffer.data(), buffer.size())) return fail();
+    written += buffer.size();
+    buffer.clear();
+    if (!writeAll(indexFd, index.data(), index.size() * sizeof(ColumnIndexEntry))) return fail();
+    index.clear();
+    return true;
+  }
+
+  // Flush and close, returns false if any write failed
+  bool close() {
+    bool ok = fd < 0 || flush();
+    if (fd >= 0) ::close(fd);
+    if (indexFd >= 0) ::close(indexFd);
+    fd = indexFd = -1;
+    return ok;
+  }
+
+  uint64_t bytesWritten() const { return written; }
+  uint64_t sampleBytes() const { return rawBytes; }     // the same samples as S1 records
+  uint32_t blocks() const { return blockCount; }
+  bool failed() const { return writeFailed; }
+
+private:
+  bool fail() {
+    writeFailed = true;
+    return false;
+  }
+
+  static bool writeAll(int target, const void* data, size_t length) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length > 0) {
+      ssize_t n = ::write(target, p, length);
+      if (n <= 0) return false;
+      p += n;
+      length -= (size_t)n;
+    }
+    return true;
+  }
+
+  int fd;
+  int indexFd;
+  std::vector<uint8_t> buffer;
+  std::vector<ColumnIndexEntry> index;
+  uint64_t startOffset;             // log size when opened
+  uint64_t written;
+  uint64_t rawBytes;
+  uint32_t blockCount;
+  bool writeFailed;                 // a write failed: nothing more is written
+};
+
+// Read-only mapping of a log and its index
+class ColumnLogReader {
+public:
+  ColumnLogReader()
+    : data(nullptr), size(0), entries(nullptr), entryCount(0), indexMap(nullptr), indexSize(0) {}
+  ~ColumnLogReader() { close(); }
+
+  // Map <basePath>.col and <basePath>.idx; rebuilt is set when the index had to be recreated
+  bool open(const std::string& basePath, bool& rebuilt) {
+    rebuilt = false;
+    if (!map(basePath + ".col", data, size)) return false;
+
+    // Index entries are trusted while they tile the log: each starts where the previous one ended, on a
+    // whole block of the length it records. A gap (entries lost when the server stopped between its two
+    // writes), an overlap, a wrong length or entries past a truncated log end the trusted part
+    size_t stored = 0;
+    if (map(basePath + ".idx", indexMap, indexSize)) {
+      entries = (const ColumnIndexEntry*)indexMap;
+      stored = indexSize / sizeof(ColumnIndexEntry);
+      uint64_t expected = 0;
+      ColumnBlockHeader block;
+      while (entryCount < stored && entries[entryCount].offset == expected &&
+             blockAt(expected, block) && columnBlockBytes(block) == entries[entryCount].bytes) {
+        expected = end(entries[entryCount]);
+        entryCount++;
+      }
+    }
+    uint64_t indexed = entryCount > 0 ? end(entries[entryCount - 1]) : 0;
+    if (indexed == size && entryCount == stored) return true;
+
+    // Walk the block headers from the end of the trusted part. Where no block starts, or a block runs
+    // into an indexed one (both left by a torn write), carry on at the next indexed block that is there
+    rebuilt = true;
+    rebuiltEntries.assign(entries, entries + entryCount);
+    size_t next = entryCount;
+    for (uint64_t offset = indexed; offset + sizeof(ColumnBlockHeader) <= size;) {
+      ColumnBlockHeader block, indexedBlock;
+      while (next < stored && entries[next].offset <= offset) next++;
+      bool found = blockAt(offset, block);
+      if (found && next < stored && entries[next].offset < offset + columnBlockBytes(block) &&
+          blockAt(entries[next].offset, indexedBlock)) {
+        found = false;
+      }
+      if (found) {
+        ColumnIndexEntry entry = { offset, (uint32_t)columnBlockBytes(block), block.deviceId, block.count,
+                                   block.firstMs, block.lastMs, block.minMm, block.maxMm };
+        rebuiltEntries.push_back(entry);
+        offset += entry.bytes;
+        continue;
+      }
+      while (next < stored && !blockAt(entries[next].offset, block)) next++;
+      if (next == stored) break;
+      offset = entries[next].offset;
+    }
+    entries = rebuiltEntries.data();
+    entryCount = rebuiltEntries.size();
+    return true;
+  }
+
+  // Write the current (e.g. rebuilt) index next to the log
+  bool saveIndex(const std::string& basePath) const {
+    int fd = ::open((basePath + ".idx").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    ssize_t length = (ssize_t)(entryCount * sizeof(ColumnIndexEntry));
+    bool ok = ::write(fd, entries, (size_t)length) == length;
+    ::close(fd);
+    return ok;
+  }
+
+  size_t blocks() const { return entryCount; }
+  const ColumnIndexEntry& entry(size_t i) const { return entries[i]; }
+  ColumnBlockHeader header(size_t i) const {
+    ColumnBlockHeader block;
+    memcpy(&block, data + entries[i].offset, sizeof(block)); // blocks are not aligned
+    return block;
+  }
+  const uint8_t* body(size_t i) const { return data + entries[i].offset + sizeof(ColumnBlockHeader); }
+  uint64_t logBytes() const { return size; }
+
+  void close() {
+    if (data != nullptr) munmap((void*)data, size);
+    if (indexMap != nullptr) munmap((void*)indexMap, indexSize);
+    data = indexMap = nullptr;
+    entries = nullptr;
+    entryCount = 0;
+  }
+
+private:
+  static uint64_t end(const ColumnIndexEntry& entry) { return entry.offset + entry.bytes; }
+
+  // True when a whole block starts at offset
+  bool blockAt(uint64_t offset, ColumnBlockHeader& block) const {
+    if (offset + sizeof(ColumnBlockHeader) > size) return false;
+    memcpy(&block, data + offset, sizeof(block));
+    return block.magic == COLUMN_BLOCK_MAGIC && offset + columnBlockBytes(block) <= size;
+  }
+
+  static bool map(const std::string& path, const uint8_t*& mapping, uint64_t& length) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0 && info.st_size > 0;
+    if (ok) {
+      void* p = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ok = p != MAP_FAILED;
+      if (ok) {
+        mapping = (const uint8_t*)p;
+        length = (uint64_t)info.st_size;
+      }
+    }
+    ::close(fd);
+    return ok;
+  }
+
+  const uint8_t* data;
+  uint64_t size;
+  const ColumnIndexEntry* entries;
+  size_t entryCount;
+  const uint8_t* indexMap;
+  uint64_t indexSize;
+  std::vector<ColumnIndexEntry> rebuiltEntries;
+};
@@ -0,0 +1,54 @@
+/*********************************************************************************************************
+ * Ingest Wire Protocol
+ *
+ * Description:
+ *   Framing used between devices (or the load generator) and the host ingest server. A TCP stream carries
+ *   length-prefixed frames: one hello naming the device, then sample batches in the same "S1" payload
+ *   format the device publishes over MQTT and WebSocket (see include/batch_publisher.h).
+ *
+ * How It Works:
+ *   1. Frame: uint32 little-endian length (type byte + body) | uint8 type | body
+ *   2. Hello ('H'): body is the device name ("distance-<mac>"), at most INGEST_NAME_MAX bytes. It must be
+ *      the first frame on a connection and names the device for the batches that follow (a later hello
+ *      switches device, so one pipe can carry several devices in tests)
+ *   3. Batch ('B'): body is an S1 payload
+ *
+ * Notes:
+ *   - Frames larger than INGEST_FRAME_MAX are a protocol error and close the connection
+ *
+ **********************************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../../include/batch_publisher.h"
+
+#define INGEST_DEFAULT_PORT 5140    // TCP port of the ingest server
+#define INGEST_NAME_MAX 32          // device name bytes in a hello
+#define INGEST_PREFIX_BYTES 4       // length prefix
+#define INGEST_FRAME_MAX (1 + BATCH_PAYLOAD_MAX)
+
+#define INGEST_HELLO 'H'
+#define INGEST_BATCH 'B'
+
+inline uint32_t ingestGet32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void ingestPut32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+}
+
+// Write a complete frame into out (room for INGEST_PREFIX_BYTES + 1 + length), returns its size
+inline size_t ingestFrame(uint8_t* out, uint8_t type, const void* body, size_t length) {
+  ingestPut32(out, (uint32_t)(length + 1));
+  out[INGEST_PREFIX_BYTES] = type;
+  memcpy(out + INGEST_PREFIX_BYTES + 1, body, length);
+  return INGEST_PREFIX_BYTES + 1 + length;
+}
@@ -0,0 +1,631 @@
+/*********************************************************************************************************
+ * Multi-Device Ingest Server
+ *
+ * Description:
+ *   Host-side collector for many sensor units. Devices (or load_generator) connect over TCP and stream
+ *   framed S1 sample batches (see ingest_protocol.h). Network threads decode batches in parallel and hand
+ *   them to writer threads without locks; each writer keeps a time-ordered store per device and appends
+ *   columnar blocks (see column_log.h) to its own log file.
+ *
+ * How It Works:
+ *   1. Network: Each worker thread owns an epoll set. All workers wait on the listening socket with
+ *      EPOLLEXCLUSIVE, so a new connection wakes one worker, which then owns it for its lifetime
+ *   2. Decode: A worker reassembles frames from its read buffer and decodes each batch straight into a
+ *      slot of a single-producer single-consumer ring towards the writer that owns the device
+ *      (device id % writers). When that ring is full the connection is parked: it leaves the epoll set
+ *      with its frames still buffered, so TCP flow control slows that sender while the worker serves the
+ *      others, and rejoins once the ring has HANDOFF_RESUME_SLOTS free
+ *   3. Store: Each writer polls its rings (one per worker) and appends samples to the device's store,
+ *      sorting a store only if a sample arrived out of order (e.g. replay after a reconnect)
+ *   4. Log: A device store becomes one compressed column block once it holds --block-samples samples or
+ *      its oldest sample is --block-ms old. Blocks go to ingest-<writer>.col (with a sparse index in
+ *      ingest-<writer>.idx) in large buffered writes, at least every flush interval
+ *   5. Stats: Once a second the main thread prints samples/s, throughput and, with --latency, the ingest
+ *      latency percentiles (sample timestamp to writer store, using the sender's monotonic clock)
+ *
+ * Notes:
+ *   - --stdin reads frames from standard input as an extra connection and stops at end of input, so the
+ *     whole path can be exercised through a pipe:  load_generator --pipe | ingest_server --stdin
+ *   - Device names and ids are recorded in devices.txt in the output directory; a restart loads it and
+ *     appends, so ids in existing logs keep their names
+ *   - A failed log write stops the server (the log cannot be continued consistently)
+ *   - Build: g++ -O2 -std=c++17 -pthread -o ingest_server ingest_server.cpp  (Linux)
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ingest_protocol.h"
+#include "column_log.h"
+
+#define HANDOFF_SLOTS 1024          // batches per worker-to-writer ring (power of 2)
+#define HANDOFF_RESUME_SLOTS 256    // free slots before a parked connection is read again
+#define READ_BUFFER_BYTES 65536     // per-connection receive buffer
+#define EPOLL_EVENTS 64             // events handled per epoll_wait
+#define LATENCY_BUCKETS 1024        // 1ms latency histogram buckets (last one is >= 1023ms)
+
+struct Options {
+  uint16_t port = INGEST_DEFAULT_PORT;
+  int workers = 4;
+  int writers = 2;
+  uint32_t flushMs = 1000;          // write buffered blocks at least this often
+  uint32_t blockSamples = 4096;     // close a device's block at this many samples
+  uint32_t blockMs = 60000;         // ... or when its oldest sample has waited this long
+  uint32_t durationS = 0;           // 0 = until SIGINT / end of stdin
+  bool latency = false;
+  bool readStdin = false;
+  std::string outputDir = "ingest-data";
+};
+
+// One decoded batch on its way to a writer
+struct Chunk {
+  uint32_t deviceId;
+  uint16_t count;
+  SampleRecord records[BATCH_MAX_SAMPLES];
+};
+
+// Single-producer single-consumer ring; slots are filled in place to avoid a copy
+template <class T, uint32_t CAPACITY>
+class SpscRing {
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of 2");
+
+public:
+  // Producer: free slot to fill, or nullptr while the ring is full
+  T* claim() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= CAPACITY) return nullptr;
+    return &slots[h & (CAPACITY - 1)];
+  }
+  void publish() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Producer: free slots
+  uint32_t space() const {
+    return CAPACITY - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+  }
+
+  // Consumer: oldest filled slot, or nullptr when empty
+  T* front() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return nullptr;
+    return &slots[t & (CAPACITY - 1)];
+  }
+  void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+  alignas(64) std::atomic<uint32_t> head{0};
+  alignas(64) std::atomic<uint32_t> tail{0};
+  T slots[CAPACITY];
+};
+
+typedef SpscRing<Chunk, HANDOFF_SLOTS> Handoff;
+
+struct Connection {
+  uint8_t buffer[READ_BUFFER_BYTES];
+  size_t used = 0;
+  int64_t deviceId = -1;            // set by the hello frame
+  Handoff* parkedOn = nullptr;      // full ring the buffered frames wait for (out of the epoll set)
+};
+
+struct WorkerStats {
+  alignas(64) std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> frames{0};
+  std::atomic<uint32_t> connections{0};
+  std::atomic<uint32_t> protocolErrors{0};
+};
+
+struct WriterStats {
+  alignas(64) std::atomic<uint64_t> samples{0};
+  std::atomic<uint64_t> reordered{0};
+  std::atomic<uint64_t> logBytes{0};
+  std::atomic<uint64_t> sampleBytes{0};
+  std::atomic<uint64_t> latency[LATENCY_BUCKETS];
+};
+
+// Device name -> id, shared by all workers (only touched on hello frames)
+class DeviceRegistry {
+public:
+  // Load the ids already given out ("<id> <name>" per line), then append new ones
+  bool open(const std::string& path) {
+    FILE* existing = fopen(path.c_str(), "r");
+    if (existing != nullptr) {
+      unsigned id;
+      char name[INGEST_NAME_MAX + 1];
+      while (fscanf(existing, "%u %32s", &id, name) == 2) {
+        ids.emplace(name, id);
+        if (id >= nextId) nextId = id + 1;
+      }
+      fclose(existing);
+    }
+    file = fopen(path.c_str(), "a");
+    return file != nullptr;
+  }
+
+  uint32_t lookup(const std::string& name) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = ids.find(name);
+    if (found != ids.end()) return found->second;
+    uint32_t id = nextId++;
+    ids.emplace(name, id);
+    fprintf(file, "%u %s\n", id, name.c_str());
+    fflush(file);
+    return id;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return ids.size();
+  }
+
+private:
+  std::mutex lock;
+  std::unordered_map<std::string, uint32_t> ids;
+  uint32_t nextId = 0;
+  FILE* file = nullptr;
+};
+
+static Options options;
+static std::atomic<bool> stopping{false};
+static std::atomic<int> workersRunning{0};
+static int listenFd = -1;
+static DeviceRegistry registry;
+static std::vector<std::unique_ptr<Handoff>> rings;      // [worker * writers + writer]
+static std::unique_ptr<WorkerStats[]> workerStats;
+static std::unique_ptr<WriterStats[]> writerStats;
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to read the monotonic clock in ms (the clock load_generator stamps samples with)
+static uint64_t monotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Function to stop all threads on SIGINT / SIGTERM
+static void onSignal(int) { stopping = true; }
+
+// Function to make a descriptor non-blocking
+static bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Function to open the listening socket
+static int openListener(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd < 0) return -1;
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 1024) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+enum class FrameResult { HANDLED, FULL, INVALID };
+
+// Function to hand one batch to the writer that owns the device (FULL while its ring has no free slot)
+static FrameResult handOff(int worker, Connection& connection, const uint8_t* payload, size_t length) {
+  uint32_t deviceId = (uint32_t)connection.deviceId;
+  Handoff& ring = *rings[worker * options.writers + deviceId % options.writers];
+  Chunk* chunk = ring.claim();
+  if (chunk == nullptr) {
+    connection.parkedOn = &ring;
+    return FrameResult::FULL;
+  }
+
+  chunk->deviceId = deviceId;
+  chunk->count = 0;
+  int samples = decodeBatch(payload, length, [chunk](const SampleRecord& record) {
+    chunk->records[chunk->count++] = record;
+  });
+  if (samples < 0) return FrameResult::INVALID;
+  if (samples > 0) ring.publish();
+  return FrameResult::HANDLED;
+}
+
+// Function to handle one complete frame
+static FrameResult handleFrame(int worker, Connection& connection, const uint8_t* frame, size_t length) {
+  uint8_t type = frame[0];
+  const uint8_t* body = frame + 1;
+  size_t bodyLength = length - 1;
+
+  if (type == INGEST_HELLO) {
+    if (bodyLength == 0 || bodyLength > INGEST_NAME_MAX) return FrameResult::INVALID;
+    connection.deviceId = registry.lookup(std::string((const char*)body, bodyLength));
+    return FrameResult::HANDLED;
+  }
+  if (type == INGEST_BATCH && connection.deviceId >= 0) {
+    return handOff(worker, connection, body, bodyLength);
+  }
+  return FrameResult::INVALID;
+}
+
+enum class ReadResult { OPEN, PARKED, CLOSED, ERROR };
+
+// Function to handle every complete frame in a connection's buffer (PARKED: stopped at a full ring)
+static ReadResult handleFrames(int worker, Connection& connection) {
+  size_t pos = 0;
+  uint64_t frames = 0;
+  ReadResult result = ReadResult::OPEN;
+  while (connection.used - pos >= INGEST_PREFIX_BYTES) {
+    uint32_t length = ingestGet32(connection.buffer + pos);
+    if (length == 0 || length > INGEST_FRAME_MAX) return ReadResult::ERROR;
+    if (connection.used - pos < INGEST_PREFIX_BYTES + length) break;
+    FrameResult handled = handleFrame(worker, connection, connection.buffer + pos + INGEST_PREFIX_BYTES, length);
+    if (handled == FrameResult::INVALID) return ReadResult::ERROR;
+    if (handled == FrameResult::FULL) {
+      result = ReadResult::PARKED;
+      break;
+    }
+    pos += INGEST_PREFIX_BYTES + length;
+    frames++;
+  }
+  workerStats[worker].frames.fetch_add(frames, std::memory_order_relaxed);
+
+  // Keep the unhandled frames at the start of the buffer
+  memmove(connection.buffer, connection.buffer + pos, connection.used - pos);
+  connection.used -= pos;
+  return result;
+}
+
+// Function to read what is available on a connection and handle every complete frame
+static ReadResult serviceConnection(int worker, int fd, Connection& connection) {
+  ssize_t n = read(fd, connection.buffer + connection.used, READ_BUFFER_BYTES - connection.used);
+  if (n == 0) return connection.used == 0 ? ReadResult::CLOSED : ReadResult::ERROR; // ended mid-frame
+  if (n < 0) return errno == EAGAIN || errno == EINTR ? ReadResult::OPEN : ReadResult::CLOSED;
+  connection.used += (size_t)n;
+  workerStats[worker].bytes.fetch_add((uint64_t)n, std::memory_order_relaxed);
+  return handleFrames(worker, connection);
+}
+
+// Function to add a descriptor to a worker's epoll set
+static void watch(int epollFd, int fd, uint32_t events) {
+  epoll_event event = {};
+  event.events = events;
+  event.data.fd = fd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+// Function to append a device store to the log as one block
+static void flushStore(ColumnLogWriter& log, uint32_t deviceId, std::vector<SampleRecord>& store,
+                       bool& ordered) {
+  if (store.empty()) return;
+  if (!ordered) {
+    std::stable_sort(store.begin(), store.end(), [](const SampleRecord& a, const SampleRecord& b) {
+      return (int32_t)(a.timestampMs - b.timestampMs) < 0;
+    });
+    ordered = true;
+  }
+  log.append(deviceId, store.data(), (uint32_t)store.size());
+  store.clear();
+}
+
+// Function to find a percentile (in ms) in a latency histogram (fraction 1 gives the maximum)
+static uint32_t percentileMs(const uint64_t* histogram, uint64_t total, double fraction) {
+  uint64_t rank = std::min<uint64_t>((uint64_t)(total * fraction), total - 1);
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram[i];
+    if (seen > rank) return i;
+  }
+  return LATENCY_BUCKETS - 1;
+}
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+// Network thread: accept, read, decode and hand off
+static void runWorker(int worker) {
+  int epollFd = epoll_create1(0);
+  watch(epollFd, listenFd, EPOLLIN | EPOLLEXCLUSIVE);
+
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+  if (worker == 0 && options.readStdin) {
+    setNonBlocking(STDIN_FILENO);
+    watch(epollFd, STDIN_FILENO, EPOLLIN);
+    connections[STDIN_FILENO].reset(new Connection());
+  }
+
+  // Remove a connection that closed or misbehaved
+  auto drop = [&](int fd, ReadResult result) {
+    if (result == ReadResult::ERROR) workerStats[worker].protocolErrors++;
+    connections.erase(fd);
+    if (fd == STDIN_FILENO) {
+      stopping = true;                  // end of the piped input ends the run
+    }
+    else {
+      close(fd);
+      workerStats[worker].connections--;
+    }
+  };
+
+  // Connections out of the epoll set until their ring drains
+  std::vector<int> parked;
+
+  epoll_event events[EPOLL_EVENTS];
+  while (!stopping) {
+    // Resume parked connections once their ring has room: hand over the buffered frames, then read again
+    for (size_t p = 0; p < parked.size();) {
+      int fd = parked[p];
+      Connection& connection = *connections[fd];
+      if (connection.parkedOn->space() < HANDOFF_RESUME_SLOTS) {
+        p++;
+        continue;
+      }
+      connection.parkedOn = nullptr;
+      ReadResult result = handleFrames(worker, connection);
+      if (result == ReadResult::PARKED) {
+        p++;
+        continue;
+      }
+      parked[p] = parked.back();
+      parked.pop_back();
+      if (result == ReadResult::OPEN) watch(epollFd, fd, EPOLLIN | EPOLLRDHUP);
+      else drop(fd, result);
+    }
+
+    int ready = epoll_wait(epollFd, events, EPOLL_EVENTS, parked.empty() ? 100 : 1);
+    for (int i = 0; i < ready; i++) {
+      int fd = events[i].data.fd;
+      if (fd == listenFd) {
+        int client;
+        while ((client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+          watch(epollFd, client, EPOLLIN | EPOLLRDHUP);
+          connections[client].reset(new Connection());
+          workerStats[worker].connections++;
+        }
+        continue;
+      }
+
+      auto found = connections.find(fd);
+      if (found == connections.end()) continue;
+      ReadResult result = serviceConnection(worker, fd, *found->second);
+      if (result == ReadResult::OPEN) continue;
+
+      // Full ring: stop reading this sender; closed or misbehaving: drop the connection
+      epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+      if (result == ReadResult::PARKED) parked.push_back(fd);
+      else drop(fd, result);
+    }
+  }
+
+  for (auto& entry : connections) {
+    if (entry.first != STDIN_FILENO) close(entry.first);
+  }
+  close(epollFd);
+  workersRunning--;
+}
+
+// Storage thread: drain the rings, keep per-device stores, write column blocks
+static void runWriter(int writer) {
+  ColumnLogWriter log;
+  std::string path = options.outputDir + "/ingest-" + std::to_string(writer);
+  if (!log.open(path)) {
+    fprintf(stderr, "cannot open %s\n", path.c_str());
+    stopping = true;
+    return;
+  }
+
+  struct Store {
+    std::vector<SampleRecord> samples;
+    bool ordered = true;
+    uint64_t openedMs = 0;          // arrival of the oldest sample in the store
+  };
+  std::unordered_map<uint32_t, Store> stores;
+  WriterStats& stats = writerStats[writer];
+  uint64_t lastFlushMs = monotonicMs();
+
+  for (;;) {
+    bool finished = workersRunning == 0;  // read before draining so nothing published after is missed
+    bool idle = true;
+
+    for (int worker = 0; worker < options.workers; worker++) {
+      Handoff& ring = *rings[worker * options.writers + writer];
+      for (int n = 0; n < 64; n++) {
+        Chunk* chunk = ring.front();
+        if (chunk == nullptr) break;
+
+        Store& store = stores[chunk->deviceId];
+        if (store.samples.empty()) store.openedMs = monotonicMs();
+        uint32_t newest = store.samples.empty() ? chunk->records[0].timestampMs
+                                                : store.samples.back().timestampMs;
+        for (uint16_t i = 0; i < chunk->count; i++) {
+          if ((int32_t)(chunk->records[i].timestampMs - newest) < 0) {
+            store.ordered = false;
+            stats.reordered.fetch_add(1, std::memory_order_relaxed);
+          }
+          newest = chunk->records[i].timestampMs;
+        }
+        store.samples.insert(store.samples.end(), chunk->records, chunk->records + chunk->count);
+
+        if (options.latency) {
+          uint32_t latency = (uint32_t)monotonicMs() - chunk->records[chunk->count - 1].timestampMs;
+          stats.latency[std::min<uint32_t>(latency, LATENCY_BUCKETS - 1)].fetch_add(
+            chunk->count, std::memory_order_relaxed);
+        }
+        stats.samples.fetch_add(chunk->count, std::memory_order_relaxed);
+        if (store.samples.size() >= options.blockSamples) {
+          flushStore(log, chunk->deviceId, store.samples, store.ordered);
+        }
+        ring.pop();
+        idle = false;
+      }
+    }
+
+    uint64_t nowMs = monotonicMs();
+    if (nowMs - lastFlushMs >= options.flushMs || (finished && idle)) {
+      for (auto& entry : stores) {
+        Store& store = entry.second;
+        if (finished || nowMs - store.openedMs >= options.blockMs) {
+          flushStore(log, entry.first, store.samples, store.ordered);
+        }
+      }
+      if (!log.flush()) break;
+      lastFlushMs = nowMs;
+    }
+    if (finished && idle) break;
+    if (idle) std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  if (!log.flush()) {
+    fprintf(stderr, "write to %s failed: %s\n", path.c_str(), strerror(errno));
+    stopping = true;                  // the other writers finish their logs
+  }
+  log.close();
+  stats.logBytes = log.bytesWritten();
+  stats.sampleBytes = log.sampleBytes();
+}
+
+// Function to print usage
+static void printUsage() {
+  fprintf(stderr,
+    "usage: ingest_server [--port N] [--workers N] [--writers N] [--out DIR] [--flush-ms N]\n"
+    "                     [--block-samples N] [--block-ms N] [--seconds N] [--latency] [--stdin]\n");
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--port" && hasValue) options.port = (uint16_t)atoi(argv[++i]);
+    else if (arg == "--workers" && hasValue) options.workers = std::max(1, atoi(argv[++i]));
+    else if (arg == "--writers" && hasValue) options.writers = std::max(1, atoi(argv[++i]));
+    else if (arg == "--flush-ms" && hasValue) options.flushMs = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--block-samples" && hasValue) options.blockSamples = std::max(1, atoi(argv[++i]));
+    else if (arg == "--block-ms" && hasValue) options.blockMs = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--out" && hasValue) options.outputDir = argv[++i];
+    else if (arg == "--seconds" && hasValue) options.durationS = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--latency") options.latency = true;
+    else if (arg == "--stdin") options.readStdin = true;
+    else {
+      printUsage();
+      return 2;
+    }
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  mkdir(options.outputDir.c_str(), 0755);
+  if (!registry.open(options.outputDir + "/devices.txt")) {
+    fprintf(stderr, "cannot write to %s\n", options.outputDir.c_str());
+    return 1;
+  }
+  listenFd = openListener(options.port);
+  if (listenFd < 0) {
+    fprintf(stderr, "cannot listen on port %u: %s\n", options.port, strerror(errno));
+    return 1;
+  }
+
+  for (int i = 0; i < options.workers * options.writers; i++) rings.emplace_back(new Handoff());
+  workerStats.reset(new WorkerStats[options.workers]);
+  writerStats.reset(new WriterStats[options.writers]);
+  for (int i = 0; i < options.writers; i++) {
+    for (auto& bucket : writerStats[i].latency) bucket = 0;
+  }
+
+  std::vector<std::thread> threads;
+  workersRunning = options.workers;
+  for (int i = 0; i < options.writers; i++) threads.emplace_back(runWriter, i);
+  for (int i = 0; i < options.workers; i++) threads.emplace_back(runWorker, i);
+  fprintf(stderr, "listening on port %u (%d workers, %d writers) -> %s/\n", options.port, options.workers,
+          options.writers, options.outputDir.c_str());
+
+  // Once a second: throughput and latency since the previous report
+  uint64_t startMs = monotonicMs();
+  uint64_t previousSamples = 0, previousBytes = 0;
+  std::vector<uint64_t> previousLatency(LATENCY_BUCKETS, 0);
+  uint64_t lastReportMs = startMs;
+  while (!stopping) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    uint64_t nowMs = monotonicMs();
+    if (options.durationS > 0 && nowMs - startMs >= options.durationS * 1000ULL) stopping = true;
+    if (nowMs - lastReportMs < 1000) continue;
+
+    uint64_t samples = 0, bytes = 0, latencyTotal = 0;
+    uint32_t connected = 0, errors = 0;
+    uint64_t latency[LATENCY_BUCKETS];
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+      uint64_t sum = 0;
+      for (int i = 0; i < options.writers; i++) sum += writerStats[i].latency[b];
+      latency[b] = sum - previousLatency[b];
+      previousLatency[b] = sum;
+      latencyTotal += latency[b];
+    }
+    for (int i = 0; i < options.writers; i++) samples += writerStats[i].samples;
+    for (int i = 0; i < options.workers; i++) {
+      bytes += workerStats[i].bytes;
+      connected += workerStats[i].connections;
+      errors += workerStats[i].protocolErrors;
+    }
+
+    double seconds = (nowMs - lastReportMs) / 1000.0;
+    printf("%6.1fs devices %zu connected %u samples/s %.0f MB/s %.2f errors %u", (nowMs - startMs) / 1000.0,
+           registry.size(), connected, (samples - previousSamples) / seconds,
+           (bytes - previousBytes) / seconds / 1e6, errors);
+    if (options.latency && latencyTotal > 0) {
+      printf(" latency ms p50 %u p99 %u max %u", percentileMs(latency, latencyTotal, 0.50),
+             percentileMs(latency, latencyTotal, 0.99), percentileMs(latency, latencyTotal, 1.0));
+    }
+    printf("\n");
+    fflush(stdout);
+    previousSamples = samples;
+    previousBytes = bytes;
+    lastReportMs = nowMs;
+  }
+
+  for (auto& thread : threads) thread.join();
+  close(listenFd);
+
+  uint64_t samples = 0, reordered = 0, logBytes = 0, sampleBytes = 0;
+  for (int i = 0; i < options.writers; i++) {
+    samples += writerStats[i].samples;
+    reordered += writerStats[i].reordered;
+    logBytes += writerStats[i].logBytes;
+    sampleBytes += writerStats[i].sampleBytes;
+  }
+  double seconds = (monotonicMs() - startMs) / 1000.0;
+  printf("stored %llu samples from %zu devices in %.1fs (%.0f samples/s), %llu out of order\n",
+         (unsigned long long)samples, registry.size(), seconds, samples / seconds,
+         (unsigned long long)reordered);
+  if (logBytes > 0) {
+    printf("log %.2f MB, %.2f bytes/sample (%.1fx smaller than S1 records)\n", logBytes / 1e6,
+           (double)logBytes / samples, (double)sampleBytes / logBytes);
+  }
+  return 0;
+}
@@ -0,0 +1,279 @@
+/*********************************************************************************************************
+ * Ingest Load Generator
+ *
+ * Description:
+ *   Simulates many sensor units streaming to ingest_server. Each simulated device holds its own TCP
+ *   connection, says hello with a "distance-sim<n>" name and then sends one S1 batch per batch interval,
+ *   encoded with the device's own BatchPublisher so the bytes on the wire are exactly what firmware sends.
+ *
+ * How It Works:
+ *   1. Devices: Spread over a few sender threads; each thread wakes every batch interval and sends one
+ *      batch per device covering the samples taken since the last one (rate x interval samples)
+ *   2. Samples: A slow sine around a per-device baseline plus a little jitter and 0.5% timeouts (flagged
+ *      SAMPLE_TIMEOUT as the firmware does), stamped with the monotonic clock in ms so ingest_server --latency can measure sample-to-store latency on the same host
+ *   3. Report: Samples/s actually sent versus the target, and how many intervals a thread overran (sends
+ *      blocked by backpressure or the thread falling behind)
+ *
+ * Notes:
+ *   - --compressed sends bit-packed S2 batches instead of S1
+ *   - --pipe writes all devices' frames to standard output as fast as possible instead (simulated clock,
+ *     hellos interleaved), for:  load_generator --pipe --seconds 60 | ingest_server --stdin
+ *   - Build: g++ -O2 -std=c++17 -pthread -o load_generator load_generator.cpp  (Linux)
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ingest_protocol.h"
+#include "../../include/sample.h"
+
+#define SIM_RING_SAMPLES 1024       // per-device publisher ring (power of 2)
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t port = INGEST_DEFAULT_PORT;
+  int devices = 200;
+  uint32_t rateHz = 50;             // samples per second per device
+  uint32_t batchMs = 100;           // batch interval
+  uint32_t seconds = 10;
+  int threads = 4;
+  bool pipe = false;
+  bool compressed = false;          // send S2 batches
+};
+
+struct SimDevice {
+  explicit SimDevice(bool compressed) : publisher(compressed) {}
+
+  int fd = -1;
+  std::string name;
+  double baselineMm;
+  double phase;
+  uint32_t seed;
+  BatchPublisher<SIM_RING_SAMPLES> publisher;
+};
+
+// Collects a drained batch as a complete frame
+struct FrameSink {
+  uint8_t frame[INGEST_PREFIX_BYTES + INGEST_FRAME_MAX];
+  size_t length = 0;
+
+  bool publish(const uint8_t* payload, size_t payloadLength) {
+    length = ingestFrame(frame, INGEST_BATCH, payload, payloadLength);
+    return true;
+  }
+};
+
+static Options options;
+static std::atomic<uint64_t> samplesSent{0};
+static std::atomic<uint64_t> overruns{0};
+static std::atomic<bool> failed{false};
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to read the monotonic clock in ms (same clock as ingest_server)
+static uint64_t monotonicMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Function to write a whole buffer (blocking)
+static bool sendAll(int fd, const uint8_t* data, size_t length) {
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
+
+// Function to connect a device to the server
+static int connectDevice() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(options.port);
+  inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+  if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+    close(fd);
+    return -1;
+  }
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return fd;
+}
+
+// Function to send a device's hello frame
+static bool sendHello(int fd, const SimDevice& device) {
+  uint8_t frame[INGEST_PREFIX_BYTES + 1 + INGEST_NAME_MAX];
+  size_t length = ingestFrame(frame, INGEST_HELLO, device.name.data(), device.name.size());
+  return sendAll(fd, frame, length);
+}
+
+// Function to take the samples a device measured between fromMs (exclusive) and toMs
+static void simulateSamples(SimDevice& device, uint64_t fromMs, uint64_t toMs) {
+  uint32_t periodMs = std::max<uint32_t>(1, 1000 / options.rateHz);
+  for (uint64_t t = fromMs - fromMs % periodMs + periodMs; t <= toMs; t += periodMs) {
+    device.seed = device.seed * 1103515245u + 12345u;
+    double jitter = (double)((device.seed >> 16) % 7) - 3.0;
+    double mm = device.baselineMm + 300.0 * sin(device.phase + t / 4000.0) + jitter;
+
+    bool timeout = (device.seed >> 8) % 200 == 0;
+
+    SampleRecord record;
+    record.timestampMs = (uint32_t)t;
+    record.distanceMm = timeout ? 0 : (uint16_t)std::max((double)SAMPLE_MIN_MM, mm);
+    record.flags = timeout ? SAMPLE_TIMEOUT : SAMPLE_OK;
+    record.confidence = timeout ? 0 : 200;
+    device.publisher.push(record);
+  }
+}
+
+// Function to drain a device's buffered samples to fd, returns false if the connection failed
+static bool sendPending(SimDevice& device, int fd, FrameSink& sink) {
+  while (device.publisher.pending() > 0) {
+    uint32_t before = device.publisher.pending();
+    device.publisher.drain(sink, 1);
+    if (!sendAll(fd, sink.frame, sink.length)) return false;
+    samplesSent.fetch_add(before - device.publisher.pending(), std::memory_order_relaxed);
+  }
+  return true;
+}
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+// Sender thread: paced batches for its share of the devices
+static void runSender(std::vector<SimDevice*> devices, uint64_t startMs, uint64_t endMs) {
+  FrameSink sink;
+  uint64_t tickMs = startMs;
+  while (!failed) {
+    uint64_t previousMs = tickMs;
+    tickMs += options.batchMs;
+    if (tickMs > endMs) break;
+
+    uint64_t nowMs = monotonicMs();
+    if (nowMs < tickMs) std::this_thread::sleep_for(std::chrono::milliseconds(tickMs - nowMs));
+    else if (nowMs >= tickMs + options.batchMs) overruns++;
+
+    for (SimDevice* device : devices) {
+      simulateSamples(*device, previousMs, tickMs);
+      if (!sendPending(*device, device->fd, sink)) {
+        fprintf(stderr, "%s: connection lost\n", device->name.c_str());
+        failed = true;
+        break;
+      }
+    }
+  }
+}
+
+// Pipe mode: every device's batches to stdout on a simulated clock, as fast as possible
+static int runPipe(std::vector<std::unique_ptr<SimDevice>>& devices) {
+  FrameSink sink;
+  for (uint64_t tickMs = 0; tickMs < options.seconds * 1000ULL; tickMs += options.batchMs) {
+    for (auto& device : devices) {
+      simulateSamples(*device, tickMs, tickMs + options.batchMs);
+      if (!sendHello(STDOUT_FILENO, *device) || !sendPending(*device, STDOUT_FILENO, sink)) return 1;
+    }
+  }
+  fprintf(stderr, "wrote %llu samples from %d devices\n", (unsigned long long)samplesSent.load(),
+          options.devices);
+  return 0;
+}
+
+// Function to print usage
+static void printUsage() {
+  fprintf(stderr,
+    "usage: load_generator [--host IP] [--port N] [--devices N] [--rate HZ] [--batch-ms N]\n"
+    "                      [--seconds N] [--threads N] [--pipe] [--compressed]\n");
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--host" && hasValue) options.host = argv[++i];
+    else if (arg == "--port" && hasValue) options.port = (uint16_t)atoi(argv[++i]);
+    else if (arg == "--devices" && hasValue) options.devices = std::max(1, atoi(argv[++i]));
+    else if (arg == "--rate" && hasValue) options.rateHz = std::max(1, atoi(argv[++i]));
+    else if (arg == "--batch-ms" && hasValue) options.batchMs = std::max(1, atoi(argv[++i]));
+    else if (arg == "--seconds" && hasValue) options.seconds = std::max(1, atoi(argv[++i]));
+    else if (arg == "--threads" && hasValue) options.threads = std::max(1, atoi(argv[++i]));
+    else if (arg == "--pipe") options.pipe = true;
+    else if (arg == "--compressed") options.compressed = true;
+    else {
+      printUsage();
+      return 2;
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<std::unique_ptr<SimDevice>> devices;
+  for (int i = 0; i < options.devices; i++) {
+    devices.emplace_back(new SimDevice(options.compressed));
+    SimDevice& device = *devices.back();
+    device.name = "distance-sim" + std::to_string(i);
+    device.baselineMm = 500.0 + (i * 37) % 2500;
+    device.phase = i * 0.7;
+    device.seed = 0x9E3779B9u * (i + 1);
+  }
+  if (options.pipe) return runPipe(devices);
+
+  for (auto& device : devices) {
+    device->fd = connectDevice();
+    if (device->fd < 0 || !sendHello(device->fd, *device)) {
+      fprintf(stderr, "cannot connect %s to %s:%u: %s\n", device->name.c_str(), options.host.c_str(),
+              options.port, strerror(errno));
+      return 1;
+    }
+  }
+
+  // Start on a whole second so each batch ends exactly on a sample instant
+  uint64_t startMs = monotonicMs() / 1000 * 1000 + 1000;
+  std::this_thread::sleep_for(std::chrono::milliseconds(startMs - monotonicMs()));
+  uint64_t endMs = startMs + options.seconds * 1000ULL;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < options.threads; t++) {
+    std::vector<SimDevice*> share;
+    for (int i = t; i < options.devices; i += options.threads) share.push_back(devices[i].get());
+    threads.emplace_back(runSender, share, startMs, endMs);
+  }
+  for (auto& thread : threads) thread.join();
+
+  double seconds = (monotonicMs() - startMs) / 1000.0;
+  double target = (double)options.devices * options.rateHz;
+  printf("sent %llu samples from %d devices in %.1fs: %.0f samples/s (target %.0f), %llu overruns\n",
+         (unsigned long long)samplesSent.load(), options.devices, seconds, samplesSent / seconds, target,
+         (unsigned long long)overruns.load());
+  for (auto& device : devices) close(device->fd);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+/*********************************************************************************************************
+ * Sample Log Query
+ *
+ * Description:
+ *   Time-range and threshold queries over the logs written by ingest_server. The logs and their sparse
+ *   block indexes are memory-mapped; the index is scanned first and only blocks whose device, time range
+ *   and distance range can match are decoded, straight from the mapping. A week of logs is answered by
+ *   touching the blocks that matter instead of reading everything.
+ *
+ * How It Works:
+ *   1. Open: Every ingest-<n>.col in the directory is mapped with its .idx (rebuilt from the block headers
+ *      if missing or behind the log; --reindex saves the rebuilt one)
+ *   2. Prune: A block is skipped when its device differs, its [first, last] time range misses the query
+ *      range, or (for --below / --above) its valid min/max distance cannot satisfy the threshold
+ *   3. Scan: Surviving blocks are decoded sample by sample and filtered exactly
+ *   4. Output: --stats (default) prints match count, time span and distance summary, --count only the
+ *      count, --print the matching samples as CSV (device,ms,mm,flags,confidence); pruning statistics go
+ *      to stderr
+ *
+ * Notes:
+ *   - --below / --above match valid readings only (flags == 0) and together select a band
+ *   - --no-index decodes every block (of the selected device), as a baseline for the pruning
+ *   - --generate writes a synthetic log of the given size for benchmarks (simulated devices with a daily
+ *     cycle, occasional close approaches and timeouts)
+ *   - Build: g++ -O2 -std=c++17 -o log_query log_query.cpp  (Linux)
+ *
+ **********************************************************************************************************/
+
+/*************************************************************
+******************* INCLUDES & DEFINITIONS *******************
+**************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "ingest_protocol.h"
+#include "column_log.h"
+#include "../../include/sample.h"
+
+#define GENERATE_BLOCK_SAMPLES 4096 // samples per block in synthetic logs (ingest_server default)
+
+enum class OutputMode { STATS, COUNT, PRINT };
+
+struct Query {
+  std::string directory;
+  std::string device;               // name or id, empty = all
+  int64_t deviceId = -1;
+  uint32_t fromMs = 0;
+  uint32_t toMs = UINT32_MAX;
+  uint32_t belowMm = 0;             // 0 = no threshold
+  uint32_t aboveMm = 0;
+  OutputMode mode = OutputMode::STATS;
+  uint64_t limit = UINT64_MAX;      // rows printed
+  bool useIndex = true;
+  bool reindex = false;
+};
+
+struct QueryResult {
+  uint64_t matches = 0;
+  uint64_t validMatches = 0;        // matches that are valid readings (flags == 0)
+  uint64_t sumMm = 0;
+  uint16_t minMm = 0xFFFF;
+  uint16_t maxMm = 0;
+  uint32_t firstMs = 0;
+  uint32_t lastMs = 0;
+  uint64_t blocks = 0;
+  uint64_t blocksDecoded = 0;
+  uint64_t bytesDecoded = 0;
+  uint64_t samplesDecoded = 0;
+  uint64_t logBytes = 0;
+};
+
+/*************************************************************
+********************** HELPER FUNCTIONS **********************
+**************************************************************/
+
+// Function to read devices.txt ("<id> <name>" per line) into a table indexed by id
+static std::vector<std::string> loadDeviceNames(const std::string& directory) {
+  std::vector<std::string> names;
+  FILE* file = fopen((directory + "/devices.txt").c_str(), "r");
+  if (file == nullptr) return names;
+  unsigned id;
+  char name[INGEST_NAME_MAX + 1];
+  while (fscanf(file, "%u %32s", &id, name) == 2) {
+    if (id >= names.size()) names.resize(id + 1);
+    names[id] = name;
+  }
+  fclose(file);
+  return names;
+}
+
+// Function to list the log base paths (without .col) in a directory
+static std::vector<std::string> findLogs(const std::string& directory) {
+  std::vector<std::string> logs;
+  DIR* dir = opendir(directory.c_str());
+  if (dir == nullptr) return logs;
+  while (dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".col") == 0) {
+      logs.push_back(directory + "/" + name.substr(0, name.size() - 4));
+    }
+  }
+  closedir(dir);
+  std::sort(logs.begin(), logs.end());
+  return logs;
+}
+
+// Function to decide from the index alone whether a block can hold a match
+static bool blockMayMatch(const Query& query, const ColumnIndexEntry& entry) {
+  if (query.deviceId >= 0 && entry.deviceId != (uint32_t)query.deviceId) return false;
+  if (entry.lastMs < query.fromMs || entry.firstMs > query.toMs) return false;
+  if (query.belowMm == 0 && query.aboveMm == 0) return true;
+  if (entry.minMm > entry.maxMm) return false;            // no valid readings
+  if (query.belowMm != 0 && entry.minMm >= query.belowMm) return false;
+  if (query.aboveMm != 0 && entry.maxMm <= query.aboveMm) return false;
+  return true;
+}
+
+// Function to test one decoded sample against the query
+static bool sampleMatches(const Query& query, const SampleRecord& record) {
+  if (record.timestampMs < query.fromMs || record.timestampMs > query.toMs) return false;
+  if (query.belowMm == 0 && query.aboveMm == 0) return true;
+  if (record.flags != 0) return false;
+  if (query.belowMm != 0 && record.distanceMm >= query.belowMm) return false;
+  if (query.aboveMm != 0 && record.distanceMm <= query.aboveMm) return false;
+  return true;
+}
+
+/*************************************************************
+*********************** MAIN FUNCTIONS ***********************
+**************************************************************/
+
+// Run a query over every log in the directory
+static bool runQuery(const Query& query, const std::vector<std::string>& names, QueryResult& result) {
+  std::vector<std::string> logs = findLogs(query.directory);
+  if (logs.empty()) {
+    fprintf(stderr, "no logs in %s\n", query.directory.c_str());
+    return false;
+  }
+
+  for (const std::string& base : logs) {
+    ColumnLogReader log;
+    bool rebuilt;
+    if (!log.open(base, rebuilt)) continue;
+    if (rebuilt) {
+      fprintf(stderr, "%s: index rebuilt from block headers\n", base.c_str());
+      if (query.reindex && !log.saveIndex(base)) fprintf(stderr, "%s: cannot save index\n", base.c_str());
+    }
+    result.logBytes += log.logBytes();
+    result.blocks += log.blocks();
+
+    for (size_t i = 0; i < log.blocks(); i++) {
+      const ColumnIndexEntry& entry = log.entry(i);
+      if (query.useIndex ? !blockMayMatch(query, entry)
+                         : query.deviceId >= 0 && entry.deviceId != (uint32_t)query.deviceId) {
+        continue;
+      }
+      result.blocksDecoded++;
+      result.bytesDecoded += entry.bytes;
+      result.samplesDecoded += entry.count;
+
+      bool intact = readColumnBlock(log.header(i), log.body(i), [&](const SampleRecord& record) {
+        if (!sampleMatches(query, record)) return;
+        if (result.matches == 0) result.firstMs = record.timestampMs;
+        result.firstMs = std::min(result.firstMs, record.timestampMs);
+        result.lastMs = std::max(result.lastMs, record.timestampMs);
+        if (record.flags == 0) {
+          result.minMm = std::min(result.minMm, record.distanceMm);
+          result.maxMm = std::max(result.maxMm, record.distanceMm);
+          result.sumMm += record.distanceMm;
+          result.validMatches++;
+        }
+        if (query.mode == OutputMode::PRINT && result.matches < query.limit) {
+          const char* name = entry.deviceId < names.size() ? names[entry.deviceId].c_str() : "?";
+          printf("%s,%u,%u,%u,%u\n", name, record.timestampMs, record.distanceMm, record.flags,
+                 record.confidence);
+        }
+        result.matches++;
+      });
+      if (!intact) fprintf(stderr, "%s: block %zu is damaged\n", base.c_str(), i);
+    }
+  }
+  return true;
+}
+
+// Write a synthetic log of about targetBytes for benchmarks
+static int generateLog(const std::string& directory, uint64_t targetBytes, uint32_t devices, uint32_t rateHz) {
+  mkdir(directory.c_str(), 0755);
+  FILE* file = fopen((directory + "/devices.txt").c_str(), "w");
+  if (file == nullptr) {
+    fprintf(stderr, "cannot write to %s\n", directory.c_str());
+    return 1;
+  }
+  for (uint32_t i = 0; i < devices; i++) fprintf(file, "%u distance-sim%u\n", i, i);
+  fclose(file);
+
+  ColumnLogWriter log;
+  if (!log.open(directory + "/ingest-0")) {
+    fprintf(stderr, "cannot create the log in %s\n", directory.c_str());
+    return 1;
+  }
+
+  // Daily cycle around a per-device baseline, a close approach (< 300mm) about once an hour, 0.5% timeouts
+  std::vector<float> daily(1440);
+  for (size_t m = 0; m < daily.size(); m++) daily[m] = 250.0f * (float)sin(m * 2 * M_PI / 1440.0);
+  std::vector<SampleRecord> block(GENERATE_BLOCK_SAMPLES);
+  std::vector<uint32_t> nextMs(devices, 0);
+  std::vector<uint32_t> approachUntil(devices, 0);
+  uint32_t periodMs = std::max<uint32_t>(1, 1000 / rateHz);
+  uint32_t seed = 12345;
+  auto start = std::chrono::steady_clock::now();
+  uint64_t samples = 0;
+
+  while (!log.failed() && log.bytesWritten() < targetBytes) {
+    for (uint32_t device = 0; device < devices && log.bytesWritten() < targetBytes; device++) {
+      float baseline = 1200.0f + (device * 97) % 1500;
+      uint32_t t = nextMs[device];
+      for (uint32_t i = 0; i < GENERATE_BLOCK_SAMPLES; i++, t += periodMs) {
+        seed = seed * 1103515245u + 12345u;
+        if (seed % (3600000u / periodMs) == 0) approachUntil[device] = t + 3000;
+        float mm = t < approachUntil[device] ? 250.0f : baseline + daily[(t / 60000) % 1440];
+        bool timeout = (seed >> 8) % 200 == 0;
+        block[i].timestampMs = t + (seed >> 20) % 3;
+        block[i].distanceMm = timeout ? 0 : (uint16_t)(mm + (int)((seed >> 12) % 7) - 3);
+        block[i].flags = timeout ? SAMPLE_TIMEOUT : SAMPLE_OK;
+        block[i].confidence = timeout ? 0 : 200;
+      }
+      nextMs[device] = t;
+      log.append(device, block.data(), GENERATE_BLOCK_SAMPLES);
+      samples += GENERATE_BLOCK_SAMPLES;
+    }
+  }
+  if (!log.close()) {
+    fprintf(stderr, "write to %s failed: %s\n", directory.c_str(), strerror(errno));
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("generated %llu samples (%.1f days per device) in %.1fs: %.2f GB, %.2f bytes/sample, %u blocks\n",
+         (unsigned long long)samples, nextMs[0] / 86400000.0, seconds, log.bytesWritten() / 1e9,
+         (double)log.bytesWritten() / samples, log.blocks());
+  return 0;
+}
+
+// Function to print usage
+static void printUsage() {
+  fprintf(stderr,
+    "usage: log_query DIR [--device NAME|ID] [--from MS] [--to MS] [--below MM] [--above MM]\n"
+    "                 [--stats | --count | --print] [--limit N] [--no-index] [--reindex]\n"
+    "       log_query --generate DIR --gb N [--devices N] [--rate HZ]\n");
+}
+
+int main(int argc, char** argv) {
+  Query query;
+  bool generate = false;
+  double generateGb = 1.0;
+  uint32_t generateDevices = 50, generateRate = 10;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--device" && hasValue) query.device = argv[++i];
+    else if (arg == "--from" && hasValue) query.fromMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--to" && hasValue) query.toMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--below" && hasValue) query.belowMm = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--above" && hasValue) query.aboveMm = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--stats") query.mode = OutputMode::STATS;
+    else if (arg == "--count") query.mode = OutputMode::COUNT;
+    else if (arg == "--print") query.mode = OutputMode::PRINT;
+    else if (arg == "--limit" && hasValue) query.limit = strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--no-index") query.useIndex = false;
+    else if (arg == "--reindex") query.reindex = true;
+    else if (arg == "--generate" && hasValue) { generate = true; query.directory = argv[++i]; }
+    else if (arg == "--gb" && hasValue) generateGb = atof(argv[++i]);
+    else if (arg == "--devices" && hasValue) generateDevices = (uint32_t)std::max(1, atoi(argv[++i]));
+    else if (arg == "--rate" && hasValue) generateRate = (uint32_t)std::max(1, atoi(argv[++i]));
+    else if (arg[0] != '-' && query.directory.empty()) query.directory = arg;
+    else {
+      printUsage();
+      return 2;
+    }
+  }
+  if (query.directory.empty()) {
+    printUsage();
+    return 2;
+  }
+  if (generate) return generateLog(query.directory, (uint64_t)(generateGb * 1e9), generateDevices, generateRate);
+
+  std::vector<std::string> names = loadDeviceNames(query.directory);
+  if (!query.device.empty()) {
+    auto found = std::find(names.begin(), names.end(), query.device);
+    if (found != names.end()) query.deviceId = found - names.begin();
+    else if (isdigit((unsigned char)query.device[0])) query.deviceId = atoi(query.device.c_str());
+    else {
+      fprintf(stderr, "unknown device %s\n", query.device.c_str());
+      return 1;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  QueryResult result;
+  if (!runQuery(query, names, result)) return 1;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (query.mode == OutputMode::COUNT) {
+    printf("%llu\n", (unsigned long long)result.matches);
+  }
+  else if (query.mode == OutputMode::STATS) {
+    printf("matches %llu", (unsigned long long)result.matches);
+    if (result.matches > 0) printf(" from %u to %u ms", result.firstMs, result.lastMs);
+    if (result.validMatches > 0) {
+      printf(" distance min %u max %u mean %.1f mm", result.minMm, result.maxMm,
+             (double)result.sumMm / result.validMatches);
+    }
+    printf("\n");
+  }
+  fprintf(stderr, "%llu of %llu blocks decoded (%.2f%%), %.1f MB of %.1f MB, %llu samples in %.3fs\n",
+          (unsigned long long)result.blocksDecoded, (unsigned long long)result.blocks,
+          result.blocks ? 100.0 * result.blocksDecoded / result.blocks : 0.0, result.bytesDecoded / 1e6,
+          result.logBytes / 1e6, (unsigned long long)result.samplesDecoded, seconds);
+  return 0;
+}